@@ -27,7 +27,7 @@ namespace kernel::ia32::paging
 {
 
 IA32_Page_Table::page_table_map IA32_Page_Table::global_page_tables;
-Spinlock IA32_Page_Table::page_table_index_lock;
+RWSpinlock IA32_Page_Table::page_table_index_lock;
 
 void IA32_Page_Table::apply() { setCR3(cr3); }
 
@@ -606,8 +606,7 @@ void IA32_Page_Table::invalidate_tlb(void *page, size_t size)
 
 klib::shared_ptr<IA32_Page_Table> IA32_Page_Table::capture_initial(u32 cr3)
 {
-    klib::shared_ptr<IA32_Page_Table> new_table =
-        klib::unique_ptr<IA32_Page_Table>(new IA32_Page_Table());
+    auto new_table = klib::make_shared<IA32_Page_Table>();
 
     if (!new_table)
         return nullptr;
@@ -1005,7 +1004,7 @@ void IA32_Page_Table::takeout_global_page_tables()
 
 klib::shared_ptr<IA32_Page_Table> IA32_Page_Table::get_page_table(u64 id)
 {
-    Auto_Lock_Scope scope_lock(page_table_index_lock);
+    Shared_Lock_Scope scope_lock(page_table_index_lock);
     auto it = global_page_tables.find(id);
     if (it == global_page_tables.end())
         return nullptr;
@@ -1016,8 +1015,7 @@ void *IA32_Page_Table::user_addr_max() const { return (void *)0xC0000000; }
 
 klib::shared_ptr<IA32_Page_Table> IA32_Page_Table::create_empty(unsigned)
 {
-    klib::shared_ptr<IA32_Page_Table> new_table =
-        klib::unique_ptr<IA32_Page_Table>(new IA32_Page_Table());
+    auto new_table = klib::make_shared<IA32_Page_Table>();
 
     if (!new_table)
         return nullptr;
@@ -47,6 +47,7 @@ u32 memory_type_to_bits(kernel::paging::Memory_Type type);
 
 void pae_clear(u32 *pt, unsigned idx);
 void pae_store_new(u32 *pt, unsigned idx, u64 value);
+void pae_update(u32 *pt, unsigned idx, u64 new_value);
 
 class IA32_Page_Table final: public kernel::paging::Page_Table
 {
@@ -99,7 +100,7 @@ protected:
 
     using page_table_map = pmos::containers::map<u64, klib::weak_ptr<IA32_Page_Table>>;
     static page_table_map global_page_tables;
-    static Spinlock page_table_index_lock;
+    static RWSpinlock page_table_index_lock;
 
     static kresult_t insert_global_page_tables(klib::shared_ptr<IA32_Page_Table> table);
     void takeout_global_page_tables();
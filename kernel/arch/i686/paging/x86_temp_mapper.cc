@@ -25,7 +25,8 @@ kernel::paging::Temp_Mapper *get_temp_temp_mapper(void *addr, u32 kernel_cr3)
 
 x86_2level_Mapper::x86_2level_Mapper(void *virt_addr, u32 cr3)
 {
-    pt_mapped = (u32 *)virt_addr;
+    pt_mapped  = (u32 *)virt_addr;
+    slots_base = (char *)virt_addr;
 
     u32 addr    = (u32)virt_addr;
     start_index = addr / 4096 % 1024;
@@ -44,13 +45,12 @@ x86_2level_Mapper::x86_2level_Mapper(void *virt_addr, u32 cr3)
     entry |= PAGE_PRESENT;
     entry |= PAGE_WRITE;
     pt[start_index] = entry;
-
-    min_index = start_index + 1;
 }
 
 x86_PAE_Temp_Mapper::x86_PAE_Temp_Mapper(void *virt_addr, u32 cr3)
 {
-    pt_mapped = (u32 *)virt_addr;
+    pt_mapped  = (u32 *)virt_addr;
+    slots_base = (char *)virt_addr;
 
     u32 addr    = (u32)virt_addr;
     start_index = addr / 4096 % 512;
@@ -69,89 +69,42 @@ x86_PAE_Temp_Mapper::x86_PAE_Temp_Mapper(void *virt_addr, u32 cr3)
     entry |= PAGE_PRESENT;
     entry |= PAGE_WRITE;
     pae_store_new(pdpt, start_index, entry);
-
-    min_index = start_index + 1;
 }
 
-void *x86_2level_Mapper::kern_map(u64 phys_frame)
+void x86_2level_Mapper::set_entry(unsigned slot, u64 phys_frame)
 {
     assert(!(phys_frame >> 32));
-    for (unsigned i = min_index; i < start_index + size; ++i) {
-        if (not(pt_mapped[i] & PAGE_PRESENT)) {
-            u32 entry = 0;
-            entry |= phys_frame;
-            entry |= PAGE_PRESENT;
-            entry |= PAGE_WRITE;
-            pt_mapped[i] = entry;
-
-            min_index = i + 1;
-
-            char *t = (char *)pt_mapped;
-            t += (i - start_index) * 4096;
 
-            return (void *)t;
-        }
-    }
-
-    return nullptr;
+    u32 entry = 0;
+    entry |= phys_frame;
+    entry |= PAGE_PRESENT;
+    entry |= PAGE_WRITE;
+    pt_mapped[start_index + slot] = entry;
 }
 
-void x86_2level_Mapper::return_map(void *p)
-{
-    if (p == nullptr)
-        return;
-
-    u64 i          = (u64)p;
-    unsigned index = temp_mapper_get_index(i);
-
-    pt_mapped[index] = 0;
-    if (index < min_index)
-        min_index = index;
+void x86_2level_Mapper::clear_entry(unsigned slot) { pt_mapped[start_index + slot] = 0; }
 
-    invlpg(p);
-}
+void x86_2level_Mapper::invalidate(void *virt_addr) { invlpg(virt_addr); }
 
-u32 x86_2level_Mapper::temp_mapper_get_index(u32 addr) { return (addr / 4096) % 1024; }
-
-void *x86_PAE_Temp_Mapper::kern_map(u64 phys_frame)
+void x86_PAE_Temp_Mapper::set_entry(unsigned slot, u64 phys_frame)
 {
     assert(!(phys_frame & 0xfff));
-    for (unsigned i = min_index; i < start_index + size; ++i) {
-        if (not(pt_mapped[i] & PAGE_PRESENT)) {
-            pae_entry_t entry = 0;
-            entry |= phys_frame;
-            entry |= PAGE_PRESENT;
-            entry |= PAGE_WRITE;
-            pae_store_new(pt_mapped, i, entry);
-
-            min_index = i + 1;
-
-            char *t = (char *)pt_mapped;
-            t += (i - start_index) * 4096;
 
-            return (void *)t;
-        }
-    }
+    pae_entry_t entry = 0;
+    entry |= phys_frame;
+    entry |= PAGE_PRESENT;
+    entry |= PAGE_WRITE;
 
-    return nullptr;
+    // The slot is still mapped when remapping, so both halves can't be stored in any order
+    if (pt_mapped[(start_index + slot) * 2] & PAGE_PRESENT)
+        pae_update(pt_mapped, start_index + slot, entry);
+    else
+        pae_store_new(pt_mapped, start_index + slot, entry);
 }
 
-void x86_PAE_Temp_Mapper::return_map(void *p)
-{
-    if (p == nullptr)
-        return;
-
-    u32 i          = (u64)p;
-    unsigned index = temp_mapper_get_index(i);
-
-    pae_clear(pt_mapped, index);
-    if (index < min_index)
-        min_index = index;
-
-    invlpg(p);
-}
+void x86_PAE_Temp_Mapper::clear_entry(unsigned slot) { pae_clear(pt_mapped, start_index + slot); }
 
-u32 x86_PAE_Temp_Mapper::temp_mapper_get_index(u32 addr) { return (addr / 4096) % 512; }
+void x86_PAE_Temp_Mapper::invalidate(void *virt_addr) { invlpg(virt_addr); }
 
 } // namespace kernel::ia32::paging
 
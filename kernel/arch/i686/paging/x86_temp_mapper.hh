@@ -8,40 +8,36 @@ namespace kernel::ia32::paging
  * @brief Temp_Mapper for PAE
  *
  */
-class x86_PAE_Temp_Mapper final: public kernel::paging::Temp_Mapper
+class x86_PAE_Temp_Mapper final: public kernel::paging::Slot_Temp_Mapper
 {
 public:
-    virtual void *kern_map(u64 phys_frame) override;
-    virtual void return_map(void *) override;
-
     constexpr x86_PAE_Temp_Mapper() = default;
     x86_PAE_Temp_Mapper(void *virt_addr, u32 cr3);
 
-private:
-    u32 *pt_mapped                 = nullptr;
-    unsigned start_index           = 0;
-    unsigned min_index             = 1;
-    constexpr static unsigned size = 16;
+protected:
+    virtual void set_entry(unsigned slot, u64 phys_frame) override;
+    virtual void clear_entry(unsigned slot) override;
+    virtual void invalidate(void *virt_addr) override;
 
-    static u32 temp_mapper_get_index(u32 addr);
+private:
+    u32 *pt_mapped       = nullptr;
+    unsigned start_index = 0;
 };
 
-class x86_2level_Mapper final: public kernel::paging::Temp_Mapper
+class x86_2level_Mapper final: public kernel::paging::Slot_Temp_Mapper
 {
 public:
-    virtual void *kern_map(u64 phys_frame) override;
-    virtual void return_map(void *) override;
-
     constexpr x86_2level_Mapper() = default;
     x86_2level_Mapper(void *virt_addr, u32 cr3);
 
-private:
-    u32 *pt_mapped                 = nullptr;
-    unsigned start_index           = 0;
-    unsigned min_index             = 1;
-    constexpr static unsigned size = 16;
+protected:
+    virtual void set_entry(unsigned slot, u64 phys_frame) override;
+    virtual void clear_entry(unsigned slot) override;
+    virtual void invalidate(void *virt_addr) override;
 
-    static u32 temp_mapper_get_index(u32 addr);
+private:
+    u32 *pt_mapped       = nullptr;
+    unsigned start_index = 0;
 };
 
 } // namespace kernel::ia32::paging
@@ -9,6 +9,11 @@ class LoongArch64TempMapper final: public kernel::paging::Temp_Mapper
 public:
     virtual void *kern_map(u64 phys_frame) override;
     virtual void return_map(void *) override;
+    // Everything is in the direct map window, so there is nothing to set up
+    virtual void *remap(void *, u64 phys_frame) override { return kern_map(phys_frame); }
+    virtual void *kern_map_window(u64 phys_frame, size_t) override { return kern_map(phys_frame); }
+    virtual void return_map_window(void *, size_t) override {}
+    virtual size_t max_window_pages() const override { return -1UL; }
 };
 
 extern LoongArch64TempMapper temp_mapper;
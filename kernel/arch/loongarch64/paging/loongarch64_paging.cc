@@ -195,8 +195,7 @@ kresult_t loongarch_map_page(u64 pt_top_phys, void *virt_addr, u64 phys_addr,
 
 klib::shared_ptr<LoongArch64_Page_Table> LoongArch64_Page_Table::create_empty(int flags)
 {
-    klib::shared_ptr<LoongArch64_Page_Table> new_table =
-        klib::unique_ptr<LoongArch64_Page_Table>(new LoongArch64_Page_Table(flags));
+    auto new_table = klib::make_shared<LoongArch64_Page_Table>(flags);
     if (!new_table)
         return nullptr;
 
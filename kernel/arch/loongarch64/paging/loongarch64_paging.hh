@@ -115,6 +115,7 @@ public:
 protected:
     LoongArch64_Page_Table() = default;
     LoongArch64_Page_Table(int flags): flags(flags) {}
+    template<class T, class... Args> friend klib::shared_ptr<T> klib::make_shared(Args &&...);
 
     static constexpr u64 PAGE_DIRECTORY_INITIALIZER = -1UL;
 
@@ -68,7 +68,6 @@ struct BIOPIC: ExtIntC {
 struct PICAllocation: InterruptHandler {
     ExtIntC *controller   = nullptr;
     u32 controller_vector = 0;
-    bool edge_triggered   = false;
 };
 
 constexpr size_t INTERRUPT_MAPPINGS_SIZE = 256;
@@ -113,14 +112,13 @@ constexpr unsigned EXT_IOImap_Core0   = 0x1C00;
 constexpr unsigned perCore_EXT_IOI    = 0x1800;
 
 static Spinlock interrupts_lock;
-void interrupts::interrupt_enable(InterruptHandler *handler)
-{
-    auto h = static_cast<PICAllocation *>(handler);
 
-    Auto_Lock_Scope l(interrupts_lock);
+// Routes the interrupt to its parent_cpu and enables it. interrupts_lock must be held.
+static void route_and_enable(PICAllocation *h)
+{
+    assert(interrupts_lock.is_locked());
     auto c = h->parent_cpu;
     auto i = h - &c->parent_eiopic->interrupt_mappings[0];
-    assert(h->parent_cpu == get_cpu_struct());
 
     switch (interrupt_model) {
     // case IntControllerClass::LIOPIC: {
@@ -158,6 +156,34 @@ void interrupts::interrupt_enable(InterruptHandler *handler)
     }
 }
 
+void interrupts::interrupt_enable(InterruptHandler *handler)
+{
+    auto h = static_cast<PICAllocation *>(handler);
+    assert(h->parent_cpu == get_cpu_struct());
+
+    Auto_Lock_Scope l(interrupts_lock);
+    route_and_enable(h);
+}
+
+kresult_t interrupts::interrupt_set_cpu(InterruptHandler *handler, CPU_Info *cpu, bool enable)
+{
+    auto h = static_cast<PICAllocation *>(handler);
+    assert(cpu);
+
+    // The mapping belongs to the EIOPIC of the node, and the other ones don't know about it
+    if (cpu->parent_eiopic != h->parent_cpu->parent_eiopic)
+        return -EXDEV;
+
+    Auto_Lock_Scope l(interrupts_lock);
+    h->parent_cpu->allocated_int_count--;
+    cpu->allocated_int_count++;
+    h->parent_cpu = cpu;
+
+    if (enable)
+        route_and_enable(h);
+    return 0;
+}
+
 void interrupts::interrupt_complete(InterruptHandler *handler)
 {
     auto h = static_cast<PICAllocation *>(handler);
@@ -476,10 +502,18 @@ ReturnStr<InterruptHandler *> interrupts::allocate_or_get_handler(u32 gsi, bool
     biopic->set_mapping(gsi, idx, cpu, edge_triggered);
 
     cpu->allocated_int_count++;
+    register_interrupt_handler(&interrupt_mappings[idx], gsi);
 
     return &interrupt_mappings[idx];
 }
 
+// TODO: The MSI controller of the 7A bridge
+ReturnStr<InterruptHandler *> interrupts::allocate_msi_handler(CPU_Info *) { return Error(-ENOTSUP); }
+
+kresult_t interrupts::get_msi_message(InterruptHandler *, u64 &, u32 &) { return -ENOTSUP; }
+
+void interrupts::free_msi_handler(InterruptHandler *) { assert(!"No MSIs are allocated"); }
+
 u32 get_irq(unsigned sector)
 {
     switch (interrupt_model) {
@@ -536,7 +570,10 @@ void handle_hardware_interrupt(u32 estat)
     csrxchg32<loongarch::csr::ECFG>(0, 1 << (sector + 2));
 
     // Send the interrupt
-    if (mapping.send_interrupt_notification() != NotificationResult::Success) {
+    auto result = mapping.send_interrupt_notification();
+    if (result == NotificationResult::Completed) {
+        interrupt_complete(&mapping);
+    } else if (result != NotificationResult::Success) {
         interrupt_disable(&mapping);
         interrupt_complete(&mapping);
     }
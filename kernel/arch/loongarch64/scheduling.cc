@@ -136,6 +136,15 @@ void prepare_cpu(u32 phys_id)
 
 void halt() { asm volatile("idle 0"); }
 
+void idle_wait() { halt(); }
+
+// CRMD.IE
+static constexpr u32 CRMD_IE = 1 << 2;
+
+ulong disable_interrupts() { return csrxchg32<loongarch::csr::CRMD>(0, CRMD_IE); }
+
+void restore_interrupts(ulong flags) { csrxchg32<loongarch::csr::CRMD>(flags, CRMD_IE); }
+
 static bool have_online_capable_bit = false;
 static void setup_online_capable()
 {
@@ -248,9 +257,18 @@ void start_aps()
     }
 }
 
+namespace kernel::sched
+{
+// TODO: Parse PPTT
+void detect_cpu_topology() { init_flat_topology(); }
+} // namespace kernel::sched
+
 void init_smp()
 {
     init_smp_acpi();
 
+    detect_cpu_topology();
+    print_cpu_topology();
+
     start_aps();
 }
\ No newline at end of file
@@ -27,4 +27,22 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-void halt() { asm volatile("wfi"); }
\ No newline at end of file
+#include <types.hh>
+
+void halt() { asm volatile("wfi"); }
+
+void idle_wait() { halt(); }
+
+ulong disable_interrupts()
+{
+    ulong sstatus;
+    // SIE
+    asm volatile("csrrci %0, sstatus, 2" : "=r"(sstatus)::"memory");
+    return sstatus;
+}
+
+void restore_interrupts(ulong flags)
+{
+    if (flags & 2)
+        asm volatile("csrsi sstatus, 2" ::: "memory");
+}
@@ -300,7 +300,10 @@ void plic_service_interrupt()
         return;
     }
 
-    if (handler->send_interrupt_notification() != kernel::interrupts::NotificationResult::Success) {
+    auto result = handler->send_interrupt_notification();
+    if (result == kernel::interrupts::NotificationResult::Completed) {
+        kernel::interrupts::interrupt_complete(handler);
+    } else if (result != kernel::interrupts::NotificationResult::Success) {
         auto plic = get_plic(irq);
         if (!plic)
             panic("No PLIC found for interrupt %d", irq);
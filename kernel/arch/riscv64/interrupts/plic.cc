@@ -185,11 +185,15 @@ void init_plic()
 }
 
 void plic_interrupt_enable(const PLIC &plic, u32 interrupt_id)
+{
+    plic_interrupt_enable_for(plic, interrupt_id, sched::get_cpu_struct());
+}
+
+void plic_interrupt_enable_for(const PLIC &plic, u32 interrupt_id, const sched::CPU_Info *c)
 {
     // Set priority 1 (will do for now)
     plic_set_priority(interrupt_id, 1);
 
-    const auto c         = sched::get_cpu_struct();
     const u16 context_id = c->eic_id & 0xffff;
 
     const u32 offset =
@@ -316,9 +320,42 @@ ReturnStr<interrupts::InterruptHandler *> interrupts::allocate_or_get_handler(u3
     // Do relaxed atomic store here so that there is no room for the compiler to do
     // since the interrupt handler doesn't take locks when reading this.
     __atomic_store_n(&plic->handlers[offset], handler.get(), __ATOMIC_RELAXED);
+    register_interrupt_handler(handler.get(), gsi);
     return Success(handler.release());
 }
 
+kresult_t interrupts::interrupt_set_cpu(InterruptHandler *handler, sched::CPU_Info *cpu, bool enable)
+{
+    assert(handler);
+    assert(cpu);
+    auto plic_handler = static_cast<riscv::interrupts::PLICHandler *>(handler);
+    assert(plic_handler->parent_plic);
+
+    // The enable bits are per hart context, and the old one has been cleared by
+    // interrupt_disable()
+    {
+        Auto_Lock_Scope l(lock);
+        handler->parent_cpu->allocated_int_count--;
+        cpu->allocated_int_count++;
+        handler->parent_cpu = cpu;
+    }
+
+    if (enable)
+        riscv::interrupts::plic_interrupt_enable_for(*plic_handler->parent_plic,
+                                                     plic_handler->interrupt_id, cpu);
+    return 0;
+}
+
+// TODO: IMSIC
+ReturnStr<interrupts::InterruptHandler *> interrupts::allocate_msi_handler(sched::CPU_Info *)
+{
+    return Error(-ENOTSUP);
+}
+
+kresult_t kernel::interrupts::get_msi_message(InterruptHandler *, u64 &, u32 &) { return -ENOTSUP; }
+
+void kernel::interrupts::free_msi_handler(InterruptHandler *) { assert(!"No MSIs are allocated"); }
+
 void kernel::interrupts::interrupt_disable(InterruptHandler *handler)
 {
     assert(handler);
@@ -46,6 +46,8 @@ u32 plic_interrupt_limit();
 
 // Enable interrupt for the current hart
 void plic_interrupt_enable(const PLIC &plic, u32 interrupt_id);
+// Enable interrupt for the given hart
+void plic_interrupt_enable_for(const PLIC &plic, u32 interrupt_id, const sched::CPU_Info *c);
 void plic_interrupt_disable(const PLIC &plic, u32 interrupt_id);
 
 // Sets the priority threshold for the current hart
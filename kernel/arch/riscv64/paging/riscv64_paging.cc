@@ -538,13 +538,13 @@ u64 get_current_hart_pt() noexcept
 void RISCV64_Page_Table::takeout_global_page_tables()
 {
     Auto_Lock_Scope local_lock(page_table_index_lock);
-    global_page_tables.erase_if_exists(this->id);
+    global_page_tables.erase(this->id);
 }
 
 kresult_t RISCV64_Page_Table::insert_global_page_tables(klib::shared_ptr<RISCV64_Page_Table> table)
 {
     Auto_Lock_Scope local_lock(page_table_index_lock);
-    auto ret = global_page_tables.insert({table->id, table});
+    auto ret = global_page_tables.insert_noexcept({table->id, table});
     if (ret.first == global_page_tables.end())
         return -ENOMEM;
 
@@ -552,7 +552,7 @@ kresult_t RISCV64_Page_Table::insert_global_page_tables(klib::shared_ptr<RISCV64
 }
 
 RISCV64_Page_Table::page_table_map RISCV64_Page_Table::global_page_tables;
-Spinlock RISCV64_Page_Table::page_table_index_lock;
+RWSpinlock RISCV64_Page_Table::page_table_index_lock;
 
 void RISCV64_Page_Table::atomic_active_sum(u64 i) noexcept
 {
@@ -563,8 +563,11 @@ void RISCV64_Page_Table::apply() noexcept { apply_page_table(table_root); }
 
 klib::shared_ptr<RISCV64_Page_Table> RISCV64_Page_Table::get_page_table(u64 id) noexcept
 {
-    Auto_Lock_Scope scope_lock(page_table_index_lock);
-    return global_page_tables.get_copy_or_default(id).lock();
+    Shared_Lock_Scope scope_lock(page_table_index_lock);
+    auto it = global_page_tables.find(id);
+    if (it == global_page_tables.end())
+        return nullptr;
+    return it->second.lock();
 }
 
 klib::shared_ptr<RISCV64_Page_Table> RISCV64_Page_Table::create_clone()
@@ -620,8 +623,7 @@ klib::shared_ptr<RISCV64_Page_Table> RISCV64_Page_Table::create_clone()
 
 klib::shared_ptr<RISCV64_Page_Table> RISCV64_Page_Table::capture_initial(u64 root)
 {
-    klib::shared_ptr<RISCV64_Page_Table> new_table =
-        klib::unique_ptr<RISCV64_Page_Table>(new RISCV64_Page_Table());
+    auto new_table = klib::make_shared<RISCV64_Page_Table>();
 
     if (!new_table)
         return nullptr;
@@ -713,8 +715,7 @@ klib::shared_ptr<RISCV64_Page_Table> RISCV64_Page_Table::create_empty(int flags)
 {
     // TODO: Support 32 bit userspace as well??
 
-    klib::shared_ptr<RISCV64_Page_Table> new_table =
-        klib::unique_ptr<RISCV64_Page_Table>(new RISCV64_Page_Table());
+    auto new_table = klib::make_shared<RISCV64_Page_Table>();
 
     auto n = pmm::get_memory_for_kernel(1);
     if (pmm::alloc_failure(new_table->table_root))
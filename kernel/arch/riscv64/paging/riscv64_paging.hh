@@ -29,6 +29,7 @@
 
 #pragma once
 #include <memory/paging.hh>
+#include <pmos/containers/map.hh>
 #include <types.hh>
 
 namespace kernel::paging
@@ -237,6 +238,7 @@ protected:
     u64 table_root = 0;
 
     RISCV64_Page_Table() = default;
+    template<class T, class... Args> friend klib::shared_ptr<T> klib::make_shared(Args &&...);
 
     static kresult_t copy_to_recursive(const klib::shared_ptr<Page_Table> &to, u64 phys_page_level,
                                        u64 start, u64 to_offset, u64 max_size, u64 new_access,
@@ -254,12 +256,11 @@ private:
     /// @brief Takes out this page table from the map of the page tables
     void takeout_global_page_tables();
 
-    using page_table_map = klib::splay_tree_map<u64, klib::weak_ptr<RISCV64_Page_Table>>;
-    /// @brief Map holding all the page tables. Currently using splay tree for
-    /// the storage
-    /// @todo Consider AVL or Red-Black tree instead for better concurrency
+    using page_table_map = pmos::containers::map<u64, klib::weak_ptr<RISCV64_Page_Table>>;
+    /// @brief Map holding all the page tables. The lookups don't modify the tree, so they only
+    /// need the shared lock
     static page_table_map global_page_tables;
-    static Spinlock page_table_index_lock;
+    static RWSpinlock page_table_index_lock;
 
     /// Counter of how many Harts have this page table active
     u64 active_counter = 0;
@@ -39,7 +39,8 @@ namespace kernel::riscv64::paging
 
 RISCV64_Temp_Mapper::RISCV64_Temp_Mapper(void *virt_addr, u64 pt_ptr)
 {
-    pt_mapped = (RISCV64_PTE *)virt_addr;
+    pt_mapped  = (RISCV64_PTE *)virt_addr;
+    slots_base = (char *)virt_addr;
 
     u64 addr    = (u64)virt_addr;
     start_index = addr / 4096 % 512;
@@ -59,52 +60,24 @@ RISCV64_Temp_Mapper::RISCV64_Temp_Mapper(void *virt_addr, u64 pt_ptr)
     pte.writeable   = true;
     pte.ppn         = leaf_pt_phys.val >> 12;
     pt[start_index] = pte;
-
-    min_index = start_index + 1;
 }
 
-void *RISCV64_Temp_Mapper::kern_map(u64 phys_frame)
+void RISCV64_Temp_Mapper::set_entry(unsigned slot, u64 phys_frame)
 {
-    for (unsigned i = min_index; i < start_index + size; ++i) {
-        if (not pt_mapped[i].valid) {
-            RISCV64_PTE pte = RISCV64_PTE();
-            pte.valid       = true;
-            pte.readable    = true;
-            pte.writeable   = true;
-            pte.ppn         = phys_frame >> 12;
-            pt_mapped[i]    = pte;
-
-            min_index = i + 1;
-            char *t   = (char *)pt_mapped;
-            t += (i - start_index) * 4096;
-
-            // I've seen somewhere in RISC-V spec that the implementations
-            // may cache the unmapped entries as well, so flush here wouldn't
-            // hurt
-            flush_page((void *)t);
-
-            return (void *)t;
-        }
-    }
+    RISCV64_PTE pte = RISCV64_PTE();
+    pte.valid       = true;
+    pte.readable    = true;
+    pte.writeable   = true;
+    pte.ppn         = phys_frame >> 12;
 
-    return nullptr;
+    pt_mapped[start_index + slot] = pte;
 }
 
-static u64 temp_mapper_get_index(u64 addr) { return (addr / 4096) % 512; }
-
-void RISCV64_Temp_Mapper::return_map(void *p)
+void RISCV64_Temp_Mapper::clear_entry(unsigned slot)
 {
-    if (p == nullptr)
-        return;
-
-    u64 i          = (u64)p;
-    unsigned index = temp_mapper_get_index(i);
-
-    pt_mapped[index] = RISCV64_PTE();
-    if (index < min_index)
-        min_index = index;
-
-    flush_page(p);
+    pt_mapped[start_index + slot] = RISCV64_PTE();
 }
 
+void RISCV64_Temp_Mapper::invalidate(void *virt_addr) { flush_page(virt_addr); }
+
 } // namespace kernel::riscv64::paging
\ No newline at end of file
@@ -40,21 +40,23 @@ struct RISCV64_PTE;
  * @brief Temp_Mapper for x86_64 CPUs
  *
  */
-class RISCV64_Temp_Mapper final: public kernel::paging::Temp_Mapper
+class RISCV64_Temp_Mapper final: public kernel::paging::Slot_Temp_Mapper
 {
 public:
-    virtual void *kern_map(u64 phys_frame) override;
-    virtual void return_map(void *) override;
-
     constexpr RISCV64_Temp_Mapper() = default;
     RISCV64_Temp_Mapper(void *virt_addr, u64 pt_ptr);
 
+protected:
+    virtual void set_entry(unsigned slot, u64 phys_frame) override;
+    virtual void clear_entry(unsigned slot) override;
+    virtual void invalidate(void *virt_addr) override;
+    // I've seen somewhere in RISC-V spec that the implementations may cache the unmapped entries
+    // as well, so flush here wouldn't hurt
+    virtual bool caches_invalid_entries() const override { return true; }
+
 private:
-    RISCV64_PTE *pt_mapped         = nullptr;
-    unsigned max_index             = 0;
-    unsigned start_index           = 0;
-    unsigned min_index             = 1;
-    constexpr static unsigned size = 16;
+    RISCV64_PTE *pt_mapped = nullptr;
+    unsigned start_index   = 0;
 };
 
 } // namespace kernel::riscv64::paging
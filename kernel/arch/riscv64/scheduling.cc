@@ -605,11 +605,129 @@ void start_aps()
     }
 }
 
+static bool node_name_starts_with(dtb_node *node, const char *prefix)
+{
+    dtb_node_stat stat;
+    dtb_stat_node(node, &stat);
+    if (!stat.name)
+        return false;
+
+    for (const char *p = stat.name; *prefix; ++p, ++prefix)
+        if (*p != *prefix)
+            return false;
+    return true;
+}
+
+static CPU_Info *find_cpu_by_phandle(size_t phandle)
+{
+    auto node = dtb_find_phandle(phandle);
+    if (!node)
+        return nullptr;
+
+    auto prop = dtb_find_prop(node, "reg");
+    if (!prop)
+        return nullptr;
+
+    size_t hart_id = 0;
+    dtb_read_prop_values(prop, 1, &hart_id);
+
+    for (auto c: cpus)
+        if (c->hart_id == hart_id)
+            return c;
+    return nullptr;
+}
+
+struct CPUMapState {
+    u32 package = 0;
+    u32 cluster = 0;
+    u32 core    = 0;
+    u32 thread  = 0;
+    bool found  = false;
+};
+
+// Walks the /cpus/cpu-map node, as described in the Linux devicetree bindings. Every cluster is
+// assumed to share the last level cache.
+static void walk_cpu_map(dtb_node *node, CPUMapState &state)
+{
+    for (auto child = dtb_get_child(node); child; child = dtb_get_sibling(child)) {
+        if (node_name_starts_with(child, "socket")) {
+            walk_cpu_map(child, state);
+            ++state.package;
+        } else if (node_name_starts_with(child, "cluster")) {
+            walk_cpu_map(child, state);
+            ++state.cluster;
+        } else if (node_name_starts_with(child, "core")) {
+            state.thread = 0;
+            walk_cpu_map(child, state);
+            ++state.core;
+        } else if (node_name_starts_with(child, "thread")) {
+            walk_cpu_map(child, state);
+            ++state.thread;
+        }
+    }
+
+    auto prop = dtb_find_prop(node, "cpu");
+    if (!prop)
+        return;
+
+    size_t phandle = 0;
+    if (dtb_read_prop_values(prop, 1, &phandle) != 1)
+        return;
+
+    auto c = find_cpu_by_phandle(phandle);
+    if (!c)
+        return;
+
+    c->topology.package_id = state.package;
+    c->topology.core_id    = state.core;
+    c->topology.thread_id  = state.thread;
+    c->topology.cache_id   = state.cluster;
+    state.found            = true;
+}
+
+namespace kernel::sched
+{
+void detect_cpu_topology()
+{
+    // Every CPU not described by the cpu-map is left as its own core
+    init_flat_topology();
+
+    if (not have_dtb())
+        return;
+
+    auto cpu_map = dtb_find("/cpus/cpu-map");
+    if (!cpu_map)
+        return;
+
+    // IDs coming from the cpu-map may overlap with the ones from the flat topology
+    for (auto c: cpus)
+        c->topology.core_id = -1;
+
+    CPUMapState state;
+    walk_cpu_map(cpu_map, state);
+    if (!state.found) {
+        init_flat_topology();
+        return;
+    }
+
+    // Give the CPUs missing from the map unique cores
+    u32 next_core = state.core;
+    for (auto c: cpus)
+        if (c->topology.core_id == (u32)-1) {
+            c->topology.core_id  = next_core++;
+            c->topology.cache_id = state.cluster + 1;
+        }
+}
+} // namespace kernel::sched
+
 void init_smp()
 {
     init_smp_acpi();
     // TODO: FDT
 
+    detect_cpu_topology();
+    print_cpu_topology();
+
     start_aps();
 }
 
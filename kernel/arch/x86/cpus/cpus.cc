@@ -472,6 +472,9 @@ void init_smp()
         }
     }
 
+    detect_cpu_topology();
+    print_cpu_topology();
+
     smp_wake_everyone_else_up();
 }
 
@@ -605,9 +608,12 @@ void x86_detect_max_phys_addr()
     serial_logger.printf("Phys address length: %u bits\n", max_memory_bits);
 }
 
+void detect_mwait();
+
 void early_detect_cpu_features()
 {
     x86_detect_max_phys_addr();
+    detect_mwait();
 }
 
 namespace kernel::paging {
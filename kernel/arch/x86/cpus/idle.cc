@@ -0,0 +1,84 @@
+#include "ipi.hh"
+
+#include <interrupts/apic.hh>
+#include <kern_logger/kern_logger.hh>
+#include <processes/idle.hh>
+#include <sched/sched.hh>
+#include <x86_utils.hh>
+
+using namespace kernel::sched;
+
+namespace
+{
+
+constexpr u32 CPUID_FEATURES      = 0x01;
+constexpr u32 CPUID_MONITOR_MWAIT = 0x05;
+
+constexpr u32 CPUID_1_ECX_MONITOR   = 1 << 3;
+constexpr u32 CPUID_5_ECX_EMX       = 1 << 0;
+constexpr u32 CPUID_5_ECX_INT_BREAK = 1 << 1;
+
+// Makes MWAIT return on interrupts even if they are masked
+constexpr u32 MWAIT_ECX_INTERRUPT_BREAK = 1 << 0;
+
+// C1. Deeper states save more power, but take longer to wake up from, which is what this is trying
+// to avoid in the first place
+constexpr u32 MWAIT_HINT_C1 = 0;
+
+bool mwait_supported = false;
+
+inline void monitor(const void *addr)
+{
+    asm volatile("monitor" ::"a"(addr), "c"(0), "d"(0));
+}
+
+inline void mwait(u32 hint, u32 extensions)
+{
+    asm volatile("mwait" ::"a"(hint), "c"(extensions) : "memory");
+}
+
+} // namespace
+
+void detect_mwait()
+{
+    if (cpuid(0).eax < CPUID_MONITOR_MWAIT)
+        return;
+
+    if (!(cpuid(CPUID_FEATURES).ecx & CPUID_1_ECX_MONITOR))
+        return;
+
+    // Interrupts must be masked while going to sleep, so that the CPU can't be switched away from
+    // the idle task with idle_polling set. Without the interrupt break-event, MWAIT can't be used.
+    auto leaf = cpuid(CPUID_MONITOR_MWAIT);
+    if (!(leaf.ecx & CPUID_5_ECX_EMX) or !(leaf.ecx & CPUID_5_ECX_INT_BREAK))
+        return;
+
+    mwait_supported = true;
+    kernel::log::serial_logger.printf("Using MWAIT for idle\n");
+}
+
+void idle_wait()
+{
+    if (!mwait_supported) {
+        halt();
+        return;
+    }
+
+    auto c = get_cpu_struct();
+
+    asm volatile("cli");
+    // The IPIs are elided from this point, so ipi_mask must be checked after arming the monitor
+    __atomic_store_n(&c->idle_polling, true, __ATOMIC_SEQ_CST);
+    monitor(&c->ipi_mask);
+    if (!(__atomic_load_n(&c->ipi_mask, __ATOMIC_SEQ_CST) & CPU_Info::ipi_pollable_mask))
+        mwait(MWAIT_HINT_C1, MWAIT_ECX_INTERRUPT_BREAK);
+    __atomic_store_n(&c->idle_polling, false, __ATOMIC_SEQ_CST);
+
+    // Woken up by the memory write instead of the interrupt. The reschedule has to happen on the
+    // interrupt path (software interrupts are taken as system calls with FRED), so post the IPI to
+    // self, which is delivered as soon as the interrupts are unmasked.
+    if (__atomic_load_n(&c->ipi_mask, __ATOMIC_ACQUIRE) & CPU_Info::ipi_pollable_mask)
+        kernel::x86::interrupts::lapic::send_ipi_fixed(ipi_reschedule_int_vec, c->lapic_id);
+
+    asm volatile("sti");
+}
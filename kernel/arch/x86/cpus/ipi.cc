@@ -52,6 +52,11 @@ void ipi_invalidate_tlb_routine()
         if (val & CPU_Info::IPI_CPU_PARK)
             park_self();
     }
+
+    if (val & CPU_Info::IPI_GET_ATTENTION) {
+        __atomic_and_fetch(&c->ipi_mask, ~CPU_Info::IPI_GET_ATTENTION, __ATOMIC_SEQ_CST);
+        get_attention();
+    }
     apic_eoi();
 }
 
@@ -59,12 +64,21 @@ void signal_tlb_shootdown() { send_ipi_fixed_others(ipi_invalidate_tlb_int_vec);
 
 void reschedule_isr()
 {
+    auto c = get_cpu_struct();
+
+    u32 m = __atomic_fetch_and(&c->ipi_mask, ~CPU_Info::ipi_pollable_mask, __ATOMIC_SEQ_CST);
+    if (m & CPU_Info::IPI_GET_ATTENTION)
+        get_attention();
+
     reschedule();
     apic_eoi();
 }
 
-void CPU_Info::ipi_reschedule() { 
-    send_ipi_fixed(ipi_reschedule_int_vec, lapic_id);
+void CPU_Info::ipi_reschedule()
+{
+    __atomic_or_fetch(&ipi_mask, IPI_RESCHEDULE, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&idle_polling, __ATOMIC_SEQ_CST))
+        send_ipi_fixed(ipi_reschedule_int_vec, lapic_id);
 }
 
 void CPU_Info::ipi_tlb_shootdown()
@@ -81,6 +95,7 @@ void CPU_Info::ipi_cpu_park()
 
 void CPU_Info::ipi_get_attention()
 {
-    __atomic_or_fetch(&ipi_mask, IPI_GET_ATTENTION, __ATOMIC_RELEASE);
-    send_ipi_fixed(ipi_invalidate_tlb_int_vec, lapic_id);
+    __atomic_or_fetch(&ipi_mask, IPI_GET_ATTENTION, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&idle_polling, __ATOMIC_SEQ_CST))
+        send_ipi_fixed(ipi_invalidate_tlb_int_vec, lapic_id);
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include <kern_logger/kern_logger.hh>
+#include <sched/sched.hh>
+#include <sched/topology.hh>
+#include <x86_utils.hh>
+
+using namespace kernel::log;
+
+namespace kernel::sched
+{
+
+namespace
+{
+
+constexpr u32 CPUID_EXTENDED_TOPOLOGY    = 0x0B;
+constexpr u32 CPUID_V2_EXTENDED_TOPOLOGY = 0x1F;
+constexpr u32 CPUID_INTEL_CACHE_PARAMS   = 0x04;
+constexpr u32 CPUID_AMD_CACHE_PARAMS     = 0x8000001D;
+
+constexpr u32 TOPOLOGY_LEVEL_INVALID = 0;
+constexpr u32 TOPOLOGY_LEVEL_SMT     = 1;
+
+constexpr u32 CACHE_TYPE_NULL = 0;
+
+// Number of bits needed to represent count distinct values
+u32 bits_for(u32 count)
+{
+    if (count <= 1)
+        return 0;
+    return 32 - __builtin_clz(count - 1);
+}
+
+bool is_amd()
+{
+    auto c = cpuid(0);
+    // "AuthenticAMD" and "HygonGenuine" (Zen-based) both use the AMD leaves
+    return (c.ebx == 0x68747541 and c.edx == 0x69746e65 and c.ecx == 0x444d4163) or
+           (c.ebx == 0x6f677948 and c.edx == 0x6e65476e and c.ecx == 0x656e6975);
+}
+
+// Gets the shifts of the APIC ID for the SMT and package levels from the extended topology
+// leaves. Returns false if the CPU doesn't support them.
+bool read_extended_topology(u32 &smt_shift, u32 &package_shift)
+{
+    const u32 max_leaf = cpuid(0).eax;
+
+    u32 leaf = 0;
+    if (max_leaf >= CPUID_V2_EXTENDED_TOPOLOGY and cpuid2(CPUID_V2_EXTENDED_TOPOLOGY, 0).ebx != 0)
+        leaf = CPUID_V2_EXTENDED_TOPOLOGY;
+    else if (max_leaf >= CPUID_EXTENDED_TOPOLOGY and cpuid2(CPUID_EXTENDED_TOPOLOGY, 0).ebx != 0)
+        leaf = CPUID_EXTENDED_TOPOLOGY;
+    else
+        return false;
+
+    smt_shift     = 0;
+    package_shift = 0;
+    for (u32 subleaf = 0; subleaf < 8; ++subleaf) {
+        auto c          = cpuid2(leaf, subleaf);
+        const u32 type  = (c.ecx >> 8) & 0xff;
+        const u32 shift = c.eax & 0x1f;
+        if (type == TOPOLOGY_LEVEL_INVALID)
+            break;
+
+        if (type == TOPOLOGY_LEVEL_SMT)
+            smt_shift = shift;
+
+        // Levels are reported from the lowest, so the last one gives the package shift. Module,
+        // tile and die levels are folded into the core ID.
+        package_shift = shift;
+    }
+
+    return package_shift != 0;
+}
+
+// Returns the shift of the APIC ID identifying the CPUs sharing the last level cache, or -1 if it
+// can't be determined
+int read_llc_shift()
+{
+    u32 leaf = 0;
+    if (is_amd()) {
+        if (cpuid(0x80000000).eax < CPUID_AMD_CACHE_PARAMS)
+            return -1;
+        // TOPOEXT
+        if (!(cpuid(0x80000001).ecx & (1 << 22)))
+            return -1;
+        leaf = CPUID_AMD_CACHE_PARAMS;
+    } else {
+        if (cpuid(0).eax < CPUID_INTEL_CACHE_PARAMS)
+            return -1;
+        leaf = CPUID_INTEL_CACHE_PARAMS;
+    }
+
+    int shift      = -1;
+    u32 best_level = 0;
+    for (u32 subleaf = 0; subleaf < 16; ++subleaf) {
+        auto c         = cpuid2(leaf, subleaf);
+        const u32 type = c.eax & 0x1f;
+        if (type == CACHE_TYPE_NULL)
+            break;
+
+        const u32 level   = (c.eax >> 5) & 0x7;
+        const u32 sharing = ((c.eax >> 14) & 0xfff) + 1;
+        if (level >= best_level) {
+            best_level = level;
+            shift      = bits_for(sharing);
+        }
+    }
+
+    return shift;
+}
+
+} // namespace
+
+void detect_cpu_topology()
+{
+    u32 smt_shift, package_shift;
+    if (!read_extended_topology(smt_shift, package_shift)) {
+        serial_logger.printf("CPU topology leaves are not supported, assuming flat topology\n");
+        init_flat_topology();
+        return;
+    }
+
+    // Without the cache information, assume the whole package shares the cache
+    int llc_shift = read_llc_shift();
+    if (llc_shift < 0 or (u32)llc_shift > package_shift)
+        llc_shift = package_shift;
+
+    const u32 smt_mask  = (1U << smt_shift) - 1;
+    const u32 core_mask = (1U << (package_shift - smt_shift)) - 1;
+
+    // All of the CPUs are assumed to be the same, which holds for everything but hybrid designs,
+    // where the cores still report the same shifts
+    for (auto c: cpus) {
+        const u32 apic_id      = c->lapic_id;
+        c->topology.thread_id  = apic_id & smt_mask;
+        c->topology.core_id    = (apic_id >> smt_shift) & core_mask;
+        c->topology.package_id = apic_id >> package_shift;
+        c->topology.cache_id   = (apic_id & ((1U << package_shift) - 1)) >> llc_shift;
+    }
+}
+
+} // namespace kernel::sched
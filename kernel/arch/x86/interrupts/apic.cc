@@ -562,12 +562,17 @@ extern "C" void programmable_interrupt(u32 intno)
         return;
     }
 
-    if (handler->send_interrupt_notification() != kernel::interrupts::NotificationResult::Success) {
+    auto result = handler->send_interrupt_notification();
+    if (result == kernel::interrupts::NotificationResult::Completed) {
+        apic_eoi();
+    } else if (result != kernel::interrupts::NotificationResult::Success) {
         global_logger.printf("[Kernel] Warning: Failed to send interrupt notification for interrupt %h\n", intno);
 
-        // TODO if I end up sopporting MSIs
-        auto ioapic_handler = static_cast<IOAPIC_Handler *>(handler);
-        ioapic_handler->mask_interrupt();
+        // MSIs can only be masked in the device, and being edge-triggered, won't fire again until
+        // the driver gets to it
+        auto lapic_handler = static_cast<LAPIC_Handler *>(handler);
+        if (lapic_handler->source == LAPIC_Handler::Source::IOAPIC)
+            static_cast<IOAPIC_Handler *>(lapic_handler)->mask_interrupt();
         apic_eoi();
         tpr_write(0);
         return;
@@ -580,11 +585,10 @@ void ::kernel::interrupts::interrupt_complete(InterruptHandler *handler)
 {
     assert(handler);
     
-    // Everything goes through IOAPIC for now anyway...
-    auto ioapic_handler = static_cast<IOAPIC_Handler *>(handler);
+    auto lapic_handler = static_cast<LAPIC_Handler *>(handler);
 
-    assert(ioapic_handler->lapic_vector >= first_mappable_vector);
-    u32 intno = ioapic_handler->lapic_vector;
+    assert(lapic_handler->lapic_vector >= first_mappable_vector);
+    u32 intno = lapic_handler->lapic_vector;
     
     assert(intno < 256);
     smart_eoi(intno);
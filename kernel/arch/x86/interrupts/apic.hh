@@ -38,6 +38,7 @@ namespace kernel::x86::interrupts
 
 class IOAPIC;
 struct IOAPIC_Handler;
+struct LAPIC_Handler;
 
 namespace lapic
 {
@@ -245,7 +246,20 @@ constexpr u32 X2APIC_MSR_BASE = 0x800;
         u32 vector;
     };
 
-    kresult_t allocate_interrupt(IOAPIC_Handler *);
+    // Protects isr_handlers and allocated_int_count of all CPUs
+    extern Spinlock int_allocation_lock;
+
+    /// @brief Picks the CPU with the fewest interrupts routed to it
+    ///
+    /// Only the CPUs addressable by the 8 bit destination of the IOAPIC redirection entries and
+    /// the MSI messages are considered.
+    sched::CPU_Info *least_loaded_cpu();
+
+    /// @brief Assigns a free vector of the given CPU to the handler
+    ///
+    /// int_allocation_lock must be held
+    /// @return -ENOMEM if the CPU has no free vectors
+    kresult_t allocate_vector(LAPIC_Handler *handler, sched::CPU_Info *cpu);
     
     enum class APICMode {
         XAPIC,
@@ -1,6 +1,7 @@
 #include "ioapic.hh"
 
 #include "apic.hh"
+#include "msi.hh"
 
 #include <uacpi/acpi.h>
 #include <uacpi/tables.h>
@@ -151,7 +152,44 @@ void IOAPIC::init_ioapics()
     uacpi_table_unref(&m);
 }
 
-Spinlock int_allocation_lock;
+Spinlock lapic::int_allocation_lock;
+
+sched::CPU_Info *lapic::least_loaded_cpu()
+{
+    sched::CPU_Info *cpu = nullptr;
+    for (auto c: sched::cpus) {
+        // Would need interrupt remapping (or the extended destination ID) to be reachable
+        if (c->lapic_id > 0xff)
+            continue;
+
+        if (!cpu or c->allocated_int_count < cpu->allocated_int_count)
+            cpu = c;
+    }
+
+    return cpu ? cpu : sched::cpus[0];
+}
+
+kresult_t lapic::allocate_vector(LAPIC_Handler *handler, sched::CPU_Info *cpu)
+{
+    assert(int_allocation_lock.is_locked());
+
+    // Find unused slot
+    u32 idx = 0;
+    for (; idx < cpu->MAPPABLE_INTS; ++idx) {
+        if (!cpu->isr_handlers[idx])
+            break;
+    }
+
+    if (idx == cpu->MAPPABLE_INTS)
+        return -ENOMEM;
+
+    handler->parent_cpu   = cpu;
+    handler->lapic_vector = idx + lapic::first_mappable_vector;
+
+    __atomic_store_n(&cpu->isr_handlers[idx], handler, __ATOMIC_RELAXED);
+    cpu->allocated_int_count++;
+    return 0;
+}
 
 ReturnStr<IOAPIC_Handler *>
         IOAPIC::allocate_or_get_handler(u32 gsi, bool edge_triggered, bool active_low)
@@ -161,7 +199,7 @@ ReturnStr<IOAPIC_Handler *>
         return Error(-ENOENT);
     auto apic_base = gsi - ioapic->int_base;
 
-    Auto_Lock_Scope l(int_allocation_lock);
+    Auto_Lock_Scope l(lapic::int_allocation_lock);
 
     auto m = ioapic->mappings[apic_base];
     if (m)
@@ -174,48 +212,75 @@ ReturnStr<IOAPIC_Handler *>
     handler->parent_ioapic = ioapic;
     handler->active_low = active_low;
     handler->level_triggered = !edge_triggered;
+    handler->edge_triggered = edge_triggered;
     handler->ioapic_index = apic_base;
 
-    // Find least loaded CPU
-    auto *cpu = sched::cpus[0];
-    for (size_t i = 1; i < sched::cpus.size(); ++i) {
-        // TODO: Fix x2apic handling here...
-        if (sched::cpus[i]->allocated_int_count < cpu->allocated_int_count)
-            cpu = sched::cpus[i];
-    }
-
-    // Find unused slot
-    u32 idx = 0;
-    for (; idx < cpu->MAPPABLE_INTS; ++idx) {
-        if (!cpu->isr_handlers[idx])
-            break;
-    }
-
-    if (idx == cpu->MAPPABLE_INTS)
-        return Error(-ENOMEM);
-
-    handler->parent_cpu = cpu;
-    handler->lapic_vector = idx + lapic::first_mappable_vector;
+    auto *cpu = lapic::least_loaded_cpu();
+    auto result = lapic::allocate_vector(handler.get(), cpu);
+    if (result)
+        return Error(result);
 
     assert(ioapic->mappings.size() > apic_base);
 
     ioapic->mappings[apic_base] = handler.get();
-    __atomic_store_n(&cpu->isr_handlers[idx], handler.get(), __ATOMIC_RELAXED);
-    cpu->allocated_int_count++;
-
-    // TODO!
-    u32 lapic_id = cpu->lapic_id << 24;
 
     // Set the mapping
-    u64 val = ((u64)lapic_id << 32) | (1 << 16) | ((u32)!edge_triggered << 15) |
-                ((u32)active_low << 13) | handler->lapic_vector;
-    ioapic->write_redir_entry(apic_base, val);
+    ioapic->write_handler_entry(handler.get(), true);
 
     log::serial_logger.printf("IOAPIC added entry for gsi %x (ioapic vector %x) -> CPU %x (lapic %x) vector %x\n", gsi, apic_base, cpu->cpu_id, cpu->lapic_id, handler->lapic_vector);
 
+    register_interrupt_handler(handler.get(), gsi);
     return handler.release();
 }
 
+void IOAPIC::write_handler_entry(const IOAPIC_Handler *handler, bool masked)
+{
+    assert(handler->parent_cpu);
+    u32 lapic_id = handler->parent_cpu->lapic_id << 24;
+
+    u64 val = ((u64)lapic_id << 32) | ((u32)masked << 16) | ((u32)handler->level_triggered << 15) |
+              ((u32)handler->active_low << 13) | handler->lapic_vector;
+    write_redir_entry(handler->ioapic_index, val);
+}
+
+kresult_t kernel::interrupts::interrupt_set_cpu(InterruptHandler *handler, sched::CPU_Info *cpu,
+                                                bool enable)
+{
+    assert(handler);
+    assert(cpu);
+    auto lapic_handler = static_cast<LAPIC_Handler *>(handler);
+
+    // The message is programmed into the device by its driver, which has to allocate a new MSI
+    // instead
+    if (lapic_handler->source != LAPIC_Handler::Source::IOAPIC)
+        return -ENOTSUP;
+
+    if (cpu->lapic_id > 0xff)
+        return -EINVAL;
+
+    auto ioapic_handler = static_cast<IOAPIC_Handler *>(lapic_handler);
+    assert(ioapic_handler->parent_ioapic);
+
+    Auto_Lock_Scope l(lapic::int_allocation_lock);
+
+    auto old_cpu    = handler->parent_cpu;
+    auto old_vector = lapic_handler->lapic_vector;
+
+    auto result = lapic::allocate_vector(lapic_handler, cpu);
+    if (result)
+        return result;
+
+    ioapic_handler->parent_ioapic->write_handler_entry(ioapic_handler, !enable);
+    ioapic_handler->enabled = enable;
+
+    // If the interrupt has already been latched by this CPU, it will find no handler and be
+    // acknowledged. The level-triggered ones are then delivered again to the new CPU.
+    __atomic_store_n(&old_cpu->isr_handlers[old_vector - lapic::first_mappable_vector], nullptr,
+                     __ATOMIC_RELAXED);
+    old_cpu->allocated_int_count--;
+    return 0;
+}
+
 IOAPIC *IOAPIC::get_ioapic(u32 gsi)
 {
     for (auto ioapic: ioapics) {
@@ -260,19 +325,36 @@ void IOAPIC::interrupt_disable(u32 vector)
 void kernel::interrupts::interrupt_enable(InterruptHandler *handler)
 {
     assert(handler);
-    auto ioapic_handler = static_cast<IOAPIC_Handler *>(handler);
-    assert(ioapic_handler->parent_ioapic);
-    ioapic_handler->parent_ioapic->interrupt_enable(ioapic_handler->ioapic_index);
-    ioapic_handler->enabled = true;
+    auto lapic_handler = static_cast<LAPIC_Handler *>(handler);
+    switch (lapic_handler->source) {
+    case LAPIC_Handler::Source::IOAPIC: {
+        auto ioapic_handler = static_cast<IOAPIC_Handler *>(lapic_handler);
+        assert(ioapic_handler->parent_ioapic);
+        ioapic_handler->parent_ioapic->interrupt_enable(ioapic_handler->ioapic_index);
+        ioapic_handler->enabled = true;
+    } break;
+    case LAPIC_Handler::Source::MSI:
+        // The device is masked by its driver, the vector is always live
+        static_cast<MSI_Handler *>(lapic_handler)->enabled = true;
+        break;
+    }
 }
 
 void kernel::interrupts::interrupt_disable(InterruptHandler *handler)
 {
     assert(handler);
-    auto ioapic_handler = static_cast<IOAPIC_Handler *>(handler);
-    assert(ioapic_handler->parent_ioapic);
-    ioapic_handler->parent_ioapic->interrupt_disable(ioapic_handler->ioapic_index);
-    ioapic_handler->enabled = false;
+    auto lapic_handler = static_cast<LAPIC_Handler *>(handler);
+    switch (lapic_handler->source) {
+    case LAPIC_Handler::Source::IOAPIC: {
+        auto ioapic_handler = static_cast<IOAPIC_Handler *>(lapic_handler);
+        assert(ioapic_handler->parent_ioapic);
+        ioapic_handler->parent_ioapic->interrupt_disable(ioapic_handler->ioapic_index);
+        ioapic_handler->enabled = false;
+    } break;
+    case LAPIC_Handler::Source::MSI:
+        static_cast<MSI_Handler *>(lapic_handler)->enabled = false;
+        break;
+    }
 }
 
 void IOAPIC_Handler::mask_interrupt()
@@ -11,12 +11,26 @@ namespace kernel::x86::interrupts
 
 class IOAPIC;
 
-struct IOAPIC_Handler final: ::kernel::interrupts::InterruptHandler {
-    IOAPIC *parent_ioapic = nullptr;
+// Interrupt delivered through one of the mappable vectors of the local APIC
+struct LAPIC_Handler: ::kernel::interrupts::InterruptHandler {
+    enum class Source : u8 {
+        IOAPIC,
+        MSI,
+    };
+
+    const Source source;
 
     // 48 .. 240
     u32 lapic_vector = 0;
 
+    LAPIC_Handler(Source source): source(source) {}
+};
+
+struct IOAPIC_Handler final: LAPIC_Handler {
+    IOAPIC_Handler(): LAPIC_Handler(Source::IOAPIC) {}
+
+    IOAPIC *parent_ioapic = nullptr;
+
     // gsi - parent_ioapic->int_base
     u32 ioapic_index = 0;
 
@@ -39,6 +53,9 @@ public:
         allocate_or_get_handler(u32 gsi, bool edge_triggered, bool active_low);
 
     static void mask_interrupt(sched::CPU_Info *cpu, int vec);
+
+    // Programs the redirection entry with the handler's CPU and vector
+    void write_handler_entry(const IOAPIC_Handler *handler, bool masked);
     
 private:
 
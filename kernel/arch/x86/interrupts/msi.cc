@@ -0,0 +1,90 @@
+#include "msi.hh"
+
+#include "apic.hh"
+
+#include <kern_logger/kern_logger.hh>
+#include <lib/memory.hh>
+
+using namespace kernel;
+using namespace kernel::x86::interrupts;
+
+u64 MSI_Handler::message_address() const
+{
+    assert(parent_cpu);
+    // Physical destination mode, no redirection hint
+    return msi_address_base | ((u64)(parent_cpu->lapic_id & 0xff) << 12);
+}
+
+u32 MSI_Handler::message_data() const
+{
+    // Fixed delivery mode, edge-triggered
+    return lapic_vector;
+}
+
+ReturnStr<kernel::interrupts::InterruptHandler *>
+    kernel::interrupts::allocate_msi_handler(sched::CPU_Info *cpu)
+{
+    // Without interrupt remapping, only the first 256 APIC IDs can be targeted
+    if (cpu and cpu->lapic_id > 0xff)
+        return Error(-EINVAL);
+
+    klib::unique_ptr<MSI_Handler> handler = klib::make_unique<MSI_Handler>();
+    if (!handler)
+        return Error(-ENOMEM);
+
+    Auto_Lock_Scope l(lapic::int_allocation_lock);
+
+    if (!cpu)
+        cpu = lapic::least_loaded_cpu();
+
+    auto result = lapic::allocate_vector(handler.get(), cpu);
+    if (result)
+        return Error(result);
+
+    log::serial_logger.printf("Allocated MSI -> CPU %x (lapic %x) vector %x\n", cpu->cpu_id,
+                              cpu->lapic_id, handler->lapic_vector);
+
+    handler->releasable = true;
+    register_interrupt_handler(handler.get(), -1U);
+
+    return handler.release();
+}
+
+void kernel::interrupts::free_msi_handler(InterruptHandler *handler)
+{
+    assert(handler);
+    auto msi_handler = static_cast<MSI_Handler *>(static_cast<LAPIC_Handler *>(handler));
+    assert(msi_handler->source == LAPIC_Handler::Source::MSI);
+    assert(msi_handler->released);
+
+    {
+        Auto_Lock_Scope l(lapic::int_allocation_lock);
+
+        // If the device still sends the message, the interrupt finds no handler and is
+        // acknowledged
+        auto cpu = msi_handler->parent_cpu;
+        __atomic_store_n(&cpu->isr_handlers[msi_handler->lapic_vector - lapic::first_mappable_vector],
+                         nullptr, __ATOMIC_RELAXED);
+        cpu->allocated_int_count--;
+    }
+
+    msi_handler->rcu_head.rcu_func = [](void *self, bool) {
+        MSI_Handler *t = reinterpret_cast<MSI_Handler *>(reinterpret_cast<char *>(self) -
+                                                         offsetof(MSI_Handler, rcu_head));
+        delete t;
+    };
+    sched::get_cpu_struct()->heap_rcu_cpu.push(&msi_handler->rcu_head);
+}
+
+kresult_t kernel::interrupts::get_msi_message(InterruptHandler *handler, u64 &address, u32 &data)
+{
+    assert(handler);
+    auto lapic_handler = static_cast<LAPIC_Handler *>(handler);
+    if (lapic_handler->source != LAPIC_Handler::Source::MSI)
+        return -EINVAL;
+
+    auto msi_handler = static_cast<MSI_Handler *>(lapic_handler);
+    address          = msi_handler->message_address();
+    data             = msi_handler->message_data();
+    return 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "ioapic.hh"
+
+namespace kernel::x86::interrupts
+{
+
+// Message-signalled interrupt, written by the device straight to the local APIC of the parent_cpu
+struct MSI_Handler final: LAPIC_Handler {
+    MSI_Handler(): LAPIC_Handler(Source::MSI) { edge_triggered = true; }
+
+    bool enabled = false;
+
+    memory::RCU_Head rcu_head;
+
+    // Base of the MSI address range. The destination APIC ID goes to bits 12-19.
+    static constexpr u64 msi_address_base = 0xfee00000;
+
+    u64 message_address() const;
+    u32 message_data() const;
+};
+
+}; // namespace kernel::x86::interrupts
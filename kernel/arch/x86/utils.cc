@@ -33,6 +33,20 @@
 
 void halt() { asm("hlt"); }
 
+ulong disable_interrupts()
+{
+    ulong flags;
+    asm volatile("pushf; pop %0; cli" : "=r"(flags)::"memory");
+    return flags;
+}
+
+void restore_interrupts(ulong flags)
+{
+    // IF
+    if (flags & 0x200)
+        asm volatile("sti" ::: "memory");
+}
+
 bool serial_initiated  = false;
 bool serial_functional = false;
 Spinlock serial_lock;
@@ -489,8 +489,7 @@ x86_Page_Table::Page_Info x86_Page_Table::get_page_mapping(void *virt_addr) cons
 
 klib::shared_ptr<x86_Page_Table> x86_Page_Table::capture_initial(u64 cr3)
 {
-    klib::shared_ptr<x86_Page_Table> t =
-        klib::unique_ptr<x86_Page_Table>(new x86_Page_Table());
+    auto t = klib::make_shared<x86_Page_Table>();
 
     if (not t)
         return nullptr;
@@ -505,8 +504,7 @@ klib::shared_ptr<x86_Page_Table> x86_Page_Table::capture_initial(u64 cr3)
 
 klib::shared_ptr<x86_Page_Table> x86_Page_Table::create_empty(int flags)
 {
-    klib::shared_ptr<x86_Page_Table> new_table =
-        klib::unique_ptr<x86_Page_Table>(new x86_Page_Table());
+    auto new_table = klib::make_shared<x86_Page_Table>();
 
     if (not new_table)
         return nullptr;
@@ -1028,13 +1026,13 @@ klib::shared_ptr<x86_Page_Table> x86_Page_Table::create_clone()
 }
 
 x86_Page_Table::page_table_map x86_Page_Table::global_page_tables;
-Spinlock x86_Page_Table::page_table_index_lock;
+RWSpinlock x86_Page_Table::page_table_index_lock;
 
 kresult_t
     x86_Page_Table::insert_global_page_tables(klib::shared_ptr<x86_Page_Table> table)
 {
     Auto_Lock_Scope local_lock(page_table_index_lock);
-    auto p = global_page_tables.insert({table->id, table});
+    auto p = global_page_tables.insert_noexcept({table->id, table});
     if (p.first == global_page_tables.end()) [[unlikely]]
         return -ENOMEM;
 
@@ -1047,7 +1045,7 @@ kresult_t
 void x86_Page_Table::takeout_global_page_tables()
 {
     Auto_Lock_Scope local_lock(page_table_index_lock);
-    global_page_tables.erase_if_exists(this->id);
+    global_page_tables.erase(this->id);
 }
 
 void x86_Page_Table::apply() noexcept {
@@ -1128,7 +1126,7 @@ ReturnStr<bool> x86_Page_Table::atomic_copy_to_user(void *to, const void *from,
 
 klib::shared_ptr<x86_Page_Table> x86_Page_Table::get_page_table(u64 id)
 {
-    Auto_Lock_Scope local_lock(page_table_index_lock);
+    Shared_Lock_Scope local_lock(page_table_index_lock);
     auto p = global_page_tables.find(id);
     if (p == global_page_tables.end())
         return nullptr;
@@ -29,6 +29,7 @@
 
 #pragma once
 #include <memory/paging.hh>
+#include <pmos/containers/map.hh>
 
 namespace kernel::x86_64::paging
 {
@@ -205,17 +206,17 @@ protected:
     /// @brief Takes out this page table from the map of the page tables
     void takeout_global_page_tables();
 
-    using page_table_map = klib::splay_tree_map<u64, klib::weak_ptr<x86_Page_Table>>;
-    /// @brief Map holding all the page tables. Currently using splay tree for
-    /// the storage
-    /// @todo Consider AVL or Red-Black tree instead for better concurrency
+    using page_table_map = pmos::containers::map<u64, klib::weak_ptr<x86_Page_Table>>;
+    /// @brief Map holding all the page tables. The lookups don't modify the tree, so they only
+    /// need the shared lock
     static page_table_map global_page_tables;
-    static Spinlock page_table_index_lock;
+    static RWSpinlock page_table_index_lock;
 
     virtual void invalidate_range(kernel::paging::TLBShootdownContext &ctx, void *virt_addr,
                                   size_t size_bytes, bool free) override;
 
     x86_Page_Table() = default;
+    template<class T, class... Args> friend klib::shared_ptr<T> klib::make_shared(Args &&...);
 
     // Frees user pages
     void free_user_pages();
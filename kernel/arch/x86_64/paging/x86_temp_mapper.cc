@@ -38,7 +38,8 @@ using namespace kernel::x86_64::paging;
 
 x86_PAE_Temp_Mapper::x86_PAE_Temp_Mapper(void *virt_addr, u64 cr3)
 {
-    pt_mapped = (x86_PAE_Entry *)virt_addr;
+    pt_mapped  = (x86_PAE_Entry *)virt_addr;
+    slots_base = (char *)virt_addr;
 
     u64 addr    = (u64)virt_addr;
     start_index = addr / 4096 % 512;
@@ -56,49 +57,25 @@ x86_PAE_Temp_Mapper::x86_PAE_Temp_Mapper(void *virt_addr, u64 cr3)
     pt[start_index].present   = true;
     pt[start_index].writeable = true;
     pt[start_index].page_ppn  = pt_phys >> 12;
-
-    min_index = start_index + 1;
 }
 
-void *x86_PAE_Temp_Mapper::kern_map(u64 phys_frame)
+void x86_PAE_Temp_Mapper::set_entry(unsigned slot, u64 phys_frame)
 {
-    for (unsigned i = min_index; i < start_index + size; ++i) {
-        if (not pt_mapped[i].present) {
-            pt_mapped[i].present   = true;
-            pt_mapped[i].writeable = true;
-            pt_mapped[i].page_ppn  = phys_frame >> 12;
-
-            min_index = i + 1;
-
-            char *t = (char *)pt_mapped;
-            t += (i - start_index) * 4096;
-
-            return (void *)t;
-        }
-    }
-
-    assert(false && "trying to map too many things at once");
+    x86_PAE_Entry entry = x86_PAE_Entry();
+    entry.present       = true;
+    entry.writeable     = true;
+    entry.page_ppn      = phys_frame >> 12;
 
-    return nullptr;
+    pt_mapped[start_index + slot] = entry;
 }
 
-static u64 temp_mapper_get_index(u64 addr) { return (addr / 4096) % 512; }
-
-void x86_PAE_Temp_Mapper::return_map(void *p)
+void x86_PAE_Temp_Mapper::clear_entry(unsigned slot)
 {
-    if (p == nullptr)
-        return;
-
-    u64 i          = (u64)p;
-    unsigned index = temp_mapper_get_index(i);
-
-    pt_mapped[index] = x86_PAE_Entry();
-    if (index < min_index)
-        min_index = index;
-
-    invlpg((void *)i);
+    pt_mapped[start_index + slot] = x86_PAE_Entry();
 }
 
+void x86_PAE_Temp_Mapper::invalidate(void *virt_addr) { invlpg(virt_addr); }
+
 x86_PAE_Temp_Mapper create_temp_mapper(void *virt_addr, u64 cr3)
 {
     return x86_PAE_Temp_Mapper(virt_addr, cr3);
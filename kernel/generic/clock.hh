@@ -1,4 +1,26 @@
 #pragma once
 #include <types.hh>
 
-extern u64 unix_time_bootup;
\ No newline at end of file
+extern u64 unix_time_bootup;
+
+// Reads the free-running CPU timestamp counter (TSC on x86, time CSR on RISC-V, stable counter on
+// LoongArch). It is cheap, but the frequency is arch-specific, so it is only good for relative
+// measurements.
+inline u64 read_timestamp_counter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    u32 lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((u64)hi << 32) | lo;
+#elif defined(__riscv)
+    u64 t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+#elif defined(__loongarch__)
+    u64 t;
+    asm volatile("rdtime.d %0, $zero" : "=r"(t));
+    return t;
+#else
+    return 0;
+#endif
+}
\ No newline at end of file
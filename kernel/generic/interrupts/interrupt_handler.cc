@@ -4,9 +4,12 @@
 #include <errno.h>
 #include <exceptions.hh>
 #include <kern_logger/kern_logger.hh>
+#include <memory/paging.hh>
+#include <memory/vmm.hh>
 #include <pmos/utility/scope_guard.hh>
 #include <processes/tasks.hh>
 #include <sched/sched.hh>
+#include <utils.hh>
 #include <pmos/ipc.h>
 
 using namespace kernel::interrupts;
@@ -14,6 +17,8 @@ using namespace kernel::interrupts;
 namespace kernel::interrupts
 {
 
+static void release_if_unused(InterruptHandler *handler);
+
 ReturnStr<IntSourceRight *> IntSourceRight::create_for_group(InterruptHandler *handler, proc::TaskGroup *group)
 {
     assert(handler);
@@ -33,6 +38,9 @@ ReturnStr<IntSourceRight *> IntSourceRight::create_for_group(InterruptHandler *h
     if (!group->atomic_alive())
         return Error(-ESRCH);
 
+    if (handler->released)
+        return Error(-ENOENT);
+
     new_right->right_sender_id = ++group->current_right_id;
     handler->sources.push_back(new_right.get());
     group->rights.insert(new_right.get());
@@ -54,6 +62,7 @@ void IntSourceRight::remove_from_parent()
     assert(parent_handler);
     Auto_Lock_Scope l(parent_handler->sources_lock);
     parent_handler->sources.remove(this);
+    release_if_unused(parent_handler);
 }
 
 ipc::RightType IntSourceRight::type() const
@@ -80,22 +89,137 @@ ReturnStr<bool> IntNotificationRight::copy_to_user_buff(char *buff) const
     return copy_to_user((const char *)&interrupt, buff, sizeof(interrupt));
 }
 
+InterruptCounterMapping::InterruptCounterMapping(InterruptCounterMapping &&other)
+    : page(klib::move(other.page)), kernel_mapping(other.kernel_mapping), counter(other.counter)
+{
+    other.kernel_mapping = nullptr;
+    other.counter        = nullptr;
+}
+
+InterruptCounterMapping &InterruptCounterMapping::operator=(InterruptCounterMapping &&other)
+{
+    if (this == &other)
+        return *this;
+
+    this->~InterruptCounterMapping();
+    new (this) InterruptCounterMapping(klib::move(other));
+    return *this;
+}
+
+InterruptCounterMapping::~InterruptCounterMapping()
+{
+    if (!kernel_mapping)
+        return;
+
+    auto ctx = paging::TLBShootdownContext::create_kernel();
+    paging::unmap_kernel_page(ctx, kernel_mapping);
+    ctx.finalize();
+
+    vmm::kernel_space_allocator.virtmem_free(kernel_mapping, 1);
+    kernel_mapping = nullptr;
+    counter        = nullptr;
+}
+
+ReturnStr<bool> InterruptCounterMapping::map_from_user(ulong user_addr, InterruptCounterMapping &out)
+{
+    const ulong offset = user_addr & (PAGE_SIZE - 1);
+    if (user_addr % alignof(interrupt_counter) or offset + sizeof(interrupt_counter) > PAGE_SIZE)
+        return Error(-EINVAL);
+
+    auto b = prepare_user_buff_wr((char *)user_addr, sizeof(interrupt_counter));
+    if (!b.success() or !b.val)
+        return b;
+
+    pmm::Page_Descriptor page;
+    {
+        auto table = sched::get_current_task()->page_table;
+        assert(table);
+
+        Auto_Lock_Scope l(table->lock);
+
+        // The page must be a normal memory, whose lifetime can be extended while it's mapped
+        auto mapping = table->get_page_mapping((void *)(user_addr - offset));
+        if (!mapping.is_allocated or mapping.nofree)
+            return Error(-EINVAL);
+
+        // If the task forks, the counter stays with the original page
+        page = pmm::Page_Descriptor::find_page_struct(mapping.page_addr);
+        if (!page)
+            return Error(-EINVAL);
+    }
+
+    void *virt = vmm::kernel_space_allocator.virtmem_alloc(1);
+    if (!virt)
+        return Error(-ENOMEM);
+
+    const paging::Page_Table_Arguments arg = {.readable           = true,
+                                              .writeable          = true,
+                                              .user_access        = false,
+                                              .global             = true,
+                                              .execution_disabled = true,
+                                              .extra              = PAGING_FLAG_NOFREE,
+                                              .cache_policy       = paging::Memory_Type::Normal};
+    auto result = paging::map_kernel_page(page.page_struct_ptr->get_phys_addr(), virt, arg);
+    if (result) {
+        vmm::kernel_space_allocator.virtmem_free(virt, 1);
+        return Error(result);
+    }
+
+    out                = InterruptCounterMapping();
+    out.page           = klib::move(page);
+    out.kernel_mapping = virt;
+    out.counter        = (interrupt_counter *)((char *)virt + offset);
+    return true;
+}
+
+struct InterruptPollTimer final: sched::TimerNode {
+    InterruptHandler *handler = nullptr;
+    bool armed                = false;
+
+    virtual void fire() override;
+};
+
+static void cancel_poll_timer(InterruptHandler *handler)
+{
+    auto t = handler->poll_timer;
+    if (!t or !t->armed)
+        return;
+
+    handler->parent_cpu->timer_queue.erase(t);
+    t->armed = false;
+}
+
+static void update_owner(InterruptHandler *handler)
+{
+    u64 owner = 0;
+    if (!handler->notification_rights.empty())
+        owner = handler->notification_rights.front().parent->owner->task_id;
+    __atomic_store_n(&handler->owner_task_id, owner, __ATOMIC_RELAXED);
+}
+
 // Didn't like having a private struct member
-static void after_removing_pending(InterruptHandler *handler)
+static void update_handler_state(InterruptHandler *handler)
 {
     assert(handler);
     assert(sched::get_cpu_struct() == handler->parent_cpu);
 
-    bool all_completed = true;
+    bool pending = false, polling = false;
     for (auto &n: handler->notification_rights) {
-        if (n.pending_completion) {
-            all_completed = false;
-            break;
-        }
+        pending |= n.pending_completion;
+        polling |= n.poll_requested;
     }
 
-    if (all_completed)
+    if (!pending and handler->in_service) {
+        handler->in_service = false;
         interrupt_complete(handler);
+    }
+
+    if (handler->polling and !pending and !polling) {
+        handler->polling = false;
+        cancel_poll_timer(handler);
+        if (!handler->notification_rights.empty())
+            interrupt_enable(handler);
+    }
 
     if (handler->notification_rights.empty())
         interrupt_disable(handler);
@@ -121,10 +245,17 @@ bool IntNotificationRight::destroy_recieve_right()
     }
 
     assert(parent_handler);
-    parent_handler->notification_rights.remove(this);
+    {
+        // Keeps the source rights from releasing the handler until it's updated
+        Auto_Lock_Scope l(parent_handler->sources_lock);
+        parent_handler->notification_rights.remove(this);
+        update_owner(parent_handler);
+
+        if (pending_completion or poll_requested)
+            update_handler_state(parent_handler);
 
-    if (pending_completion)
-        after_removing_pending(parent_handler);
+        release_if_unused(parent_handler);
+    }
 
     if (!sent)
         delete this;
@@ -167,55 +298,150 @@ ReturnStr<std::pair<ipc::Right *, u64>> IntSourceRight::duplicate(proc::TaskGrou
     return Success(std::make_pair(ptr, ptr->right_sender_id));
 }
 
+static void enqueue_notification(IntNotificationRight &n)
+{
+    if (n.sent)
+        return;
+
+    auto port = n.parent;
+    assert(port);
+    // Only the owner can delete the port, so this isn't possible
+    assert(port->alive);
+
+    n.sent = true;
+
+    Auto_Lock_Scope l(port->lock);
+    port->enqueue(klib::unique_ptr(&n));
+}
+
 NotificationResult InterruptHandler::send_interrupt_notification()
 {
+    __atomic_store_n(&interrupt_count, interrupt_count + 1, __ATOMIC_RELAXED);
+
     if (notification_rights.empty())
         return NotificationResult::NoHandlers;
 
+    // MSIs can't be masked by the kernel, but the drivers are polling the device anyway
+    if (polling)
+        return NotificationResult::Completed;
+
+    bool needs_completion = false;
     for (auto &n: notification_rights) {
-        if (n.sent)
-            continue;
+        if (auto c = n.counter.counter) {
+            __atomic_add_fetch(&c->count, 1, __ATOMIC_RELEASE);
+            if (!edge_triggered) {
+                n.pending_completion = true;
+                needs_completion     = true;
+            }
+
+            // Only wake up the owner if it's about to block
+            if (!__atomic_exchange_n(&c->waiting, 0, __ATOMIC_ACQ_REL))
+                continue;
+        } else {
+            n.pending_completion = true;
+            needs_completion     = true;
+        }
 
-        auto port = n.parent;
-        assert(port);
-        // Only the owner can delete the port, so this isn't possible
-        assert(port->alive);
+        enqueue_notification(n);
+    }
+
+    in_service = needs_completion;
+    return needs_completion ? NotificationResult::Success : NotificationResult::Completed;
+}
+
+void InterruptHandler::poll_timer_fired()
+{
+    assert(sched::get_cpu_struct() == parent_cpu);
 
+    for (auto &n: notification_rights) {
+        if (!n.poll_requested)
+            continue;
+
+        // The owner has to answer with either complete() or complete_and_poll(), even if the
+        // interrupt is edge-triggered
+        n.poll_requested     = false;
         n.pending_completion = true;
 
-        Auto_Lock_Scope l(port->lock);
-        port->enqueue(klib::unique_ptr(&n));
+        if (auto c = n.counter.counter) {
+            __atomic_add_fetch(&c->count, 1, __ATOMIC_RELEASE);
+            if (!__atomic_exchange_n(&c->waiting, 0, __ATOMIC_ACQ_REL))
+                continue;
+        }
+
+        enqueue_notification(n);
     }
-    
-    return NotificationResult::Success;
+}
+
+void InterruptPollTimer::fire()
+{
+    assert(armed);
+    armed = false;
+    handler->poll_timer_fired();
 }
 
 kresult_t IntNotificationRight::complete()
 {
     assert(alive);
-    if (!pending_completion)
-        return -EAGAIN;
+    if (!pending_completion and !poll_requested)
+        // With the counters, the driver completes once per batch, without knowing if the
+        // interrupt was edge-triggered and already completed by the kernel
+        return counter.counter ? 0 : -EAGAIN;
 
     pending_completion = false;
- 
+    // The device has run out of work before the poll timer has fired
+    poll_requested = false;
+
+    assert(parent_handler);
+    update_handler_state(parent_handler);
+    return 0;
+}
+
+kresult_t IntNotificationRight::complete_and_poll(u64 delay_ns)
+{
+    assert(alive);
     assert(parent_handler);
     assert(sched::get_cpu_struct() == parent_handler->parent_cpu);
 
-    bool all_completed = true;
-    for (auto &n: parent_handler->notification_rights) {
-        if (n.pending_completion) {
-            all_completed = false;
-            break;
-        }
+    if (delay_ns == 0)
+        return -EINVAL;
+
+    auto handler = parent_handler;
+    if (!handler->poll_timer) {
+        handler->poll_timer = new InterruptPollTimer();
+        if (!handler->poll_timer)
+            return -ENOMEM;
+        handler->poll_timer->handler = handler;
+    }
+
+    pending_completion = false;
+    poll_requested     = true;
+
+    // Mask the line before completing it, so that the level-triggered interrupts don't fire again
+    if (!handler->polling) {
+        handler->polling = true;
+        interrupt_disable(handler);
     }
 
-    if (all_completed)
-        interrupt_complete(parent_handler);
+    // Multiple drivers sharing the interrupt get notified with the earliest deadline
+    auto t       = handler->poll_timer;
+    u64 deadline = sched::get_ns_since_bootup() + delay_ns;
+    auto c       = handler->parent_cpu;
+    if (!t->armed or t->fire_at_ns > deadline) {
+        if (t->armed)
+            c->timer_queue.erase(t);
+
+        t->fire_at_ns = deadline;
+        c->timer_queue.insert(t);
+        sched::maybe_rearm_timer(deadline);
+        t->armed = true;
+    }
 
+    update_handler_state(handler);
     return 0;
 }
 
-ReturnStr<IntNotificationRight *> IntNotificationRight::create_for_port(InterruptHandler *handler, ipc::Port *port)
+ReturnStr<IntNotificationRight *> IntNotificationRight::create_for_port(InterruptHandler *handler, ipc::Port *port,
+                                                                        InterruptCounterMapping counter)
 {
     bool first_right;
 
@@ -236,6 +462,7 @@ ReturnStr<IntNotificationRight *> IntNotificationRight::create_for_port(Interrup
 
     new_right->parent_handler = handler;
     new_right->parent = port;
+    new_right->counter = klib::move(counter);
 
     {
         Auto_Lock_Scope l3(parent_task->sched_lock);
@@ -248,6 +475,10 @@ ReturnStr<IntNotificationRight *> IntNotificationRight::create_for_port(Interrup
         Auto_Lock_Scope l1(handler->sources_lock);
         Auto_Lock_Scope l2(port->rights_lock);
 
+        // The source right used to find the handler might have been deleted in the meantime
+        if (handler->released)
+            return Error(-ENOENT);
+
         first_right = handler->notification_rights.empty();
 
         assert(port->alive);
@@ -258,10 +489,105 @@ ReturnStr<IntNotificationRight *> IntNotificationRight::create_for_port(Interrup
         parent_task->interrupt_handlers_count++;
     }
 
-    if (first_right)
+    if (first_right) {
+        update_owner(handler);
         interrupt_enable(handler);
+    }
 
     return Success(new_right.release());
 }
 
+kresult_t InterruptHandler::set_cpu(sched::CPU_Info *cpu)
+{
+    assert(cpu);
+    assert(sched::get_cpu_struct() == parent_cpu);
+
+    if (cpu == parent_cpu)
+        return 0;
+
+    // The poll timer is in this CPU's queue, so poll right away instead of moving it
+    if (poll_timer and poll_timer->armed) {
+        cancel_poll_timer(this);
+        poll_timer_fired();
+    }
+
+    bool unmask = !notification_rights.empty() and !polling;
+    if (in_service) {
+        // The interrupt can only be completed by the CPU it was delivered to. Keep it masked
+        // until the drivers complete it, like when they are polling.
+        interrupt_disable(this);
+        in_service = false;
+        interrupt_complete(this);
+        polling = true;
+        unmask  = false;
+    } else if (unmask) {
+        interrupt_disable(this);
+    }
+
+    auto result = interrupt_set_cpu(this, cpu, unmask);
+    if (result and unmask)
+        interrupt_enable(this);
+
+    return result;
+}
+
+static Spinlock interrupt_handlers_lock;
+static pmos::containers::CircularDoubleList<InterruptHandler, &InterruptHandler::list_node>
+    interrupt_handlers;
+static u32 next_interrupt_id = 0;
+
+void register_interrupt_handler(InterruptHandler *handler, u32 gsi)
+{
+    assert(handler);
+
+    Auto_Lock_Scope l(interrupt_handlers_lock);
+    handler->id  = next_interrupt_id++;
+    handler->gsi = gsi;
+    interrupt_handlers.push_back(handler);
+}
+
+InterruptHandler *get_interrupt_handler(u32 index)
+{
+    Auto_Lock_Scope l(interrupt_handlers_lock);
+    for (auto &h: interrupt_handlers)
+        if (index-- == 0)
+            return &h;
+
+    return nullptr;
+}
+
+// Must be called with sources_lock held
+static void release_if_unused(InterruptHandler *handler)
+{
+    assert(handler->sources_lock.is_locked());
+
+    if (!handler->releasable or handler->released)
+        return;
+
+    if (!handler->sources.empty() or !handler->notification_rights.empty())
+        return;
+
+    handler->released = true;
+
+    {
+        Auto_Lock_Scope l(interrupt_handlers_lock);
+        interrupt_handlers.remove(handler);
+    }
+
+    // With no notification rights, the poll timer has been cancelled
+    assert(!handler->poll_timer or !handler->poll_timer->armed);
+    delete handler->poll_timer;
+    handler->poll_timer = nullptr;
+
+    free_msi_handler(handler);
+}
+
+void release_interrupt_handler(InterruptHandler *handler)
+{
+    assert(handler);
+
+    Auto_Lock_Scope l(handler->sources_lock);
+    release_if_unused(handler);
+}
+
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
+#include <kernel/interrupt_counter.h>
 #include <lib/memory.hh>
 #include <lib/vector.hh>
 #include <messaging/messaging.hh>
 #include <messaging/ports.hh>
+#include <memory/pmm.hh>
 #include <messaging/rights.hh>
 #include <utility>
 #include <pmos/containers/intrusive_list.hh>
@@ -20,6 +22,23 @@ namespace interrupts
 
 struct InterruptHandler;
 
+// User memory holding an interrupt_counter, pinned and mapped into the kernel so that it can be
+// updated from the interrupt handler
+struct InterruptCounterMapping {
+    pmm::Page_Descriptor page;
+    void *kernel_mapping       = nullptr;
+    interrupt_counter *counter = nullptr;
+
+    InterruptCounterMapping() = default;
+    InterruptCounterMapping(InterruptCounterMapping &&other);
+    InterruptCounterMapping &operator=(InterruptCounterMapping &&other);
+    ~InterruptCounterMapping();
+
+    // Maps the counter at user_addr of the current task. Returns false if the page is not yet
+    // available, in which case the syscall has to be repeated.
+    static ReturnStr<bool> map_from_user(ulong user_addr, InterruptCounterMapping &out);
+};
+
 struct IntNotificationRight final: ipc::RecieveRight {
     // A bit of a thinking process here: initially, I wanted to make this an
     // ipc::Right, so that this can be accessed through the same APIs as other rights,
@@ -37,18 +56,30 @@ struct IntNotificationRight final: ipc::RecieveRight {
     bool alive : 1 = true;
     bool sent : 1 = false;
     bool pending_completion : 1 = false;
+    // The owner is polling the device and is waiting for the poll timer
+    bool poll_requested : 1 = false;
 
     pmos::containers::DoubleListHead<IntNotificationRight> notification_node;
 
+    // If set, the interrupts are counted there, and the message is only sent when the owner asks
+    // for it
+    InterruptCounterMapping counter;
+
     // GenericMessage overrides
     virtual size_t size() const override;
     virtual ReturnStr<bool> copy_to_user_buff(char *buff) const override;
     virtual void delete_self() override;
     virtual ipc::RightType recieve_type() const override;
 
-    static ReturnStr<IntNotificationRight *> create_for_port(InterruptHandler *handler, ipc::Port *port);
+    static ReturnStr<IntNotificationRight *> create_for_port(InterruptHandler *handler, ipc::Port *port,
+                                                             InterruptCounterMapping counter = {});
 
     kresult_t complete();
+
+    // Completes the interrupt, but keeps the line masked while the owner polls the device. The
+    // notification is sent again after delay_ns, as if the interrupt has fired, and the owner
+    // should either poll again or complete() the interrupt once there is no more work.
+    kresult_t complete_and_poll(u64 delay_ns);
 };
 
 struct IntSourceRight final: ipc::Right {
@@ -71,8 +102,12 @@ struct IntSourceRight final: ipc::Right {
 enum class NotificationResult {
     NoHandlers,
     Success,
+    // Nobody is waiting for the completion, and the interrupt should be completed right away
+    Completed,
 };
 
+struct InterruptPollTimer;
+
 struct InterruptHandler {
     pmos::containers::CircularDoubleList<IntNotificationRight, &IntNotificationRight::notification_node> notification_rights;
 
@@ -84,11 +119,56 @@ struct InterruptHandler {
     // Don't keep refcount here (or shared_ptr stuff), since the userspace is expected to
     // allocate/deallocate interrupts explicitly...
 
+    // Set for the MSIs, which are freed once the last source and notification rights are gone.
+    // The handlers of the interrupt lines are kept for reuse.
+    bool releasable = false;
+    // Set once the handler has been released. Protected by sources_lock.
+    bool released = false;
+
     sched::CPU_Info *parent_cpu = nullptr;
 
+    // Set by the arch code. Edge-triggered interrupts don't need to be masked until the driver
+    // services the device, so the counted ones are completed by the kernel.
+    bool edge_triggered = false;
+
+    // Set when the notification needing completion has been sent, until interrupt_complete() is
+    // called
+    bool in_service = false;
+    // Set while the line is masked because the drivers are polling the device instead
+    bool polling = false;
+    // Allocated on the first poll request, and kept for the lifetime of the handler
+    InterruptPollTimer *poll_timer = nullptr;
+
+    // Statistics for balancing the interrupts between the CPUs. Only written by the parent_cpu.
+    u64 interrupt_count = 0;
+    // Task owning the notification rights, or 0 if there are none
+    u64 owner_task_id = 0;
+    // Set by register_interrupt_handler(). The GSI is -1 for the MSIs.
+    pmos::containers::DoubleListHead<InterruptHandler> list_node;
+    u32 id  = 0;
+    u32 gsi = -1U;
+
     NotificationResult send_interrupt_notification();
+    void poll_timer_fired();
+
+    // Moves the interrupt to another CPU. Must be called by the parent_cpu. The notification
+    // rights stay with the handler, and their owners should follow it to the new CPU. If the
+    // interrupt is in service, it is completed here and stays masked until the drivers complete
+    // it on the new CPU.
+    kresult_t set_cpu(sched::CPU_Info *cpu);
 };
 
+// Adds the newly allocated handler to the list of the interrupts, assigning it the id
+void register_interrupt_handler(InterruptHandler *handler, u32 gsi);
+
+// Returns the handler at the given position in the list, or nullptr if there is none. The handlers
+// are freed with RCU, so the pointer stays valid until the end of the syscall.
+InterruptHandler *get_interrupt_handler(u32 index);
+
+// Releases the releasable handler if it has no rights left. Used when the handler couldn't be given
+// to the userspace.
+void release_interrupt_handler(InterruptHandler *handler);
+
 
 
 // ================ Arch-specific stuff ================
@@ -99,8 +179,24 @@ void interrupt_enable(InterruptHandler *handler);
 void interrupt_disable(InterruptHandler *handler);
 void interrupt_complete(InterruptHandler *handler);
 
+// Called by the parent_cpu with the interrupt masked. Routes the interrupt to the cpu, updating
+// parent_cpu, and unmasks it if enable is set. Returns -ENOTSUP if the interrupt can't be moved.
+kresult_t interrupt_set_cpu(InterruptHandler *handler, sched::CPU_Info *cpu, bool enable);
+
 // On x86, userspace can figure out ISA -> GSI mapping itself...
 ReturnStr<InterruptHandler *> allocate_or_get_handler(u32 gsi, bool edge_triggered = false, bool active_low = false);
 
+// Allocates a new message-signalled interrupt, delivered to the given CPU, or to the least loaded
+// one if cpu is nullptr. Returns -ENOTSUP if the platform can't do MSIs.
+ReturnStr<InterruptHandler *> allocate_msi_handler(sched::CPU_Info *cpu);
+
+// Frees the handler returned by allocate_msi_handler() and its vector, once it has been released.
+// The memory is freed after an RCU grace period, since the interrupts might still be using it.
+void free_msi_handler(InterruptHandler *handler);
+
+// Gets the address and the data the device has to write to trigger the interrupt. Returns
+// -EINVAL if the handler is not an MSI.
+kresult_t get_msi_message(InterruptHandler *handler, u64 &address, u32 &data);
+
 }; // namespace interrupts
 }; // namespace kernel
\ No newline at end of file
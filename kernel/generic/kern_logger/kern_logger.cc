@@ -28,9 +28,17 @@
 
 #include "kern_logger.hh"
 
+#include <clock.hh>
 #include <messaging/messaging.hh>
+#include <sched/sched.hh>
 #include <stdarg.h>
 #include <types.hh>
+#include <utils.hh>
+
+namespace kernel::sched
+{
+extern bool cpu_struct_works;
+}
 
 void printc(int c);
 extern "C" void dbg_uart_putc(int c) { printc(c); }
@@ -190,63 +198,198 @@ void Logger::log(const klib::string &str)
 
 void Bochs_Logger::log_nolock(const char *c, size_t size) { t_write_bochs(c, size); }
 
-void Buffered_Logger::log_nolock(const char *c, size_t size)
+namespace
 {
-    constexpr size_t buff_size = 508;
 
-    auto *ptr  = ipc::Port::atomic_get_port(messaging_port_id);
-    bool alive = false;
-    if (ptr) {
-        Auto_Lock_Scope port_lock(ptr->lock);
-        alive = ptr->alive;
-        // Check this since port might linger after getting deleted
-    }
-    if (alive) {
-        struct Msg {
-            u32 type = 0x40;
-            char buff[buff_size];
-        } var;
-
-        size_t length   = size;
-        const char *str = c;
-
-        for (size_t i = 0; i < length; i += buff_size) {
-            size_t l = min(length - i, buff_size);
-            memcpy(var.buff, str, l);
-            ptr->atomic_send_from_system((char *)&var, l + 4);
+// Formats the message on the stack, passing it to the target in pieces of up to message_size bytes
+struct RecordBuilder final: Logger {
+    Logger &target;
+    char buffer[Buffered_Logger::message_size];
+    size_t length = 0;
+
+    RecordBuilder(Logger &target): target(target) {}
+
+    virtual void log_nolock(const char *c, size_t size) override
+    {
+        while (size > 0) {
+            if (length == sizeof(buffer))
+                flush();
+
+            const size_t l = min(size, sizeof(buffer) - length);
+            memcpy(buffer + length, c, l);
+            length += l;
+            c += l;
+            size -= l;
         }
-    } else {
-        log_buffer.append(c, size);
     }
+
+    void flush()
+    {
+        if (length > 0)
+            target.log_nolock(buffer, length);
+        length = 0;
+    }
+};
+
+// IPC_Write_Plain
+struct LogMessage {
+    u32 type = 0x40;
+    char buff[Buffered_Logger::message_size];
+};
+
+} // namespace
+
+void Buffered_Logger::printf(const char *str, ...)
+{
+    va_list arg;
+    va_start(arg, str);
+
+    vprintf(str, arg);
+
+    va_end(arg);
 }
 
-void Buffered_Logger::set_port(ipc::Port *port, uint32_t /* flags */)
+void Buffered_Logger::vprintf(const char *str, va_list arg)
 {
-    Auto_Lock_Scope scope_lock(logger_lock);
+    RecordBuilder b(*this);
+    b.vprintf_nolock(str, arg);
+    b.flush();
+}
 
-    messaging_port_id = port->portno;
+void Buffered_Logger::log(const char *str, size_t size) { log_nolock(str, size); }
 
-    Auto_Lock_Scope port_lock(port->lock);
+void Buffered_Logger::log(const klib::string &str) { log_nolock(str.c_str(), str.size()); }
 
-    // TODO
+void Buffered_Logger::log_nolock(const char *c, size_t size)
+{
+    if (size == 0)
+        return;
+
+    // Before the per-CPU structures are set up, only the bootstrap CPU is running
+    LogRing *ring = &boot_ring;
+    if (sched::cpu_struct_works)
+        ring = &sched::get_cpu_struct()->log_ring;
+
+    const u64 timestamp = read_timestamp_counter();
+    for (size_t i = 0; i < size; i += message_size)
+        ring->push(c + i, min(size - i, message_size), timestamp);
 
-    constexpr size_t buff_size = 508;
+    schedule_flush();
+}
 
-    struct Msg {
-        u32 type = 0x40;
-        char buff[buff_size];
-    } var;
+void Buffered_Logger::schedule_flush()
+{
+    if (!sched::cpu_struct_works or !__atomic_load_n(&messaging_port_id, __ATOMIC_RELAXED))
+        return;
+
+    // Sending the messages right away would make every printf go through the port lock, and
+    // could happen with arbitrary kernel locks held. Instead, the records are picked up from the
+    // timer interrupt, where no context is held, and the messages written in the meantime are sent
+    // together.
+    auto c = sched::get_cpu_struct();
+    auto &t = c->log_flush_timer;
+    if (t.armed)
+        return;
+
+    // Set first, in case something gets logged while the timer is being armed
+    t.armed      = true;
+    t.fire_at_ns = sched::get_ns_since_bootup() + flush_delay_ns;
+    c->timer_queue.insert(&t);
+    sched::maybe_rearm_timer(t.fire_at_ns);
+}
 
-    size_t length   = log_buffer.length();
-    const char *str = log_buffer.c_str();
+void Buffered_Logger::flush()
+{
+    auto port_id = __atomic_load_n(&messaging_port_id, __ATOMIC_RELAXED);
+    if (!port_id)
+        return;
+
+    // The other CPU might have already scanned this CPU's ring, so try again later instead of
+    // leaving the records there until something else gets logged
+    if (!flush_lock.try_lock()) {
+        schedule_flush();
+        return;
+    }
+
+    auto *port = ipc::Port::atomic_get_port(port_id);
+    bool alive = false;
+    if (port) {
+        Auto_Lock_Scope port_lock(port->lock);
+        alive = port->alive;
+        // Check this since port might linger after getting deleted
+    }
+    if (!alive) {
+        flush_lock.unlock();
+        return;
+    }
 
-    for (size_t i = 0; i < length; i += buff_size) {
-        size_t buf_length = min(length - i, buff_size);
-        memcpy(var.buff, str, buf_length);
-        port->send_from_system((char *)&var, buf_length + 4);
+    LogMessage msg;
+    size_t length = 0;
+
+    auto send = [&] {
+        if (length > 0)
+            port->atomic_send_from_system((char *)&msg, length + sizeof(msg.type));
+        length = 0;
+    };
+
+    auto append = [&](const char *c, size_t size) {
+        if (length + size > message_size)
+            send();
+        memcpy(msg.buff + length, c, size);
+        length += size;
+    };
+
+    // Read before draining, so that the records dropped while doing it are not reported early
+    u64 dropped = boot_ring.get_dropped();
+    for (auto c: sched::cpus)
+        dropped += c->log_ring.get_dropped();
+
+    // Everything in the boot ring predates the per-CPU ones
+    while (auto r = boot_ring.peek()) {
+        append(r->data, r->size);
+        boot_ring.pop(r);
     }
 
-    log_buffer.clear();
+    while (true) {
+        LogRing *oldest_ring     = nullptr;
+        const LogRecord *oldest = nullptr;
+        for (auto c: sched::cpus) {
+            auto r = c->log_ring.peek();
+            if (r and (!oldest or r->timestamp < oldest->timestamp)) {
+                oldest      = r;
+                oldest_ring = &c->log_ring;
+            }
+        }
+
+        if (!oldest)
+            break;
+
+        append(oldest->data, oldest->size);
+        oldest_ring->pop(oldest);
+    }
+
+    if (dropped != reported_dropped) {
+        char number[32];
+        int l = 0;
+        uint_to_string(dropped - reported_dropped, 10, number, l);
+
+        static constexpr char prefix[] = "kernel: ";
+        static constexpr char suffix[] = " log messages were dropped\n";
+        append(prefix, sizeof(prefix) - 1);
+        append(number, l);
+        append(suffix, sizeof(suffix) - 1);
+
+        reported_dropped = dropped;
+    }
+
+    send();
+    flush_lock.unlock();
+}
+
+void Buffered_Logger::set_port(ipc::Port *port, uint32_t /* flags */)
+{
+    __atomic_store_n(&messaging_port_id, port->portno, __ATOMIC_RELEASE);
+    flush();
 }
 
 void Serial_Logger::log_nolock(const char *c, size_t size)
@@ -259,4 +402,10 @@ void Serial_Logger::log_nolock(const char *c, size_t size)
     }
 }
 
-} // namespace kernel::log
\ No newline at end of file
+} // namespace kernel::log
+
+void kernel::sched::CPU_Info::LogFlushTimerNode::fire()
+{
+    armed = false;
+    kernel::log::global_logger.flush();
+}
@@ -27,6 +27,8 @@
  */
 
 #pragma once
+#include "log_ring.hh"
+
 #include <lib/memory.hh>
 #include <lib/string.hh>
 #include <messaging/messaging.hh>
@@ -64,20 +66,46 @@ struct Logger {
 /**
  * @brief A global buffered kernel logger.
  *
- * This is a default logger where the kernel should write its information logs and whatnot. It is
- * backed by an infinite, dynamically-growing buffer where the messages are stored if the
- * messaging_port is unavailable. If it is available, the messages are automatically sent there with
- * the IPC_Write_Plain messages. The port can be set by issuing syscall_set_log_port()
+ * This is a default logger where the kernel should write its information logs and whatnot. The
+ * messages are stored without taking any locks as timestamped records in the fixed-size ring of the
+ * CPU they were written on, or in the boot ring before the per-CPU structures are set up. Once the
+ * messaging_port is set by syscall_set_log_port(), the rings are drained into it shortly after the
+ * messages are written, in the timestamp order and batched into IPC_Write_Plain messages. If a ring
+ * fills up, the new messages are dropped and the number of lost ones is reported in the log.
  *
  * @see syscall_set_log_port()
  */
 struct Buffered_Logger: Logger {
-    klib::string log_buffer;
+    // Size of the text in IPC_Write_Plain message. The records are not larger than this.
+    static constexpr size_t message_size = 508;
+    // How long the messages are accumulated before being sent to the port
+    static constexpr u64 flush_delay_ns = 10'000'000;
+
     u64 messaging_port_id = 0;
 
+    StaticLogRing<65536> boot_ring;
+
+    // These shadow the Logger ones and don't lock logger_lock. printf() and vprintf() produce a
+    // single record for the message, so that it doesn't get interleaved with the other CPUs.
+    void printf(const char *format, ...);
+    void vprintf(const char *format, va_list list);
+    void log(const klib::string &s);
+    void log(const char *s, size_t size);
+
     virtual void log_nolock(const char *c, size_t size) override;
 
     void set_port(ipc::Port *port, uint32_t flags);
+
+    // Sends the accumulated records to the port. Does nothing if the port is not set, and retries
+    // from the timer if another CPU is already doing it.
+    void flush();
+
+private:
+    CriticalSpinlock flush_lock;
+    // Dropped records that were already reported. Protected by flush_lock
+    u64 reported_dropped = 0;
+
+    void schedule_flush();
 };
 extern Buffered_Logger global_logger;
 
@@ -0,0 +1,76 @@
+#include "log_ring.hh"
+
+#include <utils.hh>
+
+namespace kernel::log
+{
+
+static size_t record_length(size_t data_size)
+{
+    return (sizeof(LogRecord) + data_size + LogRing::record_alignment - 1) &
+           ~(LogRing::record_alignment - 1);
+}
+
+bool LogRing::push(const char *data, size_t length, u64 timestamp)
+{
+    length                   = min(length, max_record_size());
+    const size_t record_size = record_length(length);
+
+    u64 h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    size_t padding;
+    do {
+        const u64 t         = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+        const size_t offset = h & (size - 1);
+        // Records don't wrap around, so that the reader can hand them out as they are
+        padding = offset + record_size > size ? size - offset : 0;
+        if (h + padding + record_size - t > size) {
+            __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&head, &h, h + padding + record_size, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if (padding) {
+        auto gap  = reinterpret_cast<LogRecord *>(buffer + (h & (size - 1)));
+        gap->size = padding;
+        __atomic_store_n(&gap->state, LogRecord::STATE_COMMITTED | LogRecord::STATE_PADDING,
+                         __ATOMIC_RELEASE);
+        h += padding;
+    }
+
+    auto r       = reinterpret_cast<LogRecord *>(buffer + (h & (size - 1)));
+    r->size      = length;
+    r->timestamp = timestamp;
+    memcpy(r->data, data, length);
+    __atomic_store_n(&r->state, LogRecord::STATE_COMMITTED, __ATOMIC_RELEASE);
+    return true;
+}
+
+const LogRecord *LogRing::peek()
+{
+    while (true) {
+        const u64 t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        auto r      = reinterpret_cast<LogRecord *>(buffer + (t & (size - 1)));
+
+        // The consumed space is zeroed, so this also catches the empty ring
+        const u32 state = __atomic_load_n(&r->state, __ATOMIC_ACQUIRE);
+        if (!(state & LogRecord::STATE_COMMITTED))
+            return nullptr;
+
+        if (!(state & LogRecord::STATE_PADDING))
+            return r;
+
+        const size_t gap = r->size;
+        memset(r, 0, gap);
+        __atomic_store_n(&tail, t + gap, __ATOMIC_RELEASE);
+    }
+}
+
+void LogRing::pop(const LogRecord *record)
+{
+    const size_t length = record_length(record->size);
+    memset(const_cast<LogRecord *>(record), 0, length);
+    __atomic_store_n(&tail, __atomic_load_n(&tail, __ATOMIC_RELAXED) + length, __ATOMIC_RELEASE);
+}
+
+} // namespace kernel::log
@@ -0,0 +1,72 @@
+#pragma once
+#include <types.hh>
+
+namespace kernel::log
+{
+
+// Header of the record in the LogRing. The text follows it, and the whole record is padded to
+// LogRing::record_alignment.
+struct LogRecord {
+    // Set last, once the record is written. 0 means that the space is either free or still being
+    // filled in.
+    u32 state;
+    u32 size;
+    u64 timestamp;
+    char data[];
+
+    static constexpr u32 STATE_COMMITTED = 0x01;
+    // Unused space at the end of the ring. size is the length of the whole gap, including the
+    // header.
+    static constexpr u32 STATE_PADDING = 0x02;
+};
+
+/**
+ * @brief Fixed-size ring of log records
+ *
+ * Any number of writers can add records without taking locks, including the nested ones, e.g. from
+ * an interrupt which arrived while a record was being written. The space is reserved by advancing
+ * head, filled in and then published by setting the record state. There must be only one reader,
+ * which zeroes the records after consuming them so that their space reads as unpublished again.
+ *
+ * If the ring is full, the new records are discarded and counted in dropped.
+ */
+struct LogRing {
+    static constexpr size_t record_alignment = sizeof(LogRecord);
+
+    char *buffer;
+    // Power of 2, multiple of record_alignment
+    size_t size;
+
+    u64 head    = 0;
+    u64 tail    = 0;
+    u64 dropped = 0;
+
+    constexpr LogRing(char *buffer, size_t size): buffer(buffer), size(size) {}
+
+    // Largest message which fits into a single record
+    size_t max_record_size() const { return size / 4 - sizeof(LogRecord); }
+
+    // Adds the record, truncating it to max_record_size(). Returns false if there was no space.
+    bool push(const char *data, size_t length, u64 timestamp);
+
+    // Returns the oldest published record, or nullptr if there are none. Reader only.
+    const LogRecord *peek();
+
+    // Frees the record returned by peek(). Reader only.
+    void pop(const LogRecord *record);
+
+    u64 get_dropped() const { return __atomic_load_n(&dropped, __ATOMIC_RELAXED); }
+};
+
+// LogRing with its own storage
+template<size_t Size> struct StaticLogRing: LogRing {
+    static_assert((Size & (Size - 1)) == 0);
+
+    alignas(LogRing::record_alignment) char storage[Size];
+
+    // Constant-initialized, so that the global rings are usable before the constructors are run
+    constexpr StaticLogRing(): LogRing(storage, Size), storage {} {}
+    StaticLogRing(const StaticLogRing &) = delete;
+};
+
+} // namespace kernel::log
@@ -0,0 +1,123 @@
+#include "lockstat.hh"
+
+#include <clock.hh>
+#include <utils.hh>
+
+#ifdef ENABLE_LOCKSTAT
+
+namespace kernel::lockstat
+{
+
+namespace
+{
+
+struct Site {
+    void *ip;
+    u64 acquisitions;
+    u64 contended;
+    u64 spin_ticks;
+    u64 hold_ticks;
+    u64 max_hold_ticks;
+};
+
+// Statically zero-initialized, so that the locks can be taken before the constructors are run
+Site sites[max_sites];
+
+constexpr u32 overflow_site = 0;
+
+u32 find_site(void *ip) noexcept
+{
+    const size_t hash = ((ulong)ip >> 2) * 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < max_sites - 1; ++i) {
+        u32 idx = 1 + (hash + i) % (max_sites - 1);
+
+        void *current = __atomic_load_n(&sites[idx].ip, __ATOMIC_ACQUIRE);
+        if (current == ip)
+            return idx;
+
+        if (current == nullptr) {
+            if (__atomic_compare_exchange_n(&sites[idx].ip, &current, ip, false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE) or
+                current == ip)
+                return idx;
+        }
+    }
+
+    return overflow_site;
+}
+
+} // namespace
+
+u64 now() noexcept { return read_timestamp_counter(); }
+
+void acquired(Holder &h, void *site, bool contended, u64 spin_start) noexcept
+{
+    u32 idx = find_site(site);
+    auto &s = sites[idx];
+
+    u64 t = now();
+    __atomic_add_fetch(&s.acquisitions, 1, __ATOMIC_RELAXED);
+    if (contended) {
+        __atomic_add_fetch(&s.contended, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s.spin_ticks, t - spin_start, __ATOMIC_RELAXED);
+    }
+
+    h.site        = idx;
+    h.acquired_at = t;
+}
+
+void released(Holder &h) noexcept
+{
+    auto &s  = sites[h.site];
+    u64 hold = now() - h.acquired_at;
+
+    __atomic_add_fetch(&s.hold_ticks, hold, __ATOMIC_RELAXED);
+
+    u64 max = __atomic_load_n(&s.max_hold_ticks, __ATOMIC_RELAXED);
+    while (hold > max and !__atomic_compare_exchange_n(&s.max_hold_ticks, &max, hold, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+ReturnStr<bool> copy_to_user(lockstat_entry *user_buffer, size_t count, bool reset,
+                             size_t &total)
+{
+    total = 0;
+    for (size_t i = 0; i < max_sites; ++i) {
+        auto &s = sites[i];
+        if (!__atomic_load_n(&s.acquisitions, __ATOMIC_RELAXED))
+            continue;
+
+        if (total < count) {
+            lockstat_entry e = {
+                .site           = (u64)(ulong)__atomic_load_n(&s.ip, __ATOMIC_RELAXED),
+                .acquisitions   = __atomic_load_n(&s.acquisitions, __ATOMIC_RELAXED),
+                .contended      = __atomic_load_n(&s.contended, __ATOMIC_RELAXED),
+                .spin_ticks     = __atomic_load_n(&s.spin_ticks, __ATOMIC_RELAXED),
+                .hold_ticks     = __atomic_load_n(&s.hold_ticks, __ATOMIC_RELAXED),
+                .max_hold_ticks = __atomic_load_n(&s.max_hold_ticks, __ATOMIC_RELAXED),
+            };
+
+            auto result = ::copy_to_user((char *)&e, (char *)(user_buffer + total), sizeof(e));
+            if (!result.success() or !result.val)
+                return result;
+        }
+
+        ++total;
+    }
+
+    if (reset)
+        for (auto &s: sites) {
+            __atomic_store_n(&s.acquisitions, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&s.contended, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&s.spin_ticks, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&s.hold_ticks, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&s.max_hold_ticks, 0, __ATOMIC_RELAXED);
+        }
+
+    return true;
+}
+
+} // namespace kernel::lockstat
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+#include <kernel/lockstat.h>
+#include <types.hh>
+
+// Spinlock statistics, collected when the kernel is built with ENABLE_LOCKSTAT. The statistics are
+// keyed by the return address of lock(), which is the code taking the lock.
+namespace kernel::lockstat
+{
+
+// Number of distinct call sites that can be tracked. The sites which don't fit are accounted to
+// the entry with the null address.
+inline constexpr size_t max_sites = 1024;
+
+// Copies up to count entries to the user buffer, optionally clearing the counters, and sets total
+// to the number of the sites with statistics. Follows ::copy_to_user() in the return value.
+ReturnStr<bool> copy_to_user(lockstat_entry *user_buffer, size_t count, bool reset,
+                             size_t &total);
+
+} // namespace kernel::lockstat
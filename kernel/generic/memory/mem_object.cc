@@ -61,9 +61,9 @@ Mem_Object::~Mem_Object()
 klib::shared_ptr<Mem_Object> Mem_Object::create(u64 page_size_log, u64 size_pages, int flags)
 {
     // Create new object
-    klib::shared_ptr<Mem_Object> ptr(new Mem_Object(
+    auto ptr = klib::make_shared<Mem_Object>(
         page_size_log, size_pages,
-        Protection::Readable | Protection::Writeable | Protection::Executable, flags));
+        Protection::Readable | Protection::Writeable | Protection::Executable, flags);
     if (!ptr)
         return nullptr;
 
@@ -78,6 +78,11 @@ klib::shared_ptr<Mem_Object> Mem_Object::create(u64 page_size_log, u64 size_page
         assert(page->pending_alloc_head.size_pages == count);
         assert(!(page->flags & pmm::Page::FLAG_NO_PAGE));
 
+        // The pages are given to userspace, so the previous contents must not be leaked. Each of
+        // the runs is contiguous and is cleared in as few mappings as possible.
+        for (auto p = page; p; p = p->pending_alloc_head.next)
+            clear_pages(p->pending_alloc_head.phys_addr, p->pending_alloc_head.size_pages);
+
         for (u64 i = 0; i < count; ++i) {
             auto current = page;
             if (page->pending_alloc_head.size_pages > 1) {
@@ -113,7 +118,7 @@ klib::shared_ptr<Mem_Object> Mem_Object::create_from_phys(u64 phys_addr, u64 siz
     assert(take_ownership && "not taking ownership is not implemented");
 
     // Create new object
-    klib::shared_ptr<Mem_Object> ptr(new Mem_Object(12, pages_count, max_user_permissions, 0));
+    auto ptr = klib::make_shared<Mem_Object>(12, pages_count, max_user_permissions, 0);
     if (!ptr)
         return nullptr;
 
@@ -250,8 +255,7 @@ ReturnStr<pmm::Page_Descriptor> Mem_Object::request_page(u64 offset, bool write,
 
         return pmm::Page_Descriptor::none();
     } else {
-        // TODO
-        auto pager_port = pager;
+        auto pager_port = pager_port_id ? ipc::Port::atomic_get_port(pager_port_id) : nullptr;
         if (not pager_port) {
             auto pp = pmm::Page_Descriptor::allocate_page_zeroed(page_size_log);
             if (!pp.success())
@@ -278,20 +282,111 @@ ReturnStr<pmm::Page_Descriptor> Mem_Object::request_page(u64 offset, bool write,
             .page_offset   = offset,
         };
         auto result = pager_port->atomic_send_from_system(reinterpret_cast<char *>(&request),
-                                                          sizeof(request));
+                                                          sizeof(request), pager_right_id);
         if (result)
             return Error(result);
 
+        // Leave a placeholder, so the page is only requested once
         p.page_struct_ptr->l.offset = offset;
         p.page_struct_ptr->l.next   = pages_storage;
+        p.page_struct_ptr->l.owner  = this;
         pages_storage               = p.page_struct_ptr;
-        p.takeout_page();
+        p.page_struct_ptr           = nullptr;
         return pmm::Page_Descriptor::none();
     }
 
     assert(false);
 }
 
+kresult_t Mem_Object::atomic_set_pager(u64 port_id, u64 right_id)
+{
+    Auto_Lock_Scope l(lock);
+    if (pager_port_id)
+        return -EEXIST;
+
+    pager_port_id  = port_id;
+    pager_right_id = right_id;
+    return 0;
+}
+
+u64 Mem_Object::atomic_get_pager_port()
+{
+    Auto_Lock_Scope l(lock);
+    return pager_port_id;
+}
+
+ReturnStr<bool> Mem_Object::atomic_wait_for_page(u64 offset, u64 page_table_id)
+{
+    Auto_Lock_Scope l(lock);
+
+    offset &= ~0xfffUL;
+    auto page = pages_storage;
+    while (page and page->l.offset != offset)
+        page = page->l.next;
+
+    if (page and page->has_physical_page())
+        return false;
+
+    for (auto id: pager_waiters)
+        if (id == page_table_id)
+            return true;
+
+    if (!pager_waiters.push_back(page_table_id))
+        return Error(-ENOMEM);
+
+    return true;
+}
+
+kresult_t Mem_Object::atomic_provide_page(u64 offset, pmm::Page_Descriptor page)
+{
+    assert(page.page_struct_ptr);
+
+    klib::vector<u64> waiters;
+    {
+        Auto_Lock_Scope l(lock);
+
+        if ((offset >> page_size_log) >= pages_size)
+            return -EINVAL;
+
+        offset &= ~0xfffUL;
+        pmm::Page **p = &pages_storage;
+        while (*p and (*p)->l.offset != offset)
+            p = &(*p)->l.next;
+
+        if (*p) {
+            if ((*p)->has_physical_page())
+                return -EEXIST;
+
+            // Drop the placeholder of the pending request
+            auto placeholder = *p;
+            *p               = placeholder->l.next;
+            pmm::Page_Descriptor::from_raw_ptr(placeholder);
+        }
+
+        auto s        = page.page_struct_ptr;
+        s->l.offset   = offset;
+        s->l.owner    = this;
+        s->l.next     = pages_storage;
+        pages_storage = s;
+        page.takeout_page();
+
+        waiters = klib::move(pager_waiters);
+    }
+
+    // The faulting tasks hold the page table lock until they are blocked, so taking it here
+    // guarantees that the wakeups are not lost
+    for (auto id: waiters) {
+        auto table = Page_Table::get_page_table(id);
+        if (!table)
+            continue;
+
+        Auto_Lock_Scope l(table->lock);
+        table->unblock_tasks_waiting_for(this);
+    }
+
+    return 0;
+}
+
 // kresult_t Mem_Object::atomic_resize(u64 new_size_pages)
 // {
 //     Auto_Lock_Scope resize_l(resize_lock);
@@ -191,6 +191,33 @@ public:
 
     void atomic_remove_anonymous_page(kernel::pmm::Page *page);
 
+    /// Sets the pager. The requests are sent to the port as if they came through the right
+    /// right_id, so that the pager can serve several objects from one port. The pager can only be
+    /// set once, since anyone holding the object's right could otherwise take it over.
+    kresult_t atomic_set_pager(u64 port_id, u64 right_id);
+
+    /// Returns the port of the pager, or 0 if the object has none
+    u64 atomic_get_pager_port();
+
+    /**
+     * @brief Registers the page table as waiting for the page from the pager
+     *
+     * The tasks of the page table blocked on the mappings of this object are unblocked once the
+     * page is provided.
+     *
+     * @return true if the task should be blocked, false if the page has been provided in the
+     * meantime and the fault should be retried
+     */
+    ReturnStr<bool> atomic_wait_for_page(u64 offset, u64 page_table_id);
+
+    /**
+     * @brief Inserts the page provided by the pager
+     *
+     * Replaces the pending request for the page, if any, and unblocks the tasks waiting for it.
+     * Fails with -EEXIST if the object already has the page.
+     */
+    kresult_t atomic_provide_page(u64 offset, kernel::pmm::Page_Descriptor page);
+
 protected:
     Mem_Object() = delete;
 
@@ -200,6 +227,7 @@ protected:
     /// @param max_user_permission Maximum user permission that can be granted to user space
     /// mapping the pages
     Mem_Object(u64 page_size_log, u64 size_pages, u32 max_user_permission, int flags);
+    template<class T, class... Args> friend klib::shared_ptr<T> klib::make_shared(Args &&...);
 
     /**
      * @brief Id of the memory region
@@ -260,11 +288,15 @@ protected:
      * @brief Pager for the region
      *
      * A pager is used for page faults. Upon an attempt to reference the page, if it is found
-     * that the page is not allocated, a message is sent to the port to try and allocate the
-     * page. If the pager has not been able to provide the page, an attempt to allocate a
-     * zero-filled page will be made.
+     * that the page is not allocated, IPC_Kernel_Request_Page is sent to the port and the page
+     * stays pending until it is provided with atomic_provide_page(). If there is no pager or its
+     * port no longer exists, a zero-filled page is allocated.
      */
-    ipc::Port *pager = nullptr;
+    u64 pager_port_id  = 0;
+    u64 pager_right_id = 0;
+
+    /// IDs of the page tables with tasks waiting for the pages from the pager
+    klib::vector<u64> pager_waiters;
 
     kresult_t push_anonymous_page(kernel::pmm::Page *page);
 
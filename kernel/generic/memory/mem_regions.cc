@@ -268,6 +268,20 @@ Page_Table_Arguments Mem_Object_Reference::craft_arguments(void *) const
     };
 }
 
+const Mem_Object *Mem_Object_Reference::shared_object_at(void *addr, u64 &offset) const noexcept
+{
+    // The CoW pages become private once written to
+    if (cow)
+        return nullptr;
+
+    const u64 reg_addr = (char *)addr - (char *)start_addr;
+    if (reg_addr < start_offset_bytes or reg_addr >= start_offset_bytes + object_size_bytes)
+        return nullptr;
+
+    offset = reg_addr - start_offset_bytes + object_offset_bytes;
+    return references.get();
+}
+
 ReturnStr<bool> Mem_Object_Reference::alloc_page(void *ptr_addr, Page_Table::Page_Info mapping,
                                                  unsigned access_type)
 {
@@ -312,7 +326,8 @@ ReturnStr<bool> Mem_Object_Reference::alloc_page(void *ptr_addr, Page_Table::Pag
                 return page.propagate();
 
             if (not page.val.page_struct_ptr)
-                return false;
+                return wait_for_page(ptr_addr, mapping, access_type,
+                                     reg_addr - start_offset_bytes + object_offset_bytes);
 
             // TODO
             auto addr_aligned = (ulong)ptr_addr & ~0xffful;
@@ -332,7 +347,8 @@ ReturnStr<bool> Mem_Object_Reference::alloc_page(void *ptr_addr, Page_Table::Pag
             return page.propagate();
 
         if (not page.val.page_struct_ptr)
-            return false;
+            return wait_for_page(ptr_addr, mapping, access_type,
+                                 reg_addr - start_offset_bytes + object_offset_bytes);
 
         if (reg_addr >= start_offset_bytes and
             reg_addr + 0x1000 <= start_offset_bytes + object_size_bytes) {
@@ -375,7 +391,7 @@ ReturnStr<bool> Mem_Object_Reference::alloc_page(void *ptr_addr, Page_Table::Pag
             return page.propagate();
 
         if (not page.val.page_struct_ptr)
-            return false;
+            return wait_for_page(ptr_addr, mapping, access_type, reg_addr);
 
         auto result = owner->map(klib::move(page.val), (void *)addr_aligned, craft_arguments(ptr_addr));
         if (result)
@@ -385,6 +401,19 @@ ReturnStr<bool> Mem_Object_Reference::alloc_page(void *ptr_addr, Page_Table::Pag
     }
 }
 
+ReturnStr<bool> Mem_Object_Reference::wait_for_page(void *ptr_addr, Page_Info info,
+                                                    unsigned access_type, u64 object_offset)
+{
+    auto wait = references->atomic_wait_for_page(object_offset, owner->id);
+    if (!wait.success())
+        return wait.propagate();
+
+    if (wait.val)
+        return false;
+
+    return alloc_page(ptr_addr, info, access_type);
+}
+
 kresult_t Mem_Object_Reference::move_to(TLBShootdownContext &ctx,
                                         const klib::shared_ptr<Page_Table> &new_table,
                                         void *base_addr, unsigned new_access)
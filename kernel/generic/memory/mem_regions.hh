@@ -57,6 +57,7 @@ namespace paging
     };
 
     class Page_Table;
+    class Mem_Object;
     struct Page_Info;
 
     struct Page_Table_Arguments;
@@ -202,6 +203,22 @@ namespace paging
 
         constexpr virtual bool is_managed() const noexcept { return false; }
 
+        /**
+         * @brief Identifies the memory shared through the region at the address
+         *
+         * Returns the memory object and sets *offset* to the offset in it if the writes to the
+         * address are seen by the other mappings of the object, or nullptr otherwise.
+         */
+        virtual const Mem_Object *shared_object_at(void *addr, u64 &offset) const noexcept
+        {
+            (void)addr;
+            (void)offset;
+            return nullptr;
+        }
+
+        /// Returns the memory object the pages of the region come from, if any
+        virtual const Mem_Object *referenced_object() const noexcept { return nullptr; }
+
         /**
          * @brief Moves the region to the new page table
          *
@@ -318,6 +335,13 @@ namespace paging
 
         virtual Page_Table_Arguments craft_arguments(void *for_ptr) const override;
 
+        virtual const Mem_Object *shared_object_at(void *addr, u64 &offset) const noexcept override;
+
+        virtual const Mem_Object *referenced_object() const noexcept override
+        {
+            return references.get();
+        }
+
         /**
          * Returns the end byte of the memory object that is referenced by the region
          */
@@ -329,6 +353,12 @@ namespace paging
 
         void trim(void *new_start_addr, size_t new_size_bytes) noexcept override;
         kresult_t punch_hole(void *hole_addr_start, size_t hole_size_bytes) override;
+
+    protected:
+        /// Called when the page at object_offset is still being fetched by the pager. Blocks the
+        /// task until it arrives, or retries the fault if it already has.
+        ReturnStr<bool> wait_for_page(void *ptr_addr, Page_Info info, unsigned access_type,
+                                      u64 object_offset);
     };
 
 }; // namespace paging
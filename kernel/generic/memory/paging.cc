@@ -106,6 +106,17 @@ ReturnStr<bool> Page_Table::atomic_copy_to_user(void *to, const void *from, size
     return true;
 }
 
+const Mem_Object *Page_Table::atomic_shared_object_at(void *addr, u64 &offset)
+{
+    Auto_Lock_Scope l(lock);
+
+    auto it = get_region(addr);
+    if (it == paging_regions.end())
+        return nullptr;
+
+    return it->shared_object_at(addr, offset);
+}
+
 kresult_t Page_Table::release_in_range(TLBShootdownContext &ctx, void *start_addr, size_t size)
 {
     bool clean_pages = false;
@@ -349,6 +360,25 @@ void Page_Table::unblock_tasks(void *page)
         it->atomic_try_unblock_by_page(page);
 }
 
+void Page_Table::unblock_tasks_waiting_for(const Mem_Object *object)
+{
+    assert(lock.is_locked());
+
+    for (const auto &it: owner_tasks) {
+        // Checked again under the task's lock by atomic_try_unblock_by_page()
+        void *page = __atomic_load_n(&it->page_blocked_by, __ATOMIC_RELAXED);
+        if (!page)
+            continue;
+
+        auto region = paging_regions.get_smaller_or_equal(page);
+        if (region == paging_regions.end() or not region->is_in_range(page) or
+            region->referenced_object() != object)
+            continue;
+
+        it->atomic_try_unblock_by_page(page);
+    }
+}
+
 kresult_t Page_Table::map(u64 page_addr, void *virt_addr) noexcept
 {
     auto it = get_region(virt_addr);
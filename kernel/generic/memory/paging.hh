@@ -541,6 +541,10 @@ public:
      */
     virtual ReturnStr<bool> atomic_copy_to_user(void *to, const void *from, size_t size);
 
+    /// Returns the memory object shared at the address and sets *offset* to the offset in it, or
+    /// nullptr if the address is not in a shared mapping of one
+    const Mem_Object *atomic_shared_object_at(void *addr, u64 &offset);
+
     /// @brief Checks if the pages exists and invalidates it, invalidating TLB entries if needed
     /// @param virt_addr Virtual address of the page
     /// @param free Indicates whether the page should be freed or not after invalidating
@@ -559,6 +563,10 @@ public:
     // TODO: Calling this on page table is weird
     static void trigger_shootdown(Page_Table *maybe_page_table, sched::CPU_Info *cpu);
 
+    /// Unblocks the tasks waiting for the pages of the memory object. Must be called with the lock
+    /// held.
+    void unblock_tasks_waiting_for(const Mem_Object *object);
+
     virtual inline void arch_specific_shutdown_stuff(u16 flags)
     {
         (void)flags;
@@ -39,15 +39,7 @@ ReturnStr<Page_Descriptor> Page_Descriptor::create_copy() const noexcept
     if (!new_page.success())
         return new_page.propagate();
 
-    Temp_Mapper_Obj<char> this_mapping(request_temp_mapper());
-    Temp_Mapper_Obj<char> new_mapping(request_temp_mapper());
-
-    this_mapping.map(page_struct_ptr->get_phys_addr());
-    new_mapping.map(new_page.val.page_struct_ptr->get_phys_addr());
-
-    const auto page_size_bytes = 4096;
-
-    memcpy(new_mapping.ptr, this_mapping.ptr, page_size_bytes);
+    copy_pages(page_struct_ptr->get_phys_addr(), new_page.val.page_struct_ptr->get_phys_addr(), 1);
 
     return new_page;
 }
@@ -212,15 +204,7 @@ Page_Descriptor Page_Table::Page_Info::create_copy() const
     if (!new_page.success())
         return {};
 
-    Temp_Mapper_Obj<char> this_mapping(request_temp_mapper());
-    Temp_Mapper_Obj<char> new_mapping(request_temp_mapper());
-
-    this_mapping.map(page_addr);
-    new_mapping.map(new_page.val.page_struct_ptr->get_phys_addr());
-
-    const auto page_size_bytes = 4096;
-
-    memcpy(new_mapping.ptr, this_mapping.ptr, page_size_bytes);
+    copy_pages(page_addr, new_page.val.page_struct_ptr->get_phys_addr(), 1);
 
     return klib::move(new_page.val);
 }
@@ -579,19 +563,23 @@ Page *kernel::pmm::alloc_pages(size_t count, bool /* contiguous */, AllocPolicy
     // for large allocations, when the system is low on memory
     // (maybe not)
 
+    Page *ptr = nullptr;
     if (policy == AllocPolicy::Normal) {
-        auto ptr = alloc_pages_from(region_above_4gb, count);
+        ptr = alloc_pages_from(region_above_4gb, count);
         if (!ptr)
             ptr = alloc_pages_from(region_below_4gb, count);
-
-        return ptr;
     } else if (policy == AllocPolicy::Below4GB) {
-        return alloc_pages_from(region_below_4gb, count);
+        ptr = alloc_pages_from(region_below_4gb, count);
     } else if (policy == AllocPolicy::ISA) {
-        return alloc_pages_from(region_isa, count);
+        ptr = alloc_pages_from(region_isa, count);
     }
 
-    return nullptr;
+    // The pages released recently are only freed after the paging RCU grace period, which can take
+    // a while if the other CPUs don't switch tasks. Hurry it up, so that the retry has a chance.
+    if (!ptr)
+        memory::expedite_grace_periods();
+
+    return ptr;
 }
 
 PMMRegion *PMMRegion::get(Page::page_addr_t start_addr)
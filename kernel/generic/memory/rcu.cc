@@ -1,5 +1,8 @@
 #include "rcu.hh"
 
+#include <processes/tasks.hh>
+#include <sched/sched.hh>
+
 using namespace kernel::memory;
 
 bool RCU::cpu_bit_set(size_t cpu_id) noexcept
@@ -34,6 +37,12 @@ void RCU::start_generation() noexcept
     highest_generation = generation + 1;
 }
 
+bool RCU::cpu_pending(size_t cpu_id) noexcept
+{
+    Auto_Lock_Scope l(lock);
+    return cpu_bit_set(cpu_id);
+}
+
 void RCU_CPU::quiet(RCU &parent, size_t my_cpu_id)
 {
     if (parent.cpu_bit_set(my_cpu_id)) {
@@ -50,17 +59,28 @@ void RCU_CPU::quiet(RCU &parent, size_t my_cpu_id)
     }
 
     if (current_callbacks and (parent.generation > generation)) {
-        while (current_callbacks) {
-            // TODO: This can be delayed, e.g. to be executed while the CPU is idling
-            RCU_Head *next = current_callbacks->rcu_next;
-            current_callbacks->rcu_func(current_callbacks, next and (next->rcu_func == current_callbacks->rcu_func));
-            current_callbacks = next;
-        }
+        // Keep the order, so that the chained callbacks stay next to each other
+        if (ready_callbacks)
+            ready_last->rcu_next = current_callbacks;
+        else
+            ready_callbacks = current_callbacks;
+        ready_last = current_last;
+        ready_count += current_count;
+        if (ready_count > max_ready)
+            max_ready = ready_count;
+
+        current_callbacks = nullptr;
+        current_last      = nullptr;
+        current_count     = 0;
     }
 
     if ((!current_callbacks) and next_callbacks) {
         current_callbacks = next_callbacks;
+        current_last      = next_last;
+        current_count     = next_count;
         next_callbacks    = nullptr;
+        next_last         = nullptr;
+        next_count        = 0;
 
         Auto_Lock_Scope l(parent.lock);
         generation = parent.generation + 1;
@@ -72,4 +92,79 @@ void RCU_CPU::quiet(RCU &parent, size_t my_cpu_id)
             parent.start_generation();
         }
     }
-}
\ No newline at end of file
+}
+
+bool RCU_CPU::run_callbacks(size_t limit)
+{
+    for (size_t i = 0; i < limit and ready_callbacks; ++i) {
+        // The callback might push new ones, so the list must be consistent before calling it
+        RCU_Head *head  = ready_callbacks;
+        RCU_Head *next  = head->rcu_next;
+        ready_callbacks = next;
+        if (!next)
+            ready_last = nullptr;
+        --ready_count;
+        ++callbacks_run;
+
+        head->rcu_func(head, next and (next->rcu_func == head->rcu_func));
+    }
+
+    return ready_callbacks != nullptr;
+}
+
+namespace kernel::sched
+{
+extern bool cpu_struct_works;
+}
+
+void kernel::memory::expedite_grace_periods()
+{
+    if (!sched::cpu_struct_works)
+        return;
+
+    auto self = sched::get_cpu_struct();
+    bool sent = false;
+    for (auto c: sched::cpus) {
+        // The current CPU might be holding references, so it has to wait for its own quiescent state
+        if (c == self)
+            continue;
+
+        if (!sched::heap_rcu.cpu_pending(c->cpu_id) and !sched::paging_rcu.cpu_pending(c->cpu_id))
+            continue;
+
+        Auto_Lock_Scope l(c->attention_queue_lock);
+        if (c->rcu_expedite_node.queued)
+            continue;
+
+        c->rcu_expedite_node.queued = true;
+        c->attention_queue.push_back(&c->rcu_expedite_node);
+        c->ipi_get_attention();
+        sent = true;
+    }
+
+    if (sent) {
+        __atomic_add_fetch(&sched::heap_rcu.expedited_count, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&sched::paging_rcu.expedited_count, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void kernel::sched::CPU_Info::RCUExpediteNode::get_attention()
+{
+    auto c = get_cpu_struct();
+    {
+        Auto_Lock_Scope l(c->attention_queue_lock);
+        c->attention_queue.erase(this);
+        queued = false;
+    }
+
+    // Called from the interrupt, which means that the CPU was either in the userspace or idle, so,
+    // like in the timer interrupt, no references are held
+    c->heap_rcu_cpu.quiet(heap_rcu, c->cpu_id);
+
+    // The paging RCU is normally quieted when the page table is switched, since that flushes the
+    // TLB. The tasks without their own page table run on the idle one, which has no user mappings
+    // to flush.
+    if (c->current_task->page_table)
+        c->current_task->page_table->tlb_flush_all();
+    c->paging_rcu_cpu.quiet(paging_rcu, c->cpu_id);
+}
@@ -65,6 +65,14 @@ public:
 
     ~RCU() = default;
 
+    // Number of the grace periods that have been forced with expedite_grace_periods()
+    u64 expedited_count = 0;
+
+    u64 get_generation() const noexcept { return __atomic_load_n(&generation, __ATOMIC_RELAXED); }
+
+    // Returns true if the CPU has not passed through a quiescent state in the current generation
+    bool cpu_pending(size_t cpu_id) noexcept;
+
 private:
     Spinlock lock;
     klib::vector<u64> bitmask;
@@ -80,17 +88,58 @@ private:
     friend struct RCU_CPU;
 };
 
+/**
+ * @brief Per-CPU part of the RCU
+ *
+ * The callbacks are pushed to next_callbacks, which become current_callbacks when the new
+ * generation is started for them. Once it's complete, quiet() moves them to ready_callbacks, from
+ * where they are executed by run_callbacks() in batches, so that freeing a lot of objects at once
+ * doesn't stall the timer interrupt. Only the owning CPU touches these lists, with interrupts
+ * disabled.
+ */
 struct RCU_CPU {
     RCU_Head *current_callbacks = nullptr, *next_callbacks = nullptr;
+    RCU_Head *ready_callbacks = nullptr;
+    // Last elements of the lists, for appending to ready_callbacks
+    RCU_Head *current_last = nullptr, *next_last = nullptr, *ready_last = nullptr;
     u64 generation = 0;
 
+    // Lengths of the lists and the statistics. Written by the owning CPU only, read racily by the
+    // others.
+    u64 current_count = 0, next_count = 0, ready_count = 0;
+    u64 callbacks_run = 0;
+    u64 max_ready     = 0;
+
+    // Number of the callbacks waiting for the grace period, after which the CPU asks the other ones
+    // to hurry up
+    static constexpr u64 expedite_threshold = 4096;
+
     void push(RCU_Head *head)
     {
+        if (!next_callbacks)
+            next_last = head;
+
         head->rcu_next = next_callbacks;
         next_callbacks = head;
+        ++next_count;
     }
 
+    // Reports the quiescent state of the CPU and collects the callbacks whose grace period has
+    // ended. Does not run them.
     void quiet(RCU &parent, size_t my_cpu_id);
+
+    // Runs up to limit ready callbacks. Returns true if there are more left.
+    bool run_callbacks(size_t limit);
+
+    bool has_ready_callbacks() const { return ready_callbacks != nullptr; }
+
+    // Returns true if the backlog is large enough to warrant an expedited grace period
+    bool backlog_high() const { return current_count + next_count >= expedite_threshold; }
 };
 
+// Makes all of the other CPUs pass through a quiescent state for both paging_rcu and heap_rcu as
+// soon as possible, by sending them IPIs, instead of waiting for their timer interrupts and task
+// switches. Used when the memory is running low and the pending callbacks would free some.
+void expedite_grace_periods();
+
 } // namespace kernel::memory
\ No newline at end of file
@@ -42,6 +42,79 @@ u64 temp_mapper_get_index(u64 addr) { return (addr / 4096) % 512; }
 
 u64 temp_mapper_get_offset() { return temp_mapper_start_addr + temp_mapper_offset * 4096; }
 
+void *Slot_Temp_Mapper::kern_map(u64 phys_frame)
+{
+    const u32 free = ~used_slots & ((1U << slots_count) - 1);
+    if (free == 0)
+        return nullptr;
+
+    const unsigned slot = __builtin_ctz(free);
+    used_slots |= 1U << slot;
+    set_entry(slot, phys_frame);
+
+    void *addr = slot_addr(slot);
+    if (caches_invalid_entries())
+        invalidate(addr);
+    return addr;
+}
+
+void Slot_Temp_Mapper::return_map(void *virt_addr)
+{
+    if (virt_addr == nullptr)
+        return;
+
+    const unsigned slot = slot_index(virt_addr);
+    clear_entry(slot);
+    used_slots &= ~(1U << slot);
+    invalidate(virt_addr);
+}
+
+void *Slot_Temp_Mapper::remap(void *virt_addr, u64 phys_frame)
+{
+    if (virt_addr == nullptr)
+        return kern_map(phys_frame);
+
+    // The entry is overwritten in place, so a single invalidation drops the old translation
+    set_entry(slot_index(virt_addr), phys_frame);
+    invalidate(virt_addr);
+    return virt_addr;
+}
+
+void *Slot_Temp_Mapper::kern_map_window(u64 phys_frame, size_t npages)
+{
+    if (npages == 0 or npages > slots_count - 1)
+        return nullptr;
+
+    const u32 mask = (1U << npages) - 1;
+    for (unsigned slot = 1; slot + npages <= slots_count; ++slot) {
+        if (used_slots & (mask << slot))
+            continue;
+
+        used_slots |= mask << slot;
+        for (unsigned i = 0; i < npages; ++i) {
+            set_entry(slot + i, phys_frame + i * 4096);
+            if (caches_invalid_entries())
+                invalidate(slot_addr(slot + i));
+        }
+        return slot_addr(slot);
+    }
+
+    return nullptr;
+}
+
+void Slot_Temp_Mapper::return_map_window(void *virt_addr, size_t npages)
+{
+    if (virt_addr == nullptr)
+        return;
+
+    const unsigned slot = slot_index(virt_addr);
+    for (unsigned i = 0; i < npages; ++i) {
+        clear_entry(slot + i);
+        invalidate(slot_addr(slot + i));
+    }
+    used_slots &= ~(((1U << npages) - 1) << slot);
+}
+
 void *Direct_Mapper::kern_map(u64 phys_frame) { return (void *)(virt_offset + phys_frame); }
 
 void Direct_Mapper::return_map(void * /* unused */)
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <assert.h>
 #include <types.hh>
 
 namespace kernel::paging
@@ -53,6 +54,9 @@ namespace kernel::paging
  * Upon initialization, we take out 16 pages from the region designated for it and, after preparing
  * the multilevel paging structures and whatnot, map the page directory into the first entry. This
  * leaves us with 15 other entries which can be used for quickly mapping physical memory.
+ *
+ * Besides the single pages, physically contiguous ranges can be mapped as a window of consecutive
+ * slots, so that larger copies and clears don't have to go page by page.
  */
 class Temp_Mapper
 {
@@ -68,11 +72,81 @@ public:
     /// @param virt_addr Virtual address previously returned by kern_map.
     virtual void return_map(void *virt_addr) = 0;
 
-    // TODO: Remap would be nice
+    /// @brief Points the mapping returned by kern_map() to another frame
+    ///
+    /// Cheaper than return_map() followed by kern_map(), since the slot is kept and its TLB entry is
+    /// only invalidated once.
+    /// @return The new virtual address, which might differ from virt_addr
+    virtual void *remap(void *virt_addr, u64 phys_frame)
+    {
+        return_map(virt_addr);
+        return kern_map(phys_frame);
+    }
+
+    /// @brief Maps npages physically contiguous frames to consecutive virtual addresses
+    /// @return The virtual address of the first frame, or nullptr if there is no window that large
+    /// free. npages must not be larger than max_window_pages().
+    virtual void *kern_map_window(u64 phys_frame, size_t npages)
+    {
+        return npages == 1 ? kern_map(phys_frame) : nullptr;
+    }
+
+    /// @brief Returns the window mapped with kern_map_window()
+    virtual void return_map_window(void *virt_addr, size_t npages)
+    {
+        if (npages == 1)
+            return_map(virt_addr);
+    }
+
+    /// @brief Largest number of pages kern_map_window() can map at once, with no other mappings
+    virtual size_t max_window_pages() const { return 1; }
 
     Temp_Mapper() = default;
 };
 
+/**
+ * @brief Temp_Mapper using a window of slots in a page table
+ *
+ * Common part of the architecture-specific per-CPU mappers. The slots are slots_count consecutive
+ * pages, the first of which maps the page table holding the entries of all of them. The
+ * architectures only provide the functions writing the entries.
+ */
+class Slot_Temp_Mapper: public Temp_Mapper
+{
+public:
+    virtual void *kern_map(u64 phys_frame) override;
+    virtual void return_map(void *virt_addr) override;
+    virtual void *remap(void *virt_addr, u64 phys_frame) override;
+    virtual void *kern_map_window(u64 phys_frame, size_t npages) override;
+    virtual void return_map_window(void *virt_addr, size_t npages) override;
+    virtual size_t max_window_pages() const override { return slots_count - 1; }
+
+    constexpr Slot_Temp_Mapper() = default;
+
+protected:
+    constexpr static unsigned slots_count = 16;
+
+    // Address of the first slot
+    char *slots_base = nullptr;
+    // Bit N is set if the slot N is in use. The first slot maps the page table.
+    u32 used_slots = 1;
+
+    // Writes the entry of the slot, which might have been in use
+    virtual void set_entry(unsigned slot, u64 phys_frame) = 0;
+    virtual void clear_entry(unsigned slot) = 0;
+    // Invalidates the TLB entry of the slot on this CPU
+    virtual void invalidate(void *virt_addr) = 0;
+    // Some CPUs (e.g. RISC-V) are allowed to cache the invalid entries, which then have to be
+    // invalidated after being filled in
+    virtual bool caches_invalid_entries() const { return false; }
+
+    void *slot_addr(unsigned slot) const { return slots_base + slot * 4096; }
+    unsigned slot_index(void *virt_addr) const
+    {
+        return ((char *)virt_addr - slots_base) / 4096;
+    }
+};
+
 /**
  * @brief Request the appropriate temp mapper
  *
@@ -94,22 +168,45 @@ Temp_Mapper &request_temp_mapper();
 template<typename P = void> struct Temp_Mapper_Obj {
     P *ptr = nullptr;
     Temp_Mapper &parent;
+    // Number of pages mapped at ptr
+    size_t pages = 0;
 
     /**
      * @brief Maps the phys_frame to ptr
      *
      * This function maps the phys_frame to some virtual address, modifying ptr. If ptr was pointing
-     * to another mapping, unmaps it first.
+     * to another page, its slot is reused.
      *
      * @param phys_frame Physical page-aligned address that is to be mapped
      * @return P* new virtual address
      */
     P *map(u64 phys_frame)
     {
-        if (ptr != nullptr)
-            parent.return_map((void *)(ptr));
+        if (pages == 1)
+            ptr = reinterpret_cast<P *>(parent.remap((void *)ptr, phys_frame));
+        else {
+            clear();
+            ptr = reinterpret_cast<P *>(parent.kern_map(phys_frame));
+        }
+
+        pages = ptr ? 1 : 0;
+        return ptr;
+    }
+
+    /**
+     * @brief Maps npages contiguous frames to consecutive addresses
+     *
+     * Unmaps the previous mapping first. Returns nullptr if the window can't be mapped, in which
+     * case the caller should try with fewer pages.
+     */
+    P *map_window(u64 phys_frame, size_t npages)
+    {
+        if (npages == 1)
+            return map(phys_frame);
 
-        ptr = reinterpret_cast<P *>(parent.kern_map(phys_frame));
+        clear();
+        ptr   = reinterpret_cast<P *>(parent.kern_map_window(phys_frame, npages));
+        pages = ptr ? npages : 0;
         return ptr;
     }
 
@@ -121,8 +218,12 @@ template<typename P = void> struct Temp_Mapper_Obj {
     void clear()
     {
         if (ptr != nullptr) {
-            parent.return_map((void *)(ptr));
-            ptr = nullptr;
+            if (pages == 1)
+                parent.return_map((void *)(ptr));
+            else
+                parent.return_map_window((void *)ptr, pages);
+            ptr   = nullptr;
+            pages = 0;
         }
     }
 
@@ -135,11 +236,49 @@ template<typename P = void> struct Temp_Mapper_Obj {
 
     constexpr Temp_Mapper_Obj(Temp_Mapper &t): ptr(nullptr), parent(t) {};
 
-    Temp_Mapper_Obj(Temp_Mapper_Obj &&p): ptr(p.ptr), parent(p.parent) { p.ptr = nullptr; }
+    Temp_Mapper_Obj(Temp_Mapper_Obj &&p): ptr(p.ptr), parent(p.parent), pages(p.pages)
+    {
+        p.ptr   = nullptr;
+        p.pages = 0;
+    }
 
     Temp_Mapper_Obj(const Temp_Mapper_Obj &) = delete;
 };
 
+/**
+ * @brief Maps the physical range in the largest windows the mapper allows
+ *
+ * Calls func(void *virt, size_t size) for each of the consecutive chunks of the range. phys_addr and
+ * size don't have to be page aligned. The windows are only valid during the call.
+ */
+template<typename Func> void for_each_phys_window(u64 phys_addr, size_t size, Func func)
+{
+    Temp_Mapper &mapper  = request_temp_mapper();
+    size_t window        = mapper.max_window_pages();
+    const u64 page_mask  = 4096 - 1;
+    Temp_Mapper_Obj<char> obj(mapper);
+
+    while (size > 0) {
+        const u64 page      = phys_addr & ~page_mask;
+        const u64 offset    = phys_addr & page_mask;
+        const size_t needed = (offset + size + page_mask) / 4096;
+        size_t npages       = needed < window ? needed : window;
+
+        // Some of the slots might be taken by the caller
+        char *virt;
+        while (!(virt = obj.map_window(page, npages)) and npages > 1)
+            window = npages = npages / 2;
+        assert(virt);
+
+        const size_t mapped = npages * 4096 - offset;
+        const size_t chunk  = size < mapped ? size : mapped;
+        func(virt + offset, chunk);
+
+        phys_addr += chunk;
+        size -= chunk;
+    }
+}
+
 /**
  * @brief Temp_Mapper using direct mapping
  *
@@ -151,6 +290,10 @@ class Direct_Mapper final: public Temp_Mapper
 public:
     virtual void *kern_map(u64 phys_frame) override;
     virtual void return_map(void *) override;
+    virtual void *remap(void *, u64 phys_frame) override { return kern_map(phys_frame); }
+    virtual void *kern_map_window(u64 phys_frame, size_t) override { return kern_map(phys_frame); }
+    virtual void return_map_window(void *, size_t) override {}
+    virtual size_t max_window_pages() const override { return -1UL; }
 
     /**
      * Virtual offset of the direct mapping
@@ -34,12 +34,27 @@
 #include <assert.h>
 #include <errno.h>
 #include <kern_logger/kern_logger.hh>
+#include <pmos/utility/scope_guard.hh>
+#include <sched/sched.hh>
 
 using namespace kernel;
 
+namespace kernel::sched
+{
+extern bool cpu_struct_works;
+}
+
 namespace kernel::vmm
 {
 
+static VirtmemQuantumCache *current_cpu_quantum_cache()
+{
+    if (!sched::cpu_struct_works)
+        return nullptr;
+
+    return &sched::get_cpu_struct()->vmm_quantum_cache;
+}
+
 void virtmem_fill_initial_tags()
 {
     for (size_t i = 0; i < virtmem_initial_segments; ++i) {
@@ -72,6 +87,7 @@ void virtmem_init(void *virtmem_base, size_t virtmem_size, void *kernel_start, s
     assert(!(kernel_size % PAGE_SIZE));
 
     kernel_space_allocator.init();
+    kernel_space_allocator.enable_quantum_caches(current_cpu_quantum_cache);
 
     virtmem_fill_initial_tags();
 
@@ -185,6 +201,44 @@ int virtmem_ensure_tags(size_t size)
     return virtmem_ensure_tags(size);
 }
 
+int virtmem_populate(void *virt, size_t npages)
+{
+    auto phys_addr = pmm::get_memory_for_kernel(npages);
+    if (phys_addr == -1UL)
+        return -ENOMEM;
+
+    size_t i   = 0;
+    auto guard = pmos::utility::make_scope_guard([&]() {
+        pmm::free_memory_for_kernel(phys_addr + i * PAGE_SIZE, npages - i);
+        virtmem_depopulate(virt, i);
+    });
+
+    for (; i < npages; ++i) {
+        static const paging::Page_Table_Arguments arg = {
+            .readable           = true,
+            .writeable          = true,
+            .user_access        = false,
+            .global             = false,
+            .execution_disabled = true,
+            .extra              = PAGING_FLAG_STRUCT_PAGE,
+        };
+
+        auto result = map_kernel_page(phys_addr + i * PAGE_SIZE, (char *)virt + i * PAGE_SIZE, arg);
+        if (result)
+            return result;
+    }
+
+    guard.dismiss();
+    return 0;
+}
+
+void virtmem_depopulate(void *virt, size_t npages)
+{
+    auto ctx = paging::TLBShootdownContext::create_kernel();
+    for (size_t i = 0; i < npages; ++i)
+        unmap_kernel_page(ctx, (char *)virt + i * PAGE_SIZE);
+}
+
 void virtmem_link_tag(VirtmemBoundaryTag *prev, VirtmemBoundaryTag *next)
 {
     // Since only PAGE_SIZE is used for now...
@@ -28,18 +28,19 @@
 
 #pragma once
 
-// !!!!!! HUGE TODO !!!!!!!!!!!
-// Investigate locks and concurrency in the allocator
-
 /** Kernel's virtual memory allocator
  *
  * virtmem/vmm is a virtual memory allocator for the kernel. It is inspired by vmem algorithm
  * created by Bonwick and Adams but it currently is a very simple implementation since having a more
  * complete and efficient one is not a priority at the moment.
+ *
+ * The arena (freelists, hash table and the boundary tags) is protected by VirtMem::lock. The small
+ * allocations mostly go through the per-CPU quantum caches instead, see VirtmemQuantumCache.
  */
 
 #include <assert.h>
 #include <errno.h>
+#include <new>
 #include <pmos/containers/intrusive_list.hh>
 #include <types.hh>
 
@@ -112,6 +113,35 @@ void virtmem_fill_initial_tags();
 // freelist
 void virtmem_init(void *virtmem_base, size_t virtmem_size, void *kernel_start, size_t kernel_size);
 
+// Backs the segment with the memory pages. This is used for the allocator's own data, which can't
+// be allocated with palloc() since it would recurse into the allocator. Returns 0 on success or an
+// error code otherwise.
+int virtmem_populate(void *virt, size_t npages);
+// Unmaps and frees the pages of the segment filled by virtmem_populate()
+void virtmem_depopulate(void *virt, size_t npages);
+
+/**
+ * @brief Per-CPU cache of the small segments
+ *
+ * Similar to the quantum caches of vmem. Each CPU keeps a few free segments of every size from 1 to
+ * max_pages quanta, which covers the kernel stacks and most of palloc() calls, so that they don't
+ * have to take the allocator lock. The segments stay allocated in the arena while they are cached,
+ * and are moved to and from it in batches of half of the magazine.
+ *
+ * Only used by the owning CPU, with interrupts disabled.
+ */
+struct VirtmemQuantumCache {
+    static constexpr size_t max_pages     = 16;
+    static constexpr size_t magazine_size = 8;
+
+    struct Magazine {
+        size_t count = 0;
+        void *segments[magazine_size];
+    };
+
+    Magazine magazines[max_pages] = {};
+};
+
 template<int QUANTUM, int MAX_ORDER> class VirtMem
 {
 public:
@@ -138,7 +168,32 @@ public:
     // Initializes a free freelist
     void init();
 
+    // Starts using the quantum caches for the small allocations. get_cache returns the cache of the
+    // current CPU, or nullptr if it's not available (e.g. early during the boot).
+    void enable_quantum_caches(VirtmemQuantumCache *(*get_cache)()) { get_quantum_cache = get_cache; }
+
 protected:
+    Spinlock lock;
+
+    VirtmemQuantumCache *(*get_quantum_cache)() = nullptr;
+
+    // Returns the quantum cache to be used for the segment of the given size, or nullptr if the
+    // allocation has to go to the arena
+    VirtmemQuantumCache *quantum_cache_for(u64 npages)
+    {
+        if (npages == 0 or npages > VirtmemQuantumCache::max_pages or !get_quantum_cache)
+            return nullptr;
+        return get_quantum_cache();
+    }
+
+    // Returns all of the cached segments to the arena. Called with the lock held.
+    void virtmem_drain_quantum_cache(VirtmemQuantumCache *cache);
+
+    // The functions doing the actual work on the arena. Called with the lock held.
+    void *virtmem_alloc_locked(u64 npages, VirtmemAllocPolicy policy);
+    void *virtmem_alloc_aligned_locked(u64 npages, u64 alignment);
+    void virtmem_free_locked(void *ptr, u64 npages);
+
     // Page size in bytes
     static const u64 freelist_quantum   = QUANTUM;
     // Max log2 of boundary tag size
@@ -185,16 +240,31 @@ protected:
     // The hash table array is always a power of 2, so the mask can be used instead of modulo.
     VirtMemFreelist virtmem_initial_hash[virtmem_initial_hash_size];
 
+    // The hash table grows 4 times when there are more than 2 entries per bucket on average, and
+    // shrinks in half when there is less than 1 entry per 8 buckets
+    static const u64 virtmem_hash_max_load    = 2;
+    static const u64 virtmem_hash_grow_factor = 4;
+    static const u64 virtmem_hash_min_load    = 8;
+
     u64 virtmem_hashtable_entries      = 0;
     VirtMemFreelist *virtmem_hashtable = nullptr;
     u64 virtmem_hashtable_size         = virtmem_initial_hash_size;
     u64 virtmem_hashtable_size_bytes() { return virtmem_hashtable_size * sizeof(VirtMemFreelist); }
     u64 virtmem_hash_mask() { return virtmem_hashtable_size - 1; }
 
-    // Save the tag to the hash table. This function will try to optimistically resize the hash
-    // table, but might postpone it if the system is under memory pressure and the allocation fails.
+    static u64 virtmem_hashtable_pages(u64 size)
+    {
+        return (size * sizeof(VirtMemFreelist) + (1UL << QUANTUM) - 1) >> QUANTUM;
+    }
+
+    // Save the tag to the hash table
     void virtmem_save_to_alloc_hashtable(VirtmemBoundaryTag *tag);
 
+    // Resizes the hash table if its load is out of bounds. If the new table can't be allocated,
+    // keeps the old one, which still works, just slower. Called with the lock held, at the end of
+    // the public functions, since the resize itself allocates from the arena.
+    void virtmem_maybe_resize_hashtable();
+
     // Adds a boundary tag to the appropriate list of free segments
     void virtmem_add_to_free_list(VirtmemBoundaryTag *tag);
 
@@ -226,6 +296,38 @@ void virtmem_link_tag(VirtmemBoundaryTag *preceeding, VirtmemBoundaryTag *new_ta
 void virtmem_unlink_tag(VirtmemBoundaryTag *tag);
 
 template<int Q, int M> void VirtMem<Q, M>::virtmem_free(void *ptr, u64 npages)
+{
+    auto cache = quantum_cache_for(npages);
+    if (!cache) {
+        Auto_Lock_Scope l(lock);
+        virtmem_free_locked(ptr, npages);
+        virtmem_maybe_resize_hashtable();
+        return;
+    }
+
+    assert(!((ulong)ptr % (1 << Q)));
+
+    auto &m = cache->magazines[npages - 1];
+    if (m.count == VirtmemQuantumCache::magazine_size) {
+        Auto_Lock_Scope l(lock);
+        while (m.count > VirtmemQuantumCache::magazine_size / 2)
+            virtmem_free_locked(m.segments[--m.count], npages);
+        virtmem_maybe_resize_hashtable();
+    }
+
+    m.segments[m.count++] = ptr;
+}
+
+template<int Q, int M> void VirtMem<Q, M>::virtmem_drain_quantum_cache(VirtmemQuantumCache *cache)
+{
+    for (size_t i = 0; i < VirtmemQuantumCache::max_pages; ++i) {
+        auto &m = cache->magazines[i];
+        while (m.count > 0)
+            virtmem_free_locked(m.segments[--m.count], i + 1);
+    }
+}
+
+template<int Q, int M> void VirtMem<Q, M>::virtmem_free_locked(void *ptr, u64 npages)
 {
     assert(!((ulong)ptr % (1 << Q)));
     // Find the tag that corresponds to the base of the segment
@@ -247,6 +349,7 @@ template<int Q, int M> void VirtMem<Q, M>::virtmem_free(void *ptr, u64 npages)
 
     // Take the tag out of the hashtable
     VirtMemFreelist::remove(tag);
+    virtmem_hashtable_entries--;
 
     // Mark the tag as free
     tag->state = VirtmemBoundaryTag::State::FREE;
@@ -275,15 +378,68 @@ template<int Q, int M> void VirtMem<Q, M>::virtmem_free(void *ptr, u64 npages)
 
 template<int Q, int M> void VirtMem<Q, M>::virtmem_save_to_alloc_hashtable(VirtmemBoundaryTag *tag)
 {
-    // This function is also supposed to resize the hashtable if needed.
-    // But for now, it is not a priority and the the performance hit is
-    // not a concern compared to other parts of the kernel.
-
     u64 idx = virtmem_hashtable_index(tag->base);
     virtmem_hashtable[idx].push_front(tag);
+    virtmem_hashtable_entries++;
+}
+
+template<int Q, int M> void VirtMem<Q, M>::virtmem_maybe_resize_hashtable()
+{
+    u64 new_size;
+    if (virtmem_hashtable_entries > virtmem_hashtable_size * virtmem_hash_max_load)
+        new_size = virtmem_hashtable_size * virtmem_hash_grow_factor;
+    else if (virtmem_hashtable_size > virtmem_initial_hash_size and
+             virtmem_hashtable_entries < virtmem_hashtable_size / virtmem_hash_min_load)
+        new_size = virtmem_hashtable_size / 2;
+    else
+        return;
+
+    VirtMemFreelist *new_table = virtmem_initial_hash;
+    if (new_size > virtmem_initial_hash_size) {
+        const u64 pages = virtmem_hashtable_pages(new_size);
+        void *segment   = virtmem_alloc_locked(pages, VirtmemAllocPolicy::INSTANTFIT);
+        if (segment and virtmem_populate(segment, pages) != 0) {
+            virtmem_free_locked(segment, pages);
+            segment = nullptr;
+        }
+
+        if (!segment)
+            return;
+
+        new_table = static_cast<VirtMemFreelist *>(segment);
+        for (u64 i = 0; i < new_size; ++i)
+            new (&new_table[i]) VirtMemFreelist();
+    }
+
+    VirtMemFreelist *old_table = virtmem_hashtable;
+    const u64 old_size         = virtmem_hashtable_size;
+
+    virtmem_hashtable      = new_table;
+    virtmem_hashtable_size = new_size;
+    for (u64 i = 0; i < old_size; ++i) {
+        while (!old_table[i].empty()) {
+            auto tag = &old_table[i].front();
+            VirtMemFreelist::remove(tag);
+            virtmem_hashtable[virtmem_hashtable_index(tag->base)].push_front(tag);
+        }
+    }
+
+    if (old_table != virtmem_initial_hash) {
+        const u64 pages = virtmem_hashtable_pages(old_size);
+        virtmem_depopulate(old_table, pages);
+        virtmem_free_locked(old_table, pages);
+    }
 }
 
 template<int Q, int M> void *VirtMem<Q, M>::virtmem_alloc_aligned(u64 npages, u64 alignment)
+{
+    Auto_Lock_Scope l(lock);
+    void *ptr = virtmem_alloc_aligned_locked(npages, alignment);
+    virtmem_maybe_resize_hashtable();
+    return ptr;
+}
+
+template<int Q, int M> void *VirtMem<Q, M>::virtmem_alloc_aligned_locked(u64 npages, u64 alignment)
 {
     // I don't anticipate this function to be used frequently, so just implement best fit for now
 
@@ -367,6 +523,47 @@ found:
 }
 
 template<int Q, int M> void *VirtMem<Q, M>::virtmem_alloc(u64 npages, VirtmemAllocPolicy policy)
+{
+    auto cache = quantum_cache_for(npages);
+    if (!cache) {
+        Auto_Lock_Scope l(lock);
+        void *ptr = virtmem_alloc_locked(npages, policy);
+        if (!ptr and get_quantum_cache and (cache = get_quantum_cache())) {
+            // The segments cached on this CPU might be preventing the merges
+            virtmem_drain_quantum_cache(cache);
+            ptr = virtmem_alloc_locked(npages, policy);
+        }
+        virtmem_maybe_resize_hashtable();
+        return ptr;
+    }
+
+    auto &m = cache->magazines[npages - 1];
+    if (m.count == 0) {
+        Auto_Lock_Scope l(lock);
+        // Only fill half of the magazine, so that the frees have some space before going to the
+        // arena
+        while (m.count < VirtmemQuantumCache::magazine_size / 2) {
+            void *ptr = virtmem_alloc_locked(npages, policy);
+            if (!ptr)
+                break;
+            m.segments[m.count++] = ptr;
+        }
+
+        if (m.count == 0) {
+            virtmem_drain_quantum_cache(cache);
+            void *ptr = virtmem_alloc_locked(npages, policy);
+            virtmem_maybe_resize_hashtable();
+            return ptr;
+        }
+
+        virtmem_maybe_resize_hashtable();
+    }
+
+    return m.segments[--m.count];
+}
+
+template<int Q, int M>
+void *VirtMem<Q, M>::virtmem_alloc_locked(u64 npages, VirtmemAllocPolicy policy)
 {
     // Make sure there is 1 free boundary tag available, in case the segment needs to be split
     if (virtmem_ensure_tags(1) != 0)
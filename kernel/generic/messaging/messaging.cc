@@ -114,6 +114,27 @@ kresult_t Port::send_from_system(klib::vector<char> &&v)
     return 0;
 }
 
+kresult_t Port::atomic_send_from_system(const char *msg_ptr, size_t size, u64 sent_with_right)
+{
+    assert(size > 0);
+
+    klib::vector<char> message;
+    if (!message.resize(size))
+        return -ENOMEM;
+
+    memcpy(&message.front(), msg_ptr, size);
+
+    auto ptr = klib::make_unique<Message>(0, klib::move(message));
+    if (!ptr)
+        return -ENOMEM;
+
+    ptr->sent_with_right_ = sent_with_right;
+
+    Auto_Lock_Scope scope_lock(lock);
+    enqueue(klib::move(ptr));
+    return 0;
+}
+
 kresult_t Port::send_from_system(const char *msg_ptr, size_t size)
 {
     assert(size > 0);
@@ -276,6 +297,7 @@ ReturnStr<std::pair<Right * /* right */, u64 /* new_id_error */>>
         return {-EPERM, std::make_pair(nullptr, 0)};
 
     auto send_to = right->parent_port();
+    auto current = sched::get_current_task();
 
     klib::unique_ptr<Message> msg = new Message(sender_id, std::move(data));
     if (!msg)
@@ -369,6 +391,20 @@ ReturnStr<std::pair<Right * /* right */, u64 /* new_id_error */>>
 
         msg->rights = array;
 
+        // Priority inheritance: the receiver of the message is now the one the client waits on,
+        // so lend it the sender's priority until it replies. If the reply rights of other
+        // clients are being forwarded, their donations follow them.
+        auto reciever = send_to->owner;
+        if (reply_right && new_right_type == RightType::SendOnce && reciever != current)
+            static_cast<SendOnceRight *>(reply_right.get())->donate_priority(reciever, current->priority);
+
+        for (auto r: array)
+            if (r && r->type() == RightType::SendOnce) {
+                auto send_once = static_cast<SendOnceRight *>(r);
+                if (send_once->donated_to_task_id)
+                    send_once->donate_priority(reciever, send_once->donated_priority);
+            }
+
         {
             Auto_Lock_Scope l(send_to->lock);
             send_to->enqueue(std::move(msg));
@@ -41,6 +41,9 @@ public:
     ReturnStr<bool> send_from_user(proc::TaskDescriptor *sender, const char *unsafe_user_ptr,
                                    size_t msg_size);
     kresult_t atomic_send_from_system(const char *msg, size_t size);
+    /// Sends the message as if it had been sent with the right (e.g. for the pagers), so that it
+    /// is dispatched by the reciever like the other messages for that right
+    kresult_t atomic_send_from_system(const char *msg, size_t size, u64 sent_with_right);
 
     // Returns true if successfully sent, false otherwise (e.g. when it is needed to repeat the
     // syscall). Throws on crytical errors
@@ -3,6 +3,7 @@
 #include "messaging.hh"
 
 #include <processes/task_group.hh>
+#include <processes/tasks.hh>
 #include <sched/sched.hh>
 #include <memory/mem_object.hh>
 #include <pmos/ipc.h>
@@ -96,6 +97,7 @@ bool SendOnceRight::destroy_nolock(DestroyReason reason, proc::TaskGroup *match_
     alive = false;
 
     remove_from_parent();
+    revert_priority_donation();
 
     bool send_notification = reason == DestroyReason::DeletedBySender;
 
@@ -190,6 +192,30 @@ ReturnStr<SendOnceRight *> SendOnceRight::create_for_group(Port *port, proc::Tas
     return Success(new_right.release());
 }
 
+void SendOnceRight::donate_priority(proc::TaskDescriptor *task, priority_t priority)
+{
+    assert(task);
+
+    revert_priority_donation();
+
+    task->atomic_donate_priority(priority);
+    donated_to_task_id = task->task_id;
+    donated_priority   = priority;
+}
+
+void SendOnceRight::revert_priority_donation()
+{
+    if (!donated_to_task_id)
+        return;
+
+    // If the task has died in the meantime, there is nothing to revert
+    auto task = proc::get_task(donated_to_task_id);
+    if (task)
+        task->atomic_revert_priority_donation(donated_priority);
+
+    donated_to_task_id = 0;
+}
+
 ReturnStr<u64> SendManyRight::atomic_watch(Port *port)
 {
     assert(port);
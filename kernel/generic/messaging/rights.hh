@@ -5,6 +5,7 @@
 #include <pmos/containers/intrusive_list.hh>
 #include <types.hh>
 #include <lib/memory.hh>
+#include <sched/defs.hh>
 #include "messaging.hh"
 
 namespace kernel::proc
@@ -156,6 +157,17 @@ struct SendManyRight final: SendRight {
 struct SendOnceRight final: SendRight {
     static ReturnStr<SendOnceRight *> create_for_group(Port *port, proc::TaskGroup *group, u64 id_in_parent);
 
+    // Priority inheritance: when the reply right is sent with a message, the sender's priority is
+    // donated to the owner of the port the message was sent to, until the right is consumed or
+    // destroyed. The task is kept by its ID, since it might die while the right is still alive.
+    u64 donated_to_task_id      = 0;
+    priority_t donated_priority = 0;
+
+    // Donates *priority* to the task, reverting the previous donation (if any). Right's lock must
+    // be held, or the right must not be reachable by others yet.
+    void donate_priority(proc::TaskDescriptor *task, priority_t priority);
+    void revert_priority_donation();
+
     virtual ReturnStr<std::pair<Right *, u64>> duplicate(proc::TaskGroup *) override;
     virtual RightType type() const override;
     virtual RightType recieve_type() const override;
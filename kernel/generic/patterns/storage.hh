@@ -27,12 +27,12 @@
  */
 
 #pragma once
-#include <lib/splay_tree_map.hh>
+#include <pmos/containers/map.hh>
 
 template<typename T> class global_weak_storage
 {
 private:
-    static splay_tree_map<u64, weak_ptr<T>> storage;
+    static pmos::containers::map<u64, weak_ptr<T>> storage;
     static Spinlock storage_lock;
 
     static u64 next_id = 1;
@@ -51,6 +51,6 @@ protected:
     static void insert(const shared_ptr<T> &ptr)
     {
         Auto_Lock_Scope scope_lock(storage_lock);
-        storage.insert(id, ptr);
+        storage.insert_noexcept({id, ptr});
     }
 };
\ No newline at end of file
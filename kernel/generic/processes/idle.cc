@@ -29,12 +29,38 @@
 #include "idle.hh"
 
 #include <kern_logger/kern_logger.hh>
+#include <sched/sched.hh>
+
+using namespace kernel::sched;
+
+// Number of the RCU callbacks run with the interrupts disabled
+static constexpr size_t rcu_idle_batch = 256;
+
+// Runs the RCU callbacks whose grace period has ended. The interrupts are enabled between the
+// batches, so that the CPU can switch away from the idle task as soon as it has something to do.
+static void run_rcu_callbacks()
+{
+    bool more = true;
+    while (more) {
+        ulong flags = disable_interrupts();
+
+        auto c = get_cpu_struct();
+        // The idle task never holds any references
+        c->heap_rcu_cpu.quiet(heap_rcu, c->cpu_id);
+
+        more = c->heap_rcu_cpu.run_callbacks(rcu_idle_batch);
+        more = c->paging_rcu_cpu.run_callbacks(rcu_idle_batch) or more;
+
+        restore_interrupts(flags);
+    }
+}
 
 void idle()
 {
     // serial_logger.printf("[Kernel] Idle task entered for the first time!\n");
 
     while (1) {
-        halt();
+        run_rcu_callbacks();
+        idle_wait();
     };
 }
\ No newline at end of file
@@ -27,8 +27,16 @@
  */
 
 #pragma once
+#include <types.hh>
 
 // This function is called in the idle loop, when there is nothing to do and CPU can be halted.
 void halt();
 
+// Waits until the CPU has something to do. Might return spuriously.
+void idle_wait();
+
+// Masks the interrupts on the current CPU, returning the previous state for restore_interrupts()
+ulong disable_interrupts();
+void restore_interrupts(ulong flags);
+
 void idle();
\ No newline at end of file
@@ -29,12 +29,20 @@
 #include <kernel/attributes.h>
 #include <kernel/block.h>
 #include <kernel/flags.h>
+#include <kernel/interrupt_stats.h>
+#include <kernel/lockstat.h>
+#include <kernel/rcu_stats.h>
+#include <kernel/syscall_stats.h>
 #include <kernel/messaging.h>
+#include <kernel/msi.h>
 #include <kernel/sysinfo.h>
 #include <lib/vector.hh>
+#include <lockstat.hh>
 #include <memory/paging.hh>
+#include <memory/temp_mapper.hh>
 #include <messaging/messaging.hh>
 #include <processes/syscalls.hh>
+#include <sched/futex.hh>
 #include <sched/sched.hh>
 #include <utils.hh>
 // #include <cpus/cpus.hh>
@@ -70,7 +78,7 @@ extern void deactivate_page_table();
 namespace kernel::proc::syscalls
 {
 
-std::array<const char *, 63> syscall_names = {
+std::array<const char *, 75> syscall_names = {
     "SYSCALL EXIT",
     "SYSCALL GET TASK ID",
     "SYSCALL CREATE PROCESS",
@@ -138,6 +146,18 @@ std::array<const char *, 63> syscall_names = {
     "SYSCALL WATCH RIGHT",
     "SYSCALL CREATE TIMER",
     "SYSCALL SET TIMER DEADLINE",
+    "SYSCALL SET AFFINITY MASK",
+    "SYSCALL GET LOCKSTAT",
+    "SYSCALL GET SYSCALL STATS",
+    "SYSCALL ALLOCATE MSI",
+    "SYSCALL GET MSI MESSAGE",
+    "SYSCALL SET INTERRUPT CPU",
+    "SYSCALL GET INTERRUPT STATS",
+    "SYSCALL GET RCU STATS",
+    "SYSCALL FUTEX WAIT",
+    "SYSCALL FUTEX WAKE",
+    "SYSCALL SET MEM OBJECT PAGER",
+    "SYSCALL PROVIDE MEM OBJECT PAGE",
 };
 
 const char *syscall_name(unsigned id)
@@ -149,7 +169,7 @@ const char *syscall_name(unsigned id)
 }
 
 using syscall_function                         = void (*)();
-std::array<syscall_function, 63> syscall_table = {
+std::array<syscall_function, 75> syscall_table = {
     syscall_exit,
     syscall_get_task_id,
     syscall_create_process,
@@ -217,6 +237,44 @@ std::array<syscall_function, 63> syscall_table = {
     syscall_watch_right,
     syscall_create_timer,
     syscall_set_timer_deadline,
+    syscall_set_affinity_mask,
+    syscall_get_lockstat,
+    syscall_get_syscall_stats,
+    syscall_allocate_msi,
+    syscall_get_msi_message,
+    syscall_set_interrupt_cpu,
+    syscall_get_interrupt_stats,
+    syscall_get_rcu_stats,
+    syscall_futex_wait,
+    syscall_futex_wake,
+    syscall_set_mem_object_pager,
+    syscall_provide_mem_object_page,
+};
+
+// Per-CPU system call statistics. Only written by the owning CPU, with interrupts disabled.
+struct SyscallStats {
+    struct Entry {
+        u64 calls;
+        u64 repeats;
+        u64 latency_histogram[SYSCALL_STATS_BUCKETS];
+    };
+
+    std::array<Entry, std::tuple_size_v<decltype(syscall_table)>> entries = {};
+
+    static unsigned bucket(u64 ticks)
+    {
+        unsigned b = ticks ? 63 - __builtin_clzll(ticks) : 0;
+        return b < SYSCALL_STATS_BUCKETS ? b : SYSCALL_STATS_BUCKETS - 1;
+    }
+
+    void record(unsigned call_n, u64 ticks, bool repeat)
+    {
+        auto &e = entries[call_n];
+        ++e.calls;
+        if (repeat)
+            ++e.repeats;
+        ++e.latency_histogram[bucket(ticks)];
+    }
 };
 
 extern "C" void syscall_handler()
@@ -253,9 +311,22 @@ extern "C" void syscall_handler()
         return;
     }
 
+    const u64 start = read_timestamp_counter();
+
     syscall_table[call_n]();
 
-    if ((syscall_error(task) < 0) && !task->regs.syscall_pending_restart()) {
+    const u64 ticks   = read_timestamp_counter() - start;
+    const bool repeat = task->regs.syscall_pending_restart();
+
+    // The task might have been switched away; the statistics go to the CPU that did the work
+    auto c = sched::get_cpu_struct();
+    if (!c->syscall_stats) [[unlikely]]
+        __atomic_store_n(&c->syscall_stats, new SyscallStats(), __ATOMIC_RELEASE);
+
+    if (c->syscall_stats) [[likely]]
+        c->syscall_stats->record(call_n, ticks, repeat);
+
+    if ((syscall_error(task) < 0) && !repeat) {
         serial_logger.printf("Debug: syscall %i (%s) pid %li (%s) ", call_n, syscall_name(call_n), task->task_id,
                              task->name.c_str());
         int val = syscall_error(task);
@@ -994,10 +1065,7 @@ void syscall_set_priority()
         return;
     }
 
-    {
-        Auto_Lock_Scope lock(current_task->sched_lock);
-        current_task->priority = priority;
-    }
+    current_task->atomic_set_base_priority(priority);
 
     reschedule();
 }
@@ -1094,6 +1162,7 @@ void syscall_set_interrupt()
 
     u64 right   = syscall_arg64(task, 0);
     u64 port    = syscall_arg64(task, 1);
+    ulong flags = syscall_flags(task);
 
     auto port_ptr = Port::atomic_get_port(port);
     if (!port_ptr) {
@@ -1112,7 +1181,21 @@ void syscall_set_interrupt()
         return;
     }
 
-    auto recieve_right = IntNotificationRight::create_for_port(handler.val, port_ptr);
+    InterruptCounterMapping counter;
+    if (flags & SET_INTERRUPT_COUNTER) {
+        ulong counter_ptr = syscall_arg(task, 2, 2);
+        auto b            = InterruptCounterMapping::map_from_user(counter_ptr, counter);
+        if (!b.success()) {
+            syscall_error(task) = b.result;
+            return;
+        }
+
+        if (!b.val)
+            return;
+    }
+
+    auto recieve_right =
+        IntNotificationRight::create_for_port(handler.val, port_ptr, klib::move(counter));
     if (!recieve_right) {
         syscall_error(task) = recieve_right.result;
         return;
@@ -1146,6 +1229,16 @@ void syscall_complete_interrupt()
 
     u64 port = syscall_arg64(task, 0);
     u64 right_id = syscall_arg64(task, 1);
+    ulong flags  = syscall_flags(task);
+
+    u64 poll_delay = 0;
+    if (flags & COMPLETE_INTERRUPT_POLL) {
+        auto result = syscall_arg64_checked(task, 2, poll_delay);
+        if (!result) {
+            syscall_error(task) = result.result;
+            return;
+        }
+    }
 
     auto port_ptr = Port::atomic_get_port(port);
     if (!port_ptr) {
@@ -1170,7 +1263,183 @@ void syscall_complete_interrupt()
     }
     auto notification_right = static_cast<IntNotificationRight *>(right);
 
-    syscall_error(task) = notification_right->complete();
+    if (flags & COMPLETE_INTERRUPT_POLL)
+        syscall_error(task) = notification_right->complete_and_poll(poll_delay);
+    else
+        syscall_error(task) = notification_right->complete();
+}
+
+void syscall_set_interrupt_cpu()
+{
+    auto c               = sched::get_cpu_struct();
+    const task_ptr &task = c->current_task;
+
+    u64 port     = syscall_arg64(task, 0);
+    u64 right_id = syscall_arg64(task, 1);
+    u32 cpu_id   = syscall_arg(task, 2, 2);
+
+    if (cpu_id == 0 or cpu_id > cpus.size()) {
+        syscall_error(task) = -EINVAL;
+        return;
+    }
+
+    auto port_ptr = Port::atomic_get_port(port);
+    if (!port_ptr) {
+        syscall_error(task) = -ENOENT;
+        return;
+    }
+
+    if (port_ptr->owner != task) {
+        syscall_error(task) = -EPERM;
+        return;
+    }
+
+    auto right = port_ptr->atomic_get_right(right_id);
+    if (!right) {
+        syscall_error(task) = -ENOENT;
+        return;
+    }
+
+    if (right->recieve_type() != RightType::InterruptNotification) {
+        syscall_error(task) = -EBADF;
+        return;
+    }
+    auto handler = static_cast<IntNotificationRight *>(right)->parent_handler;
+    assert(handler);
+    assert(handler->parent_cpu == c);
+
+    // The notification rights are bound to the CPU of the interrupt, and the task moves with it,
+    // so it must own all of them, and no other interrupts
+    size_t rights = 0;
+    for (auto &n: handler->notification_rights) {
+        if (n.parent->owner != task) {
+            syscall_error(task) = -EBUSY;
+            return;
+        }
+        ++rights;
+    }
+
+    if (rights != task->interrupt_handlers_count) {
+        syscall_error(task) = -EBUSY;
+        return;
+    }
+
+    auto target = cpus[cpu_id - 1];
+    auto result = handler->set_cpu(target);
+    if (result) {
+        syscall_error(task) = result;
+        return;
+    }
+
+    if (target == c)
+        return;
+
+    syscall_success(task);
+    find_new_process();
+
+    {
+        Auto_Lock_Scope lock(task->sched_lock);
+        task->cpu_affinity = cpu_id;
+        push_ready(task);
+    }
+
+    if (target->current_task_priority > task->priority)
+        target->ipi_reschedule();
+}
+
+void syscall_get_interrupt_stats()
+{
+    const auto current_task = get_current_task();
+    ulong buffer            = syscall_arg(current_task, 0, 0);
+    ulong count             = syscall_arg(current_task, 1, 0);
+
+    interrupt_stats_entry *user_buffer = (interrupt_stats_entry *)buffer;
+    size_t i                           = 0;
+    for (; i < count; ++i) {
+        auto handler = get_interrupt_handler(i);
+        if (!handler)
+            break;
+
+        // Racy, but good enough for the statistics. The released handlers are freed with RCU.
+        auto cpu = __atomic_load_n(&handler->parent_cpu, __ATOMIC_RELAXED);
+
+        interrupt_stats_entry e = {
+            .count      = __atomic_load_n(&handler->interrupt_count, __ATOMIC_RELAXED),
+            .owner_task = __atomic_load_n(&handler->owner_task_id, __ATOMIC_RELAXED),
+            .id         = handler->id,
+            .gsi        = handler->gsi,
+            .cpu        = cpu ? cpu->cpu_id + 1 : 0,
+            .flags      = 0,
+        };
+        if (handler->edge_triggered)
+            e.flags |= INTERRUPT_STATS_EDGE;
+        if (__atomic_load_n(&handler->polling, __ATOMIC_RELAXED))
+            e.flags |= INTERRUPT_STATS_POLLING;
+
+        auto result = copy_to_user((char *)&e, (char *)(user_buffer + i), sizeof(e));
+        if (!result.success()) {
+            syscall_error(current_task) = result.result;
+            return;
+        }
+
+        if (!result.val)
+            return;
+    }
+
+    syscall_return(current_task) = i;
+}
+
+void syscall_get_rcu_stats()
+{
+    const auto current_task = get_current_task();
+    ulong buffer            = syscall_arg(current_task, 0, 0);
+    ulong count             = syscall_arg(current_task, 1, 0);
+
+    // In the order of RCU_STATS_*
+    struct {
+        const char *name;
+        kernel::memory::RCU &rcu;
+        kernel::memory::RCU_CPU CPU_Info::*cpu;
+    } rcus[] = {
+        {"paging", paging_rcu, &CPU_Info::paging_rcu_cpu},
+        {"heap", heap_rcu, &CPU_Info::heap_rcu_cpu},
+    };
+
+    rcu_stats_entry *user_buffer = (rcu_stats_entry *)buffer;
+    for (size_t i = 0; i < std::size(rcus) and i < count; ++i) {
+        const auto &r     = rcus[i];
+        rcu_stats_entry e = {};
+
+        for (size_t j = 0; j < sizeof(e.name) - 1 and r.name[j]; ++j)
+            e.name[j] = r.name[j];
+
+        e.generation = r.rcu.get_generation();
+        e.expedited  = __atomic_load_n(&r.rcu.expedited_count, __ATOMIC_RELAXED);
+
+        // Racy, but good enough for the statistics
+        for (auto c: cpus) {
+            auto &s = c->*r.cpu;
+            e.callbacks_waiting += __atomic_load_n(&s.current_count, __ATOMIC_RELAXED) +
+                                   __atomic_load_n(&s.next_count, __ATOMIC_RELAXED);
+            e.callbacks_ready += __atomic_load_n(&s.ready_count, __ATOMIC_RELAXED);
+            e.callbacks_run += __atomic_load_n(&s.callbacks_run, __ATOMIC_RELAXED);
+
+            auto max_ready = __atomic_load_n(&s.max_ready, __ATOMIC_RELAXED);
+            if (max_ready > e.max_ready)
+                e.max_ready = max_ready;
+        }
+
+        auto result = copy_to_user((char *)&e, (char *)(user_buffer + i), sizeof(e));
+        if (!result.success()) {
+            syscall_error(current_task) = result.result;
+            return;
+        }
+
+        if (!result.val)
+            return;
+    }
+
+    syscall_return(current_task) = std::size(rcus);
 }
 
 void syscall_set_log_port()
@@ -1897,6 +2166,63 @@ void syscall_set_affinity()
     reschedule();
 }
 
+void syscall_set_affinity_mask()
+{
+    const auto current_cpu = sched::get_cpu_struct();
+    auto current_task      = current_cpu->current_task;
+
+    auto pid         = syscall_arg64(current_task, 0);
+    ulong mask_ptr   = syscall_arg(current_task, 1, 1);
+    ulong mask_bytes = syscall_arg(current_task, 2, 1);
+
+    const auto task = pid == 0 ? current_task : get_task(pid);
+    if (!task) {
+        syscall_error(current_task) = -ESRCH;
+        return;
+    }
+
+    CPUMask mask;
+    if (mask_bytes > sizeof(mask.words))
+        mask_bytes = sizeof(mask.words);
+
+    auto b = copy_from_user((char *)mask.words.data(), (char *)mask_ptr, mask_bytes);
+    if (!b.success()) {
+        syscall_error(current_task) = b.result;
+        return;
+    }
+
+    if (!b.val)
+        return;
+
+    // Drop the CPUs that don't exist
+    for (size_t i = get_cpu_count(); i < max_cpus; ++i)
+        mask.clear(i);
+
+    if (mask.empty()) {
+        syscall_error(current_task) = -EINVAL;
+        return;
+    }
+
+    // Same rules as syscall_set_affinity()
+    auto result = task->atomic_set_affinity_mask(mask, task != current_task);
+    if (result) {
+        syscall_error(current_task) = result;
+        return;
+    }
+
+    syscall_success(current_task);
+
+    if (task == current_task and !task->can_run_on(current_cpu)) {
+        // Move away from this CPU
+        find_new_process();
+
+        Auto_Lock_Scope lock(task->sched_lock);
+        push_ready(task);
+    }
+
+    reschedule();
+}
+
 void syscall_yield()
 {
     syscall_success(get_current_task());
@@ -1937,6 +2263,81 @@ void syscall_system_info()
     }
 }
 
+void syscall_get_lockstat()
+{
+    const auto current_task = get_current_task();
+
+#ifdef ENABLE_LOCKSTAT
+    ulong buffer = syscall_arg(current_task, 0, 0);
+    ulong count  = syscall_arg(current_task, 1, 0);
+    ulong flags  = syscall_flags(current_task);
+
+    size_t total = 0;
+    auto result  = kernel::lockstat::copy_to_user((lockstat_entry *)buffer, count,
+                                                  flags & LOCKSTAT_RESET, total);
+    if (!result.success()) {
+        syscall_error(current_task) = result.result;
+        return;
+    }
+
+    if (!result.val)
+        return;
+
+    syscall_return(current_task) = total;
+#else
+    syscall_error(current_task) = -ENOSYS;
+#endif
+}
+
+void syscall_get_syscall_stats()
+{
+    const auto current_task = get_current_task();
+    ulong buffer            = syscall_arg(current_task, 0, 0);
+    ulong count             = syscall_arg(current_task, 1, 0);
+    ulong flags             = syscall_flags(current_task);
+
+    syscall_stats_entry *user_buffer = (syscall_stats_entry *)buffer;
+    for (size_t i = 0; i < syscall_table.size() and i < count; ++i) {
+        syscall_stats_entry e = {};
+
+        const char *name = syscall_name(i);
+        for (size_t j = 0; j < sizeof(e.name) - 1 and name[j]; ++j)
+            e.name[j] = name[j];
+
+        for (auto c: cpus) {
+            auto stats = __atomic_load_n(&c->syscall_stats, __ATOMIC_ACQUIRE);
+            if (!stats)
+                continue;
+
+            auto &s = stats->entries[i];
+            e.calls += __atomic_load_n(&s.calls, __ATOMIC_RELAXED);
+            e.repeats += __atomic_load_n(&s.repeats, __ATOMIC_RELAXED);
+            for (size_t j = 0; j < SYSCALL_STATS_BUCKETS; ++j)
+                e.latency_histogram[j] += __atomic_load_n(&s.latency_histogram[j], __ATOMIC_RELAXED);
+        }
+
+        auto result = copy_to_user((char *)&e, (char *)(user_buffer + i), sizeof(e));
+        if (!result.success()) {
+            syscall_error(current_task) = result.result;
+            return;
+        }
+
+        if (!result.val)
+            return;
+    }
+
+    // This races with the other CPUs updating their counters, but it's good enough for statistics
+    if (flags & SYSCALL_STATS_RESET)
+        for (auto c: cpus) {
+            auto stats = __atomic_load_n(&c->syscall_stats, __ATOMIC_ACQUIRE);
+            if (stats)
+                for (auto &s: stats->entries)
+                    __builtin_memset(&s, 0, sizeof(s));
+        }
+
+    syscall_return(current_task) = syscall_table.size();
+}
+
 void syscall_pause_task()
 {
     const auto current_task = get_current_task();
@@ -2171,6 +2572,78 @@ void syscall_cpu_for_interrupt()
     syscall_return(current_task) = right.val->right_sender_id;
 }
 
+void syscall_allocate_msi()
+{
+    auto current_task = get_current_task();
+    u32 cpu_id        = syscall_arg(current_task, 0, 0);
+
+    auto group = current_task->rights_namespace.load(std::memory_order::consume);
+    if (!group) {
+        syscall_error(current_task) = -ESRCH;
+        return;
+    }
+
+    CPU_Info *cpu = nullptr;
+    if (cpu_id != 0) {
+        if (cpu_id > cpus.size()) {
+            syscall_error(current_task) = -EINVAL;
+            return;
+        }
+        cpu = cpus[cpu_id - 1];
+    }
+
+    // TODO: Check permissions here (superuser right or something)
+
+    auto result = allocate_msi_handler(cpu);
+    if (!result.success()) {
+        syscall_error(current_task) = result.result;
+        return;
+    }
+
+    auto right = IntSourceRight::create_for_group(result.val, group);
+    if (!right.success()) {
+        release_interrupt_handler(result.val);
+        syscall_error(current_task) = right.result;
+        return;
+    }
+
+    syscall_return(current_task) = right.val->right_sender_id;
+}
+
+void syscall_get_msi_message()
+{
+    auto current_task = get_current_task();
+    u64 right_id      = syscall_arg64(current_task, 0);
+    ulong message_ptr = syscall_arg(current_task, 1, 1);
+
+    auto handler = interrupt_handler_for_right(current_task, right_id);
+    if (!handler.success()) {
+        syscall_error(current_task) = handler.result;
+        return;
+    }
+
+    msi_message message = {};
+    auto result = get_msi_message(handler.val, message.address, message.data);
+    if (result) {
+        syscall_error(current_task) = result;
+        return;
+    }
+
+    assert(handler.val->parent_cpu);
+    message.cpu = handler.val->parent_cpu->cpu_id + 1;
+
+    auto b = copy_to_user((char *)&message, (char *)message_ptr, sizeof(message));
+    if (!b.success()) {
+        syscall_error(current_task) = b.result;
+        return;
+    }
+
+    if (!b.val)
+        return;
+
+    syscall_success(current_task);
+}
+
 void syscall_set_right0()
 {
     auto current = get_current_task();
@@ -2377,6 +2850,9 @@ void send_message_right()
     auto new_type      = flags & REPLY_CREATE_SEND_MANY ? RightType::SendMany : RightType::SendOnce;
     bool always_delete = flags & SEND_MESSAGE_DELETE_RIGHT;
 
+    // Replying might drop the priority donated by the client
+    const auto old_priority = current->priority;
+
     auto send_result =
         Port::send_message_right(right, group, reply_port, rights, std::move(*buffer.val),
                                  current->task_id, new_type, always_delete);
@@ -2389,6 +2865,9 @@ void send_message_right()
     assert(!(reply_port and !send_result.val.second));
 
     syscall_return(current) = send_result.val.second;
+
+    if (current->priority > old_priority)
+        reschedule();
 }
 
 void syscall_delete_send_right()
@@ -2736,4 +3215,166 @@ void syscall_set_timer_deadline()
     syscall_error(task) = timer_right->set_deadline(deadline + offset);
 }
 
-} // namespace kernel::proc::syscalls
\ No newline at end of file
+void syscall_futex_wait()
+{
+    auto task  = get_current_task();
+    auto flags = syscall_flags(task);
+
+    u64 deadline = syscall_arg64(task, 0);
+    ulong addr   = syscall_arg(task, 1, 1);
+    u32 expected = syscall_arg(task, 2, 1);
+    if (deadline and (flags & PMOS_FUTEX_RELATIVE))
+        deadline += get_ns_since_bootup();
+
+    kernel::sched::futex_wait((void *)addr, expected, deadline, flags & PMOS_FUTEX_SHARED);
+}
+
+void syscall_futex_wake()
+{
+    auto task  = get_current_task();
+    auto flags = syscall_flags(task);
+
+    ulong addr = syscall_arg(task, 0);
+    u32 count  = syscall_arg(task, 1);
+
+    auto result = kernel::sched::futex_wake((void *)addr, count, flags & PMOS_FUTEX_SHARED);
+    if (!result.success()) {
+        syscall_error(task) = result.result;
+        return;
+    }
+
+    syscall_success(task);
+    syscall_return(task) = result.val;
+}
+
+void syscall_set_mem_object_pager()
+{
+    auto task        = get_current_task();
+    u64 object_right = syscall_arg64(task, 0);
+    u64 pager_right  = syscall_arg64(task, 1);
+
+    auto ret = mem_object_for_right(task, object_right);
+    if (!ret.success()) {
+        syscall_error(task) = ret.result;
+        return;
+    }
+    auto object = klib::move(ret.val);
+    assert(object);
+
+    if (object->is_anonymous() or object->is_dma()) {
+        syscall_error(task) = -EPERM;
+        return;
+    }
+
+    auto group = task->get_rights_namespace();
+    if (!group) {
+        syscall_error(task) = -ESRCH;
+        return;
+    }
+
+    auto right = group->atomic_get_right(pager_right);
+    if (!right or !right->atomic_alive()) {
+        syscall_error(task) = -ENOENT;
+        return;
+    }
+
+    // The right is kept by the caller, so it must be reusable
+    if (right->type() != RightType::SendMany) {
+        syscall_error(task) = -EPERM;
+        return;
+    }
+
+    // Only the owner of the port can serve the pages
+    auto send_right = static_cast<SendRight *>(right);
+    auto port       = send_right->parent_port();
+    if (!port or port->owner != task) {
+        syscall_error(task) = -EPERM;
+        return;
+    }
+
+    auto result = object->atomic_set_pager(port->portno, send_right->right_id_in_reciever());
+    if (result) {
+        syscall_error(task) = result;
+        return;
+    }
+
+    syscall_success(task);
+    syscall_return(task) = object->get_id();
+}
+
+void syscall_provide_mem_object_page()
+{
+    auto task        = get_current_task();
+    u64 object_right = syscall_arg64(task, 0);
+    u64 offset       = syscall_arg64(task, 1);
+    ulong data       = syscall_arg(task, 2, 2);
+
+    if (offset & (PAGE_SIZE - 1)) {
+        syscall_error(task) = -EINVAL;
+        return;
+    }
+
+    auto ret = mem_object_for_right(task, object_right);
+    if (!ret.success()) {
+        syscall_error(task) = ret.result;
+        return;
+    }
+    auto object = klib::move(ret.val);
+    assert(object);
+
+    if (object->is_anonymous()) {
+        syscall_error(task) = -EPERM;
+        return;
+    }
+
+    // Only the pager can provide the pages. The rights to the object are given to the clients
+    // mapping it, which must not be able to change what the others see.
+    auto pager_port_id = object->atomic_get_pager_port();
+    auto pager_port    = pager_port_id ? Port::atomic_get_port(pager_port_id) : nullptr;
+    if (!pager_port) {
+        syscall_error(task) = -EPERM;
+        return;
+    }
+
+    {
+        Auto_Lock_Scope scope_lock(pager_port->lock);
+        if (pager_port->owner != task) {
+            syscall_error(task) = -EPERM;
+            return;
+        }
+    }
+
+    // Copy the data first, since reading the user memory might block
+    klib::vector<char> buffer;
+    if (!buffer.resize(PAGE_SIZE, 0)) {
+        syscall_error(task) = -ENOMEM;
+        return;
+    }
+
+    if (data) {
+        auto result = copy_from_user(&buffer.front(), (const char *)data, PAGE_SIZE);
+        if (!result.success()) {
+            syscall_error(task) = result.result;
+            return;
+        }
+
+        if (!result.val)
+            return;
+    }
+
+    auto page = kernel::pmm::Page_Descriptor::allocate_page(12);
+    if (!page.success()) {
+        syscall_error(task) = page.result;
+        return;
+    }
+
+    {
+        Temp_Mapper_Obj<char> mapper(request_temp_mapper());
+        char *ptr = mapper.map(page.val.get_phys_addr());
+        memcpy(ptr, &buffer.front(), PAGE_SIZE);
+    }
+
+    syscall_error(task) = object->atomic_provide_page(offset, klib::move(page.val));
+}
+
+} // namespace kernel::proc::syscalls
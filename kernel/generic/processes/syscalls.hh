@@ -105,7 +105,8 @@ void syscall_get_lapic_id();
 
 // Programs interrupt to send the message to the right port
 void syscall_set_interrupt();
-// Parameters: uint64_t right_id, uint64_t port_id
+// Parameters: uint64_t right_id, uint64_t port_id, interrupt_counter *counter (with SET_INTERRUPT_COUNTER)
+// Flags: SET_INTERRUPT_COUNTER
 
 // Assigns a name to port
 void syscall_name_port();
@@ -192,9 +193,64 @@ void syscall_set_notify_mask();
 void syscall_set_affinity();
 // Parameters: u64 task_id, u64 cpu, u64 flags
 
+// Sets the mask of CPUs the task can run on
+void syscall_set_affinity_mask();
+// Parameters: u64 task_id, const void *mask, size_t mask_size
+
+// Reads the kernel lock statistics. Returns -ENOSYS if the kernel is built without ENABLE_LOCKSTAT
+void syscall_get_lockstat();
+// Parameters: lockstat_entry *buffer, size_t count
+// Flags: LOCKSTAT_RESET
+
+// Reads the per-syscall statistics, summed over all CPUs. Returns the number of syscalls
+void syscall_get_syscall_stats();
+// Parameters: syscall_stats_entry *buffer, size_t count
+// Flags: SYSCALL_STATS_RESET
+
+// Allocates a message-signalled interrupt and returns the interrupt source right for it
+void syscall_allocate_msi();
+// Parameters: u32 cpu (0 for any, otherwise cpu_id + 1)
+
+// Gets the message that the device has to write to trigger the MSI
+void syscall_get_msi_message();
+// Parameters: u64 right, msi_message *message
+
+// Moves the interrupt to another CPU, together with the calling task, which must own all of its
+// notification rights and no other interrupts
+void syscall_set_interrupt_cpu();
+// Parameters: u64 port, u64 right (interrupt notification), u32 cpu (cpu_id + 1)
+
+// Reads the per-interrupt counters
+void syscall_get_interrupt_stats();
+// Parameters: interrupt_stats_entry *buffer, size_t count
+
+// Reads the RCU backlog statistics. Returns the number of the RCUs
+void syscall_get_rcu_stats();
+// Parameters: rcu_stats_entry *buffer, size_t count
+
+// Blocks the task while the u32 at addr holds expected, until woken up or the deadline passes
+void syscall_futex_wait();
+// Parameters: u64 deadline_ns (0 for none), u32 *addr, u32 expected
+// Flags: PMOS_FUTEX_SHARED, PMOS_FUTEX_RELATIVE
+
+// Wakes up the tasks waiting on addr. Returns the number of woken up tasks
+void syscall_futex_wake();
+// Parameters: u32 *addr, u32 count
+// Flags: PMOS_FUTEX_SHARED
+
+// Sets the pager of the memory object. Returns the ID of the object, used in
+// IPC_Kernel_Request_Page
+void syscall_set_mem_object_pager();
+// Parameters: u64 object_right, u64 pager_right (SendMany right to a port owned by the caller)
+
+// Provides the page of the memory object requested from the pager
+void syscall_provide_mem_object_page();
+// Parameters: u64 object_right, u64 offset, const void *data (PAGE_SIZE bytes, NULL for zeroes)
+
 // Completes an interrupt, dispatched to the user space
 void syscall_complete_interrupt();
-// Parameters: u64 intno
+// Parameters: u64 port, u64 right, u64 poll_delay_ns (with COMPLETE_INTERRUPT_POLL)
+// Flags: COMPLETE_INTERRUPT_POLL
 
 // Yields to the next task (if there is some)
 // In other words, reschedule()s
@@ -78,7 +78,7 @@ void TaskGroup::destroy()
 
 bool TaskGroup::atomic_has_task(u64 id) const noexcept
 {
-    Auto_Lock_Scope lock(tasks_lock);
+    Shared_Lock_Scope lock(tasks_lock);
     return tasks.count(id) == 1;
 }
 
@@ -121,7 +121,7 @@ ReturnStr<TaskGroup *> TaskGroup::create_for_task(TaskDescriptor *task)
 
     {
         Auto_Lock_Scope l(group->tasks_lock);
-        auto r   = group->tasks.insert({task->task_id, task});
+        auto r   = group->tasks.insert_noexcept({task->task_id, task});
         inserted = r.second;
     }
 
@@ -164,7 +164,7 @@ kresult_t TaskGroup::atomic_register_task(TaskDescriptor *task)
         if (!alive())
             return -ESRCH;
 
-        auto r = tasks.insert({task->task_id, task});
+        auto r = tasks.insert_noexcept({task->task_id, task});
         if (r.first == tasks.end())
             return -ENOMEM;
     }
@@ -302,7 +302,7 @@ ReturnStr<u32> TaskGroup::atomic_change_notifier_mask(ipc::Port *port, u32 mask,
 
     if (flags & 0x01) {
 
-        Auto_Lock_Scope tasks_l(tasks_lock);
+        Shared_Lock_Scope tasks_l(tasks_lock);
 
         for (const auto &t: tasks) {
             auto task = t.second;
@@ -341,7 +341,7 @@ TaskGroup *TaskGroup::get_task_group(u64 id)
 bool TaskGroup::alive() const noexcept { return !tasks.empty(); }
 bool TaskGroup::atomic_alive() const noexcept
 {
-    Auto_Lock_Scope l(tasks_lock);
+    Shared_Lock_Scope l(tasks_lock);
     return alive();
 }
 
@@ -28,11 +28,11 @@
 
 #pragma once
 #include <lib/memory.hh>
-#include <lib/splay_tree_map.hh>
 #include <memory/rcu.hh>
 #include <messaging/messaging.hh>
 #include <pmos/containers/intrusive_bst.hh>
 #include <pmos/containers/intrusive_list.hh>
+#include <pmos/containers/map.hh>
 #include <types.hh>
 #include <messaging/rights.hh>
 #include <messaging/ports.hh>
@@ -137,8 +137,8 @@ public:
     bool task_in_group(u64 id) const;
 
     // TODO: make this private...
-    klib::splay_tree_map<u64, TaskDescriptor *> tasks;
-    mutable Spinlock tasks_lock;
+    pmos::containers::map<u64, TaskDescriptor *> tasks;
+    mutable RWSpinlock tasks_lock;
 
     ipc::Right *atomic_get_right(u64 right_id);
     u64 atomic_new_right_id();
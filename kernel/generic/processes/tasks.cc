@@ -204,7 +204,8 @@ kresult_t init_idle(sched::CPU_Info *cpu_str)
     cpu_str->idle_task->regs.program_counter() = (u64)&idle;
     cpu_str->idle_task->type                   = TaskDescriptor::Type::Idle;
 
-    cpu_str->idle_task->priority = idle_priority;
+    cpu_str->idle_task->priority      = idle_priority;
+    cpu_str->idle_task->base_priority = idle_priority;
     cpu_str->idle_task->name     = "idle";
 
     return 0;
@@ -233,7 +234,7 @@ void TaskDescriptor::init()
         // TODO: Give up the lock in here
         if (remote_cpu->current_task_priority > priority)
             remote_cpu->ipi_reschedule();
-    } else if (current_task->priority > priority) {
+    } else if (current_task->priority > priority and can_run_on(cpu_struct)) {
         Auto_Lock_Scope scope_l(current_task->sched_lock);
 
         switch_to();
@@ -874,6 +875,8 @@ void TaskDescriptor::cleanup()
         tasks_map.erase(this);
     }
 
+    sched::futex_cancel_wait(this);
+
     auto get_first_port = [&]() -> ipc::Port * {
         Auto_Lock_Scope scope_lock(sched_lock);
         auto it = owned_ports.begin();
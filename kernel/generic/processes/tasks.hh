@@ -29,6 +29,7 @@
 #pragma once
 #include "task_group.hh"
 
+#include <array>
 #include <assert.h>
 #include <atomic>
 #include <errno.h>
@@ -45,6 +46,8 @@
 #include <pmos/load_data.h>
 #include <registers.hh>
 #include <sched/defs.hh>
+#include <sched/futex.hh>
+#include <sched/topology.hh>
 #include <tuple>
 #include <types.hh>
 
@@ -137,6 +140,21 @@ namespace proc
         u32 cpu_affinity                 = 0;
         Spinlock sched_lock;
 
+        // CPUs the task is allowed to run on, if it is not bound to a single CPU by cpu_affinity.
+        // Tasks with a restricted mask are placed into the local queues of the chosen CPUs
+        // instead of the global ones.
+        sched::CPUMask affinity_mask = sched::CPUMask::all();
+        bool affinity_restricted     = false;
+        // cpu_id + 1 of the CPU the task has last run on, or 0
+        u32 last_cpu = 0;
+
+        // Priority inheritance. *priority* is the effective priority the scheduler uses, while
+        // *base_priority* is the one the task has set for itself. The effective priority is the
+        // highest of the base priority and the priorities donated to the task by the clients
+        // waiting on its replies. Protected by sched_lock.
+        priority_t base_priority = 8;
+        std::array<u32, sched_queues_levels> donated_priorities = {};
+
         union {
             memory::RCU_Head rcu_head;
             pmos::containers::RBTreeNode<TaskDescriptor> task_tree_head = {};
@@ -150,6 +168,9 @@ namespace proc
         klib::shared_ptr<paging::Arch_Page_Table> page_table;
         void *page_blocked_by = nullptr;
 
+        // Futex wait, see sched/futex.hh
+        sched::FutexWaiter futex_waiter;
+
         // Task groups. Using sched_lock...
         pmos::containers::set<TaskGroup *> task_groups;
 
@@ -290,7 +311,7 @@ namespace proc
             static constexpr int NOTIFY_BREAKPOINT = 4;
         };
 
-        klib::splay_tree_map<u64, NotifierPort> notifier_ports;
+        pmos::containers::map<u64, NotifierPort> notifier_ports;
         mutable Spinlock notifier_ports_lock;
 
         /**
@@ -318,6 +339,23 @@ namespace proc
         // Interrupts restarting syscall, setting the return value to interrupted error
         void interrupt_restart_syscall();
 
+        // Checks the cpu_affinity and the affinity mask
+        bool can_run_on(const sched::CPU_Info *cpu) const;
+
+        // Sets the affinity mask, moving the task if it is waiting in a queue of a CPU that is not
+        // in the mask anymore. Like with cpu_affinity, the tasks owning interrupts can't be moved
+        // (-EPERM), and the other tasks must be paused if require_paused is set (-EBUSY).
+        kresult_t atomic_set_affinity_mask(const sched::CPUMask &mask, bool require_paused);
+
+        // Sets the task's own priority, keeping the donated ones
+        void atomic_set_base_priority(priority_t priority);
+
+        // Adds a priority donation (e.g. from the client blocked on the reply from this task)
+        void atomic_donate_priority(priority_t priority);
+
+        // Removes the priority donated by atomic_donate_priority()
+        void atomic_revert_priority_donation(priority_t priority);
+
         // Unblocks the task if it is not already blocked
         void atomic_try_unblock();
 
@@ -342,6 +380,14 @@ namespace proc
         // Unblocks the task from the blocked state
         void unblock() noexcept;
 
+        // Takes the ready task out of its queue and pushes it back with the current priority and
+        // affinity. Returns false if the task was not in a ready queue. sched_lock must be held
+        bool requeue_if_ready() noexcept;
+
+        // Recalculates the effective priority from the base and donated priorities, moving the
+        // task between the ready queues if needed. sched_lock must be held
+        void update_effective_priority() noexcept;
+
         kresult_t set_32bit();
     };
 
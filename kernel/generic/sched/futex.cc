@@ -0,0 +1,250 @@
+#include "futex.hh"
+
+#include "sched.hh"
+
+#include <errno.h>
+#include <memory/paging.hh>
+#include <processes/syscalls.hh>
+#include <processes/tasks.hh>
+#include <utils.hh>
+
+using namespace kernel::proc;
+using namespace kernel::proc::syscalls;
+
+namespace kernel::sched
+{
+
+struct FutexTimeout final: TimerNode {
+    FutexKey key;
+    u64 task_id = 0;
+
+    virtual void fire() override;
+
+    void time_out(TaskDescriptor *task);
+};
+
+namespace
+{
+
+struct FutexBucket {
+    Spinlock lock;
+    pmos::containers::CircularDoubleList<FutexWaiter, &FutexWaiter::list_node> waiters;
+};
+
+using waiters_list = pmos::containers::CircularDoubleList<FutexWaiter, &FutexWaiter::list_node>;
+
+constexpr unsigned futex_bucket_bits = 8;
+FutexBucket futex_buckets[1 << futex_bucket_bits];
+
+// The tasks blocked on the futexes. They are looked up through the buckets, this is only the
+// parent_queue they are unblocked from.
+sched_queue futex_blocked;
+
+FutexBucket &bucket_for(const FutexKey &key)
+{
+    const u64 hash = ((u64)key.object ^ key.offset) * 0x9E3779B97F4A7C15ULL;
+    return futex_buckets[hash >> (64 - futex_bucket_bits)];
+}
+
+ReturnStr<FutexKey> futex_key(TaskDescriptor *task, void *addr, bool shared)
+{
+    if ((ulong)addr & (sizeof(u32) - 1))
+        return Error(-EINVAL);
+
+    auto page_table = task->page_table.get();
+    if (!page_table)
+        return Error(-EFAULT);
+
+    // Memory not shared through an object can only be seen by this address space, so the private
+    // key works for it too
+    if (shared) {
+        u64 offset = 0;
+        if (auto object = page_table->atomic_shared_object_at(addr, offset))
+            return FutexKey {object, offset};
+    }
+
+    return FutexKey {page_table, (u64)addr};
+}
+
+// Takes the waiter out of the bucket, after which the caller is responsible for unblocking the task.
+// The bucket must be locked.
+void claim_waiter(FutexWaiter &w, CPU_Info *c)
+{
+    waiters_list::remove(&w);
+    w.queued = false;
+
+    if (auto timeout = w.timeout) {
+        w.timeout = nullptr;
+        if (w.timeout_cpu == c->cpu_id) {
+            c->timer_queue.erase(timeout);
+            delete timeout;
+        }
+    }
+}
+
+void unblock_waiters(waiters_list &woken)
+{
+    while (!woken.empty()) {
+        FutexWaiter &w = woken.front();
+        // The task might wait again as soon as it is unblocked, reusing the list node
+        waiters_list::remove(&w);
+        w.task->atomic_erase_from_queue(&futex_blocked);
+    }
+}
+
+} // namespace
+
+void FutexTimeout::time_out(TaskDescriptor *task)
+{
+    {
+        auto &bucket = bucket_for(key);
+        Auto_Lock_Scope l(bucket.lock);
+
+        auto &w = task->futex_waiter;
+        // Woken up before the deadline, or waiting again with a different one
+        if (!w.queued or w.timeout != this)
+            return;
+
+        w.timeout = nullptr;
+        claim_waiter(w, get_cpu_struct());
+        syscall_error(task) = -ETIMEDOUT;
+    }
+
+    task->atomic_erase_from_queue(&futex_blocked);
+}
+
+void FutexTimeout::fire()
+{
+    // The task might have exited since, so it is looked up again
+    if (auto task = get_task(task_id))
+        time_out(task);
+
+    delete this;
+}
+
+void futex_wait(void *addr, u32 expected, u64 deadline_ns, bool shared)
+{
+    auto c    = get_cpu_struct();
+    auto task = c->current_task;
+
+    // Another unblock (e.g. by pause and resume) might have left the previous wait queued
+    futex_cancel_wait(task);
+
+    auto key = futex_key(task, addr, shared);
+    if (!key.success()) {
+        syscall_error(task) = key.result;
+        return;
+    }
+
+    klib::unique_ptr<FutexTimeout> timeout = nullptr;
+    if (deadline_ns) {
+        timeout = klib::make_unique<FutexTimeout>();
+        if (!timeout) {
+            syscall_error(task) = -ENOMEM;
+            return;
+        }
+
+        timeout->key        = key.val;
+        timeout->task_id    = task->task_id;
+        timeout->fire_at_ns = deadline_ns;
+    }
+
+    auto &bucket = bucket_for(key.val);
+    Auto_Lock_Scope l(bucket.lock);
+
+    // The wakers change the value before taking the bucket lock, so reading it under the lock
+    // guarantees that a wake-up can't be missed
+    u32 value = 0;
+    auto b    = copy_from_user((char *)&value, (const char *)addr, sizeof(value));
+    if (!b.success()) {
+        syscall_error(task) = b.result;
+        return;
+    }
+
+    // Blocked by the page, the syscall is repeated once it is available
+    if (!b.val)
+        return;
+
+    if (value != expected) {
+        syscall_error(task) = -EAGAIN;
+        return;
+    }
+
+    if (deadline_ns and deadline_ns <= get_ns_since_bootup()) {
+        syscall_error(task) = -ETIMEDOUT;
+        return;
+    }
+
+    Auto_Lock_Scope scope_lock(task->sched_lock);
+    if (task->status == TaskStatus::TASK_DYING)
+        return;
+
+    auto &w  = task->futex_waiter;
+    w.task   = task;
+    w.key    = key.val;
+    w.queued = true;
+    bucket.waiters.push_back(&w);
+
+    if (timeout) {
+        w.timeout     = timeout.release();
+        w.timeout_cpu = c->cpu_id;
+        c->timer_queue.insert(w.timeout);
+        maybe_rearm_timer(deadline_ns);
+    }
+
+    syscall_success(task);
+
+    task->status     = TaskStatus::TASK_BLOCKED;
+    task->blocked_by = nullptr;
+    {
+        Auto_Lock_Scope l(futex_blocked.lock);
+        futex_blocked.push_back(task);
+    }
+
+    find_new_process();
+}
+
+ReturnStr<u32> futex_wake(void *addr, u32 count, bool shared)
+{
+    auto c   = get_cpu_struct();
+    auto key = futex_key(c->current_task, addr, shared);
+    if (!key.success())
+        return key.propagate();
+
+    waiters_list woken;
+    u32 woken_count = 0;
+    {
+        auto &bucket = bucket_for(key.val);
+        Auto_Lock_Scope l(bucket.lock);
+
+        for (auto it = bucket.waiters.begin(); it != bucket.waiters.end() and woken_count < count;) {
+            FutexWaiter &w = *it;
+            ++it;
+
+            if (w.key != key.val)
+                continue;
+
+            claim_waiter(w, c);
+            woken.push_back(&w);
+            ++woken_count;
+        }
+    }
+
+    unblock_waiters(woken);
+    return woken_count;
+}
+
+void futex_cancel_wait(TaskDescriptor *task)
+{
+    auto &w = task->futex_waiter;
+    if (!__atomic_load_n(&w.queued, __ATOMIC_ACQUIRE))
+        return;
+
+    // The key is only changed by the task itself
+    auto &bucket = bucket_for(w.key);
+    Auto_Lock_Scope l(bucket.lock);
+    if (w.queued)
+        claim_waiter(w, get_cpu_struct());
+}
+
+} // namespace kernel::sched
@@ -0,0 +1,61 @@
+#pragma once
+#include <pmos/containers/intrusive_list.hh>
+#include <types.hh>
+
+namespace kernel::proc
+{
+class TaskDescriptor;
+}
+
+namespace kernel::sched
+{
+
+/**
+ * @brief Identifies the word the tasks wait on
+ *
+ * For the private futexes, this is the page table and the virtual address. For the ones in memory
+ * shared through a memory object, this is the object and the offset in it, so that the tasks
+ * mapping it at different addresses (or in different address spaces) find each other. The
+ * pointers are only compared and never dereferenced.
+ */
+struct FutexKey {
+    const void *object = nullptr;
+    u64 offset         = 0;
+
+    bool operator==(const FutexKey &) const = default;
+};
+
+struct FutexTimeout;
+
+// Per-task state of the futex wait. Protected by the lock of the bucket of the key.
+struct FutexWaiter {
+    pmos::containers::DoubleListHead<FutexWaiter> list_node;
+    proc::TaskDescriptor *task = nullptr;
+    FutexKey key;
+
+    // Deadline of the current wait, if any. The timer can only be removed from the queue of the
+    // CPU it was armed on, so the other CPUs just clear this, and the timer discards itself when
+    // it fires.
+    FutexTimeout *timeout = nullptr;
+    u32 timeout_cpu       = 0;
+
+    bool queued = false;
+};
+
+/**
+ * @brief Blocks the current task if the u32 at addr holds expected
+ *
+ * The syscall returns 0 once woken up by futex_wake(), -EAGAIN if the value was different and
+ * -ETIMEDOUT if deadline_ns (in nanoseconds since bootup, 0 for none) has passed. The value is
+ * checked with the bucket locked, so the wake-ups after changing the value can't be missed.
+ */
+void futex_wait(void *addr, u32 expected, u64 deadline_ns, bool shared);
+
+/// Wakes up to count tasks waiting on addr. Returns the number of woken up tasks, or a negative
+/// error
+ReturnStr<u32> futex_wake(void *addr, u32 count, bool shared);
+
+/// Removes the dying task from the futex queue, if it is waiting
+void futex_cancel_wait(proc::TaskDescriptor *task);
+
+} // namespace kernel::sched
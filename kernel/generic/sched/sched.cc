@@ -115,7 +115,13 @@ void push_ready(TaskDescriptor *p)
 
     if (priority < priority_lim) {
         const auto affinity = p->cpu_affinity;
-        auto &sched_queues = affinity == 0 ? global_sched_queues : cpus[affinity - 1]->sched_queues;
+        CPU_Info *target    = nullptr;
+        if (affinity != 0)
+            target = cpus[affinity - 1];
+        else if (p->affinity_restricted)
+            target = select_cpu_for_mask(p);
+
+        auto &sched_queues = target ? target->sched_queues : global_sched_queues;
         auto *const queue  = &sched_queues[priority];
 
         p->parent_queue = queue;
@@ -176,6 +182,9 @@ void CPU_Info::SchedulerTimerNode::fire()
     }
 }
 
+// Number of the RCU callbacks run on each timer interrupt, to bound its latency
+static constexpr size_t rcu_interrupt_batch = 64;
+
 void cpu_timer_interrupt()
 {
     CPU_Info *c = get_cpu_struct();
@@ -184,6 +193,13 @@ void cpu_timer_interrupt()
     // Since this function is called from the timer interrupt, no context is held here
     c->heap_rcu_cpu.quiet(heap_rcu, c->cpu_id);
 
+    // The callbacks are mostly run by the idle task, but a busy CPU has to make some progress too
+    c->heap_rcu_cpu.run_callbacks(rcu_interrupt_batch);
+    c->paging_rcu_cpu.run_callbacks(rcu_interrupt_batch);
+
+    if (c->heap_rcu_cpu.backlog_high() or c->paging_rcu_cpu.backlog_high())
+        memory::expedite_grace_periods();
+
     // TODO: Replace with more sophisticated algorithm. Will definitely need to be redone once we
     // have multi-cpu support
 
@@ -377,6 +393,29 @@ void check_synchronous_ipis()
 
 } // namespace kernel::sched
 
+// If the ready task has been pushed to the local queue of another CPU, sends it a reschedule
+// IPI if it is running something with a lower priority
+static void notify_queue_owner(TaskDescriptor *t)
+{
+    auto queue = t->parent_queue;
+    if (!queue or t->priority >= sched_queues_levels)
+        return;
+
+    CPU_Info *owner = nullptr;
+    if (t->cpu_affinity != 0) {
+        owner = cpus[t->cpu_affinity - 1];
+    } else if (t->affinity_restricted) {
+        for (auto c: cpus)
+            if (queue == &c->sched_queues[t->priority]) {
+                owner = c;
+                break;
+            }
+    }
+
+    if (owner and owner != get_cpu_struct() and owner->current_task_priority > t->priority)
+        owner->ipi_reschedule();
+}
+
 void TaskDescriptor::atomic_block_by_page(void *page, sched_queue *blocked_ptr)
 {
     assert(status != TaskStatus::TASK_BLOCKED && "task cannot be blocked twice");
@@ -412,7 +451,30 @@ void TaskDescriptor::unblock() noexcept
 
     auto &local_cpu = *get_cpu_struct();
 
-    if (cpu_affinity == 0 or ((cpu_affinity - 1) == local_cpu.cpu_id)) {
+    if (cpu_affinity == 0) {
+        auto target = select_wakeup_cpu(this, &local_cpu);
+        if (target and target != &local_cpu and priority < global_sched_queues.size()) {
+            // Carry the dying status, so that the other CPU cleans the task up
+            if (status != TaskStatus::TASK_DYING)
+                status = TaskStatus::TASK_READY;
+
+            // The target is only a hint: it might get busy before picking the task up, so unless
+            // the mask says otherwise, the task goes to the global queue where any CPU can find it
+            auto &queues      = affinity_restricted ? target->sched_queues : global_sched_queues;
+            auto *const queue = &queues[priority];
+            parent_queue      = queue;
+            {
+                Auto_Lock_Scope lock(queue->lock);
+                queue->push_back(this);
+            }
+
+            if (target->current_task_priority > priority)
+                target->ipi_reschedule();
+            return;
+        }
+    }
+
+    if ((cpu_affinity == 0 and can_run_on(&local_cpu)) or ((cpu_affinity - 1) == local_cpu.cpu_id)) {
         TaskDescriptor *current_task = get_cpu_struct()->current_task;
 
         if (current_task->priority > priority) {
@@ -436,10 +498,7 @@ void TaskDescriptor::unblock() noexcept
         // TODO: If other CPU is switching to a lower priority task, it might miss the newly pushed
         // one and not execute it immediately. Not a big deal for now, but better approach is
         // probably needed...
-        auto remote_cpu = cpus[cpu_affinity - 1];
-        assert(remote_cpu->cpu_id == cpu_affinity - 1);
-        if (remote_cpu->current_task_priority > priority)
-            remote_cpu->ipi_reschedule();
+        notify_queue_owner(this);
     }
 }
 
@@ -468,6 +527,7 @@ void TaskDescriptor::switch_to()
 
     c->current_task_priority = priority;
     c->current_task          = this;
+    last_cpu                 = c->cpu_id + 1;
 
     this->after_task_switch();
 
@@ -530,6 +590,111 @@ void TaskDescriptor::atomic_try_unblock()
     unblock();
 }
 
+bool TaskDescriptor::requeue_if_ready() noexcept
+{
+    assert(sched_lock.is_locked());
+
+    // Another CPU might have popped the task from the ready queue and be waiting on its
+    // sched_lock, so check that it is still in the queue
+    bool requeue = false;
+    if (auto queue = parent_queue; status == TaskStatus::TASK_READY and queue) {
+        Auto_Lock_Scope l(queue->lock);
+        if (parent_queue == queue) {
+            queue->erase(this);
+            requeue = true;
+        }
+    }
+
+    if (!requeue)
+        return false;
+
+    push_ready(this);
+    notify_queue_owner(this);
+
+    return true;
+}
+
+bool TaskDescriptor::can_run_on(const CPU_Info *cpu) const
+{
+    if (cpu_affinity != 0)
+        return cpu_affinity - 1 == cpu->cpu_id;
+
+    return affinity_mask.test(cpu->cpu_id);
+}
+
+kresult_t TaskDescriptor::atomic_set_affinity_mask(const CPUMask &mask, bool require_paused)
+{
+    Auto_Lock_Scope l(sched_lock);
+    if (require_paused and status != TaskStatus::TASK_PAUSED)
+        return -EBUSY;
+
+    if (not can_be_rebound())
+        return -EPERM;
+
+    affinity_mask       = mask;
+    affinity_restricted = !mask.covers_all_cpus();
+
+    requeue_if_ready();
+    return 0;
+}
+
+void TaskDescriptor::update_effective_priority() noexcept
+{
+    assert(sched_lock.is_locked());
+
+    priority_t new_priority = base_priority;
+    for (priority_t i = 0; i < new_priority and i < sched_queues_levels; ++i) {
+        if (donated_priorities[i]) {
+            new_priority = i;
+            break;
+        }
+    }
+
+    if (new_priority == priority)
+        return;
+
+    priority = new_priority;
+
+    if (requeue_if_ready())
+        return;
+
+    auto c = get_cpu_struct();
+    if (c->current_task == this)
+        c->current_task_priority = priority;
+
+    // If the task is running on another CPU, its priority will be picked up on the next switch.
+    // Blocked and paused tasks carry the priority with them when they get pushed to the ready
+    // queues.
+}
+
+void TaskDescriptor::atomic_set_base_priority(priority_t new_priority)
+{
+    Auto_Lock_Scope l(sched_lock);
+    base_priority = new_priority;
+    update_effective_priority();
+}
+
+void TaskDescriptor::atomic_donate_priority(priority_t donated)
+{
+    if (donated < 0 or donated >= sched_queues_levels)
+        return;
+
+    Auto_Lock_Scope l(sched_lock);
+    ++donated_priorities[donated];
+    update_effective_priority();
+}
+
+void TaskDescriptor::atomic_revert_priority_donation(priority_t donated)
+{
+    if (donated < 0 or donated >= sched_queues_levels)
+        return;
+
+    Auto_Lock_Scope l(sched_lock);
+    assert(donated_priorities[donated] > 0);
+    --donated_priorities[donated];
+    update_effective_priority();
+}
+
 extern int kernel_pt_active_cpus_count[2];
 
 void kernel::sched::call_after_smp_entry()
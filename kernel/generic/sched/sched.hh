@@ -29,10 +29,12 @@
 #pragma once
 #include "defs.hh"
 #include "sched_queue.hh"
+#include "topology.hh"
 
 #include <array>
 #include <interrupts/interrupt_handler.hh>
 #include <interrupts/stack.hh>
+#include <kern_logger/log_ring.hh>
 #include <lib/array.hh>
 #include <lib/memory.hh>
 #include <lib/splay_tree_map.hh>
@@ -41,6 +43,7 @@
 #include <lib/vector.hh>
 #include <memory/rcu.hh>
 #include <memory/temp_mapper.hh>
+#include <memory/vmm.hh>
 #include <messaging/messaging.hh>
 #include <pmos/containers/intrusive_bst.hh>
 #include <pmos/containers/intrusive_list.hh>
@@ -59,6 +62,11 @@
     struct EIOPIC;
 #endif
 
+namespace kernel::proc::syscalls
+{
+struct SyscallStats;
+}
+
 namespace kernel::sched
 {
 
@@ -160,13 +168,33 @@ struct CPU_Info {
 
     u32 cpu_id = 0;
 
+    CPUTopology topology;
+
     memory::RCU_CPU paging_rcu_cpu;
     memory::RCU_CPU heap_rcu_cpu;
 
+    vmm::VirtmemQuantumCache vmm_quantum_cache;
+
+    // Queued by memory::expedite_grace_periods() to make the CPU report the quiescent state
+    struct RCUExpediteNode final: AttentionNode {
+        // Protected by attention_queue_lock
+        bool queued = false;
+        virtual void get_attention() override;
+    };
+
+    RCUExpediteNode rcu_expedite_node = {};
+
+    // Allocated on the first system call
+    proc::syscalls::SyscallStats *syscall_stats = nullptr;
+
 #if defined(__x86_64__) || defined(__i386__)
     u32 lapic_id                            = 0;
     static constexpr unsigned MAPPABLE_INTS = 192;
     std::array<interrupts::InterruptHandler *, MAPPABLE_INTS> isr_handlers;
+
+    // Set while the idle task is waiting in MWAIT on ipi_mask. The pollable IPIs only need to set
+    // the bit in the mask then.
+    bool idle_polling = false;
 #endif
     // TODO: APLIC on RISC-V and other per-CPU controller memes...
     // Also, this is a random place to leave this comment, but it would be nice to implement the ELF TLS thing
@@ -203,6 +231,8 @@ struct CPU_Info {
     u32 allocated_int_count                = 0;
 
     constexpr static u32 ipi_synchronous_mask = IPI_TLB_SHOOTDOWN | IPI_CPU_PARK;
+    // IPIs which don't need an interrupt if the CPU is idle and is monitoring ipi_mask
+    constexpr static u32 ipi_pollable_mask = IPI_RESCHEDULE | IPI_GET_ATTENTION;
     constexpr static u32 IPI_MASK = IPI_RESCHEDULE | IPI_TLB_SHOOTDOWN | IPI_CPU_PARK | IPI_GET_ATTENTION;
 
     // IMHO this is better than protecting current_task pointer with spinlock
@@ -240,6 +270,16 @@ struct CPU_Info {
     SchedulerTimerNode stn = {};
     u64 sched_timer_deadline = 0;
 
+    // Kernel log messages written on this CPU, see log::Buffered_Logger
+    log::StaticLogRing<32768> log_ring;
+
+    struct LogFlushTimerNode final: TimerNode {
+        bool armed = false;
+        virtual void fire() override;
+    };
+
+    LogFlushTimerNode log_flush_timer = {};
+
     void sched_timer(u64 period_ms);
 
     u64 local_timer_next_deadline = 0;
@@ -0,0 +1,128 @@
+#include "topology.hh"
+
+#include "sched.hh"
+
+#include <kern_logger/kern_logger.hh>
+#include <processes/tasks.hh>
+
+namespace kernel::sched
+{
+
+bool CPUMask::covers_all_cpus() const noexcept
+{
+    for (auto c: cpus)
+        if (!test(c->cpu_id))
+            return false;
+    return true;
+}
+
+bool shares_core(const CPU_Info *a, const CPU_Info *b)
+{
+    return a->topology.package_id == b->topology.package_id and
+           a->topology.core_id == b->topology.core_id;
+}
+
+bool shares_cache(const CPU_Info *a, const CPU_Info *b)
+{
+    return a->topology.package_id == b->topology.package_id and
+           a->topology.cache_id == b->topology.cache_id;
+}
+
+static bool is_idle(const CPU_Info *c)
+{
+    return __atomic_load_n(&c->current_task_priority, __ATOMIC_RELAXED) >= idle_priority;
+}
+
+static bool would_preempt(const CPU_Info *c, priority_t priority)
+{
+    return __atomic_load_n(&c->current_task_priority, __ATOMIC_RELAXED) > priority;
+}
+
+static bool usable_for(const CPU_Info *c, const proc::TaskDescriptor *task)
+{
+    return __atomic_load_n(&c->online, __ATOMIC_RELAXED) and task->affinity_mask.test(c->cpu_id);
+}
+
+CPU_Info *select_wakeup_cpu(proc::TaskDescriptor *task, CPU_Info *waker)
+{
+    assert(task);
+    assert(waker);
+
+    // The cache of the CPU the task has last run on is the most likely to still be hot
+    if (task->last_cpu != 0 and task->last_cpu <= cpus.size()) {
+        auto prev = cpus[task->last_cpu - 1];
+        if (prev != waker and usable_for(prev, task) and is_idle(prev))
+            return prev;
+    }
+
+    if (usable_for(waker, task) and would_preempt(waker, task->priority))
+        return waker;
+
+    // Otherwise, find an idle CPU close to the waker, preferring SMT siblings
+    CPU_Info *candidate = nullptr;
+    for (auto c: cpus) {
+        if (c == waker or !usable_for(c, task) or !is_idle(c))
+            continue;
+
+        if (shares_core(c, waker))
+            return c;
+
+        if (!candidate and shares_cache(c, waker))
+            candidate = c;
+    }
+
+    return candidate;
+}
+
+CPU_Info *select_cpu_for_mask(proc::TaskDescriptor *task)
+{
+    assert(task);
+
+    if (task->last_cpu != 0 and task->last_cpu <= cpus.size()) {
+        auto prev = cpus[task->last_cpu - 1];
+        if (usable_for(prev, task))
+            return prev;
+    }
+
+    CPU_Info *best = nullptr;
+    for (auto c: cpus) {
+        if (!usable_for(c, task))
+            continue;
+
+        if (is_idle(c))
+            return c;
+
+        if (!best or __atomic_load_n(&c->current_task_priority, __ATOMIC_RELAXED) >
+                         __atomic_load_n(&best->current_task_priority, __ATOMIC_RELAXED))
+            best = c;
+    }
+
+    if (!best) {
+        // None of the CPUs are online; take the first one from the mask
+        auto first = task->affinity_mask.first();
+        if (first >= 0 and (size_t)first < cpus.size())
+            best = cpus[first];
+    }
+
+    return best;
+}
+
+void init_flat_topology()
+{
+    for (auto c: cpus) {
+        c->topology.package_id = 0;
+        c->topology.core_id    = c->cpu_id;
+        c->topology.thread_id  = 0;
+        c->topology.cache_id   = 0;
+    }
+}
+
+void print_cpu_topology()
+{
+    for (auto c: cpus)
+        log::serial_logger.printf("CPU %i: package %i core %i thread %i cache %i\n", c->cpu_id,
+                                  c->topology.package_id, c->topology.core_id,
+                                  c->topology.thread_id, c->topology.cache_id);
+}
+
+} // namespace kernel::sched
@@ -0,0 +1,100 @@
+#pragma once
+#include <array>
+#include <types.hh>
+
+namespace kernel::proc
+{
+class TaskDescriptor;
+}
+
+namespace kernel::sched
+{
+
+struct CPU_Info;
+
+// Maximum number of CPUs that can be expressed in the affinity masks
+inline constexpr size_t max_cpus = 256;
+
+// cpuset-style bitmap of CPUs, indexed by CPU_Info::cpu_id
+struct CPUMask {
+    static constexpr size_t bits_per_word = sizeof(u64) * 8;
+    std::array<u64, max_cpus / bits_per_word> words = {};
+
+    constexpr void set(u32 cpu) noexcept
+    {
+        if (cpu < max_cpus)
+            words[cpu / bits_per_word] |= (u64)1 << (cpu % bits_per_word);
+    }
+
+    constexpr void clear(u32 cpu) noexcept
+    {
+        if (cpu < max_cpus)
+            words[cpu / bits_per_word] &= ~((u64)1 << (cpu % bits_per_word));
+    }
+
+    constexpr bool test(u32 cpu) const noexcept
+    {
+        if (cpu >= max_cpus)
+            return false;
+        return words[cpu / bits_per_word] & ((u64)1 << (cpu % bits_per_word));
+    }
+
+    constexpr bool empty() const noexcept
+    {
+        for (auto w: words)
+            if (w)
+                return false;
+        return true;
+    }
+
+    // Returns the first CPU in the mask, or -1 if the mask is empty
+    constexpr int first() const noexcept
+    {
+        for (size_t i = 0; i < words.size(); ++i)
+            if (words[i])
+                return i * bits_per_word + __builtin_ctzll(words[i]);
+        return -1;
+    }
+
+    // True if every CPU present in the system is in the mask
+    bool covers_all_cpus() const noexcept;
+
+    static constexpr CPUMask all() noexcept
+    {
+        CPUMask m;
+        for (auto &w: m.words)
+            w = ~(u64)0;
+        return m;
+    }
+};
+
+// Position of the CPU in the system. The IDs are only meaningful for comparing with other CPUs.
+struct CPUTopology {
+    u32 package_id = 0;
+    u32 core_id    = 0;
+    u32 thread_id  = 0;
+    // CPUs with the same cache_id share the last level cache
+    u32 cache_id = 0;
+};
+
+bool shares_core(const CPU_Info *a, const CPU_Info *b);
+bool shares_cache(const CPU_Info *a, const CPU_Info *b);
+
+// Picks the CPU for the task being woken up by *waker*, preferring the CPU the task has last run
+// on and the CPUs sharing the cache with the waker, if they would run it right away. Returns
+// nullptr if there is no good candidate, in which case the task should go to the global queues.
+CPU_Info *select_wakeup_cpu(proc::TaskDescriptor *task, CPU_Info *waker);
+
+// Picks the CPU for the task with a restricted affinity mask, which is not bound to a single CPU
+CPU_Info *select_cpu_for_mask(proc::TaskDescriptor *task);
+
+// Discovers the CPU topology. Arch-specific, called once all CPU_Info structures are created
+void detect_cpu_topology();
+
+// Fallback for when no topology information is available: every CPU is its own core, sharing the
+// package and the cache with the others
+void init_flat_topology();
+
+void print_cpu_topology();
+
+} // namespace kernel::sched
@@ -76,12 +76,32 @@ template<typename T> ReturnStr<T> Success(T r) { return ReturnStr<T>::success(st
 
 extern "C" void t_print_bochs(const char *str, ...);
 
+#ifdef ENABLE_LOCKSTAT
+// Lock statistics, see lockstat.cc
+namespace kernel::lockstat
+{
+// State of the current lock holder
+struct Holder {
+    u32 site        = 0;
+    u64 acquired_at = 0;
+};
+
+u64 now() noexcept;
+void acquired(Holder &h, void *site, bool contended, u64 spin_start) noexcept;
+void released(Holder &h) noexcept;
+} // namespace kernel::lockstat
+#endif
+
 class Spinlock_base
 {
 private:
     u32 locked = 0;
 
 protected:
+#ifdef ENABLE_LOCKSTAT
+    kernel::lockstat::Holder lockstat;
+#endif
+
     void lock() noexcept;
     bool try_lock() noexcept;
     void unlock() noexcept;
@@ -100,18 +120,55 @@ public:
     bool try_lock() noexcept;
 
     // Function to unlock the spinlock
+#ifdef ENABLE_LOCKSTAT
+    void unlock() noexcept
+    {
+        kernel::lockstat::released(lockstat);
+        Spinlock_base::unlock();
+    }
+#else
     void unlock() noexcept { Spinlock_base::unlock(); }
+#endif
 };
 
 class CriticalSpinlock: public Spinlock_base
 {
 public:
+#ifdef ENABLE_LOCKSTAT
+    void lock() noexcept;
+    bool try_lock() noexcept;
+
+    inline void unlock() noexcept
+    {
+        kernel::lockstat::released(lockstat);
+        Spinlock_base::unlock();
+    }
+#else
     inline void lock() noexcept { Spinlock_base::lock(); }
     /// Tries to lock the spinlock. True if lock has been ackquired, false otherwise
     inline bool try_lock() noexcept { return Spinlock_base::try_lock(); }
 
     // Function to unlock the spinlock
     inline void unlock() noexcept { Spinlock_base::unlock(); }
+#endif
+};
+
+/// Spinlock which can be held by several readers at once. Good for the read-mostly structures,
+/// where the lookups would otherwise serialize. Waiting writers block the new readers, so they
+/// don't get starved.
+class RWSpinlock
+{
+private:
+    static constexpr u32 WRITER = 1U << 31;
+    // WRITER is set when a writer holds or waits for the lock, the rest counts the readers
+    u32 state = 0;
+
+public:
+    void lock() noexcept;
+    void unlock() noexcept;
+
+    void lock_shared() noexcept;
+    void unlock_shared() noexcept;
 };
 
 template<typename T>
@@ -130,6 +187,15 @@ template<spinlock_type T> struct Auto_Lock_Scope {
     ~Auto_Lock_Scope() { s.unlock(); }
 };
 
+template<typename T> struct Shared_Lock_Scope {
+    T &s;
+
+    Shared_Lock_Scope() = delete;
+    Shared_Lock_Scope(T &lock): s(lock) { s.lock_shared(); }
+
+    ~Shared_Lock_Scope() { s.unlock_shared(); }
+};
+
 template<spinlock_type T> struct Auto_Lock_Scope_Double {
     T &a;
     T &b;
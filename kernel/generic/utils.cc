@@ -491,13 +491,44 @@ extern "C" void *memset(void *str, int c, size_t n)
     return str;
 }
 
-void clear_page(u64 phys_addr, u64 pattern)
-{
-    Temp_Mapper_Obj<u64> mapper(request_temp_mapper());
-    mapper.map(phys_addr);
+void clear_pages(u64 phys_addr, size_t count, u64 pattern)
+{
+    for_each_phys_window(phys_addr, count * 4096, [&](void *virt, size_t size) {
+        u64 *p = (u64 *)virt;
+        for (size_t i = 0; i < size / sizeof(u64); ++i)
+            p[i] = pattern;
+    });
+}
+
+void clear_page(u64 phys_addr, u64 pattern) { clear_pages(phys_addr, 1, pattern); }
+
+void copy_pages(u64 from, u64 to, size_t count)
+{
+    Temp_Mapper &mapper = request_temp_mapper();
+    // Both of the ranges have to be mapped at the same time
+    size_t window = mapper.max_window_pages() / 2;
+    if (window == 0)
+        window = 1;
+
+    Temp_Mapper_Obj<char> src(mapper);
+    Temp_Mapper_Obj<char> dst(mapper);
+    while (count > 0) {
+        const size_t n = count < window ? count : window;
+        src.map_window(from, n);
+        dst.map_window(to, n);
+        if (!src.ptr or !dst.ptr) {
+            // Some of the slots are taken by the caller
+            assert(n > 1);
+            window = n / 2;
+            continue;
+        }
 
-    for (size_t i = 0; i < 4096 / sizeof(u64); ++i)
-        mapper.ptr[i] = pattern;
+        memcpy(dst.ptr, src.ptr, n * 4096);
+
+        from += n * 4096;
+        to += n * 4096;
+        count -= n;
+    }
 }
 
 int fflush(FILE *) { return 0; }
@@ -536,13 +567,11 @@ extern "C" int strcmp(const char *str1, const char *str2)
 
 void copy_from_phys(u64 phys_addr, void *to, size_t size)
 {
-    Temp_Mapper_Obj<void> mapper(request_temp_mapper());
-    for (u64 i = phys_addr & ~0xfffULL; i < phys_addr + size; i += 0x1000) {
-        mapper.map(i);
-        const u64 start = i < phys_addr ? phys_addr : i;
-        const u64 end   = i + 0x1000 < phys_addr + size ? i + 0x1000 : phys_addr + size;
-        memcpy((char *)to + (start - phys_addr), (char *)mapper.ptr + (start - i), end - start);
-    }
+    char *dst = (char *)to;
+    for_each_phys_window(phys_addr, size, [&](void *virt, size_t chunk) {
+        memcpy(dst, virt, chunk);
+        dst += chunk;
+    });
 }
 
 size_t strlen_over_phys(u64 phys_addr)
@@ -616,22 +645,98 @@ void check_synchronous_ipis();
 
 void Spinlock::lock() noexcept
 {
+#ifdef ENABLE_LOCKSTAT
+    void *site = __builtin_return_address(0);
+    if (Spinlock_base::try_lock()) {
+        kernel::lockstat::acquired(lockstat, site, false, 0);
+        return;
+    }
+    u64 spin_start = kernel::lockstat::now();
+#endif
+
     while (!Spinlock_base::try_lock()) {
         // Since the current kernel spinlock situation is not very good, and the
         // kernel can't preempt itself, if the lock fails to acquire,
         // check that other CPUs are not waiting for us to do something.
         check_synchronous_ipis();
     }
+
+#ifdef ENABLE_LOCKSTAT
+    kernel::lockstat::acquired(lockstat, site, true, spin_start);
+#endif
+}
+
+void RWSpinlock::lock() noexcept
+{
+    u32 s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    while (true) {
+        if (!(s & WRITER) and
+            __atomic_compare_exchange_n(&state, &s, s | WRITER, true, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED))
+            break;
+
+        check_synchronous_ipis();
+        s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    }
+
+    // Wait for the readers which got in before
+    while (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != WRITER)
+        check_synchronous_ipis();
 }
 
+void RWSpinlock::unlock() noexcept { __atomic_store_n(&state, 0, __ATOMIC_RELEASE); }
+
+void RWSpinlock::lock_shared() noexcept
+{
+    u32 s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    while (true) {
+        if (!(s & WRITER) and __atomic_compare_exchange_n(&state, &s, s + 1, true,
+                                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+
+        check_synchronous_ipis();
+        s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    }
+}
+
+void RWSpinlock::unlock_shared() noexcept { __atomic_sub_fetch(&state, 1, __ATOMIC_RELEASE); }
+
 bool Spinlock::try_lock() noexcept
 {
     auto result = Spinlock_base::try_lock();
     if (!result) {
         check_synchronous_ipis();
     }
+#ifdef ENABLE_LOCKSTAT
+    else {
+        kernel::lockstat::acquired(lockstat, __builtin_return_address(0), false, 0);
+    }
+#endif
+    return result;
+}
+
+#ifdef ENABLE_LOCKSTAT
+void CriticalSpinlock::lock() noexcept
+{
+    void *site = __builtin_return_address(0);
+    if (Spinlock_base::try_lock()) {
+        kernel::lockstat::acquired(lockstat, site, false, 0);
+        return;
+    }
+
+    u64 spin_start = kernel::lockstat::now();
+    Spinlock_base::lock();
+    kernel::lockstat::acquired(lockstat, site, true, spin_start);
+}
+
+bool CriticalSpinlock::try_lock() noexcept
+{
+    auto result = Spinlock_base::try_lock();
+    if (result)
+        kernel::lockstat::acquired(lockstat, __builtin_return_address(0), false, 0);
     return result;
 }
+#endif
 
 void halt();
 
@@ -64,10 +64,12 @@ ReturnStr<bool> prepare_user_buff_wr(char *buff, size_t size);
 ReturnStr<bool> copy_from_user(char *to, const char *from, size_t size);
 ReturnStr<bool> copy_to_user(const char *from, char *to, size_t size);
 
-// Copies a frame (ppn)
-void copy_frame(u64 from, u64 to);
+// Copies count physically contiguous pages, mapping as many of them at once as the temp mapper
+// allows
+void copy_pages(u64 from, u64 to, size_t count);
 
 void clear_page(u64 phys_addr, u64 pattern = 0);
+void clear_pages(u64 phys_addr, size_t count, u64 pattern = 0);
 
 void copy_from_phys(u64 phys_addr, void *to, size_t size);
 klib::string capture_from_phys(u64 phys_addr);
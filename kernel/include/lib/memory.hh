@@ -30,6 +30,7 @@
 #include "cstddef.hh"
 #include "utility.hh"
 
+#include <new>
 #include <stddef.h>
 #include <types.hh>
 
@@ -204,12 +205,72 @@ template<class T> constexpr unique_ptr<T> make_unique(size_t size)
     return unique_ptr<T>(new typename remove_extent<T>::type[size]());
 }
 
+/// Control block of shared_ptr and weak_ptr. The counters are atomic, so copying the pointers
+/// doesn't take locks. The shared references hold one weak reference between them, so the block is
+/// freed when both the object is destroyed and the last weak_ptr is gone.
 struct _smart_ptr_refcount_str {
-    unsigned long shared_refs = 0;
-    unsigned long weak_refs   = 0;
-    Spinlock s;
+    unsigned long shared_refs = 1;
+    unsigned long weak_refs   = 1;
+
+    virtual ~_smart_ptr_refcount_str() = default;
+
+    /// Destroys the managed object, once the last shared reference is dropped
+    virtual void destroy_object() noexcept = 0;
+
+    void add_shared() noexcept { __atomic_fetch_add(&shared_refs, 1, __ATOMIC_RELAXED); }
+
+    /// Adds the shared reference, unless the object has already been destroyed
+    bool try_add_shared() noexcept
+    {
+        unsigned long refs = __atomic_load_n(&shared_refs, __ATOMIC_RELAXED);
+        do {
+            if (refs == 0)
+                return false;
+        } while (!__atomic_compare_exchange_n(&shared_refs, &refs, refs + 1, true, __ATOMIC_ACQUIRE,
+                                              __ATOMIC_RELAXED));
+        return true;
+    }
+
+    void release_shared() noexcept
+    {
+        if (__atomic_sub_fetch(&shared_refs, 1, __ATOMIC_ACQ_REL) == 0) {
+            destroy_object();
+            release_weak();
+        }
+    }
+
+    void add_weak() noexcept { __atomic_fetch_add(&weak_refs, 1, __ATOMIC_RELAXED); }
+
+    void release_weak() noexcept
+    {
+        if (__atomic_sub_fetch(&weak_refs, 1, __ATOMIC_ACQ_REL) == 0)
+            delete this;
+    }
+
+    unsigned long use_count() const noexcept
+    {
+        return __atomic_load_n(&shared_refs, __ATOMIC_RELAXED);
+    }
+};
+
+/// Control block of the object allocated separately, e.g. passed in unique_ptr
+template<class T> struct _smart_ptr_pointer_block final: _smart_ptr_refcount_str {
+    T *ptr;
+
+    _smart_ptr_pointer_block(T *ptr) noexcept: ptr(ptr) {}
+    void destroy_object() noexcept override { delete ptr; }
+};
+
+/// Control block with the object stored in it, created by make_shared()
+template<class T> struct _smart_ptr_inplace_block final: _smart_ptr_refcount_str {
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *object() noexcept { return reinterpret_cast<T *>(storage); }
+    void destroy_object() noexcept override { object()->~T(); }
 };
 
+template<class T> class enable_shared_from_this;
+
 template<class T> class shared_ptr
 {
     template<class U> friend class shared_ptr;
@@ -220,25 +281,26 @@ private:
 
     void _clear()
     {
-        if (refcount == nullptr)
-            return;
-
-        unsigned long temp_shared_refs = -1;
-        unsigned long temp_weak_refs   = -1;
+        if (refcount != nullptr)
+            refcount->release_shared();
 
-        refcount->s.lock();
-        temp_shared_refs = --refcount->shared_refs;
-        temp_weak_refs   = refcount->weak_refs;
-        refcount->s.unlock();
+        ptr      = nullptr;
+        refcount = nullptr;
+    }
 
-        if (temp_shared_refs == 0) {
-            delete ptr;
+    void _acquire()
+    {
+        if (refcount != nullptr)
+            refcount->add_shared();
+    }
 
-            if (temp_weak_refs == 0) {
-                delete refcount;
-            }
-        }
+    // Takes over the reference held by *refcount*
+    shared_ptr(T *ptr, _smart_ptr_refcount_str *refcount) noexcept: ptr(ptr), refcount(refcount)
+    {
     }
+
+    void _enable_weak_this();
+
 public:
     typedef T element_type;
 
@@ -247,21 +309,10 @@ public:
 
     template<typename Y> shared_ptr(const shared_ptr<Y> &p): ptr(p.ptr), refcount(p.refcount)
     {
-        if (refcount != nullptr) {
-            refcount->s.lock();
-            refcount->shared_refs += 1;
-            refcount->s.unlock();
-        }
+        _acquire();
     }
 
-    shared_ptr(const shared_ptr &p): ptr(p.ptr), refcount(p.refcount)
-    {
-        if (refcount != nullptr) {
-            refcount->s.lock();
-            refcount->shared_refs += 1;
-            refcount->s.unlock();
-        }
-    }
+    shared_ptr(const shared_ptr &p): ptr(p.ptr), refcount(p.refcount) { _acquire(); }
 
     constexpr shared_ptr(shared_ptr &&p): ptr(p.ptr), refcount(p.refcount)
     {
@@ -287,33 +338,31 @@ public:
         if (this == &r)
             return *this;
 
-        _clear();
-        this->ptr      = r.ptr;
-        this->refcount = r.refcount;
+        // Acquire first, in case *this holds the last reference to the object owning r
+        if (r.refcount != nullptr)
+            r.refcount->add_shared();
 
-        if (refcount != nullptr) {
-            refcount->s.lock();
-            refcount->shared_refs += 1;
-            refcount->s.unlock();
-        }
+        T *new_ptr    = r.ptr;
+        auto *new_ref = r.refcount;
+
+        _clear();
+        this->ptr      = new_ptr;
+        this->refcount = new_ref;
 
         return *this;
     }
 
     template<typename U> shared_ptr<T> &operator=(const shared_ptr<U> &r) noexcept
     {
-        if (this == &r)
-            return *this;
+        if (r.refcount != nullptr)
+            r.refcount->add_shared();
 
-        _clear();
-        this->ptr      = r.ptr;
-        this->refcount = r.refcount;
+        T *new_ptr    = r.ptr;
+        auto *new_ref = r.refcount;
 
-        if (refcount != nullptr) {
-            refcount->s.lock();
-            refcount->shared_refs += 1;
-            refcount->s.unlock();
-        }
+        _clear();
+        this->ptr      = new_ptr;
+        this->refcount = new_ref;
 
         return *this;
     }
@@ -336,9 +385,6 @@ public:
 
     template<typename U> shared_ptr<T> &operator=(shared_ptr<U> &&r) noexcept
     {
-        if (this == &r)
-            return *this;
-
         _clear();
 
         this->ptr      = r.ptr;
@@ -352,22 +398,7 @@ public:
 
     template<typename U> shared_ptr<T> &operator=(unique_ptr<U> &&r)
     {
-        unique_ptr<_smart_ptr_refcount_str> new_refcount = nullptr;
-
-        if (r) {
-            new_refcount = make_unique<_smart_ptr_refcount_str>(_smart_ptr_refcount_str());
-            if (new_refcount)
-                new_refcount->shared_refs++;
-            else 
-                r = nullptr;
-        }
-
-        _clear();
-
-        this->ptr      = r.release();
-        this->refcount = new_refcount.release();
-
-        return *this;
+        return *this = shared_ptr<T>(unique_ptr<T>(klib::move(r)));
     }
 
     constexpr element_type *get() const noexcept { return ptr; }
@@ -378,7 +409,7 @@ public:
 
     element_type &operator[](unsigned long idx) const { return get()[idx]; }
 
-    long use_count() const noexcept { return refcount ? refcount->shared_refs : 0; }
+    long use_count() const noexcept { return refcount ? refcount->use_count() : 0; }
 
     bool unique() const noexcept { return use_count() == 1; }
 
@@ -386,7 +417,7 @@ public:
 
     friend class weak_ptr<T>;
 
-    template<class... Args> friend shared_ptr<T> make_shared(Args &&...args);
+    template<class U, class... Args> friend shared_ptr<U> make_shared(Args &&...args);
 
     template<class A, class U>
     friend shared_ptr<A> dynamic_pointer_cast(const shared_ptr<U> &sp) noexcept;
@@ -405,18 +436,8 @@ template<class T, class U> shared_ptr<T> dynamic_pointer_cast(const shared_ptr<U
     if (ptr == nullptr)
         return nullptr;
 
-    shared_ptr<T> new_ptr;
-
-    new_ptr.ptr      = ptr;
-    new_ptr.refcount = sp.refcount;
-
-    if (new_ptr.refcount != nullptr) {
-        new_ptr.refcount->s.lock();
-        new_ptr.refcount->shared_refs += 1;
-        new_ptr.refcount->s.unlock();
-    }
-
-    return new_ptr;
+    sp.refcount->add_shared();
+    return shared_ptr<T>(ptr, sp.refcount);
 }
 
 template<class T, class U> shared_ptr<T> static_pointer_cast(const shared_ptr<U> &sp) noexcept
@@ -424,25 +445,24 @@ template<class T, class U> shared_ptr<T> static_pointer_cast(const shared_ptr<U>
     if (sp.ptr == nullptr)
         return nullptr;
 
-    T *ptr = static_cast<T *>(sp.ptr);
-
-    shared_ptr<T> new_ptr;
-
-    new_ptr.ptr      = ptr;
-    new_ptr.refcount = sp.refcount;
-
-    if (new_ptr.refcount != nullptr) {
-        new_ptr.refcount->s.lock();
-        new_ptr.refcount->shared_refs += 1;
-        new_ptr.refcount->s.unlock();
-    }
-
-    return new_ptr;
+    sp.refcount->add_shared();
+    return shared_ptr<T>(static_cast<T *>(sp.ptr), sp.refcount);
 }
 
+/// Creates the object together with its control block in a single allocation. Returns nullptr if
+/// the memory could not be allocated. Classes with non-public constructors need to befriend this
+/// function.
 template<class T, class... Args> shared_ptr<T> make_shared(Args &&...args)
 {
-    return shared_ptr<T>(make_unique<T>(forward<Args>(args)...));
+    auto block = new _smart_ptr_inplace_block<T>();
+    if (!block)
+        return nullptr;
+
+    T *object = new (block->storage) T(forward<Args>(args)...);
+
+    shared_ptr<T> p(object, block);
+    p._enable_weak_this();
+    return p;
 }
 
 template<class T, class U>
@@ -468,38 +488,24 @@ template<class T> class weak_ptr
     template<typename U> friend class weak_ptr;
     void _clear()
     {
-        if (refcount == nullptr)
-            return;
-        bool delete_refcount = false;
+        if (refcount != nullptr)
+            refcount->release_weak();
 
-        refcount->s.lock();
-        refcount->weak_refs--;
-        if (refcount->shared_refs == 0 and refcount->weak_refs == 0) {
-            delete_refcount = true;
-        }
-        refcount->s.unlock();
-
-        if (delete_refcount)
-            delete refcount;
+        ptr      = nullptr;
+        refcount = nullptr;
     }
 public:
     constexpr weak_ptr() noexcept = default;
     weak_ptr(const weak_ptr<T> &p) noexcept: ptr(p.ptr), refcount(p.refcount)
     {
-        if (refcount != nullptr) {
-            refcount->s.lock();
-            ++refcount->weak_refs;
-            refcount->s.unlock();
-        }
+        if (refcount != nullptr)
+            refcount->add_weak();
     }
 
     weak_ptr(const shared_ptr<T> &p) noexcept: ptr(p.ptr), refcount(p.refcount)
     {
-        if (refcount != nullptr) {
-            refcount->s.lock();
-            ++refcount->weak_refs;
-            refcount->s.unlock();
-        }
+        if (refcount != nullptr)
+            refcount->add_weak();
     }
 
     constexpr weak_ptr(weak_ptr<T> &&r) noexcept: ptr(r.ptr), refcount(r.refcount)
@@ -517,15 +523,15 @@ public:
 
     weak_ptr &operator=(const shared_ptr<T> &r) noexcept
     {
-        _clear();
-        this->ptr      = r.ptr;
-        this->refcount = r.refcount;
+        if (r.refcount != nullptr)
+            r.refcount->add_weak();
 
-        if (refcount != nullptr) {
-            refcount->s.lock();
-            refcount->weak_refs += 1;
-            refcount->s.unlock();
-        }
+        T *new_ptr    = r.ptr;
+        auto *new_ref = r.refcount;
+
+        _clear();
+        this->ptr      = new_ptr;
+        this->refcount = new_ref;
 
         return *this;
     }
@@ -551,28 +557,17 @@ public:
         if (refcount == nullptr)
             return 0;
 
-        return refcount->shared_refs;
+        return refcount->use_count();
     }
 
     bool expired() const noexcept { return use_count() == 0; }
 
     shared_ptr<T> lock() const noexcept
     {
-        if (refcount == nullptr)
+        if (refcount == nullptr or !refcount->try_add_shared())
             return shared_ptr<T>();
 
-        shared_ptr<T> p = shared_ptr<T>();
-
-        refcount->s.lock();
-        if (refcount->shared_refs) {
-            refcount->shared_refs++;
-            p.ptr = ptr;
-        }
-        refcount->s.unlock();
-
-        if (p.ptr != nullptr)
-            p.refcount = refcount;
-        return p;
+        return shared_ptr<T>(ptr, refcount);
     }
 
     constexpr bool operator<(const weak_ptr &p) const
@@ -616,23 +611,123 @@ public:
     template<class X> friend class shared_ptr;
 };
 
+template<class T> void shared_ptr<T>::_enable_weak_this()
+{
+    if constexpr (klib::is_base_of_template<enable_shared_from_this, T>::value) {
+        ptr->weak_this = *this;
+    }
+}
+
 template<class T> shared_ptr<T>::shared_ptr(unique_ptr<T> &&p)
 {
     if (not p.get())
         return;
 
-    unique_ptr<_smart_ptr_refcount_str> refcount_new =
-        make_unique<_smart_ptr_refcount_str>(_smart_ptr_refcount_str());
-    if (not refcount_new)
+    auto block = new _smart_ptr_pointer_block<T>(p.get());
+    if (not block)
         return;
-    
-    ptr                   = p.release();
-    refcount              = refcount_new.release();
-    refcount->shared_refs = 1;
 
-    if constexpr (klib::is_base_of_template<enable_shared_from_this, T>::value) {
-        ptr->weak_this = *this;
+    ptr      = p.release();
+    refcount = block;
+    _enable_weak_this();
+}
+
+/// Base for the objects with the reference count embedded in them, managed by intrusive_ptr. This
+/// avoids the control block altogether, and the pointer can be recreated from the raw one. The
+/// object is deleted through T when the last reference is dropped.
+template<class T> class intrusive_ref_counted
+{
+private:
+    mutable unsigned long intrusive_refs = 0;
+
+    template<class U> friend class intrusive_ptr;
+
+protected:
+    constexpr intrusive_ref_counted() noexcept = default;
+    intrusive_ref_counted(const intrusive_ref_counted &) noexcept {}
+    intrusive_ref_counted &operator=(const intrusive_ref_counted &) noexcept { return *this; }
+    ~intrusive_ref_counted() = default;
+
+public:
+    unsigned long ref_count() const noexcept
+    {
+        return __atomic_load_n(&intrusive_refs, __ATOMIC_RELAXED);
     }
+};
+
+template<class T> class intrusive_ptr
+{
+private:
+    T *ptr = nullptr;
+
+    void _acquire() noexcept
+    {
+        if (ptr)
+            __atomic_fetch_add(&ptr->intrusive_refs, 1, __ATOMIC_RELAXED);
+    }
+
+    void _clear() noexcept
+    {
+        if (ptr and __atomic_sub_fetch(&ptr->intrusive_refs, 1, __ATOMIC_ACQ_REL) == 0)
+            delete ptr;
+        ptr = nullptr;
+    }
+
+public:
+    typedef T element_type;
+
+    constexpr intrusive_ptr() noexcept = default;
+    constexpr intrusive_ptr(nullptr_t) noexcept {}
+
+    /// Adds the reference to the object, which might already be referenced by other pointers
+    explicit intrusive_ptr(T *p) noexcept: ptr(p) { _acquire(); }
+
+    intrusive_ptr(const intrusive_ptr &p) noexcept: ptr(p.ptr) { _acquire(); }
+    constexpr intrusive_ptr(intrusive_ptr &&p) noexcept: ptr(p.ptr) { p.ptr = nullptr; }
+
+    template<class U> intrusive_ptr(const intrusive_ptr<U> &p) noexcept: ptr(p.get())
+    {
+        _acquire();
+    }
+
+    ~intrusive_ptr() { _clear(); }
+
+    intrusive_ptr &operator=(const intrusive_ptr &r) noexcept
+    {
+        intrusive_ptr(r).swap(*this);
+        return *this;
+    }
+
+    intrusive_ptr &operator=(intrusive_ptr &&r) noexcept
+    {
+        intrusive_ptr(klib::move(r)).swap(*this);
+        return *this;
+    }
+
+    void reset() noexcept { _clear(); }
+
+    void swap(intrusive_ptr &other) noexcept
+    {
+        T *tmp    = ptr;
+        ptr       = other.ptr;
+        other.ptr = tmp;
+    }
+
+    constexpr T *get() const noexcept { return ptr; }
+    constexpr T &operator*() const noexcept { return *ptr; }
+    constexpr T *operator->() const noexcept { return ptr; }
+    constexpr explicit operator bool() const noexcept { return ptr != nullptr; }
+
+    template<class U> bool operator==(const intrusive_ptr<U> &rhs) const noexcept
+    {
+        return ptr == rhs.get();
+    }
+};
+
+/// Allocates the object and returns the first reference to it, or nullptr if there is no memory
+template<class T, class... Args> intrusive_ptr<T> make_intrusive(Args &&...args)
+{
+    return intrusive_ptr<T>(new T(forward<Args>(args)...));
 }
 
-} // namespace klib
\ No newline at end of file
+} // namespace klib
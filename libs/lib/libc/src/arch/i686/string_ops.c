@@ -0,0 +1,4 @@
+#include "../../generic/string_ops.h"
+
+// SSE2 is not guaranteed on i686, so the generic versions are kept
+void __init_string_ops(void) {}
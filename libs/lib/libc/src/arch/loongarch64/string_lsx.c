@@ -0,0 +1,93 @@
+#include "../../generic/string_ops.h"
+
+#include <lsxintrin.h>
+#include <stdint.h>
+
+// Built with -mlsx (see the libc CMakeLists.txt), but only called if the CPU has LSX. The partial
+// vectors at the end are handled by redoing the last whole one, which overlaps the processed bytes.
+
+void *__memcpy_lsx(void *restrict dest, const void *restrict src, size_t n)
+{
+    if (n < 16)
+        return __memcpy_generic(dest, src, n);
+
+    unsigned char *d       = dest;
+    const unsigned char *s = src;
+
+    for (; n >= 64; n -= 64, d += 64, s += 64) {
+        __m128i v0 = __lsx_vld(s, 0);
+        __m128i v1 = __lsx_vld(s, 16);
+        __m128i v2 = __lsx_vld(s, 32);
+        __m128i v3 = __lsx_vld(s, 48);
+        __lsx_vst(v0, d, 0);
+        __lsx_vst(v1, d, 16);
+        __lsx_vst(v2, d, 32);
+        __lsx_vst(v3, d, 48);
+    }
+
+    for (; n >= 16; n -= 16, d += 16, s += 16)
+        __lsx_vst(__lsx_vld(s, 0), d, 0);
+
+    if (n)
+        __lsx_vst(__lsx_vld(s + n - 16, 0), d + n - 16, 0);
+
+    return dest;
+}
+
+void *__memset_lsx(void *s, int c, size_t n)
+{
+    if (n < 16)
+        return __memset_generic(s, c, n);
+
+    unsigned char *d = s;
+    const __m128i v  = __lsx_vreplgr2vr_b(c);
+
+    for (; n >= 64; n -= 64, d += 64) {
+        __lsx_vst(v, d, 0);
+        __lsx_vst(v, d, 16);
+        __lsx_vst(v, d, 32);
+        __lsx_vst(v, d, 48);
+    }
+
+    for (; n >= 16; n -= 16, d += 16)
+        __lsx_vst(v, d, 0);
+
+    if (n)
+        __lsx_vst(v, d + n - 16, 0);
+
+    return s;
+}
+
+int __memcmp_lsx(const void *s1, const void *s2, size_t n)
+{
+    const unsigned char *a = s1;
+    const unsigned char *b = s2;
+
+    // The differing vector is searched byte by byte
+    for (; n >= 16; n -= 16, a += 16, b += 16)
+        if (__lsx_bnz_v(__lsx_vxor_v(__lsx_vld(a, 0), __lsx_vld(b, 0))))
+            return __memcmp_generic(a, b, 16);
+
+    return __memcmp_generic(a, b, n);
+}
+
+size_t __strlen_lsx(const char *str)
+{
+    // Aligned loads never cross a page boundary. The bytes before the string are masked out.
+    uintptr_t offset       = (uintptr_t)str & 15;
+    const unsigned char *p = (const unsigned char *)str - offset;
+
+    __m128i zero  = __lsx_vseqi_b(__lsx_vld(p, 0), 0);
+    unsigned mask = __lsx_vpickve2gr_wu(__lsx_vmskltz_b(zero), 0) >> offset;
+    if (mask)
+        return __builtin_ctz(mask);
+
+    while (1) {
+        p += 16;
+        zero = __lsx_vseqi_b(__lsx_vld(p, 0), 0);
+        if (__lsx_bnz_v(zero)) {
+            mask = __lsx_vpickve2gr_wu(__lsx_vmskltz_b(zero), 0);
+            return (const char *)p - str + __builtin_ctz(mask);
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#include "../../generic/string_ops.h"
+
+#include <stdint.h>
+
+void *__memcpy_lsx(void *restrict dest, const void *restrict src, size_t n);
+void *__memset_lsx(void *s, int c, size_t n);
+int __memcmp_lsx(const void *s1, const void *s2, size_t n);
+size_t __strlen_lsx(const char *str);
+
+#define CPUCFG2_LSX (1 << 6)
+
+void __init_string_ops(void)
+{
+    // The kernel enables LSX on first use, so only the CPU needs to support it
+    uint32_t cpucfg2;
+    asm("cpucfg %0, %1" : "=r"(cpucfg2) : "r"(2));
+    if (!(cpucfg2 & CPUCFG2_LSX))
+        return;
+
+    __string_ops = (struct __string_ops) {
+        .memcpy = __memcpy_lsx,
+        .memset = __memset_lsx,
+        .memcmp = __memcmp_lsx,
+        .strlen = __strlen_lsx,
+    };
+}
@@ -0,0 +1,29 @@
+#include "../../generic/string_ops.h"
+
+#include <elf.h>
+
+void *__memcpy_rvv(void *restrict dest, const void *restrict src, size_t n);
+void *__memset_rvv(void *s, int c, size_t n);
+int __memcmp_rvv(const void *s1, const void *s2, size_t n);
+size_t __strlen_rvv(const char *str);
+
+extern auxv_t *__auxv;
+const auxv_t *__elf_aux_search(const auxv_t *auxv, int a_type);
+
+#define HWCAP_ISA_V (1UL << ('V' - 'A'))
+
+void __init_string_ops(void)
+{
+    // The vector unit must also be enabled by the kernel, which reports it in AT_HWCAP. Without
+    // it, the generic versions are kept.
+    const auxv_t *hwcap = __elf_aux_search(__auxv, AT_HWCAP);
+    if (!hwcap || !((unsigned long)hwcap->a_val & HWCAP_ISA_V))
+        return;
+
+    __string_ops = (struct __string_ops) {
+        .memcpy = __memcpy_rvv,
+        .memset = __memset_rvv,
+        .memcmp = __memcmp_rvv,
+        .strlen = __strlen_rvv,
+    };
+}
@@ -0,0 +1,77 @@
+#include "../../generic/string_ops.h"
+
+#include <riscv_vector.h>
+
+// Built with the vector extension enabled (see the libc CMakeLists.txt), but only called if
+// __init_string_ops() finds it usable. The loops are strip-mined with the largest register group,
+// so that the hardware picks the vector length.
+
+void *__memcpy_rvv(void *restrict dest, const void *restrict src, size_t n)
+{
+    unsigned char *d       = dest;
+    const unsigned char *s = src;
+
+    while (n) {
+        size_t vl    = __riscv_vsetvl_e8m8(n);
+        vuint8m8_t v = __riscv_vle8_v_u8m8(s, vl);
+        __riscv_vse8_v_u8m8(d, v, vl);
+        d += vl;
+        s += vl;
+        n -= vl;
+    }
+
+    return dest;
+}
+
+void *__memset_rvv(void *s, int c, size_t n)
+{
+    unsigned char *d = s;
+    vuint8m8_t v     = __riscv_vmv_v_x_u8m8((unsigned char)c, __riscv_vsetvlmax_e8m8());
+
+    while (n) {
+        size_t vl = __riscv_vsetvl_e8m8(n);
+        __riscv_vse8_v_u8m8(d, v, vl);
+        d += vl;
+        n -= vl;
+    }
+
+    return s;
+}
+
+int __memcmp_rvv(const void *s1, const void *s2, size_t n)
+{
+    const unsigned char *a = s1;
+    const unsigned char *b = s2;
+
+    while (n) {
+        size_t vl     = __riscv_vsetvl_e8m8(n);
+        vuint8m8_t va = __riscv_vle8_v_u8m8(a, vl);
+        vuint8m8_t vb = __riscv_vle8_v_u8m8(b, vl);
+        long i        = __riscv_vfirst_m_b1(__riscv_vmsne_vv_u8m8_b1(va, vb, vl), vl);
+        if (i >= 0)
+            return a[i] < b[i] ? -1 : 1;
+
+        a += vl;
+        b += vl;
+        n -= vl;
+    }
+
+    return 0;
+}
+
+size_t __strlen_rvv(const char *str)
+{
+    const unsigned char *p = (const unsigned char *)str;
+    const size_t vlmax     = __riscv_vsetvlmax_e8m8();
+
+    while (1) {
+        // Fault-only-first load stops at the first inaccessible byte instead of faulting
+        size_t vl;
+        vuint8m8_t v = __riscv_vle8ff_v_u8m8(p, &vl, vlmax);
+        long i       = __riscv_vfirst_m_b1(__riscv_vmseq_vx_u8m8_b1(v, 0, vl), vl);
+        if (i >= 0)
+            return (const char *)p - str + i;
+
+        p += vl;
+    }
+}
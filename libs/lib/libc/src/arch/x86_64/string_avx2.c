@@ -0,0 +1,125 @@
+#include "../../generic/string_ops.h"
+
+#include <immintrin.h>
+#include <stdint.h>
+
+// Same as the SSE2 versions, with the 32 byte vectors. Only used if the CPU and the kernel support
+// AVX2, see __init_string_ops().
+
+void *__memcpy_sse2(void *restrict dest, const void *restrict src, size_t n);
+void *__memset_sse2(void *s, int c, size_t n);
+int __memcmp_sse2(const void *s1, const void *s2, size_t n);
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 void *__memcpy_avx2(void *restrict dest, const void *restrict src, size_t n)
+{
+    if (n < 32)
+        return __memcpy_sse2(dest, src, n);
+
+    unsigned char *d       = dest;
+    const unsigned char *s = src;
+
+    _mm256_storeu_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+    size_t skip = 32 - ((uintptr_t)d & 31);
+    d += skip;
+    s += skip;
+    n -= skip;
+
+    for (; n >= 128; n -= 128, d += 128, s += 128) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)s);
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(s + 32));
+        __m256i v2 = _mm256_loadu_si256((const __m256i *)(s + 64));
+        __m256i v3 = _mm256_loadu_si256((const __m256i *)(s + 96));
+        _mm256_store_si256((__m256i *)d, v0);
+        _mm256_store_si256((__m256i *)(d + 32), v1);
+        _mm256_store_si256((__m256i *)(d + 64), v2);
+        _mm256_store_si256((__m256i *)(d + 96), v3);
+    }
+
+    for (; n >= 32; n -= 32, d += 32, s += 32)
+        _mm256_store_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+
+    if (n)
+        _mm256_storeu_si256((__m256i *)(d + n - 32),
+                            _mm256_loadu_si256((const __m256i *)(s + n - 32)));
+
+    return dest;
+}
+
+AVX2 void *__memset_avx2(void *s, int c, size_t n)
+{
+    if (n < 32)
+        return __memset_sse2(s, c, n);
+
+    unsigned char *d = s;
+    const __m256i v  = _mm256_set1_epi8((char)c);
+
+    _mm256_storeu_si256((__m256i *)d, v);
+    size_t skip = 32 - ((uintptr_t)d & 31);
+    d += skip;
+    n -= skip;
+
+    for (; n >= 128; n -= 128, d += 128) {
+        _mm256_store_si256((__m256i *)d, v);
+        _mm256_store_si256((__m256i *)(d + 32), v);
+        _mm256_store_si256((__m256i *)(d + 64), v);
+        _mm256_store_si256((__m256i *)(d + 96), v);
+    }
+
+    for (; n >= 32; n -= 32, d += 32)
+        _mm256_store_si256((__m256i *)d, v);
+
+    if (n)
+        _mm256_storeu_si256((__m256i *)(d + n - 32), v);
+
+    return s;
+}
+
+AVX2 static inline int compare_32(const unsigned char *a, const unsigned char *b)
+{
+    __m256i eq    = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)a),
+                                      _mm256_loadu_si256((const __m256i *)b));
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(eq);
+    if (!mask)
+        return 0;
+
+    unsigned i = __builtin_ctz(mask);
+    return a[i] < b[i] ? -1 : 1;
+}
+
+AVX2 int __memcmp_avx2(const void *s1, const void *s2, size_t n)
+{
+    if (n < 32)
+        return __memcmp_sse2(s1, s2, n);
+
+    const unsigned char *a = s1;
+    const unsigned char *b = s2;
+
+    for (; n >= 32; n -= 32, a += 32, b += 32) {
+        int r = compare_32(a, b);
+        if (r)
+            return r;
+    }
+
+    return n ? compare_32(a + n - 32, b + n - 32) : 0;
+}
+
+AVX2 size_t __strlen_avx2(const char *str)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    uintptr_t offset = (uintptr_t)str & 31;
+    const __m256i *p = (const __m256i *)(str - offset);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(p), zero));
+    mask >>= offset;
+    if (mask)
+        return __builtin_ctz(mask);
+
+    while (1) {
+        ++p;
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(p), zero));
+        if (mask)
+            return (const char *)p - str + __builtin_ctz(mask);
+    }
+}
@@ -0,0 +1,56 @@
+#include "../../generic/string_ops.h"
+
+#include <cpuid.h>
+#include <stdint.h>
+
+void *__memcpy_sse2(void *restrict dest, const void *restrict src, size_t n);
+void *__memset_sse2(void *s, int c, size_t n);
+int __memcmp_sse2(const void *s1, const void *s2, size_t n);
+size_t __strlen_sse2(const char *str);
+
+void *__memcpy_avx2(void *restrict dest, const void *restrict src, size_t n);
+void *__memset_avx2(void *s, int c, size_t n);
+int __memcmp_avx2(const void *s1, const void *s2, size_t n);
+size_t __strlen_avx2(const char *str);
+
+// Checks that the CPU has AVX2 and that the kernel saves the YMM registers
+static int avx2_usable()
+{
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+        return 0;
+
+    uint32_t xcr0_low, xcr0_high;
+    asm volatile("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+    // SSE and AVX state
+    if ((xcr0_low & 0x6) != 0x6)
+        return 0;
+
+    if (__get_cpuid_max(0, NULL) < 7)
+        return 0;
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return !!(ebx & bit_AVX2);
+}
+
+void __init_string_ops(void)
+{
+    if (avx2_usable()) {
+        __string_ops = (struct __string_ops) {
+            .memcpy = __memcpy_avx2,
+            .memset = __memset_avx2,
+            .memcmp = __memcmp_avx2,
+            .strlen = __strlen_avx2,
+        };
+    } else {
+        __string_ops = (struct __string_ops) {
+            .memcpy = __memcpy_sse2,
+            .memset = __memset_sse2,
+            .memcmp = __memcmp_sse2,
+            .strlen = __strlen_sse2,
+        };
+    }
+}
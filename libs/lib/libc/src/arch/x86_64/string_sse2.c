@@ -0,0 +1,121 @@
+#include "../../generic/string_ops.h"
+
+#include <emmintrin.h>
+#include <stdint.h>
+
+// SSE2 is always there on x86_64, so these replace the generic versions unconditionally. The
+// sizes below one vector are left to the generic ones, and the partial vectors at the end are
+// handled by redoing the last whole vector, which overlaps the already processed bytes.
+
+void *__memcpy_sse2(void *restrict dest, const void *restrict src, size_t n)
+{
+    if (n < 16)
+        return __memcpy_generic(dest, src, n);
+
+    unsigned char *d       = dest;
+    const unsigned char *s = src;
+
+    // Store the first vector unaligned and continue from the aligned destination
+    _mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+    size_t skip = 16 - ((uintptr_t)d & 15);
+    d += skip;
+    s += skip;
+    n -= skip;
+
+    for (; n >= 64; n -= 64, d += 64, s += 64) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)s);
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i v3 = _mm_loadu_si128((const __m128i *)(s + 48));
+        _mm_store_si128((__m128i *)d, v0);
+        _mm_store_si128((__m128i *)(d + 16), v1);
+        _mm_store_si128((__m128i *)(d + 32), v2);
+        _mm_store_si128((__m128i *)(d + 48), v3);
+    }
+
+    for (; n >= 16; n -= 16, d += 16, s += 16)
+        _mm_store_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+
+    if (n)
+        _mm_storeu_si128((__m128i *)(d + n - 16), _mm_loadu_si128((const __m128i *)(s + n - 16)));
+
+    return dest;
+}
+
+void *__memset_sse2(void *s, int c, size_t n)
+{
+    if (n < 16)
+        return __memset_generic(s, c, n);
+
+    unsigned char *d = s;
+    const __m128i v  = _mm_set1_epi8((char)c);
+
+    _mm_storeu_si128((__m128i *)d, v);
+    size_t skip = 16 - ((uintptr_t)d & 15);
+    d += skip;
+    n -= skip;
+
+    for (; n >= 64; n -= 64, d += 64) {
+        _mm_store_si128((__m128i *)d, v);
+        _mm_store_si128((__m128i *)(d + 16), v);
+        _mm_store_si128((__m128i *)(d + 32), v);
+        _mm_store_si128((__m128i *)(d + 48), v);
+    }
+
+    for (; n >= 16; n -= 16, d += 16)
+        _mm_store_si128((__m128i *)d, v);
+
+    if (n)
+        _mm_storeu_si128((__m128i *)(d + n - 16), v);
+
+    return s;
+}
+
+// Compares the 16 bytes, returning 0 if they are equal or the memcmp() result otherwise
+static inline int compare_16(const unsigned char *a, const unsigned char *b)
+{
+    __m128i eq    = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a),
+                                   _mm_loadu_si128((const __m128i *)b));
+    unsigned mask = _mm_movemask_epi8(eq) ^ 0xffff;
+    if (!mask)
+        return 0;
+
+    unsigned i = __builtin_ctz(mask);
+    return a[i] < b[i] ? -1 : 1;
+}
+
+int __memcmp_sse2(const void *s1, const void *s2, size_t n)
+{
+    if (n < 16)
+        return __memcmp_generic(s1, s2, n);
+
+    const unsigned char *a = s1;
+    const unsigned char *b = s2;
+
+    for (; n >= 16; n -= 16, a += 16, b += 16) {
+        int r = compare_16(a, b);
+        if (r)
+            return r;
+    }
+
+    return n ? compare_16(a + n - 16, b + n - 16) : 0;
+}
+
+size_t __strlen_sse2(const char *str)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    // Aligned loads never cross a page boundary. The bytes before the string are masked out.
+    uintptr_t offset = (uintptr_t)str & 15;
+    const __m128i *p = (const __m128i *)(str - offset);
+    unsigned mask    = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero)) >> offset;
+    if (mask)
+        return __builtin_ctz(mask);
+
+    while (1) {
+        ++p;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero));
+        if (mask)
+            return (const char *)p - str + __builtin_ctz(mask);
+    }
+}
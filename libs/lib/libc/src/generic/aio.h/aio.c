@@ -0,0 +1,270 @@
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pmos/io_ring.h>
+#include <pmos/system.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/// Maximum number of requests of a thread in progress or not yet collected
+#define AIO_RING_ENTRIES 256
+
+static __thread pmos_io_ring_t *aio_ring = NULL;
+
+static pmos_io_ring_t *get_ring()
+{
+    if (!aio_ring)
+        aio_ring = pmos_io_ring_create(AIO_RING_ENTRIES);
+    return aio_ring;
+}
+
+static int check_sigevent(const struct sigevent *sig)
+{
+    if (sig && sig->sigev_notify != SIGEV_NONE) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+static void prepare(struct aiocb *aiocbp, struct pmos_io_sqe *sqe, uint32_t opcode)
+{
+    aiocbp->__error  = EINPROGRESS;
+    aiocbp->__return = -1;
+    aiocbp->__ring   = aio_ring;
+
+    *sqe = (struct pmos_io_sqe) {
+        .opcode    = opcode,
+        .fd        = aiocbp->aio_fildes,
+        .buf       = (void *)aiocbp->aio_buf,
+        .len       = aiocbp->aio_nbytes,
+        .offset    = aiocbp->aio_offset,
+        .user_data = (uintptr_t)aiocbp,
+    };
+}
+
+static int submit(struct aiocb *aiocbp, uint32_t opcode)
+{
+    if (check_sigevent(&aiocbp->aio_sigevent) < 0)
+        return -1;
+
+    if (aiocbp->aio_offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pmos_io_ring_t *ring = get_ring();
+    if (!ring)
+        return -1;
+
+    struct pmos_io_sqe sqe;
+    prepare(aiocbp, &sqe, opcode);
+    if (pmos_io_ring_submit(ring, &sqe, 1) < 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return 0;
+}
+
+int aio_read(struct aiocb *aiocbp) { return submit(aiocbp, PMOS_IO_READ); }
+
+int aio_write(struct aiocb *aiocbp) { return submit(aiocbp, PMOS_IO_WRITE); }
+
+/// Stores the results of the completed requests in their control blocks
+static int collect(int64_t timeout_ns)
+{
+    struct pmos_io_cqe cqes[32];
+    int n = pmos_io_ring_wait(aio_ring, cqes, 32, timeout_ns == 0 ? 0 : 1, timeout_ns);
+    for (int i = 0; i < n; ++i) {
+        struct aiocb *aiocbp = (struct aiocb *)(uintptr_t)cqes[i].user_data;
+        if (cqes[i].result < 0) {
+            aiocbp->__return = -1;
+            aiocbp->__error  = -cqes[i].result;
+        } else {
+            aiocbp->__return = cqes[i].result;
+            aiocbp->__error  = 0;
+        }
+    }
+    return n;
+}
+
+int aio_error(const struct aiocb *aiocbp)
+{
+    // Only the submitting thread receives the completions
+    if (aiocbp->__error == EINPROGRESS && aiocbp->__ring && aiocbp->__ring == aio_ring)
+        while (collect(0) > 0)
+            ;
+
+    return aiocbp->__error;
+}
+
+ssize_t aio_return(struct aiocb *aiocbp)
+{
+    if (aio_error(aiocbp) == EINPROGRESS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (aiocbp->__return < 0)
+        errno = aiocbp->__error;
+    return aiocbp->__return;
+}
+
+static bool any_complete(const struct aiocb *const list[], int nent, bool *own_pending)
+{
+    *own_pending = false;
+    for (int i = 0; i < nent; ++i) {
+        if (!list[i])
+            continue;
+        if (list[i]->__error != EINPROGRESS)
+            return true;
+        if (list[i]->__ring == aio_ring)
+            *own_pending = true;
+    }
+    return false;
+}
+
+static uint64_t now_ns() { return pmos_get_time(GET_TIME_NANOSECONDS_SINCE_BOOTUP).value; }
+
+int aio_suspend(const struct aiocb *const list[], int nent, const struct timespec *timeout)
+{
+    const int64_t timeout_ns =
+        timeout ? (int64_t)timeout->tv_sec * 1000000000 + timeout->tv_nsec : -1;
+    const uint64_t deadline = timeout_ns > 0 ? now_ns() + timeout_ns : 0;
+
+    for (;;) {
+        bool own_pending;
+        if (aio_ring)
+            while (collect(0) > 0)
+                ;
+        if (any_complete(list, nent, &own_pending))
+            return 0;
+
+        // The requests of the other threads can't be waited for
+        if (!own_pending) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        int64_t remaining = -1;
+        if (timeout_ns == 0) {
+            remaining = 0;
+        } else if (deadline) {
+            uint64_t now = now_ns();
+            remaining    = now < deadline ? (int64_t)(deadline - now) : 0;
+        }
+
+        if (remaining == 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        if (collect(remaining) < 0)
+            return -1;
+    }
+}
+
+int aio_cancel(int fildes, struct aiocb *aiocbp)
+{
+    // The requests are sent right away, and the servers can't take them back
+    if (aiocbp) {
+        if (aiocbp->aio_fildes != fildes) {
+            errno = EINVAL;
+            return -1;
+        }
+        return aio_error(aiocbp) == EINPROGRESS ? AIO_NOTCANCELED : AIO_ALLDONE;
+    }
+
+    struct stat st;
+    if (fstat(fildes, &st) < 0)
+        return -1;
+
+    return aio_ring && pmos_io_ring_pending(aio_ring) ? AIO_NOTCANCELED : AIO_ALLDONE;
+}
+
+int aio_fsync(int op, struct aiocb *aiocbp)
+{
+    if (op != O_SYNC && op != O_DSYNC) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The filesystem servers don't have a request to flush the data
+    (void)aiocbp;
+    errno = EINVAL;
+    return -1;
+}
+
+int lio_listio(int mode, struct aiocb *const list[], int nent, struct sigevent *sig)
+{
+    if ((mode != LIO_WAIT && mode != LIO_NOWAIT) || nent < 0 || nent > AIO_RING_ENTRIES ||
+        check_sigevent(sig) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pmos_io_ring_t *ring = get_ring();
+    if (!ring)
+        return -1;
+
+    struct pmos_io_sqe sqes[nent > 0 ? nent : 1];
+    int count = 0;
+    for (int i = 0; i < nent; ++i) {
+        struct aiocb *aiocbp = list[i];
+        if (!aiocbp || aiocbp->aio_lio_opcode == LIO_NOP)
+            continue;
+
+        if ((aiocbp->aio_lio_opcode != LIO_READ && aiocbp->aio_lio_opcode != LIO_WRITE) ||
+            aiocbp->aio_offset < 0 || check_sigevent(&aiocbp->aio_sigevent) < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        ++count;
+    }
+
+    // Either all of the requests are submitted, or none
+    if (count > (int)(AIO_RING_ENTRIES - pmos_io_ring_pending(ring))) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    count = 0;
+    for (int i = 0; i < nent; ++i) {
+        struct aiocb *aiocbp = list[i];
+        if (!aiocbp || aiocbp->aio_lio_opcode == LIO_NOP)
+            continue;
+
+        prepare(aiocbp, &sqes[count++],
+                aiocbp->aio_lio_opcode == LIO_READ ? PMOS_IO_READ : PMOS_IO_WRITE);
+    }
+
+    if (count > 0 && pmos_io_ring_submit(ring, sqes, count) < 0)
+        return -1;
+
+    if (mode == LIO_NOWAIT)
+        return 0;
+
+    bool failed = false;
+    for (int i = 0; i < nent; ++i) {
+        struct aiocb *aiocbp = list[i];
+        if (!aiocbp || aiocbp->aio_lio_opcode == LIO_NOP)
+            continue;
+
+        while (aiocbp->__error == EINPROGRESS)
+            if (collect(-1) <= 0) {
+                errno = EIO;
+                return -1;
+            }
+
+        failed |= aiocbp->__error != 0;
+    }
+
+    if (failed) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
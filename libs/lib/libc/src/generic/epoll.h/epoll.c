@@ -0,0 +1,665 @@
+#include "../filesystem/filesystem.h"
+#include "../filesystem/filesystem_struct.h"
+
+#include <errno.h>
+#include <pmos/__internal.h>
+#include <pmos/ipc.h>
+#include <pmos/ports.h>
+#include <pmos/system.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+
+int __poll_descriptor(int fd, uint32_t events, pmos_port_t notify_port, uint64_t cookie,
+                      pmos_right_t *notify_id, uint32_t *revents);
+int __add_descriptor(uint8_t type, uint8_t flags, const struct Filesystem_Adaptor *adaptor,
+                     union File_Data *data);
+struct Epoll_Instance *__get_epoll_instance(int fd);
+void __epoll_release_instance(struct Epoll_Instance *ep);
+
+/// Cookie of the messages waking up epoll_wait() after a change from another thread
+#define WAKE_COOKIE UINT64_MAX
+
+struct Epoll_Registration {
+    int fd;
+    size_t key;
+
+    /// Requested events, with EPOLLET and EPOLLONESHOT
+    uint32_t events;
+
+    /// Events which are ready and haven't been reported yet
+    uint32_t revents;
+
+    epoll_data_t data;
+
+    /// Receive right of the server's notifications, or INVALID_RIGHT if the readiness of the
+    /// descriptor never changes
+    pmos_right_t notify_id;
+
+    /// EPOLLONESHOT event has been reported
+    bool disarmed;
+
+    /// The event has been reported while level-triggered, and must be checked again before
+    /// reporting it next time
+    bool recheck;
+
+    bool queued;
+    struct Epoll_Registration *ready_prev, *ready_next;
+};
+
+/**
+ * @brief Persistent interest in the readiness of a set of descriptors
+ *
+ * The servers of the descriptors send IPC_Poll_Notify to the instance's port when the events
+ * become ready, and the registrations are then moved to the ready list. epoll_wait() only looks at
+ * the ready list, so its cost doesn't depend on the number of descriptors being watched.
+ *
+ * The port is owned by the thread which created the instance, which is the only one able to wait
+ * on it.
+ */
+struct Epoll_Instance {
+    size_t refcount;
+
+    pthread_mutex_t lock;
+
+    pmos_port_t port;
+
+    /// Right used to wake up the waiting thread
+    pmos_right_t wake_right;
+    pmos_right_t wake_id;
+
+    /// Timer for the timeouts of epoll_wait(), created on the first use
+    pmos_right_t timer_right;
+
+    /// A thread is blocked on the port
+    bool waiting;
+
+    /// Registrations, indexed by key (the descriptor for epoll_ctl())
+    struct Epoll_Registration **slots;
+    size_t slots_count;
+
+    struct Epoll_Registration *ready_head, *ready_tail;
+    size_t ready_count;
+};
+
+static void queue_ready(struct Epoll_Instance *ep, struct Epoll_Registration *r)
+{
+    if (r->queued)
+        return;
+
+    r->queued     = true;
+    r->ready_next = NULL;
+    r->ready_prev = ep->ready_tail;
+    if (ep->ready_tail)
+        ep->ready_tail->ready_next = r;
+    else
+        ep->ready_head = r;
+    ep->ready_tail = r;
+    ep->ready_count++;
+}
+
+static void unqueue_ready(struct Epoll_Instance *ep, struct Epoll_Registration *r)
+{
+    if (!r->queued)
+        return;
+
+    if (r->ready_prev)
+        r->ready_prev->ready_next = r->ready_next;
+    else
+        ep->ready_head = r->ready_next;
+
+    if (r->ready_next)
+        r->ready_next->ready_prev = r->ready_prev;
+    else
+        ep->ready_tail = r->ready_prev;
+
+    r->queued = false;
+    ep->ready_count--;
+}
+
+static bool is_ready(struct Epoll_Registration *r)
+{
+    return !r->disarmed && (r->revents & (r->events | EPOLLERR | EPOLLHUP));
+}
+
+struct Epoll_Instance *__epoll_create_instance()
+{
+    struct Epoll_Instance *ep = calloc(1, sizeof(*ep));
+    if (!ep)
+        return NULL;
+
+    ports_request_t port = create_port(TASK_ID_SELF, 0);
+    if (port.result != SUCCESS) {
+        errno = -port.result;
+        free(ep);
+        return NULL;
+    }
+
+    right_request_t wake = create_right(port.port, &ep->wake_id, 0);
+    if (wake.result != SUCCESS) {
+        errno = -wake.result;
+        pmos_delete_port(port.port);
+        free(ep);
+        return NULL;
+    }
+
+    pthread_mutex_init(&ep->lock, NULL);
+    ep->refcount   = 1;
+    ep->port       = port.port;
+    ep->wake_right = wake.right;
+    return ep;
+}
+
+void __epoll_acquire_instance(struct Epoll_Instance *ep)
+{
+    __atomic_add_fetch(&ep->refcount, 1, __ATOMIC_RELAXED);
+}
+
+static void free_registration(struct Epoll_Instance *ep, struct Epoll_Registration *r)
+{
+    unqueue_ready(ep, r);
+    delete_receive_right(ep->port, r->notify_id);
+    free(r);
+}
+
+/// Removes all the registrations. Must be called with the lock held.
+static void clear_registrations(struct Epoll_Instance *ep)
+{
+    for (size_t i = 0; i < ep->slots_count; ++i) {
+        if (ep->slots[i]) {
+            free_registration(ep, ep->slots[i]);
+            ep->slots[i] = NULL;
+        }
+    }
+}
+
+void __epoll_clear(struct Epoll_Instance *ep)
+{
+    pthread_mutex_lock(&ep->lock);
+    clear_registrations(ep);
+    pthread_mutex_unlock(&ep->lock);
+}
+
+void __epoll_release_instance(struct Epoll_Instance *ep)
+{
+    if (__atomic_sub_fetch(&ep->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+
+    clear_registrations(ep);
+    free(ep->slots);
+    delete_right(ep->wake_right);
+    pmos_delete_port(ep->port);
+    pthread_mutex_destroy(&ep->lock);
+    free(ep);
+}
+
+static int reserve_slot(struct Epoll_Instance *ep, size_t key)
+{
+    if (key < ep->slots_count)
+        return 0;
+
+    size_t new_count = ep->slots_count ? ep->slots_count * 2 : 16;
+    if (new_count <= key)
+        new_count = key + 1;
+
+    struct Epoll_Registration **slots = realloc(ep->slots, new_count * sizeof(*slots));
+    if (!slots)
+        return -1;
+
+    memset(slots + ep->slots_count, 0, (new_count - ep->slots_count) * sizeof(*slots));
+    ep->slots       = slots;
+    ep->slots_count = new_count;
+    return 0;
+}
+
+/// Registers the interest with the descriptor's server and updates the readiness. Must be called
+/// with the lock held.
+static int arm_registration(struct Epoll_Instance *ep, struct Epoll_Registration *r, size_t key)
+{
+    delete_receive_right(ep->port, r->notify_id);
+    r->notify_id = INVALID_RIGHT;
+
+    uint32_t events = r->events & ~(EPOLLET | EPOLLONESHOT);
+    uint32_t revents;
+    if (__poll_descriptor(r->fd, events, ep->port, key, &r->notify_id, &revents) < 0)
+        return -1;
+
+    r->revents  = revents;
+    r->disarmed = false;
+    r->recheck  = false;
+    if (is_ready(r))
+        queue_ready(ep, r);
+    else
+        unqueue_ready(ep, r);
+    return 0;
+}
+
+static void wake_waiter(struct Epoll_Instance *ep)
+{
+    if (!ep->waiting || !ep->ready_head)
+        return;
+
+    IPC_Poll_Notify n = {
+        .type    = IPC_Poll_Notify_NUM,
+        .revents = 0,
+        .cookie  = WAKE_COOKIE,
+    };
+    send_message_right(ep->wake_right, INVALID_PORT, &n, sizeof(n), NULL, 0);
+}
+
+int __epoll_ctl(struct Epoll_Instance *ep, int op, size_t key, int fd, struct epoll_event *event)
+{
+    if (op != EPOLL_CTL_DEL && !event) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    int result = 0;
+    pthread_mutex_lock(&ep->lock);
+
+    struct Epoll_Registration *r = key < ep->slots_count ? ep->slots[key] : NULL;
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        if (r) {
+            errno  = EEXIST;
+            result = -1;
+            break;
+        }
+
+        if (reserve_slot(ep, key) < 0) {
+            result = -1;
+            break;
+        }
+
+        r = calloc(1, sizeof(*r));
+        if (!r) {
+            result = -1;
+            break;
+        }
+
+        r->fd        = fd;
+        r->key       = key;
+        r->events    = event->events;
+        r->data      = event->data;
+        r->notify_id = INVALID_RIGHT;
+        if (arm_registration(ep, r, key) < 0) {
+            free_registration(ep, r);
+            result = -1;
+            break;
+        }
+        ep->slots[key] = r;
+        break;
+    case EPOLL_CTL_MOD:
+        if (!r) {
+            errno  = ENOENT;
+            result = -1;
+            break;
+        }
+
+        r->events = event->events;
+        r->data   = event->data;
+        result    = arm_registration(ep, r, key);
+        break;
+    case EPOLL_CTL_DEL:
+        if (!r) {
+            errno  = ENOENT;
+            result = -1;
+            break;
+        }
+
+        free_registration(ep, r);
+        ep->slots[key] = NULL;
+        break;
+    default:
+        errno  = EINVAL;
+        result = -1;
+        break;
+    }
+
+    if (result == 0)
+        wake_waiter(ep);
+
+    pthread_mutex_unlock(&ep->lock);
+    return result;
+}
+
+static void handle_message(struct Epoll_Instance *ep, Message_Descriptor *desc, void *msg)
+{
+    IPC_Generic_Msg *m = msg;
+    if (desc->size < sizeof(IPC_Poll_Notify) || m->type != IPC_Poll_Notify_NUM)
+        // Timer or an unexpected message, which only wakes up the waiter
+        return;
+
+    IPC_Poll_Notify *n = msg;
+    if (n->cookie >= ep->slots_count)
+        return;
+
+    // The notifications of the deleted registrations can still be in the queue
+    struct Epoll_Registration *r = ep->slots[n->cookie];
+    if (!r || r->notify_id != desc->sent_with_right)
+        return;
+
+    r->revents |= n->revents;
+    if (is_ready(r))
+        queue_ready(ep, r);
+}
+
+/// Pops the front message of the port. Must be called with the lock held.
+static int receive_message(struct Epoll_Instance *ep, Message_Descriptor *desc)
+{
+    union {
+        IPC_Poll_Notify notify;
+        IPC_Timer_Expired timer;
+        char buff[64];
+    } small;
+
+    void *msg = &small;
+    if (desc->size > sizeof(small)) {
+        msg = malloc(desc->size);
+        if (!msg)
+            return -1;
+    }
+
+    result_t result = get_first_message(msg, MSG_ARG_REJECT_RIGHT, ep->port).result;
+    if (result == SUCCESS)
+        handle_message(ep, desc, msg);
+
+    if (msg != &small)
+        free(msg);
+
+    if (result != SUCCESS) {
+        errno = -result;
+        return -1;
+    }
+    return 0;
+}
+
+/// Moves the ready events to the output. Must be called with the lock held.
+static int collect_ready(struct Epoll_Instance *ep, struct epoll_event *events, int maxevents)
+{
+    int n = 0;
+
+    // The level-triggered registrations are requeued at the back, so only look at each once
+    size_t count = ep->ready_count;
+    for (size_t i = 0; i < count && n < maxevents && ep->ready_head; ++i) {
+        struct Epoll_Registration *r = ep->ready_head;
+        unqueue_ready(ep, r);
+
+        if (r->recheck) {
+            // The events might have been consumed since they were reported
+            pmos_right_t unused;
+            uint32_t revents;
+            if (__poll_descriptor(r->fd, r->events & ~(EPOLLET | EPOLLONESHOT), INVALID_PORT, 0,
+                                  &unused, &revents) < 0) {
+                if (errno == EBADF) {
+                    // Closed descriptors are forgotten
+                    ep->slots[r->key] = NULL;
+                    free_registration(ep, r);
+                    continue;
+                }
+                revents = EPOLLERR;
+            }
+            r->revents = revents;
+            r->recheck = false;
+        }
+
+        uint32_t ev = r->revents & (r->events | EPOLLERR | EPOLLHUP);
+        if (!ev || r->disarmed) {
+            r->revents = 0;
+            continue;
+        }
+
+        events[n].events = ev;
+        events[n].data   = r->data;
+        ++n;
+
+        if (r->events & EPOLLONESHOT) {
+            r->disarmed = true;
+            r->revents  = 0;
+        } else if (r->events & EPOLLET) {
+            r->revents = 0;
+        } else {
+            // Still ready, unless it can change
+            r->recheck = r->notify_id != INVALID_RIGHT;
+            queue_ready(ep, r);
+        }
+    }
+
+    return n;
+}
+
+static int arm_timer(struct Epoll_Instance *ep, uint64_t deadline)
+{
+    if (ep->timer_right == INVALID_RIGHT) {
+        right_request_t timer = pmos_create_timer(ep->port);
+        if (timer.result != SUCCESS) {
+            errno = -timer.result;
+            return -1;
+        }
+        ep->timer_right = timer.right;
+    }
+
+    result_t result = pmos_set_timer(ep->port, ep->timer_right, deadline, 0);
+    if (result != SUCCESS) {
+        errno = -result;
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t now_ns() { return pmos_get_time(GET_TIME_NANOSECONDS_SINCE_BOOTUP).value; }
+
+int __epoll_wait(struct Epoll_Instance *ep, struct epoll_event *events, int maxevents,
+                 int64_t timeout_ns)
+{
+    if (maxevents <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const uint64_t deadline = timeout_ns > 0 ? now_ns() + timeout_ns : 0;
+    bool timer_armed        = false;
+
+    int n = 0;
+    pthread_mutex_lock(&ep->lock);
+    for (;;) {
+        // Drain the notifications which have already arrived
+        Message_Descriptor desc;
+        while (syscall_get_message_info(&desc, ep->port, FLAG_NOBLOCK) == SUCCESS) {
+            if (receive_message(ep, &desc) < 0) {
+                n = -1;
+                goto out;
+            }
+        }
+
+        n = collect_ready(ep, events, maxevents);
+        if (n > 0 || timeout_ns == 0)
+            break;
+
+        if (deadline) {
+            if (now_ns() >= deadline)
+                break;
+
+            if (!timer_armed) {
+                if (arm_timer(ep, deadline) < 0) {
+                    n = -1;
+                    break;
+                }
+                timer_armed = true;
+            }
+        }
+
+        ep->waiting = true;
+        pthread_mutex_unlock(&ep->lock);
+
+        result_t result = syscall_get_message_info(&desc, ep->port, 0);
+
+        pthread_mutex_lock(&ep->lock);
+        ep->waiting = false;
+
+        if (result != SUCCESS) {
+            errno = -result;
+            n     = -1;
+            break;
+        }
+    }
+
+out:
+    pthread_mutex_unlock(&ep->lock);
+    return n;
+}
+
+static ssize_t epoll_read(void *, void *, size_t, size_t, bool)
+{
+    errno = EINVAL;
+    return -1;
+}
+
+static ssize_t epoll_write(void *, const void *, size_t, size_t, bool)
+{
+    errno = EINVAL;
+    return -1;
+}
+
+static ssize_t epoll_writev(void *, const struct iovec *, int, size_t, bool)
+{
+    errno = EINVAL;
+    return -1;
+}
+
+static int epoll_clone(void *file_data, void *new_data)
+{
+    struct Epoll_Descriptor *d = file_data;
+    __epoll_acquire_instance(d->instance);
+    ((struct Epoll_Descriptor *)new_data)->instance = d->instance;
+    return 0;
+}
+
+static int epoll_close(void *) { return 0; }
+
+static int epoll_fstat(void *, struct stat *statbuf)
+{
+    memset(statbuf, 0, sizeof(*statbuf));
+    statbuf->st_nlink = 1;
+    return 0;
+}
+
+static int epoll_isatty(void *) { return 0; }
+
+static int epoll_isseekable(void *) { return 0; }
+
+static ssize_t epoll_filesize(void *) { return 0; }
+
+static void epoll_free(void *file_data)
+{
+    struct Epoll_Descriptor *d = file_data;
+    if (d->instance) {
+        __epoll_release_instance(d->instance);
+        d->instance = NULL;
+    }
+}
+
+static int epoll_poll(void *file_data, uint32_t events, pmos_port_t, uint64_t,
+                      pmos_right_t *notify_id, uint32_t *revents)
+{
+    // TODO: Nested instances are only checked, and don't notify when they become ready
+    struct Epoll_Descriptor *d = file_data;
+    pthread_mutex_lock(&d->instance->lock);
+    *revents = d->instance->ready_head ? events & (POLLIN | POLLRDNORM) : 0;
+    pthread_mutex_unlock(&d->instance->lock);
+    *notify_id = INVALID_RIGHT;
+    return 0;
+}
+
+static const struct Filesystem_Adaptor epoll_adaptor = {
+    .read       = epoll_read,
+    .write      = epoll_write,
+    .writev     = epoll_writev,
+    .clone      = epoll_clone,
+    .close      = epoll_close,
+    .fstat      = epoll_fstat,
+    .isatty     = epoll_isatty,
+    .isseekable = epoll_isseekable,
+    .filesize   = epoll_filesize,
+    .free       = epoll_free,
+    .poll       = epoll_poll,
+};
+
+int epoll_create1(int flags)
+{
+    if (flags & ~EPOLL_CLOEXEC) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    union File_Data data = {
+        .epoll.instance = __epoll_create_instance(),
+    };
+    if (!data.epoll.instance)
+        return -1;
+
+    int fd = __add_descriptor(DESCRIPTOR_EPOLL, 0, &epoll_adaptor, &data);
+    if (fd < 0)
+        __epoll_release_instance(data.epoll.instance);
+    return fd;
+}
+
+int epoll_create(int size)
+{
+    if (size <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return epoll_create1(0);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    if (fd < 0 || fd == epfd) {
+        errno = fd < 0 ? EBADF : EINVAL;
+        return -1;
+    }
+
+    struct Epoll_Instance *ep = __get_epoll_instance(epfd);
+    if (!ep)
+        return -1;
+
+    int result = __epoll_ctl(ep, op, fd, fd, event);
+    __epoll_release_instance(ep);
+    return result;
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    struct Epoll_Instance *ep = __get_epoll_instance(epfd);
+    if (!ep)
+        return -1;
+
+    int64_t timeout_ns = timeout < 0 ? -1 : (int64_t)timeout * 1000000;
+    int result         = __epoll_wait(ep, events, maxevents, timeout_ns);
+    __epoll_release_instance(ep);
+    return result;
+}
+
+int epoll_pwait(int epfd, struct epoll_event *events, int maxevents, int timeout,
+                const sigset_t *sigmask)
+{
+    sigset_t old;
+    if (sigmask && pthread_sigmask(SIG_SETMASK, sigmask, &old) != 0)
+        return -1;
+
+    int result = epoll_wait(epfd, events, maxevents, timeout);
+
+    if (sigmask) {
+        int e = errno;
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        errno = e;
+    }
+    return result;
+}
@@ -32,14 +32,18 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <poll.h>
 #include <pmos/helpers.h>
 #include <pmos/ipc.h>
+#include <pmos/memory.h>
 #include <pmos/ports.h>
 #include <pmos/tls.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/uio.h>
 
 int vfsd_send_persistant(size_t msg_size, const void *message);
@@ -91,6 +95,216 @@ static void fs_right_invalid(pmos_right_t right)
                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED);
 }
 
+/// Size of the memory object shared with the server
+#define READ_WINDOW_SIZE      (256 * 1024)
+/// Initial size of the sequential reads. It is doubled on each refill, up to READ_WINDOW_SIZE.
+#define READ_WINDOW_READAHEAD (16 * 1024)
+
+/**
+ * @brief Buffer shared with the filesystem server, for the files supporting IPC_Read_Shared
+ *
+ * The server writes the data directly into the memory object, so it doesn't have to be copied
+ * into the reply messages. The sequential reads are served from the window, and it is refilled
+ * with exponentially growing requests once it has been consumed.
+ *
+ * The server's position in the file would be ahead of the reader by the unconsumed data, so the
+ * position is kept here instead, and all of the requests of the file are positional. The stream
+ * writes are sent at the reader's position. lseek() isn't implemented and the files can't be
+ * cloned, so nothing else uses the server's position.
+ */
+struct File_Read_Window {
+    pthread_mutex_t lock;
+
+    /// Right to the memory object, if it hasn't been sent to the server yet
+    pmos_right_t object_right;
+
+    /// Mapping of the memory object (READ_WINDOW_SIZE bytes)
+    unsigned char *data;
+
+    /// Offset in the file of the start of the window
+    size_t offset;
+
+    /// The unconsumed data is [pos, len). The position of the file is offset + pos.
+    size_t pos;
+    size_t len;
+
+    /// Size of the next request
+    size_t readahead;
+};
+
+static struct File_Read_Window *create_read_window()
+{
+    struct File_Read_Window *w = malloc(sizeof(*w));
+    if (!w)
+        return NULL;
+
+    right_request_t object = create_mem_object(READ_WINDOW_SIZE, 0);
+    if (object.result != SUCCESS) {
+        free(w);
+        return NULL;
+    }
+
+    map_mem_object_param_t params = {
+        .page_table_id   = PAGE_TABLE_SELF,
+        .object_right    = object.right,
+        .addr_start_uint = 0,
+        .size            = READ_WINDOW_SIZE,
+        .offset_object   = 0,
+        .offset_start    = 0,
+        .object_size     = READ_WINDOW_SIZE,
+        .access_flags    = PROT_READ,
+    };
+
+    mem_request_ret_t map = map_mem_object(&params);
+    if (map.result != SUCCESS) {
+        delete_right(object.right);
+        free(w);
+        return NULL;
+    }
+
+    pthread_mutex_init(&w->lock, NULL);
+    w->object_right = object.right;
+    w->data         = map.virt_addr;
+    w->offset       = 0;
+    w->pos          = 0;
+    w->len          = 0;
+    w->readahead    = READ_WINDOW_READAHEAD;
+    return w;
+}
+
+static void destroy_read_window(struct File_Read_Window *w)
+{
+    release_region(TASK_ID_SELF, w->data);
+    if (w->object_right != INVALID_RIGHT)
+        delete_right(w->object_right);
+    pthread_mutex_destroy(&w->lock);
+    free(w);
+}
+
+/// Moves the position of the file to offset after a stream write, discarding the buffered data. Must
+/// be called with the lock held.
+static void seek_read_window(struct File_Read_Window *w, size_t offset)
+{
+    w->offset    = offset;
+    w->pos       = 0;
+    w->len       = 0;
+    w->readahead = READ_WINDOW_READAHEAD;
+}
+
+/// Discards the unconsumed data if it overlaps [offset, offset + count), after a positional write.
+/// The position of the file is kept. Must be called with the lock held.
+static void invalidate_read_window(struct File_Read_Window *w, size_t offset, size_t count)
+{
+    size_t start = w->offset + w->pos;
+    size_t end   = w->offset + w->len;
+    if (offset < end && offset + count > start) {
+        w->offset = start;
+        w->pos    = 0;
+        w->len    = 0;
+    }
+}
+
+/// Asks the server to fill the window with up to max_size bytes from the position of the file. Must
+/// be called with the lock held, once the window has been consumed.
+static int refill_read_window(struct File *file, struct File_Read_Window *w, size_t max_size,
+                              pmos_port_t reply_port)
+{
+    size_t position = w->offset + w->len;
+
+    IPC_Read_Shared message = {
+        .type         = IPC_Read_Shared_NUM,
+        .flags        = 0,
+        .start_offset = position,
+        .max_size     = max_size,
+        .buffer_size  = READ_WINDOW_SIZE,
+    };
+
+    // The object is sent with the first request, and the server keeps it mapped
+    message_extra_t extra = {
+        .extra_rights = {w->object_right},
+    };
+    message_extra_t *aux = w->object_right != INVALID_RIGHT ? &extra : NULL;
+
+    right_request_t send_result =
+        send_message_right(file->io_right, reply_port, &message, sizeof(message), aux, 0);
+    if (send_result.result != SUCCESS) {
+        errno = EIO;
+        return -1;
+    }
+    w->object_right = INVALID_RIGHT;
+
+    Message_Descriptor reply_descr;
+    IPC_Generic_Msg *reply_msg;
+    result_t result = get_message(&reply_descr, (unsigned char **)&reply_msg, reply_port, NULL, NULL);
+    if (result != SUCCESS) {
+        errno = EIO;
+        return -1;
+    }
+
+    if (reply_descr.size < sizeof(IPC_Read_Shared_Reply) ||
+        reply_msg->type != IPC_Read_Shared_Reply_NUM) {
+        free(reply_msg);
+        errno = EIO;
+        return -1;
+    }
+
+    IPC_Read_Shared_Reply *reply = (IPC_Read_Shared_Reply *)reply_msg;
+    int result_code              = reply->result_code;
+    uint64_t bytes_read          = reply->bytes_read;
+    free(reply_msg);
+
+    if (result_code < 0) {
+        errno = -result_code;
+        return -1;
+    }
+
+    if (bytes_read > max_size) {
+        errno = EIO;
+        return -1;
+    }
+
+    w->offset = position;
+    w->pos    = 0;
+    w->len    = bytes_read;
+    return 0;
+}
+
+static ssize_t read_shared(struct File *file, void *buf, size_t size)
+{
+    struct File_Read_Window *w = file->read_window;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->pos == w->len && size > 0) {
+        pmos_port_t reply_port = prepare_reply_port();
+        if (reply_port == INVALID_PORT) {
+            pthread_mutex_unlock(&w->lock);
+            return -1;
+        }
+
+        size_t request = size > w->readahead ? size : w->readahead;
+        if (request > READ_WINDOW_SIZE)
+            request = READ_WINDOW_SIZE;
+
+        if (refill_read_window(file, w, request, reply_port) < 0) {
+            pthread_mutex_unlock(&w->lock);
+            return -1;
+        }
+
+        if (w->readahead < READ_WINDOW_SIZE)
+            w->readahead *= 2;
+    }
+
+    size_t count = w->len - w->pos;
+    if (count > size)
+        count = size;
+
+    memcpy(buf, w->data + w->pos, count);
+    w->pos += count;
+    pthread_mutex_unlock(&w->lock);
+
+    return count;
+}
+
 ssize_t __file_read(void *file_data, void *buf, size_t size, size_t offset, bool seek)
 {
     // Check if ssize_t can represent size
@@ -108,6 +322,10 @@ ssize_t __file_read(void *file_data, void *buf, size_t size, size_t offset, bool
 
     struct File *file = (struct File *)file_data;
 
+    // The positional reads (pread()) are rare, so they bypass the window
+    if (seek && file->read_window)
+        return read_shared(file, buf, size);
+
     uint32_t flags = 0;
     if (seek)
         flags |= IPC_FLAG_IO_OP_SEEK;
@@ -254,11 +472,21 @@ ssize_t __file_write(void *file_data, const void *buf, size_t size,
         return -1;
     }
 
+    struct File *file          = (struct File *)file_data;
+    struct File_Read_Window *w = file->read_window;
+    bool stream                = seek;
+    if (w) {
+        pthread_mutex_lock(&w->lock);
+        if (stream) {
+            offset = w->offset + w->pos;
+            seek   = false;
+        }
+    }
+
     uint32_t flags = 0;
     if (seek)
         flags |= IPC_FLAG_IO_OP_SEEK;
 
-    struct File *file     = (struct File *)file_data;
     const size_t msg_size = sizeof(IPC_Write) + size;
 
     uint64_t buff[1 + (msg_size - 1) / sizeof(uint64_t)];
@@ -294,7 +522,15 @@ ssize_t __file_write(void *file_data, const void *buf, size_t size,
     }
 
     count = reply->bytes_written;
+    if (w) {
+        if (stream)
+            seek_read_window(w, offset + count);
+        else
+            invalidate_read_window(w, offset, count);
+    }
 error:
+    if (w)
+        pthread_mutex_unlock(&w->lock);
     free(reply_msg);
     return count;
 }
@@ -302,7 +538,7 @@ error:
 ssize_t __file_writev(void *file_data, const struct iovec *iov, int iovcnt,
                       size_t offset, bool seek)
 {
-    ssize_t count              = -1;
+    size_t written             = 0;
     IPC_Generic_Msg *reply_msg = NULL;
 
     pmos_port_t reply_port = prepare_reply_port();
@@ -310,55 +546,280 @@ ssize_t __file_writev(void *file_data, const struct iovec *iov, int iovcnt,
         return -1;
     }
 
+    // TODO: This is problematic...
+    struct File *file          = (struct File *)file_data;
+    struct File_Read_Window *w = file->read_window;
+    bool stream                = seek;
+    if (w) {
+        pthread_mutex_lock(&w->lock);
+        if (stream) {
+            offset = w->offset + w->pos;
+            seek   = false;
+        }
+    }
+
     uint32_t flags = 0;
     if (seek)
         flags |= IPC_FLAG_IO_OP_SEEK;
 
-    // TODO: This is problematic...
-    struct File *file = (struct File *)file_data;
-    for (int i = 0; i < iovcnt; i++) {
+    bool failed = false;
+    for (int i = 0; i < iovcnt && !failed; i++) {
         const size_t msg_size = sizeof(IPC_Write) + iov[i].iov_len;
 
         uint64_t buff[1 + (msg_size - 1) / sizeof(uint64_t)];
         IPC_Write *message      = (void *)buff;
         message->type           = IPC_Write_NUM;
         message->flags          = flags;
-        message->offset         = offset + count;
+        message->offset         = offset + written;
 
         memcpy(message->data, iov[i].iov_base, iov[i].iov_len);
 
+        failed = true;
         right_request_t send_result = send_message_right(file->io_right, reply_port, (const char *)message, msg_size, NULL, 0);
         if (send_result.result != SUCCESS) {
             errno = EIO;
-            goto error;
+            break;
         }
 
         Message_Descriptor reply_descr;
         result_t k_result = get_message(&reply_descr, (unsigned char **)&reply_msg, reply_port, NULL, NULL);
         if (k_result != SUCCESS) {
             errno = EIO;
-            goto error;
+            break;
         }
 
+        IPC_Write_Reply *reply = (IPC_Write_Reply *)reply_msg;
         if (reply_msg->type != IPC_Write_Reply_NUM) {
             errno = EIO;
-            goto error;
-        }
-
-        IPC_Write_Reply *reply = (IPC_Write_Reply *)reply_msg;
-        if (reply->result_code < 0) {
+        } else if (reply->result_code < 0) {
             errno = -reply->result_code;
-            goto error;
+        } else {
+            written += reply->bytes_written;
+            failed = false;
         }
 
-        count += reply->bytes_written;
-        continue;
-    error:
         free(reply_msg);
-        return count;
+        reply_msg = NULL;
     }
 
-    return count;
+    if (w) {
+        if (stream)
+            seek_read_window(w, offset + written);
+        else
+            invalidate_read_window(w, offset, written);
+        pthread_mutex_unlock(&w->lock);
+    }
+
+    // The partial writes are reported as such, like write() does
+    if (failed && written == 0)
+        return -1;
+    return written;
+}
+
+int __file_mmap(void *file_data, int prot, int flags, pmos_right_t *object_right,
+                size_t *object_size, pmos_right_t *sync_right)
+{
+    struct File *file = (struct File *)file_data;
+
+    pmos_port_t reply_port = prepare_reply_port();
+    if (reply_port == INVALID_PORT)
+        return -1;
+
+    IPC_Mmap message = {
+        .type  = IPC_Mmap_NUM,
+        .flags = flags & (MAP_SHARED | MAP_PRIVATE),
+        .prot  = prot,
+    };
+
+    right_request_t send_result =
+        send_message_right(file->io_right, reply_port, &message, sizeof(message), NULL, 0);
+    if (send_result.result != SUCCESS) {
+        errno = EIO;
+        return -1;
+    }
+
+    Message_Descriptor reply_descr;
+    IPC_Generic_Msg *reply_msg   = NULL;
+    pmos_right_t extra_rights[4] = {};
+    result_t result =
+        get_message(&reply_descr, (unsigned char **)&reply_msg, reply_port, NULL, extra_rights);
+    if (result != SUCCESS) {
+        errno = EIO;
+        return -1;
+    }
+
+    int ret = -1;
+    if (reply_descr.size < sizeof(IPC_Mmap_Reply) || reply_msg->type != IPC_Mmap_Reply_NUM) {
+        errno = EIO;
+        goto out;
+    }
+
+    IPC_Mmap_Reply *reply = (IPC_Mmap_Reply *)reply_msg;
+    if (reply->result_code < 0) {
+        errno = -reply->result_code;
+        goto out;
+    }
+
+    if (extra_rights[0] == INVALID_RIGHT) {
+        errno = EIO;
+        goto out;
+    }
+
+    // Only the shared writable mappings modify the file
+    *sync_right = INVALID_RIGHT;
+    if ((flags & MAP_SHARED) && (prot & PROT_WRITE)) {
+        right_request_t dup = dup_right(file->io_right);
+        if (dup.result != SUCCESS) {
+            errno = -dup.result;
+            goto out;
+        }
+        *sync_right = dup.right;
+    }
+
+    *object_right   = extra_rights[0];
+    *object_size    = reply->object_size;
+    extra_rights[0] = INVALID_RIGHT;
+    ret             = 0;
+out:
+    free(reply_msg);
+    for (size_t i = 0; i < 4; ++i) {
+        if (extra_rights[i] != INVALID_RIGHT)
+            delete_right(extra_rights[i]);
+    }
+    return ret;
+}
+
+int __file_poll(void *file_data, uint32_t events, pmos_port_t notify_port, uint64_t cookie,
+                pmos_right_t *notify_id, uint32_t *revents)
+{
+    struct File *file = (struct File *)file_data;
+
+    *notify_id = INVALID_RIGHT;
+
+    // Regular files are always ready
+    if (!(file->fs_flags & IPC_FS_FLAG_POLL)) {
+        *revents = events & (POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM);
+        return 0;
+    }
+
+    pmos_port_t reply_port = prepare_reply_port();
+    if (reply_port == INVALID_PORT)
+        return -1;
+
+    pmos_right_t recieve_id = INVALID_RIGHT;
+    message_extra_t aux     = {};
+    if (notify_port != INVALID_PORT) {
+        right_request_t r = create_right(notify_port, &recieve_id, 0);
+        if (r.result != SUCCESS) {
+            errno = -r.result;
+            return -1;
+        }
+        aux.extra_rights[0] = r.right;
+    }
+
+    IPC_Poll_Register message = {
+        .type   = IPC_Poll_Register_NUM,
+        .flags  = 0,
+        .events = events,
+        .cookie = cookie,
+    };
+
+    right_request_t send_result =
+        send_message_right(file->io_right, reply_port, &message, sizeof(message),
+                           notify_port != INVALID_PORT ? &aux : NULL, 0);
+    if (send_result.result != SUCCESS) {
+        delete_right(aux.extra_rights[0]);
+        delete_receive_right(notify_port, recieve_id);
+        errno = EIO;
+        return -1;
+    }
+
+    Message_Descriptor reply_descr;
+    IPC_Generic_Msg *reply_msg = NULL;
+    result_t result =
+        get_message(&reply_descr, (unsigned char **)&reply_msg, reply_port, NULL, NULL);
+    if (result != SUCCESS) {
+        delete_receive_right(notify_port, recieve_id);
+        errno = EIO;
+        return -1;
+    }
+
+    int ret = -1;
+    if (reply_descr.size < sizeof(IPC_Poll_Register_Reply) ||
+        reply_msg->type != IPC_Poll_Register_Reply_NUM) {
+        errno = EIO;
+        goto out;
+    }
+
+    IPC_Poll_Register_Reply *reply = (IPC_Poll_Register_Reply *)reply_msg;
+    if (reply->result_code < 0) {
+        errno = -reply->result_code;
+        goto out;
+    }
+
+    *revents   = reply->revents;
+    *notify_id = recieve_id;
+    recieve_id = INVALID_RIGHT;
+    ret        = 0;
+out:
+    free(reply_msg);
+    delete_receive_right(notify_port, recieve_id);
+    return ret;
+}
+
+int __file_submit_io(void *file_data, bool write, const void *buf, size_t count, size_t offset,
+                     pmos_port_t reply_port, pmos_right_t *reply_id)
+{
+    if (count > SSIZE_MAX) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    struct File *file = (struct File *)file_data;
+
+    right_request_t send_result;
+    if (write) {
+        // The writes are positional, so only the overlapping read-ahead is stale
+        struct File_Read_Window *w = file->read_window;
+        if (w) {
+            pthread_mutex_lock(&w->lock);
+            invalidate_read_window(w, offset, count);
+            pthread_mutex_unlock(&w->lock);
+        }
+
+        // Unlike the synchronous writes, the requests are usually large and many, so don't put
+        // them on the stack
+        const size_t msg_size = sizeof(IPC_Write) + count;
+        IPC_Write *message    = malloc(msg_size);
+        if (!message)
+            return -1;
+
+        message->type   = IPC_Write_NUM;
+        message->flags  = 0;
+        message->offset = offset;
+        memcpy(message->data, buf, count);
+
+        send_result = send_message_right(file->io_right, reply_port, message, msg_size, NULL, 0);
+        free(message);
+    } else {
+        IPC_Read message = {
+            .type         = IPC_Read_NUM,
+            .flags        = 0,
+            .start_offset = offset,
+            .max_size     = count,
+        };
+
+        send_result =
+            send_message_right(file->io_right, reply_port, &message, sizeof(message), NULL, 0);
+    }
+
+    if (send_result.result != SUCCESS) {
+        errno = EIO;
+        return -1;
+    }
+
+    *reply_id = send_result.right;
+    return 0;
 }
 
 int __file_clone(void *file_data, void *new_data)
@@ -457,14 +918,19 @@ int __file_close(void *file_data)
     return 0;
 }
 
-void __file_free(void *)
+void __file_free(void *file_data)
 {
-    // No dynamic memory associated with the file data so nothing to do here
+    struct File *file = (struct File *)file_data;
+    if (file->read_window) {
+        destroy_read_window(file->read_window);
+        file->read_window = NULL;
+    }
 }
 
 int __open_file(const char *path, int flags, mode_t mode, void *file_data)
 {
     struct File *file = (struct File *)file_data;
+    file->read_window = NULL;
 
     // TODO: Mode is ignored for now
 
@@ -560,6 +1026,11 @@ int __open_file(const char *path, int flags, mode_t mode, void *file_data)
 
     file->file_op_right = extra_rights[0];
     file->io_right      = extra_rights[1];
+    file->fs_flags      = reply->fs_flags;
+
+    // Without the window, the reads fall back to IPC_Read
+    if (file->fs_flags & IPC_FS_FLAG_SHARED_READ)
+        file->read_window = create_read_window();
 
     extra_rights[0] = INVALID_RIGHT;
     extra_rights[1] = INVALID_RIGHT;
@@ -43,6 +43,9 @@ extern isatty_func __file_isatty;
 extern isseekable_func __file_isseekable;
 extern filesize_func __file_filesize;
 extern free_func __file_free;
+extern mmap_func __file_mmap;
+extern poll_func __file_poll;
+extern submit_io_func __file_submit_io;
 
 extern const struct Filesystem_Adaptor __file_adaptor;
 
@@ -35,12 +35,14 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <pmos/__internal.h>
 #include <pmos/helpers.h>
 #include <pmos/ipc.h>
 #include <pmos/ports.h>
 #include <pmos/system.h>
 #include <pmos/tls.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -66,16 +68,30 @@ __attribute__((visibility("hidden"))) const struct Filesystem_Adaptor __file_ada
     .isseekable = &__file_isseekable,
     .filesize   = &__file_filesize,
     .free       = __file_free,
+    .mmap       = __file_mmap,
+    .poll       = __file_poll,
+    .submit_io  = __file_submit_io,
+};
+
+/// Number of descriptor objects added to the pool at once
+#define DESCRIPTOR_CHUNK_SIZE 32
+/// Initial capacity of the descriptor table. Must be a multiple of 64.
+#define INITIAL_TABLE_CAPACITY 64
+
+struct Descriptor_Chunk {
+    struct Descriptor_Chunk *next;
+    struct File_Descriptor descriptors[DESCRIPTOR_CHUNK_SIZE];
 };
 
 // Creates and initializes new Filesystem_Data. Returns its pointer on success, NULL otherwise,
 // setting errno to the appropriate code.
 struct Filesystem_Data *init_filesystem();
+int __close_internal(long int filedes);
 
 static int ensure_fs_initialization()
 {
     // Double-checked locking to initialize fs_data if it is NULL
-    if (fs_data == NULL) {
+    if (__atomic_load_n(&fs_data, __ATOMIC_ACQUIRE) == NULL) {
         pthread_spin_lock(&fs_data_lock);
         if (fs_data == NULL) {
             struct Filesystem_Data *new_data = init_filesystem();
@@ -83,7 +99,7 @@ static int ensure_fs_initialization()
                 pthread_spin_unlock(&fs_data_lock);
                 return -1;
             }
-            fs_data = new_data;
+            __atomic_store_n(&fs_data, new_data, __ATOMIC_RELEASE);
         }
         pthread_spin_unlock(&fs_data_lock);
     }
@@ -91,64 +107,250 @@ static int ensure_fs_initialization()
     return 0;
 }
 
-// Reserves a file descriptor and returns its id. Returns -1 on error.
-static int64_t reserve_descriptors(struct Filesystem_Data *fs_data, size_t count)
+static size_t bitmap_words(size_t bits) { return (bits + 63) / 64; }
+
+static void mark_fd(struct Filesystem_Data *fs, size_t fd)
+{
+    const size_t word = fd / 64;
+    fs->open_fds[word] |= 1ULL << (fd % 64);
+    if (fs->open_fds[word] == ~0ULL)
+        fs->full_words[word / 64] |= 1ULL << (word % 64);
+}
+
+static void unmark_fd(struct Filesystem_Data *fs, size_t fd)
+{
+    const size_t word = fd / 64;
+    fs->open_fds[word] &= ~(1ULL << (fd % 64));
+    fs->full_words[word / 64] &= ~(1ULL << (word % 64));
+}
+
+static bool fd_allocated(struct Filesystem_Data *fs, size_t fd)
+{
+    return fs->open_fds[fd / 64] & (1ULL << (fd % 64));
+}
+
+// Replaces the table with a larger one. Must be called with the lock held. The old table is kept
+// until the filesystem data is destroyed, since the lookups might still be reading it.
+static int grow_table(struct Filesystem_Data *fs, size_t min_capacity)
+{
+    struct Descriptor_Table *old = fs->table;
+    size_t capacity              = old->capacity * 2;
+    while (capacity < min_capacity)
+        capacity *= 2;
+
+    if (capacity > (size_t)INT_MAX + 1) {
+        errno = EMFILE;
+        return -1;
+    }
+
+    const size_t old_words = bitmap_words(old->capacity);
+    const size_t words     = bitmap_words(capacity);
+
+    uint64_t *open_fds = realloc(fs->open_fds, words * sizeof(uint64_t));
+    if (!open_fds)
+        return -1;
+    memset(open_fds + old_words, 0, (words - old_words) * sizeof(uint64_t));
+    fs->open_fds = open_fds;
+
+    const size_t old_full_words = bitmap_words(old_words);
+    const size_t full_words     = bitmap_words(words);
+    uint64_t *full              = realloc(fs->full_words, full_words * sizeof(uint64_t));
+    if (!full)
+        return -1;
+    memset(full + old_full_words, 0, (full_words - old_full_words) * sizeof(uint64_t));
+    fs->full_words = full;
+
+    struct Descriptor_Table *table =
+        malloc(sizeof(*table) + capacity * sizeof(struct File_Descriptor *));
+    if (!table)
+        return -1;
+
+    table->capacity = capacity;
+    table->previous = old;
+    memcpy(table->slots, old->slots, old->capacity * sizeof(struct File_Descriptor *));
+    memset(table->slots + old->capacity, 0,
+           (capacity - old->capacity) * sizeof(struct File_Descriptor *));
+
+    __atomic_store_n(&fs->table, table, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Allocates the lowest free descriptor. Must be called with the lock held.
+static int alloc_fd(struct Filesystem_Data *fs)
 {
-    pthread_spin_lock(&fs_data->lock);
+    for (;;) {
+        const size_t words = fs->table->capacity / 64;
+        for (size_t i = 0; i < bitmap_words(words); ++i) {
+            if (fs->full_words[i] == ~0ULL)
+                continue;
+
+            const size_t word = i * 64 + __builtin_ctzll(~fs->full_words[i]);
+            if (word >= words)
+                break;
 
-    // Check if the descriptors vector needs to be resized
-    if (fs_data->count + fs_data->reserved_count + count > fs_data->capacity) {
-        // Double the capacity of the descriptors vector
-        size_t new_capacity = (fs_data->capacity == 0) ? 4 : fs_data->capacity * 2;
-        struct File_Descriptor *new_vector =
-            realloc(fs_data->descriptors_vector, new_capacity * sizeof(struct File_Descriptor));
-        if (new_vector == NULL) {
-            pthread_spin_unlock(&fs_data->lock);
-            // Handle memory allocation error
+            const size_t fd = word * 64 + __builtin_ctzll(~fs->open_fds[word]);
+            mark_fd(fs, fd);
+            return fd;
+        }
+
+        if (grow_table(fs, fs->table->capacity + 1) < 0)
             return -1;
+    }
+}
+
+// Takes an object from the pool. Must be called with the lock held.
+static struct File_Descriptor *alloc_descriptor(struct Filesystem_Data *fs)
+{
+    if (!fs->free_descriptors) {
+        struct Descriptor_Chunk *chunk = malloc(sizeof(*chunk));
+        if (!chunk) {
+            errno = ENOMEM;
+            return NULL;
         }
 
-        // Zero out memory
-        memset(&new_vector[fs_data->capacity], 0, new_capacity - fs_data->capacity);
+        for (size_t i = 0; i < DESCRIPTOR_CHUNK_SIZE; ++i) {
+            struct File_Descriptor *d = &chunk->descriptors[i];
+            d->refcount               = 0;
+            pthread_mutex_init(&d->pos_lock, NULL);
+            d->next_free         = fs->free_descriptors;
+            fs->free_descriptors = d;
+        }
 
-        fs_data->descriptors_vector = new_vector;
-        fs_data->capacity           = new_capacity;
+        chunk->next = fs->chunks;
+        fs->chunks  = chunk;
     }
 
-    fs_data->reserved_count += count;
+    struct File_Descriptor *d = fs->free_descriptors;
+    fs->free_descriptors      = d->next_free;
+    return d;
+}
 
-    pthread_spin_unlock(&fs_data->lock);
-    return 0;
+// Reserves the lowest free descriptor, which must then be installed or released. Returns -1 on
+// error.
+static int reserve_descriptor(struct Filesystem_Data *fs)
+{
+    pthread_mutex_lock(&fs->lock);
+    int fd = alloc_fd(fs);
+    pthread_mutex_unlock(&fs->lock);
+    return fd;
 }
 
-static int reserve_descriptor(struct Filesystem_Data *fs_data)
+static void release_descriptor(struct Filesystem_Data *fs, int fd)
 {
-    return reserve_descriptors(fs_data, 1);
+    pthread_mutex_lock(&fs->lock);
+    unmark_fd(fs, fd);
+    pthread_mutex_unlock(&fs->lock);
 }
 
-// Releases a reserved descriptor. Returns 0 on success and -1 on error.
-static int release_descriptors(struct Filesystem_Data *fs_data, size_t count)
+// Creates the descriptor in the reserved slot. On error, the slot is released and the data is left
+// to the caller.
+static int install_descriptor(struct Filesystem_Data *fs, int fd, uint8_t type, uint8_t flags,
+                              const struct Filesystem_Adaptor *adaptor, union File_Data *data)
 {
-    if (fs_data == NULL) {
-        // Invalid fs_data or descriptor index
+    pthread_mutex_lock(&fs->lock);
+
+    struct File_Descriptor *d = alloc_descriptor(fs);
+    if (!d) {
+        unmark_fd(fs, fd);
+        pthread_mutex_unlock(&fs->lock);
         return -1;
     }
 
-    // Lock the descriptor to ensure thread-safety
-    pthread_spin_lock(&fs_data->lock);
+    d->type    = type;
+    d->flags   = flags;
+    d->adaptor = adaptor;
+    d->data    = *data;
 
-    assert(fs_data->reserved_count >= count);
-    fs_data->reserved_count -= count;
+    // A stale lookup might still be holding the object, so it only becomes valid once initialized,
+    // and is published after that
+    __atomic_store_n(&d->refcount, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&fs->table->slots[fd], d, __ATOMIC_RELEASE);
+    ++fs->count;
 
-    // Unlock the descriptor
-    pthread_spin_unlock(&fs_data->lock);
+    pthread_mutex_unlock(&fs->lock);
+    return fd;
+}
 
-    return 0;
+// Drops a reference to the descriptor, closing it if it was the last one. Returns the result of
+// close().
+static int put_descriptor(struct File_Descriptor *d)
+{
+    if (__atomic_sub_fetch(&d->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+        return 0;
+
+    int result = d->adaptor->close(&d->data);
+    // Even if the close() function fails, we still need to free the descriptor
+    d->adaptor->free(&d->data);
+
+    pthread_mutex_lock(&fs_data->lock);
+    d->next_free              = fs_data->free_descriptors;
+    fs_data->free_descriptors = d;
+    pthread_mutex_unlock(&fs_data->lock);
+
+    return result;
 }
 
-static int release_descriptor(struct Filesystem_Data *fs_data)
+// Same as put_descriptor(), for when errno holds the result of the operation
+static void put_descriptor_keep_errno(struct File_Descriptor *d)
 {
-    return release_descriptors(fs_data, 1);
+    int saved_errno = errno;
+    put_descriptor(d);
+    errno = saved_errno;
+}
+
+static bool get_unless_zero(struct File_Descriptor *d)
+{
+    size_t refcount = __atomic_load_n(&d->refcount, __ATOMIC_RELAXED);
+    do {
+        if (refcount == 0)
+            return false;
+    } while (!__atomic_compare_exchange_n(&d->refcount, &refcount, refcount + 1, true,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    return true;
+}
+
+// Returns the descriptor with a reference, which must be dropped with put_descriptor(), or NULL
+// with errno set. Doesn't take any locks.
+static struct File_Descriptor *get_descriptor(long int fd)
+{
+    if (ensure_fs_initialization() < 0)
+        return NULL;
+
+    struct Filesystem_Data *fs = __atomic_load_n(&fs_data, __ATOMIC_ACQUIRE);
+    for (;;) {
+        struct Descriptor_Table *table = __atomic_load_n(&fs->table, __ATOMIC_ACQUIRE);
+        if (fd < 0 || (size_t)fd >= table->capacity)
+            break;
+
+        struct File_Descriptor *d = __atomic_load_n(&table->slots[fd], __ATOMIC_ACQUIRE);
+        if (!d)
+            break;
+
+        // Being closed, so the slot has already been cleared or replaced
+        if (!get_unless_zero(d))
+            continue;
+
+        // The object might have been closed and reused for another descriptor in the meantime
+        table = __atomic_load_n(&fs->table, __ATOMIC_ACQUIRE);
+        if ((size_t)fd < table->capacity &&
+            __atomic_load_n(&table->slots[fd], __ATOMIC_ACQUIRE) == d)
+            return d;
+
+        put_descriptor(d);
+    }
+
+    errno = EBADF; // Bad file descriptor
+    return NULL;
+}
+
+// The position is kept by the server, but the operations using it must still happen one at a time
+static bool lock_position(struct File_Descriptor *d, bool uses_position)
+{
+    if (!uses_position || !d->adaptor->isseekable(&d->data))
+        return false;
+
+    pthread_mutex_lock(&d->pos_lock);
+    return true;
 }
 
 int __share_fs_data(uint64_t tid)
@@ -170,11 +372,9 @@ int open(const char *path, int flags)
     if (ensure_fs_initialization() < 0)
         return -1;
 
-    int result = reserve_descriptor(fs_data);
-    if (result < 0) {
-        errno = ENFILE; // Set errno to appropriate error code
+    int descriptor = reserve_descriptor(fs_data);
+    if (descriptor < 0)
         return -1;
-    }
 
     const struct Filesystem_Adaptor *file_adaptor = &__file_adaptor;
     union File_Data data;
@@ -182,40 +382,18 @@ int open(const char *path, int flags)
 
     if (result_code < 0) {
         // Handle error: Failed to open the file
-        release_descriptor(fs_data);
+        release_descriptor(fs_data, descriptor);
         return -1;
     }
 
-    result_code = pthread_spin_lock(&fs_data->lock);
-    if (result_code != SUCCESS) {
-        // Handle error: Failed to lock the filesystem data
-        release_descriptor(fs_data);
+    result_code =
+        install_descriptor(fs_data, descriptor, DESCRIPTOR_FILE, flags, file_adaptor, &data);
+    if (result_code < 0) {
         file_adaptor->close(&data);
         file_adaptor->free(&data);
-        // errno = result_code; // Set errno to appropriate error code
         return -1;
     }
 
-    int descriptor = -1;
-    for (size_t i = 0; i < fs_data->capacity; ++i) {
-        if (!fs_data->descriptors_vector[i].used) {
-            descriptor = i;
-            break;
-        }
-    }
-    assert(descriptor >= 0);
-
-    fs_data->count++;
-    fs_data->reserved_count--;
-
-    fs_data->descriptors_vector[descriptor].type    = DESCRIPTOR_FILE;
-    fs_data->descriptors_vector[descriptor].used    = true;
-    fs_data->descriptors_vector[descriptor].flags   = flags;
-    fs_data->descriptors_vector[descriptor].adaptor = file_adaptor;
-    fs_data->descriptors_vector[descriptor].data    = data;
-
-    pthread_spin_unlock(&fs_data->lock);
-
     // Return the file descriptor
     return descriptor;
 }
@@ -226,9 +404,13 @@ int pipe(int pipefd[2])
         return -1;
     }
 
-    int result = reserve_descriptors(fs_data, 2);
-    if (result < 0) {
-        errno = ENFILE; // Set errno to appropriate error code
+    pipefd[0] = reserve_descriptor(fs_data);
+    if (pipefd[0] < 0)
+        return -1;
+
+    pipefd[1] = reserve_descriptor(fs_data);
+    if (pipefd[1] < 0) {
+        release_descriptor(fs_data, pipefd[0]);
         return -1;
     }
 
@@ -236,43 +418,29 @@ int pipe(int pipefd[2])
     union File_Data data[2];
     int result_code = __create_pipe(data, fs_data->fs_consumer_id);
     if (result_code < 0) {
-        release_descriptors(fs_data, 2);
+        release_descriptor(fs_data, pipefd[0]);
+        release_descriptor(fs_data, pipefd[1]);
         return -1;
     }
 
-    result_code = pthread_spin_lock(&fs_data->lock);
-    if (result_code != SUCCESS) {
-        release_descriptors(fs_data, 2);
-        file_adaptor->close(&data[0]);
-        file_adaptor->free(&data[0]);
-        file_adaptor->close(&data[1]);
-        file_adaptor->free(&data[1]);
+    if (install_descriptor(fs_data, pipefd[0], DESCRIPTOR_FILE, 0, file_adaptor, &data[0]) < 0) {
+        release_descriptor(fs_data, pipefd[1]);
+        for (int i = 0; i < 2; ++i) {
+            file_adaptor->close(&data[i]);
+            file_adaptor->free(&data[i]);
+        }
         return -1;
     }
 
-    for (int i = 0; i < 2; ++i) {
-        int descriptor = -1;
-        for (size_t j = 0; j < fs_data->capacity; ++j) {
-            if (!fs_data->descriptors_vector[j].used) {
-                descriptor = j;
-                break;
-            }
-        }
-        assert(descriptor >= 0);
-
-        fs_data->count++;
-        fs_data->reserved_count--;
-
-        fs_data->descriptors_vector[descriptor] = (struct File_Descriptor) {.type = DESCRIPTOR_FILE,
-                                                                            .used = true,
-                                                                            .flags   = 0,
-                                                                            .adaptor = file_adaptor,
-                                                                            .data    = data[i]};
-
-        pipefd[i] = descriptor;
+    if (install_descriptor(fs_data, pipefd[1], DESCRIPTOR_FILE, 0, file_adaptor, &data[1]) < 0) {
+        int saved_errno = errno;
+        __close_internal(pipefd[0]);
+        file_adaptor->close(&data[1]);
+        file_adaptor->free(&data[1]);
+        errno = saved_errno;
+        return -1;
     }
 
-    pthread_spin_unlock(&fs_data->lock);
     return 0;
 }
 
@@ -346,32 +514,17 @@ finish:
 
 ssize_t __read_internal(long int fd, void *buf, size_t c, bool should_seek, size_t offset)
 {
-    if (ensure_fs_initialization() < 0)
-        return -1;
-
-    // Lock the file descriptor to ensure thread-safety
-    pthread_spin_lock(&fs_data->lock);
-
-    // Check if the file descriptor is valid
-    if (fd < 0 || fd >= fs_data->capacity) {
-        pthread_spin_unlock(&fs_data->lock);
-        errno = EBADF; // Bad file descriptor
+    struct File_Descriptor *d = get_descriptor(fd);
+    if (!d)
         return -1;
-    }
-
-    // Obtain the file descriptor data
-    struct File_Descriptor file_desc = fs_data->descriptors_vector[fd];
-
-    // Unlock the file descriptor
-    pthread_spin_unlock(&fs_data->lock);
 
-    // Check if the file descriptor is in use and reserved
-    if (!file_desc.used) {
-        errno = EBADF; // Bad file descriptor
-        return -1;
-    }
+    bool locked    = lock_position(d, should_seek);
+    ssize_t result = d->adaptor->read(&d->data, buf, c, offset, should_seek);
+    if (locked)
+        pthread_mutex_unlock(&d->pos_lock);
 
-    return file_desc.adaptor->read(&file_desc.data, buf, c, offset, should_seek);
+    put_descriptor_keep_errno(d);
+    return result;
 }
 
 ssize_t read(int fd, void *buf, size_t count) { return __read_internal(fd, buf, count, true, 0); }
@@ -381,127 +534,105 @@ ssize_t pread(int fd, void *buf, size_t count, off_t offset)
     return __read_internal(fd, buf, count, false, offset);
 }
 
+// Installs the standard stream in the given descriptor. Only used during the initialization.
 static int set_desc_queue(struct Filesystem_Data *fs_data, size_t descriptor_id, const char *name)
 {
     assert(fs_data != NULL);
+    assert(descriptor_id < fs_data->table->capacity && !fd_allocated(fs_data, descriptor_id));
 
-    if (descriptor_id < 0 || descriptor_id >= fs_data->capacity) {
-        // Invalid descriptor ID
-        errno = EBADF;
-        return -1;
-    }
-
-    // Don't lock the descriptor because this is called during initialization
-
-    // Check if the descriptor is used
-    if (fs_data->descriptors_vector[descriptor_id].used) {
-        // Descriptor must not be used
-        errno = EBADF;
-        return -1;
-    }
-
-    struct File_Descriptor *des = &fs_data->descriptors_vector[descriptor_id];
-
-    int result = __set_desc_queue(&des->data, name);
+    union File_Data data;
+    int result = __set_desc_queue(&data, name);
     if (result != 0)
         return result;
 
-    des->type    = DESCRIPTOR_IPC_QUEUE;
-    des->used    = true;
-    des->flags   = 0;
-    des->adaptor = &__ipc_queue_adaptor;
+    mark_fd(fs_data, descriptor_id);
+    result = install_descriptor(fs_data, descriptor_id, DESCRIPTOR_IPC_QUEUE, 0,
+                                &__ipc_queue_adaptor, &data);
+    if (result < 0) {
+        __ipc_queue_adaptor.free(&data);
+        return -1;
+    }
 
     return 0;
 }
 
-static void free_descriptor(struct File_Descriptor *des)
+/// Destroys the filesystem data structure. Assumes that all of the processes inside the group have
+/// left it.
+/// @param fs_data Filesystem data to be destroyed
+static void destroy_filesystem(struct Filesystem_Data *fs_data)
 {
-    assert(des != NULL);
+    if (fs_data == NULL)
+        return;
 
-    if (des->used) {
-        des->adaptor->close(&des->data);
-        des->adaptor->free(&des->data);
+    struct Descriptor_Table *table = fs_data->table;
+    if (table != NULL) {
+        for (size_t i = 0; i < table->capacity; ++i) {
+            struct File_Descriptor *d = table->slots[i];
+            if (d != NULL)
+                d->adaptor->free(&d->data);
+        }
+    }
+
+    while (table != NULL) {
+        struct Descriptor_Table *previous = table->previous;
+        free(table);
+        table = previous;
+    }
 
-        des->used = false;
+    while (fs_data->chunks != NULL) {
+        struct Descriptor_Chunk *next = fs_data->chunks->next;
+        free(fs_data->chunks);
+        fs_data->chunks = next;
     }
+
+    free(fs_data->open_fds);
+    free(fs_data->full_words);
+    pthread_mutex_destroy(&fs_data->lock);
+    free(fs_data);
 }
 
 struct Filesystem_Data *init_filesystem()
 {
-    struct Filesystem_Data *new_fs_data = malloc(sizeof(struct Filesystem_Data));
+    struct Filesystem_Data *new_fs_data = calloc(1, sizeof(struct Filesystem_Data));
     if (new_fs_data == NULL) {
         // Handle memory allocation error
         errno = ENOMEM;
         return NULL;
     }
 
-    static const size_t initial_capacity = 8;
-    struct File_Descriptor *new_descriptors_vector =
-        calloc(initial_capacity, sizeof(struct File_Descriptor));
-    if (new_descriptors_vector == NULL) {
-        // Handle memory allocation error
-        free(new_fs_data);
-        errno = ENOMEM;
-        return NULL;
-    }
-
-    new_fs_data->descriptors_vector = new_descriptors_vector;
-    new_fs_data->count              = 0;
-    new_fs_data->capacity           = initial_capacity;
+    pthread_mutex_init(&new_fs_data->lock, NULL);
 
-    int result = set_desc_queue(new_fs_data, 1, "/pmos/stdout");
-    if (result != SUCCESS) {
-        // Handle error
-        free(new_fs_data->descriptors_vector);
-        free(new_fs_data);
-        // errno is set by set_desc_queue
-        return NULL;
-    }
-
-    result = set_desc_queue(new_fs_data, 2, "/pmos/stderr");
-    if (result != SUCCESS) {
-        // Handle error
-        free_descriptor(&new_fs_data->descriptors_vector[0]);
-        free(new_fs_data->descriptors_vector);
-        free(new_fs_data);
-        // errno is set by set_desc_queue
+    struct Descriptor_Table *table = malloc(
+        sizeof(struct Descriptor_Table) + INITIAL_TABLE_CAPACITY * sizeof(struct File_Descriptor *));
+    new_fs_data->open_fds   = calloc(bitmap_words(INITIAL_TABLE_CAPACITY), sizeof(uint64_t));
+    new_fs_data->full_words = calloc(1, sizeof(uint64_t));
+    if (!table || !new_fs_data->open_fds || !new_fs_data->full_words) {
+        free(table);
+        destroy_filesystem(new_fs_data);
+        errno = ENOMEM;
         return NULL;
     }
 
-    result = set_desc_queue(new_fs_data, 0, "/pmos/stdin");
-    if (result != SUCCESS) {
-        // Handle error
-        free_descriptor(&new_fs_data->descriptors_vector[0]);
-        free_descriptor(&new_fs_data->descriptors_vector[1]);
-        free(new_fs_data->descriptors_vector);
-        free(new_fs_data);
-        // errno is set by set_desc_queue
-        return NULL;
-    }
+    table->capacity = INITIAL_TABLE_CAPACITY;
+    table->previous = NULL;
+    memset(table->slots, 0, INITIAL_TABLE_CAPACITY * sizeof(struct File_Descriptor *));
+    new_fs_data->table = table;
 
-    // Initialize the spinlock
-    result = pthread_spin_init(&new_fs_data->lock, PTHREAD_PROCESS_PRIVATE);
-    if (result != 0) {
-        // Handle error
-        free_descriptor(&new_fs_data->descriptors_vector[0]);
-        free_descriptor(&new_fs_data->descriptors_vector[1]);
-        free_descriptor(&new_fs_data->descriptors_vector[2]);
-        free(new_fs_data->descriptors_vector);
-        free(new_fs_data);
-        // errno is set by pthread_spin_init
-        return NULL;
+    static const char *const streams[] = {"/pmos/stdin", "/pmos/stdout", "/pmos/stderr"};
+    for (size_t i = 0; i < 3; ++i) {
+        int result = set_desc_queue(new_fs_data, i, streams[i]);
+        if (result != SUCCESS) {
+            // errno is set by set_desc_queue
+            destroy_filesystem(new_fs_data);
+            return NULL;
+        }
     }
 
     // Create a new task group
     syscall_r sys_result = create_task_group();
     if (sys_result.result != SUCCESS) {
         // Handle error: Failed to create the task group
-        free_descriptor(&new_fs_data->descriptors_vector[0]);
-        free_descriptor(&new_fs_data->descriptors_vector[1]);
-        free_descriptor(&new_fs_data->descriptors_vector[2]);
-        free(new_fs_data->descriptors_vector);
-        pthread_spin_destroy(&new_fs_data->lock);
-        free(new_fs_data);
+        destroy_filesystem(new_fs_data);
         errno = -sys_result.result;
         return NULL;
     }
@@ -511,30 +642,6 @@ struct Filesystem_Data *init_filesystem()
     return new_fs_data;
 }
 
-/// Destroys the filesystem data structure. Assumes that all of the processes inside the group have
-/// left it.
-/// @param fs_data Filesystem data to be destroyed
-static void destroy_filesystem(struct Filesystem_Data *fs_data)
-{
-    if (fs_data == NULL)
-        return;
-
-    // Destroy the spinlock
-    pthread_spin_destroy(&fs_data->lock);
-
-    if (fs_data->descriptors_vector != NULL) {
-        for (size_t i = 0; i < fs_data->capacity; ++i) {
-            if (fs_data->descriptors_vector[i].used) {
-                fs_data->descriptors_vector[i].adaptor->free(&fs_data->descriptors_vector[i]);
-            }
-        }
-
-        free(fs_data->descriptors_vector);
-    }
-
-    free(fs_data);
-}
-
 _HIDDEN void __destroy_fs_data(struct Filesystem_Data *fs_data) { destroy_filesystem(fs_data); };
 
 int __close_internal(long int filedes)
@@ -547,38 +654,27 @@ int __close_internal(long int filedes)
     if (ensure_fs_initialization() < 0)
         return -1;
 
-    int result = pthread_spin_lock(&fs_data->lock);
-    if (result != SUCCESS) {
-        errno = result;
-        return -1;
-    }
+    pthread_mutex_lock(&fs_data->lock);
 
-    if (fs_data->capacity <= filedes) {
-        pthread_spin_unlock(&fs_data->lock);
-        errno = EBADF;
-        return -1;
-    }
-
-    struct File_Descriptor *des = &fs_data->descriptors_vector[filedes];
+    struct Descriptor_Table *table = fs_data->table;
+    struct File_Descriptor *des    = NULL;
+    if ((size_t)filedes < table->capacity)
+        des = table->slots[filedes];
 
-    if (!des->used) {
-        pthread_spin_unlock(&fs_data->lock);
+    if (des == NULL) {
+        pthread_mutex_unlock(&fs_data->lock);
         errno = EBADF;
         return -1;
     }
 
-    struct File_Descriptor copy = *des;
-    uint64_t fs_consumer_id     = fs_data->fs_consumer_id;
-
-    des->used = false;
-
-    pthread_spin_unlock(&fs_data->lock);
+    __atomic_store_n(&table->slots[filedes], NULL, __ATOMIC_RELEASE);
+    unmark_fd(fs_data, filedes);
+    --fs_data->count;
 
-    result = copy.adaptor->close(&copy.data);
-    // Even if the close() function fails, we still need to free the descriptor
-    copy.adaptor->free(&copy.data);
+    pthread_mutex_unlock(&fs_data->lock);
 
-    return result;
+    // The operations in progress keep the file open until they finish
+    return put_descriptor(des);
 }
 
 int dup2(int oldfd, int newfd)
@@ -588,214 +684,206 @@ int dup2(int oldfd, int newfd)
         return -1;
     }
 
+    struct File_Descriptor *des = get_descriptor(oldfd);
+    if (des == NULL)
+        return -1;
+
     if (oldfd == newfd) {
+        put_descriptor(des);
         return newfd;
     }
 
-    if (ensure_fs_initialization() < 0)
+    union File_Data new_data = {};
+    int result               = des->adaptor->clone(&des->data, &new_data);
+    if (result < 0) {
+        put_descriptor_keep_errno(des);
         return -1;
-
-    int result                                   = newfd;
-    union File_Data new_data                     = {};
-    union File_Data old_data                     = {};
-    const struct Filesystem_Adaptor *old_adaptor = NULL;
-    bool free_old_data                           = true;
-
-    pthread_spin_lock(&fs_data->lock);
-
-    if (oldfd >= fs_data->capacity) {
-        errno  = EBADF;
-        result = -1;
-        goto finish;
     }
 
-    if (!fs_data->descriptors_vector[oldfd].used) {
-        errno  = EBADF;
-        result = -1;
-        goto finish;
-    }
+    struct File_Descriptor *old = NULL, *new_des = NULL;
 
-    // Check if the descriptors vector needs to be resized
-    if (newfd >= fs_data->capacity ||
-        (fs_data->descriptors_vector[newfd].used &&
-         (fs_data->count + fs_data->reserved_count) == fs_data->capacity)) {
-        // Double the capacity of the descriptors vector
-        size_t new_capacity = (fs_data->capacity == 0) ? 4 : fs_data->capacity * 2;
-        if (new_capacity <= newfd) {
-            new_capacity = newfd + 1;
-        }
-        struct File_Descriptor *new_vector =
-            realloc(fs_data->descriptors_vector, new_capacity * sizeof(struct File_Descriptor));
-        if (new_vector == NULL) {
-            result = -1;
-            goto finish;
-        }
+    pthread_mutex_lock(&fs_data->lock);
 
-        // Zero out memory
-        memset(&new_vector[fs_data->capacity], 0, new_capacity - fs_data->capacity);
+    // Check if the table needs to be resized
+    if ((size_t)newfd >= fs_data->table->capacity && grow_table(fs_data, newfd + 1) < 0)
+        goto error;
 
-        fs_data->descriptors_vector = new_vector;
-        fs_data->capacity           = new_capacity;
+    old = fs_data->table->slots[newfd];
+    if (old == NULL && fd_allocated(fs_data, newfd)) {
+        // Being opened by another thread
+        errno = EBUSY;
+        goto error;
     }
 
-    if (fs_data->descriptors_vector[newfd].used) {
-        old_adaptor   = fs_data->descriptors_vector[newfd].adaptor;
-        old_data      = fs_data->descriptors_vector[newfd].data;
-        free_old_data = true;
-    }
+    new_des = alloc_descriptor(fs_data);
+    if (new_des == NULL)
+        goto error;
 
-    const uint64_t consumer = fs_data->fs_consumer_id;
-    result                  = fs_data->descriptors_vector[oldfd].adaptor->clone(
-        &fs_data->descriptors_vector[oldfd].data, &new_data);
-    if (result < 0) {
-        free_old_data = false;
-        result        = -1;
-        goto finish;
+    new_des->type    = des->type;
+    new_des->flags   = des->flags;
+    new_des->adaptor = des->adaptor;
+    new_des->data    = new_data;
+    __atomic_store_n(&new_des->refcount, 1, __ATOMIC_RELEASE);
+
+    if (old == NULL) {
+        mark_fd(fs_data, newfd);
+        ++fs_data->count;
     }
+    __atomic_store_n(&fs_data->table->slots[newfd], new_des, __ATOMIC_RELEASE);
 
-    fs_data->descriptors_vector[newfd].used    = true;
-    fs_data->descriptors_vector[newfd].flags   = fs_data->descriptors_vector[oldfd].flags;
-    fs_data->descriptors_vector[newfd].type    = fs_data->descriptors_vector[oldfd].type;
-    fs_data->descriptors_vector[newfd].adaptor = fs_data->descriptors_vector[oldfd].adaptor;
+    pthread_mutex_unlock(&fs_data->lock);
 
-finish:
-    pthread_spin_unlock(&fs_data->lock);
-    if (free_old_data) {
-        old_adaptor->close(&old_data);
-        old_adaptor->free(&old_data);
-    }
+    // The errors of closing the old descriptor are ignored
+    if (old != NULL)
+        put_descriptor(old);
+    put_descriptor(des);
+    return newfd;
 
-    return result;
+error:
+    pthread_mutex_unlock(&fs_data->lock);
+    des->adaptor->free(&new_data);
+    put_descriptor_keep_errno(des);
+    return -1;
 }
 
 int dup(int fd)
 {
-    if (fd < 0) {
-        errno = EBADF;
-        return -1;
-    }
-
-    if (ensure_fs_initialization() < 0)
+    struct File_Descriptor *des = get_descriptor(fd);
+    if (des == NULL)
         return -1;
 
-    int result                               = -1;
-    union File_Data new_data                 = {};
-    const struct Filesystem_Adaptor *adaptor = NULL;
-
-    result = reserve_descriptor(fs_data);
+    union File_Data new_data = {};
+    int result               = des->adaptor->clone(&des->data, &new_data);
     if (result < 0) {
-        errno = ENFILE;
-        return -1;
-    }
-
-    result = pthread_spin_lock(&fs_data->lock);
-    if (result != SUCCESS) {
-        release_descriptor(fs_data);
-        errno = result;
+        put_descriptor_keep_errno(des);
         return -1;
     }
 
-    if (fd >= fs_data->capacity) {
-        pthread_spin_unlock(&fs_data->lock);
-        errno = EBADF;
-        return -1;
-    }
+    result = reserve_descriptor(fs_data);
+    if (result >= 0)
+        result = install_descriptor(fs_data, result, des->type, des->flags, des->adaptor, &new_data);
+    if (result < 0)
+        des->adaptor->free(&new_data);
 
-    if (!fs_data->descriptors_vector[fd].used) {
-        pthread_spin_unlock(&fs_data->lock);
-        errno = EBADF;
-        return -1;
-    }
+    put_descriptor_keep_errno(des);
+    return result;
+}
 
-    union File_Data old_data = fs_data->descriptors_vector[fd].data;
-    adaptor                  = fs_data->descriptors_vector[fd].adaptor;
-    const int type           = fs_data->descriptors_vector[fd].type;
-    const int flags          = fs_data->descriptors_vector[fd].flags;
+int close(int filedes) { return __close_internal(filedes); }
 
-    pthread_spin_unlock(&fs_data->lock);
+int isatty(int fd)
+{
+    struct File_Descriptor *des = get_descriptor(fd);
+    if (des == NULL)
+        return 0;
 
-    result = adaptor->clone(&old_data, &new_data);
-    if (result < 0) {
-        release_descriptor(fs_data);
-        return -1;
-    }
+    int result = des->adaptor->isatty(&des->data);
+    put_descriptor_keep_errno(des);
+    return result;
+}
 
-    result = pthread_spin_lock(&fs_data->lock);
-    if (result != SUCCESS) {
-        release_descriptor(fs_data);
-        adaptor->free(&new_data);
-        errno = result;
+int __mmap_descriptor(int fd, int prot, int flags, pmos_right_t *object_right,
+                      size_t *object_size, pmos_right_t *sync_right)
+{
+    struct File_Descriptor *des = get_descriptor(fd);
+    if (des == NULL)
         return -1;
-    }
-
-    int descriptor = -1;
-    for (size_t i = 0; i < fs_data->capacity; ++i) {
-        if (!fs_data->descriptors_vector[i].used) {
-            descriptor = i;
-            break;
-        }
-    }
-    assert(descriptor >= 0);
-    --fs_data->reserved_count;
-    ++fs_data->count;
 
-    fs_data->descriptors_vector[descriptor].type    = type;
-    fs_data->descriptors_vector[descriptor].used    = true;
-    fs_data->descriptors_vector[descriptor].flags   = flags;
-    fs_data->descriptors_vector[descriptor].adaptor = adaptor;
-    fs_data->descriptors_vector[descriptor].data    = new_data;
-
-    result = descriptor;
-
-    pthread_spin_unlock(&fs_data->lock);
+    int result = -1;
+    if (!des->adaptor->mmap)
+        errno = ENODEV;
+    else
+        result = des->adaptor->mmap(&des->data, prot, flags, object_right, object_size,
+                                    sync_right);
 
+    put_descriptor_keep_errno(des);
     return result;
 }
 
-int close(int filedes) { return __close_internal(filedes); }
-
-int isatty(int fd)
+int __poll_descriptor(int fd, uint32_t events, pmos_port_t notify_port, uint64_t cookie,
+                      pmos_right_t *notify_id, uint32_t *revents)
 {
-    if (ensure_fs_initialization() < 0)
+    struct File_Descriptor *des = get_descriptor(fd);
+    if (des == NULL)
         return -1;
 
-    pthread_spin_lock(&fs_data->lock);
-    if (fd < 0 || fd >= fs_data->capacity) {
-        errno = EBADF;
-        return 0;
+    int result = 0;
+    if (!des->adaptor->poll) {
+        *notify_id = INVALID_RIGHT;
+        *revents   = events & (POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM);
+    } else {
+        result = des->adaptor->poll(&des->data, events, notify_port, cookie, notify_id, revents);
     }
 
-    struct File_Descriptor file_desc = fs_data->descriptors_vector[fd];
-    pthread_spin_unlock(&fs_data->lock);
+    put_descriptor_keep_errno(des);
+    return result;
+}
+
+// Returns 0 if the request has been sent, or 1 if the descriptor doesn't support the asynchronous
+// I/O and the operation has been performed, with its result (bytes or -1 with errno) in *result
+int __submit_io_descriptor(int fd, bool write, void *buf, size_t count, size_t offset,
+                           pmos_port_t reply_port, pmos_right_t *reply_id, ssize_t *result)
+{
+    struct File_Descriptor *des = get_descriptor(fd);
+    if (des == NULL)
+        return -1;
 
-    if (!file_desc.used) {
-        errno = EBADF;
-        return 0;
-    }
+    int ret = 1;
+    if (des->adaptor->submit_io)
+        ret = des->adaptor->submit_io(&des->data, write, buf, count, offset, reply_port, reply_id);
+    else if (write)
+        *result = des->adaptor->write(&des->data, buf, count, offset, false);
+    else
+        *result = des->adaptor->read(&des->data, buf, count, offset, false);
 
-    return file_desc.adaptor->isatty(&file_desc.data);
+    put_descriptor_keep_errno(des);
+    return ret;
 }
 
-int fstat(int fd, struct stat *stat)
+int __add_descriptor(uint8_t type, uint8_t flags, const struct Filesystem_Adaptor *adaptor,
+                     union File_Data *data)
 {
     if (ensure_fs_initialization() < 0)
         return -1;
 
-    pthread_spin_lock(&fs_data->lock);
-    if (fd < 0 || fd >= fs_data->capacity) {
-        errno = EBADF;
+    int descriptor = reserve_descriptor(fs_data);
+    if (descriptor < 0)
         return -1;
-    }
 
-    struct File_Descriptor file_desc = fs_data->descriptors_vector[fd];
-    pthread_spin_unlock(&fs_data->lock);
+    return install_descriptor(fs_data, descriptor, type, flags, adaptor, data);
+}
+
+void __epoll_acquire_instance(struct Epoll_Instance *instance);
+
+// Returns the instance of the epoll descriptor, which must be released with
+// __epoll_release_instance()
+struct Epoll_Instance *__get_epoll_instance(int fd)
+{
+    struct File_Descriptor *des = get_descriptor(fd);
+    if (des == NULL)
+        return NULL;
 
-    if (!file_desc.used) {
+    struct Epoll_Instance *instance = NULL;
+    if (des->type == DESCRIPTOR_EPOLL) {
+        instance = des->data.epoll.instance;
+        __epoll_acquire_instance(instance);
+    }
+    put_descriptor(des);
+
+    if (!instance)
         errno = EBADF;
+    return instance;
+}
+
+int fstat(int fd, struct stat *stat)
+{
+    struct File_Descriptor *des = get_descriptor(fd);
+    if (des == NULL)
         return -1;
-    }
 
-    return file_desc.adaptor->fstat(&file_desc.data, stat);
+    int result = des->adaptor->fstat(&des->data, stat);
+    put_descriptor_keep_errno(des);
+    return result;
 }
 
 off_t __lseek_internal(long int fd, off_t offset, int whence)
@@ -828,88 +916,68 @@ int __clone_fs_data(struct Filesystem_Data **new_data, uint64_t for_task, bool e
         return -1;
     }
 
-    int result;
-    if (!exclusive) {
-        result = pthread_spin_lock(&fs_data->lock);
-        if (result != SUCCESS) {
-            remove_task_from_group(for_task, new_fs_data->fs_consumer_id);
-            destroy_filesystem(new_fs_data);
-            // errno is set by pthread_spin_lock
-            return -1;
-        }
-    }
-
-    // Make sure there is enough space in the new vector
-    if (new_fs_data->capacity < fs_data->capacity) {
-        // Resize the vector
-        size_t capacity = new_fs_data->capacity;
-
-        struct File_Descriptor *new_vector = realloc(
-            new_fs_data->descriptors_vector, fs_data->capacity * sizeof(struct File_Descriptor));
-        if (new_vector == NULL) {
-            remove_task_from_group(for_task, new_fs_data->fs_consumer_id);
-            destroy_filesystem(new_fs_data);
-
-            if (!exclusive)
-                pthread_spin_unlock(&fs_data->lock);
-
-            errno = ENOMEM;
-            return -1;
-        }
-        new_fs_data->descriptors_vector = new_vector;
-        new_fs_data->capacity           = fs_data->capacity;
-        for (size_t i = capacity; i < new_fs_data->capacity; ++i) {
-            new_fs_data->descriptors_vector[i].used = false;
-        }
-    }
-
-    // Clone tasks
-    size_t i = 0;
-    for (i = 0; i < fs_data->capacity; ++i) {
-        if (fs_data->descriptors_vector[i].used == false) {
-            // If the vector is reserved, it means that the file descriptor was being opened by
-            // another thread. Since it's a race condition, don't clone it.
-            new_fs_data->descriptors_vector[i].used = false;
+    if (!exclusive)
+        pthread_mutex_lock(&fs_data->lock);
+
+    // Start from an empty table of the same size
+    struct Descriptor_Table *table     = fs_data->table;
+    struct Descriptor_Table *new_table = new_fs_data->table;
+    for (size_t i = 0; i < new_table->capacity; ++i) {
+        struct File_Descriptor *d = new_table->slots[i];
+        if (d == NULL)
             continue;
-        }
 
-        struct File_Descriptor fd      = fs_data->descriptors_vector[i];
-        struct File_Descriptor *new_fd = &new_fs_data->descriptors_vector[i];
-
-        new_fd->type    = fd.type;
-        new_fd->used    = true;
-        new_fd->flags   = fd.flags;
-        new_fd->adaptor = fd.adaptor;
-
-        result = fd.adaptor->clone(&fd.data, &new_fd->data);
-        if (result != SUCCESS) {
-            // Handle error
-            remove_task_from_group(for_task, new_fs_data->fs_consumer_id);
-            remove_task_from_group(TASK_ID_SELF, new_fs_data->fs_consumer_id);
-            destroy_filesystem(new_fs_data);
+        d->adaptor->free(&d->data);
+        d->refcount                   = 0;
+        d->next_free                  = new_fs_data->free_descriptors;
+        new_fs_data->free_descriptors = d;
+        new_table->slots[i]           = NULL;
+        unmark_fd(new_fs_data, i);
+        --new_fs_data->count;
+    }
+
+    // The new data is not shared yet, so its lock is only taken by the functions installing the
+    // descriptors
+    if (new_table->capacity < table->capacity && grow_table(new_fs_data, table->capacity) < 0)
+        goto error;
+
+    for (size_t i = 0; i < table->capacity; ++i) {
+        // If the slot is reserved but empty, it means that the file descriptor was being opened
+        // by another thread. Since it's a race condition, don't clone it.
+        struct File_Descriptor *fd = table->slots[i];
+        if (fd == NULL)
+            continue;
 
-            if (!exclusive)
-                pthread_spin_unlock(&fs_data->lock);
+        union File_Data data;
+        if (fd->adaptor->clone(&fd->data, &data) < 0)
+            goto error;
 
-            errno = -result;
-            return -1;
+        mark_fd(new_fs_data, i);
+        if (install_descriptor(new_fs_data, i, fd->type, fd->flags, fd->adaptor, &data) < 0) {
+            fd->adaptor->free(&data);
+            goto error;
         }
-
-        new_fs_data->count++;
-    }
-
-    for (; i < new_fs_data->capacity; ++i) {
-        new_fs_data->descriptors_vector[i].used = false;
     }
 
     if (!exclusive)
-        pthread_spin_unlock(&fs_data->lock);
+        pthread_mutex_unlock(&fs_data->lock);
 
     // Remove self from the group
     remove_task_from_group(TASK_ID_SELF, new_fs_data->fs_consumer_id);
 
     *new_data = new_fs_data;
     return 0;
+
+error:
+    if (!exclusive)
+        pthread_mutex_unlock(&fs_data->lock);
+
+    int saved_errno = errno;
+    remove_task_from_group(for_task, new_fs_data->fs_consumer_id);
+    remove_task_from_group(TASK_ID_SELF, new_fs_data->fs_consumer_id);
+    destroy_filesystem(new_fs_data);
+    errno = saved_errno;
+    return -1;
 }
 
 void __libc_fixup_fs_post_fork(struct Filesystem_Data *child_data)
@@ -919,7 +987,7 @@ void __libc_fixup_fs_post_fork(struct Filesystem_Data *child_data)
     else
         pthread_spin_unlock(&fs_data_lock);
 
-    fs_data = child_data;
+    __atomic_store_n(&fs_data, child_data, __ATOMIC_RELEASE);
 
     // Fixup the reply port
     struct uthread *current = __get_tls();
@@ -940,7 +1008,7 @@ void __libc_fs_lock_pre_fork()
         pthread_spin_unlock(&fs_data_lock);
     }
 
-    pthread_spin_lock(&fs_data->lock);
+    pthread_mutex_lock(&fs_data->lock);
 }
 
 void __libc_fs_unlock_post_fork()
@@ -948,47 +1016,22 @@ void __libc_fs_unlock_post_fork()
     if (fs_data == NULL)
         pthread_spin_unlock(&fs_data_lock);
     else
-        pthread_spin_unlock(&fs_data->lock);
+        pthread_mutex_unlock(&fs_data->lock);
 }
 
 ssize_t __write_internal(long int fd, const void *buf, size_t c, size_t _offset, bool inc_offset)
 {
-    // Double-checked locking to initialize fs_data if it is NULL
-    if (fs_data == NULL) {
-        pthread_spin_lock(&fs_data_lock);
-        if (fs_data == NULL) {
-            struct Filesystem_Data *new_fs_data = init_filesystem();
-            if (new_fs_data == NULL) {
-                pthread_spin_unlock(&fs_data_lock);
-                return -1;
-            }
-            fs_data = new_fs_data;
-        }
-        pthread_spin_unlock(&fs_data_lock);
-    }
-
-    // Lock the file descriptor to ensure thread-safety
-    pthread_spin_lock(&fs_data->lock);
-
-    // Check if the file descriptor is valid
-    if (fd < 0 || fd >= fs_data->capacity) {
-        errno = EBADF; // Bad file descriptor
+    struct File_Descriptor *d = get_descriptor(fd);
+    if (!d)
         return -1;
-    }
 
-    // Obtain the file descriptor data
-    struct File_Descriptor file_desc = fs_data->descriptors_vector[fd];
+    bool locked    = lock_position(d, inc_offset);
+    ssize_t result = d->adaptor->write(&d->data, buf, c, _offset, inc_offset);
+    if (locked)
+        pthread_mutex_unlock(&d->pos_lock);
 
-    // Unlock the file descriptor
-    pthread_spin_unlock(&fs_data->lock);
-
-    // Check if the file descriptor is in use and reserved
-    if (!file_desc.used) {
-        errno = EBADF; // Bad file descriptor
-        return -1;
-    }
-
-    return file_desc.adaptor->write(&file_desc.data, buf, c, _offset, inc_offset);
+    put_descriptor_keep_errno(d);
+    return result;
 }
 
 ssize_t write(int fd, const void *buf, size_t count)
@@ -998,25 +1041,16 @@ ssize_t write(int fd, const void *buf, size_t count)
 
 ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
 {
-    if (ensure_fs_initialization() < 0)
+    struct File_Descriptor *d = get_descriptor(fd);
+    if (!d)
         return -1;
 
-    pthread_spin_lock(&fs_data->lock);
-
-    // Check if the file descriptor is valid
-    if (fd < 0 || fd >= fs_data->capacity) {
-        errno = EBADF; // Bad file descriptor
-        return -1;
-    }
-
-    struct File_Descriptor file_desc = fs_data->descriptors_vector[fd];
+    // Also keeps the vectors of the concurrent calls from interleaving
+    bool locked    = lock_position(d, true);
+    ssize_t result = d->adaptor->writev(&d->data, iov, iovcnt, 0, true);
+    if (locked)
+        pthread_mutex_unlock(&d->pos_lock);
 
-    pthread_spin_unlock(&fs_data->lock);
-
-    if (!file_desc.used) {
-        errno = EBADF; // Bad file descriptor
-        return -1;
-    }
-
-    return file_desc.adaptor->writev(&file_desc.data, iov, iovcnt, 0, true);
+    put_descriptor_keep_errno(d);
+    return result;
 }
\ No newline at end of file
@@ -34,9 +34,18 @@
 #include <stddef.h>
 #include <stdint.h>
 
+struct File_Read_Window;
+
 struct File {
     pmos_right_t file_op_right;
     pmos_right_t io_right;
+
+    /// Flags reported by the filesystem when opening the file (IPC_FS_FLAG_*)
+    uint16_t fs_flags;
+
+    /// Memory shared with the server for IPC_Read_Shared. NULL if the server doesn't support it.
+    /// The descriptors are copied when used, so the state must live outside of this structure.
+    struct File_Read_Window *read_window;
 };
 
 struct IPC_Queue {
@@ -44,35 +53,81 @@ struct IPC_Queue {
     char *name;
 };
 
+struct Epoll_Instance;
+
+struct Epoll_Descriptor {
+    /// Shared by the duplicated descriptors
+    struct Epoll_Instance *instance;
+};
+
 union File_Data {
     struct File file;
     struct IPC_Queue ipc_queue;
+    struct Epoll_Descriptor epoll;
 };
 
+/**
+ * @brief Open descriptor, shared by the table and the calls using it
+ *
+ * The table holds a reference, and so does each operation in progress, so closing the descriptor
+ * only frees it once they are done. The objects are pooled and reused, but never freed while the
+ * table exists, so the lookups can take a reference without locking and then check that the
+ * object still is the one in the slot.
+ */
 struct File_Descriptor {
-    bool used;
+    size_t refcount;
+
     uint8_t flags;
     uint8_t type;
 
+    /// Serializes the operations updating the file position
+    pthread_mutex_t pos_lock;
+
     const struct Filesystem_Adaptor *adaptor;
     union File_Data data;
+
+    /// Next object in the pool
+    struct File_Descriptor *next_free;
+};
+
+/// Array of the descriptors. It is replaced when growing, and the old arrays are kept until the
+/// filesystem data is destroyed, since the lookups might still be reading them.
+struct Descriptor_Table {
+    size_t capacity;
+    struct Descriptor_Table *previous;
+    struct File_Descriptor *slots[];
 };
 
+struct Descriptor_Chunk;
+
 enum Desctiptor_Type {
     DESCRIPTOR_FILE,
     DESCRIPTOR_LOGGER,
     DESCRIPTOR_IPC_QUEUE,
+    DESCRIPTOR_EPOLL,
 };
 
 struct Filesystem_Data {
-    struct File_Descriptor *descriptors_vector;
+    /// Current table, read without the lock
+    struct Descriptor_Table *table;
+
+    /// Allocated descriptors (installed or reserved), one bit per descriptor
+    uint64_t *open_fds;
+    /// Words of open_fds with all of the bits set, so the lowest free descriptor is found without
+    /// scanning the whole table
+    uint64_t *full_words;
+
+    /// Number of installed descriptors
     size_t count;
-    size_t capacity;
-    size_t reserved_count;
+
+    /// Pool of the descriptor objects
+    struct File_Descriptor *free_descriptors;
+    struct Descriptor_Chunk *chunks;
 
     uint64_t fs_consumer_id;
 
-    pthread_spinlock_t lock;
+    /// Protects the modifications of the table and the pool
+    pthread_mutex_t lock;
 };
 
 /**
@@ -29,6 +29,7 @@
 #ifndef FILESYSTEM_ADAPTORS_H
 #define FILESYSTEM_ADAPTORS_H
 
+#include <pmos/system.h>
 #include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -46,6 +47,33 @@ typedef ssize_t(filesize_func)(void *file_data);
 typedef ssize_t(writev_func)(void *file_data, const struct iovec *iov,
                              int iovcnt, size_t offset, bool seek);
 
+/// @brief Function returning the memory object backing the file, for mmap()
+///
+/// On success, *object_right is a right to the object owned by the caller and *object_size is its
+/// size. *sync_right is set to a new right accepting IPC_Msync, or INVALID_RIGHT if the writes
+/// don't need to be synchronized. NULL in the adaptors of the descriptors that can't be mapped.
+typedef int(mmap_func)(void *file_data, int prot, int flags, pmos_right_t *object_right,
+                       size_t *object_size, pmos_right_t *sync_right);
+
+/// @brief Function reporting the readiness of the descriptor, for poll() and epoll
+///
+/// Sets *revents to the ready subset of events (POLL*), plus POLLHUP and POLLERR. If notify_port
+/// is not INVALID_PORT, also registers the interest in the events, so that IPC_Poll_Notify with the
+/// given cookie is sent to the port each time one of them becomes ready. *notify_id is then the
+/// receive right of the notifications, which cancels the interest when deleted, or INVALID_RIGHT if
+/// the readiness never changes. NULL in the adaptors of the descriptors that are always ready.
+typedef int(poll_func)(void *file_data, uint32_t events, pmos_port_t notify_port, uint64_t cookie,
+                       pmos_right_t *notify_id, uint32_t *revents);
+
+/// @brief Function sending a positional read or write without waiting for the reply, for the
+/// asynchronous I/O
+///
+/// The reply (IPC_Read_Reply or IPC_Write_Reply) is sent to reply_port, with *reply_id as its
+/// sent_with_right. For the writes, buf can be reused once the function returns. NULL in the
+/// adaptors of the descriptors only supporting the synchronous I/O.
+typedef int(submit_io_func)(void *file_data, bool write, const void *buf, size_t count,
+                            size_t offset, pmos_port_t reply_port, pmos_right_t *reply_id);
+
 /// @brief Function to free the file data.
 ///
 /// This function must free all the memory associated with the given file data.
@@ -73,6 +101,9 @@ struct Filesystem_Adaptor {
     isseekable_func *isseekable;
     filesize_func *filesize;
     free_func *free;
+    mmap_func *mmap;
+    poll_func *poll;
+    submit_io_func *submit_io;
 };
 
 #endif // FILESYSTEM_ADAPTORS_H
\ No newline at end of file
@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <poll.h>
 #include <pmos/ipc.h>
 #include <pmos/ports.h>
 #include <pmos/system.h>
@@ -206,6 +207,15 @@ int __ipc_queue_isseekable(void *file_data) { return 0; }
 
 ssize_t __ipc_queue_filesize(void *file_data) { return 0; }
 
+int __ipc_queue_poll(void *file_data, uint32_t events, pmos_port_t /* notify_port */,
+                     uint64_t /* cookie */, pmos_right_t *notify_id, uint32_t *revents)
+{
+    // The messages can always be sent, and the queues can't be read
+    *revents   = events & (POLLOUT | POLLWRNORM);
+    *notify_id = INVALID_RIGHT;
+    return 0;
+}
+
 void __ipc_queue_free(void *file_data)
 {
     struct IPC_Queue *q = (struct IPC_Queue *)file_data;
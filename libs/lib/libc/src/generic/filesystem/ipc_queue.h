@@ -43,6 +43,7 @@ extern isatty_func __ipc_queue_isatty;
 extern isseekable_func __ipc_queue_isseekable;
 extern filesize_func __ipc_queue_filesize;
 extern free_func __ipc_queue_free;
+extern poll_func __ipc_queue_poll;
 
 static struct Filesystem_Adaptor __ipc_queue_adaptor = {
     .read       = &__ipc_queue_read,
@@ -55,6 +56,7 @@ static struct Filesystem_Adaptor __ipc_queue_adaptor = {
     .isseekable = &__ipc_queue_isseekable,
     .filesize   = &__ipc_queue_filesize,
     .free       = &__ipc_queue_free,
+    .poll       = &__ipc_queue_poll,
 };
 
 /// Initializes the descriptor to the IPC queue with the given name
@@ -0,0 +1,35 @@
+#ifndef DLMALLOC_H
+#define DLMALLOC_H
+
+#include <malloc.h>
+#include <stddef.h>
+
+// The heap, implemented by dlmalloc in malloc.c. Its chunks carry footers, so dlfree() and
+// dlrealloc() work on the memory of any mspace.
+
+typedef void *mspace;
+
+void *dlmalloc(size_t size);
+void dlfree(void *ptr);
+void *dlcalloc(size_t nmemb, size_t size);
+void *dlrealloc(void *ptr, size_t size);
+void *dlmemalign(size_t alignment, size_t size);
+void *dlvalloc(size_t size);
+void *dlpvalloc(size_t size);
+size_t dlmalloc_usable_size(void *ptr);
+size_t dlbulk_free(void **array, size_t nelem);
+struct mallinfo dlmallinfo(void);
+int dlmallopt(int param, int value);
+int dlmalloc_trim(size_t pad);
+void dlmalloc_stats(void);
+
+mspace create_mspace(size_t capacity, int locked);
+void *mspace_malloc(mspace msp, size_t size);
+void *mspace_calloc(mspace msp, size_t nmemb, size_t size);
+void *mspace_memalign(mspace msp, size_t alignment, size_t size);
+size_t mspace_bulk_free(mspace msp, void **array, size_t nelem);
+struct mallinfo mspace_mallinfo(mspace msp);
+int mspace_trim(mspace msp, size_t pad);
+void mspace_malloc_stats(mspace msp);
+
+#endif // DLMALLOC_H
@@ -534,6 +534,12 @@ void *__request_mem_b(unsigned long bytes);
 
 #define LACKS_SYS_PARAM_H 1
 
+/* The public functions are the thread caching front end in thread_cache.c */
+#define USE_DL_PREFIX 1
+#define MSPACES 1
+#include <malloc.h>
+#define STRUCT_MALLINFO_DECLARED 1
+
 /* Version identifier to allow people to support multiple versions */
 #ifndef DLMALLOC_VERSION
 #define DLMALLOC_VERSION 20806
@@ -934,7 +940,6 @@ DLMALLOC_EXPORT void* dlrealloc_in_place(void*, size_t);
   Overreliance on memalign is a sure way to fragment space.
 */
 DLMALLOC_EXPORT void* dlmemalign(size_t, size_t);
-DLMALLOC_EXPORT void* aligned_alloc(size_t, size_t);
 
 /*
   int posix_memalign(void** pp, size_t alignment, size_t n);
@@ -5295,9 +5300,6 @@ void* dlmemalign(size_t alignment, size_t bytes) {
   return internal_memalign(gm, alignment, bytes);
 }
 
-void* aligned_alloc(size_t alignment, size_t bytes)
-  __attribute__((alias("memalign")));
-
 int dlposix_memalign(void** pp, size_t alignment, size_t bytes) {
   void* mem = 0;
   if (alignment == MALLOC_ALIGNMENT)
@@ -0,0 +1,446 @@
+#include "dlmalloc.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Thread caching front end of the heap. The small blocks freed by a thread are kept in its cache
+// and handed out to its next allocations of the same size class, without taking the heap lock.
+// The blocks that stay unused are periodically given back to the heap, and the whole cache is
+// emptied when the thread exits.
+
+#define TCACHE_GRANULE   16
+#define TCACHE_MAX_SIZE  1024
+#define TCACHE_BINS      (TCACHE_MAX_SIZE / TCACHE_GRANULE + 1)
+#define TCACHE_MAX_LIMIT 256
+
+#define TCACHE_DEFAULT_LIMIT 16
+
+// Number of frees into the cache between the returns of the unused blocks
+#define TCACHE_GC_INTERVAL 4096
+
+struct tcache;
+
+struct tcache_block {
+    struct tcache_block *next;
+    // Owning cache while the block is cached, to catch double frees
+    struct tcache *key;
+};
+
+struct tcache_bin {
+    struct tcache_block *head;
+    // Read by mallinfo() from the other threads
+    unsigned count;
+    // Lowest count since the last collection; that many blocks weren't needed in the meantime
+    unsigned low_water;
+};
+
+// Heap of a thread with M_THREAD_MSPACES. The memory can still be in use after the thread exits,
+// so the heaps are never destroyed but are reused by the new threads.
+struct thread_heap {
+    mspace msp;
+    bool in_use;
+    struct thread_heap *next;
+};
+
+enum {
+    TCACHE_UNINITIALIZED = 0,
+    TCACHE_ACTIVE,
+    // The thread is exiting, everything goes straight to the heap
+    TCACHE_DISABLED,
+};
+
+struct tcache {
+    struct tcache_bin bins[TCACHE_BINS];
+    int state;
+    unsigned gc_countdown;
+    // Own heap of the thread, NULL if it uses the global one
+    mspace msp;
+    struct thread_heap *heap;
+    struct tcache *next;
+    struct tcache *prev;
+};
+
+static __thread struct tcache tcache;
+
+static unsigned tcache_limit = TCACHE_DEFAULT_LIMIT;
+static bool thread_mspaces   = false;
+
+// Protects the lists of caches and heaps
+static pthread_mutex_t registry_lock  = PTHREAD_MUTEX_INITIALIZER;
+static struct tcache *caches          = NULL;
+static struct thread_heap *heaps      = NULL;
+
+static inline size_t size_class(size_t size)
+{
+    return size ? (size + TCACHE_GRANULE - 1) / TCACHE_GRANULE : 1;
+}
+
+static inline void set_count(struct tcache_bin *bin, unsigned count)
+{
+    __atomic_store_n(&bin->count, count, __ATOMIC_RELAXED);
+}
+
+static struct thread_heap *acquire_heap(void)
+{
+    for (struct thread_heap *h = heaps; h; h = h->next) {
+        if (!h->in_use) {
+            h->in_use = true;
+            return h;
+        }
+    }
+
+    struct thread_heap *h = dlmalloc(sizeof(*h));
+    if (!h)
+        return NULL;
+
+    // Locked, since the other threads free into it
+    h->msp = create_mspace(0, 1);
+    if (!h->msp) {
+        dlfree(h);
+        return NULL;
+    }
+
+    h->in_use = true;
+    h->next   = heaps;
+    heaps     = h;
+    return h;
+}
+
+static struct tcache *tcache_init(struct tcache *tc)
+{
+    if (tc->state == TCACHE_DISABLED || !__atomic_load_n(&tcache_limit, __ATOMIC_RELAXED))
+        return NULL;
+
+    pthread_mutex_lock(&registry_lock);
+    if (__atomic_load_n(&thread_mspaces, __ATOMIC_RELAXED)) {
+        // Falls back to the global heap if it can't be created
+        tc->heap = acquire_heap();
+        tc->msp  = tc->heap ? tc->heap->msp : NULL;
+    }
+
+    tc->prev = NULL;
+    tc->next = caches;
+    if (caches)
+        caches->prev = tc;
+    caches = tc;
+    pthread_mutex_unlock(&registry_lock);
+
+    tc->gc_countdown = TCACHE_GC_INTERVAL;
+    tc->state        = TCACHE_ACTIVE;
+    return tc;
+}
+
+static inline struct tcache *get_tcache(void)
+{
+    struct tcache *tc = &tcache;
+    if (__builtin_expect(tc->state != TCACHE_ACTIVE, 0))
+        return tcache_init(tc);
+    return tc;
+}
+
+static void release_blocks(struct tcache *tc, void **blocks, size_t count)
+{
+    // The blocks of the other heaps are left in the array
+    size_t left = tc->msp ? mspace_bulk_free(tc->msp, blocks, count) : dlbulk_free(blocks, count);
+    for (size_t i = 0; left && i < count; ++i) {
+        if (blocks[i]) {
+            dlfree(blocks[i]);
+            --left;
+        }
+    }
+}
+
+// Returns count blocks of the bin to the heap
+static void flush_bin(struct tcache *tc, struct tcache_bin *bin, unsigned count)
+{
+    void *blocks[TCACHE_MAX_LIMIT];
+    unsigned n = 0;
+    while (n < count && bin->head) {
+        struct tcache_block *b = bin->head;
+        bin->head              = b->next;
+        blocks[n++]            = b;
+    }
+
+    set_count(bin, bin->count - n);
+    if (bin->low_water > bin->count)
+        bin->low_water = bin->count;
+
+    if (n)
+        release_blocks(tc, blocks, n);
+}
+
+static void tcache_gc(struct tcache *tc)
+{
+    tc->gc_countdown = TCACHE_GC_INTERVAL;
+    for (size_t i = 1; i < TCACHE_BINS; ++i) {
+        struct tcache_bin *bin = &tc->bins[i];
+        // Half of the idle blocks, so the bins of the sizes no longer used shrink gradually
+        unsigned idle = (bin->low_water + 1) / 2;
+        if (idle)
+            flush_bin(tc, bin, idle);
+        bin->low_water = bin->count;
+    }
+}
+
+static void tcache_flush_all(struct tcache *tc)
+{
+    for (size_t i = 1; i < TCACHE_BINS; ++i)
+        flush_bin(tc, &tc->bins[i], tc->bins[i].count);
+}
+
+__attribute__((noreturn)) static void double_free(void)
+{
+    static const char msg[] = "pmOS libC: double free detected\n";
+    fputs(msg, stderr);
+    abort();
+}
+
+static void check_double_free(struct tcache_bin *bin, struct tcache_block *block)
+{
+    // The key can also be left over from the user's data, so the bin is searched to be sure
+    for (struct tcache_block *b = bin->head; b; b = b->next)
+        if (b == block)
+            double_free();
+}
+
+/// Called on thread exit after the destructors have run
+void __malloc_thread_exit(void)
+{
+    struct tcache *tc = &tcache;
+    if (tc->state == TCACHE_ACTIVE) {
+        tcache_flush_all(tc);
+
+        pthread_mutex_lock(&registry_lock);
+        if (tc->prev)
+            tc->prev->next = tc->next;
+        else
+            caches = tc->next;
+        if (tc->next)
+            tc->next->prev = tc->prev;
+
+        if (tc->heap)
+            tc->heap->in_use = false;
+        pthread_mutex_unlock(&registry_lock);
+    }
+
+    tc->heap  = NULL;
+    tc->msp   = NULL;
+    tc->state = TCACHE_DISABLED;
+}
+
+static inline void *heap_malloc(size_t size)
+{
+    mspace msp = tcache.msp;
+    return msp ? mspace_malloc(msp, size) : dlmalloc(size);
+}
+
+void *malloc(size_t size)
+{
+    if (size <= TCACHE_MAX_SIZE) {
+        struct tcache *tc = get_tcache();
+        if (tc) {
+            size_t idx             = size_class(size);
+            struct tcache_bin *bin = &tc->bins[idx];
+            struct tcache_block *b = bin->head;
+            if (b) {
+                bin->head = b->next;
+                b->key    = NULL;
+                set_count(bin, bin->count - 1);
+                if (bin->count < bin->low_water)
+                    bin->low_water = bin->count;
+                return b;
+            }
+
+            // Allocate the whole class, so the block returns to this bin once freed
+            size = idx * TCACHE_GRANULE;
+        }
+    }
+
+    return heap_malloc(size);
+}
+
+void free(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    size_t idx = dlmalloc_usable_size(ptr) / TCACHE_GRANULE;
+    if (idx > 0 && idx < TCACHE_BINS) {
+        struct tcache *tc = get_tcache();
+        if (tc) {
+            struct tcache_bin *bin   = &tc->bins[idx];
+            struct tcache_block *blk = ptr;
+            if (__builtin_expect(blk->key == tc, 0))
+                check_double_free(bin, blk);
+
+            unsigned limit = __atomic_load_n(&tcache_limit, __ATOMIC_RELAXED);
+            if (__builtin_expect(bin->count >= limit, 0)) {
+                flush_bin(tc, bin, bin->count - limit / 2);
+                if (!limit) {
+                    release_blocks(tc, &ptr, 1);
+                    return;
+                }
+            }
+
+            blk->key  = tc;
+            blk->next = bin->head;
+            bin->head = blk;
+            set_count(bin, bin->count + 1);
+
+            if (--tc->gc_countdown == 0)
+                tcache_gc(tc);
+            return;
+        }
+    }
+
+    dlfree(ptr);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    size_t bytes;
+    if (__builtin_mul_overflow(nmemb, size, &bytes)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (bytes <= TCACHE_MAX_SIZE) {
+        void *p = malloc(bytes);
+        if (p)
+            memset(p, 0, bytes);
+        return p;
+    }
+
+    mspace msp = tcache.msp;
+    return msp ? mspace_calloc(msp, nmemb, size) : dlcalloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (!ptr)
+        return malloc(size);
+
+    // Left to the heap of the block, which resizes it in place when possible
+    return dlrealloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    mspace msp = tcache.msp;
+    return msp ? mspace_memalign(msp, alignment, size) : dlmemalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void *) || alignment & (alignment - 1) || !alignment)
+        return EINVAL;
+
+    void *p = memalign(alignment, size);
+    if (!p)
+        return ENOMEM;
+
+    *memptr = p;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    if (alignment & (alignment - 1) || !alignment) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return memalign(alignment, size);
+}
+
+void *valloc(size_t size) { return dlvalloc(size); }
+
+void *pvalloc(size_t size) { return dlpvalloc(size); }
+
+size_t malloc_usable_size(void *ptr) { return ptr ? dlmalloc_usable_size(ptr) : 0; }
+
+int mallopt(int param, int value)
+{
+    switch (param) {
+        case M_THREAD_CACHE:
+            if (value < 0 || value > TCACHE_MAX_LIMIT)
+                return 0;
+            __atomic_store_n(&tcache_limit, value, __ATOMIC_RELAXED);
+            return 1;
+        case M_THREAD_MSPACES:
+            __atomic_store_n(&thread_mspaces, value != 0, __ATOMIC_RELAXED);
+            return 1;
+        default:
+            return dlmallopt(param, value);
+    }
+}
+
+struct mallinfo mallinfo(void)
+{
+    struct mallinfo info = dlmallinfo();
+    size_t cached_blocks = 0;
+    size_t cached_bytes  = 0;
+
+    pthread_mutex_lock(&registry_lock);
+    for (struct thread_heap *h = heaps; h; h = h->next) {
+        struct mallinfo m = mspace_mallinfo(h->msp);
+        info.arena += m.arena;
+        info.ordblks += m.ordblks;
+        info.hblkhd += m.hblkhd;
+        info.usmblks += m.usmblks;
+        info.uordblks += m.uordblks;
+        info.fordblks += m.fordblks;
+        info.keepcost += m.keepcost;
+    }
+
+    // The blocks in the caches are allocated as far as the heap is concerned. Their exact sizes
+    // aren't tracked, so the smallest size of their class is counted.
+    for (struct tcache *tc = caches; tc; tc = tc->next) {
+        for (size_t i = 1; i < TCACHE_BINS; ++i) {
+            size_t count = __atomic_load_n(&tc->bins[i].count, __ATOMIC_RELAXED);
+            cached_blocks += count;
+            cached_bytes += count * i * TCACHE_GRANULE;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (cached_bytes > info.uordblks)
+        cached_bytes = info.uordblks;
+
+    info.smblks = cached_blocks;
+    info.fsmblks = cached_bytes;
+    info.uordblks -= cached_bytes;
+    info.fordblks += cached_bytes;
+    return info;
+}
+
+int malloc_trim(size_t pad)
+{
+    if (tcache.state == TCACHE_ACTIVE)
+        tcache_flush_all(&tcache);
+
+    int released = dlmalloc_trim(pad);
+
+    pthread_mutex_lock(&registry_lock);
+    for (struct thread_heap *h = heaps; h; h = h->next)
+        released |= mspace_trim(h->msp, pad);
+    pthread_mutex_unlock(&registry_lock);
+
+    return released;
+}
+
+void malloc_stats(void)
+{
+    dlmalloc_stats();
+
+    pthread_mutex_lock(&registry_lock);
+    for (struct thread_heap *h = heaps; h; h = h->next)
+        mspace_malloc_stats(h->msp);
+    pthread_mutex_unlock(&registry_lock);
+}
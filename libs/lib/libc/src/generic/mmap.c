@@ -27,29 +27,124 @@
  */
 
 #include <errno.h>
+#include <pmos/helpers.h>
+#include <pmos/ipc.h>
 #include <pmos/memory.h>
+#include <pmos/ports.h>
+#include <pmos/system.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <sys/mman.h>
 #include <stdio.h>
 
-void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+int __mmap_descriptor(int fd, int prot, int flags, pmos_right_t *object_right,
+                      size_t *object_size, pmos_right_t *sync_right);
+pmos_port_t prepare_reply_port();
+
+/// Shared writable mapping of a file, which has to be written back by msync()
+struct file_mapping {
+    struct file_mapping *next;
+    uintptr_t start;
+    size_t length;
+    /// Offset in the file of the start of the mapping
+    off_t offset;
+    /// Right to the file, accepting IPC_Msync
+    pmos_right_t sync_right;
+};
+
+static struct file_mapping *file_mappings = NULL;
+static pthread_mutex_t file_mappings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *map_file(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
-    // TODO: mmap can probably be fully implemented soon!
-    (void)fd;
-    (void)offset;
-
-    if (!(flags & MAP_ANONYMOUS)) {
-        // Not supported
-        // (although infrastructure for it is mostly there :) )
-        fprintf(stderr, "pmOS libc: mmap: MAP_ANONYMOUS is the only supported flag. Flags: 0x%u\n", flags);
-        errno = ENOTSUP;
+    int type = flags & (MAP_SHARED | MAP_PRIVATE);
+    if (type != MAP_SHARED && type != MAP_PRIVATE) {
+        errno = EINVAL;
+        return MAP_FAILED;
+    }
+
+    if (offset < 0 || (offset & (PAGE_SIZE - 1))) {
+        errno = EINVAL;
+        return MAP_FAILED;
+    }
+
+    size_t aligned_length = (length + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    struct file_mapping *mapping = NULL;
+    pmos_right_t object_right, sync_right;
+    size_t object_size;
+    if (__mmap_descriptor(fd, prot, flags, &object_right, &object_size, &sync_right) < 0)
         return MAP_FAILED;
+
+    if (sync_right != INVALID_RIGHT) {
+        mapping = malloc(sizeof(*mapping));
+        if (!mapping) {
+            errno = ENOMEM;
+            goto error;
+        }
     }
 
+    // The shared mappings reference the object directly, and accessing the pages past its end is
+    // an error. The private ones copy the pages on write, and are filled with zeroes past the end
+    // of the object.
+    size_t copied = 0;
+    if ((size_t)offset < object_size)
+        copied = object_size - offset < aligned_length ? object_size - offset : aligned_length;
+
+    map_mem_object_param_t params = {
+        .page_table_id   = PAGE_TABLE_SELF,
+        .object_right    = object_right,
+        .addr_start_uint = (uintptr_t)addr,
+        .size            = aligned_length,
+        .offset_object   = offset,
+        .offset_start    = 0,
+        .object_size     = type == MAP_SHARED ? aligned_length : copied,
+        .access_flags    = (prot & (PROT_READ | PROT_WRITE | PROT_EXEC)) |
+                        (flags & MAP_FIXED ? CREATE_FLAG_FIXED : 0) |
+                        (type == MAP_PRIVATE ? CREATE_FLAG_COW : 0),
+    };
+
+    mem_request_ret_t req = map_mem_object(&params);
+    if (req.result != SUCCESS) {
+        errno = req.result == -ENOMEM ? ENOMEM : EINVAL;
+        goto error;
+    }
+
+    // The region keeps the object alive
+    delete_right(object_right);
+
+    if (mapping) {
+        mapping->start      = (uintptr_t)req.virt_addr;
+        mapping->length     = aligned_length;
+        mapping->offset     = offset;
+        mapping->sync_right = sync_right;
+
+        pthread_mutex_lock(&file_mappings_lock);
+        mapping->next = file_mappings;
+        file_mappings = mapping;
+        pthread_mutex_unlock(&file_mappings_lock);
+    }
+
+    return (void *)req.virt_addr;
+error:
+    free(mapping);
+    delete_right(object_right);
+    if (sync_right != INVALID_RIGHT)
+        delete_right(sync_right);
+    return MAP_FAILED;
+}
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
     if (length == 0) {
         errno = EINVAL;
         return MAP_FAILED;
     }
 
+    if (!(flags & MAP_ANONYMOUS))
+        return map_file(addr, length, prot, flags, fd, offset);
+
     // Align length to page size
     size_t aligned_length = (length + 4095) & ~4095UL;
 
@@ -75,12 +170,138 @@ void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 //     return 0;
 // }
 
+/// Forgets the part of the file mappings in [start, end). Must be called with the lock held.
+static void forget_file_mappings(uintptr_t start, uintptr_t end)
+{
+    struct file_mapping **p = &file_mappings;
+    while (*p) {
+        struct file_mapping *m = *p;
+        uintptr_t m_end        = m->start + m->length;
+
+        if (m_end <= start || m->start >= end) {
+            p = &m->next;
+            continue;
+        }
+
+        if (m->start >= start && m_end <= end) {
+            // Fully unmapped
+            *p = m->next;
+            delete_right(m->sync_right);
+            free(m);
+            continue;
+        }
+
+        if (m->start < start && m_end > end) {
+            // Hole in the middle. Keep the tail as a new mapping, if there is enough memory for
+            // it, otherwise it won't be synced.
+            struct file_mapping *tail = malloc(sizeof(*tail));
+            right_request_t dup       = tail ? dup_right(m->sync_right) : (right_request_t) {};
+            if (tail && dup.result == SUCCESS) {
+                tail->start      = end;
+                tail->length     = m_end - end;
+                tail->offset     = m->offset + (end - m->start);
+                tail->sync_right = dup.right;
+                tail->next       = m->next;
+                m->next          = tail;
+            } else {
+                free(tail);
+            }
+            m->length = start - m->start;
+        } else if (m->start < start) {
+            m->length = start - m->start;
+        } else {
+            m->offset += end - m->start;
+            m->length = m_end - end;
+            m->start  = end;
+        }
+
+        p = &m->next;
+    }
+}
+
 int munmap(void *addr, size_t length)
 {
     result_t r = release_memory_range(0, addr, length);
-    if (r == SUCCESS)
-        return 0;
+    if (r != SUCCESS) {
+        errno = -r;
+        return -1;
+    }
+
+    pthread_mutex_lock(&file_mappings_lock);
+    if (file_mappings)
+        forget_file_mappings((uintptr_t)addr, (uintptr_t)addr + length);
+    pthread_mutex_unlock(&file_mappings_lock);
+
+    return 0;
+}
+
+static int sync_range(pmos_right_t sync_right, off_t offset, size_t size, int flags)
+{
+    pmos_port_t reply_port = prepare_reply_port();
+    if (reply_port == INVALID_PORT)
+        return -1;
+
+    IPC_Msync message = {
+        .type   = IPC_Msync_NUM,
+        .flags  = flags & (MS_SYNC | MS_ASYNC),
+        .offset = offset,
+        .size   = size,
+    };
+
+    right_request_t send_result =
+        send_message_right(sync_right, reply_port, &message, sizeof(message), NULL, 0);
+    if (send_result.result != SUCCESS) {
+        errno = EIO;
+        return -1;
+    }
 
-    errno = -r;
-    return -1;
-}
\ No newline at end of file
+    Message_Descriptor reply_descr;
+    IPC_Generic_Msg *reply_msg;
+    result_t result = get_message(&reply_descr, (unsigned char **)&reply_msg, reply_port, NULL, NULL);
+    if (result != SUCCESS) {
+        errno = EIO;
+        return -1;
+    }
+
+    int ret = 0;
+    if (reply_descr.size < sizeof(IPC_Msync_Reply) || reply_msg->type != IPC_Msync_Reply_NUM) {
+        errno = EIO;
+        ret   = -1;
+    } else if (((IPC_Msync_Reply *)reply_msg)->result_code < 0) {
+        errno = -((IPC_Msync_Reply *)reply_msg)->result_code;
+        ret   = -1;
+    }
+
+    free(reply_msg);
+    return ret;
+}
+
+int msync(void *addr, size_t length, int flags)
+{
+    if (((uintptr_t)addr & (PAGE_SIZE - 1)) || (flags & ~(MS_ASYNC | MS_SYNC | MS_INVALIDATE)) ||
+        ((flags & MS_ASYNC) && (flags & MS_SYNC))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The private and anonymous mappings have nothing to write back, and the shared ones see the
+    // object directly, so MS_INVALIDATE has nothing to do either
+    uintptr_t start = (uintptr_t)addr;
+    uintptr_t end   = start + length;
+    int ret         = 0;
+
+    pthread_mutex_lock(&file_mappings_lock);
+    for (struct file_mapping *m = file_mappings; m; m = m->next) {
+        uintptr_t m_end = m->start + m->length;
+        if (m_end <= start || m->start >= end)
+            continue;
+
+        uintptr_t s = m->start > start ? m->start : start;
+        uintptr_t e = m_end < end ? m_end : end;
+        if (sync_range(m->sync_right, m->offset + (s - m->start), e - s, flags) < 0)
+            ret = -1;
+    }
+    pthread_mutex_unlock(&file_mappings_lock);
+
+    return ret;
+}
@@ -0,0 +1,337 @@
+#include <errno.h>
+#include <pmos/hashmap.h>
+#include <pmos/io_ring.h>
+#include <pmos/ipc.h>
+#include <pmos/ports.h>
+#include <pmos/system.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+int __submit_io_descriptor(int fd, bool write, void *buf, size_t count, size_t offset,
+                           pmos_port_t reply_port, pmos_right_t *reply_id, ssize_t *result);
+
+struct IO_Ring_Request {
+    pmos_hashtable_ll_t ll;
+
+    /// sent_with_right of the reply
+    pmos_right_t reply_id;
+
+    bool write;
+    void *buf;
+    size_t len;
+    uint64_t user_data;
+
+    struct IO_Ring_Request *next_free;
+};
+
+/**
+ * The replies are matched to the requests by the rights they are sent with, so the servers can
+ * answer in any order.
+ *
+ * Each submitted request holds either a request (until the reply arrives) or a completion (until it
+ * is returned), so in_flight.count + cq_count never exceeds the number of entries.
+ */
+struct pmos_io_ring {
+    pmos_port_t port;
+
+    /// Timer for the timeouts of pmos_io_ring_wait(), created on the first use
+    pmos_right_t timer_right;
+
+    unsigned entries;
+
+    /// Requests waiting for the replies, by reply_id
+    pmos_hashtable_t in_flight;
+    struct IO_Ring_Request *requests;
+    struct IO_Ring_Request *free_requests;
+
+    /// Completions which haven't been returned yet, [cq_head, cq_head + cq_count) modulo entries
+    struct pmos_io_cqe *cq;
+    unsigned cq_head;
+    unsigned cq_count;
+};
+
+static size_t request_hash(pmos_hashtable_ll_t *e, size_t size)
+{
+    struct IO_Ring_Request *req = container_of(e, struct IO_Ring_Request, ll);
+    return req->reply_id % size;
+}
+
+static size_t reply_id_hash(void *value, size_t size) { return *(pmos_right_t *)value % size; }
+
+static bool request_equals(pmos_hashtable_ll_t *e, void *value)
+{
+    struct IO_Ring_Request *req = container_of(e, struct IO_Ring_Request, ll);
+    return req->reply_id == *(pmos_right_t *)value;
+}
+
+pmos_io_ring_t *pmos_io_ring_create(unsigned entries)
+{
+    if (entries == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    pmos_io_ring_t *ring = calloc(1, sizeof(*ring));
+    if (!ring)
+        return NULL;
+
+    ring->requests = calloc(entries, sizeof(*ring->requests));
+    ring->cq       = calloc(entries, sizeof(*ring->cq));
+    if (!ring->requests || !ring->cq)
+        goto error;
+
+    if (hasmap_initialize(&ring->in_flight) < 0)
+        goto error;
+
+    ports_request_t port = create_port(TASK_ID_SELF, 0);
+    if (port.result != SUCCESS) {
+        hashtable_destroy(&ring->in_flight);
+        errno = -port.result;
+        goto error;
+    }
+
+    for (unsigned i = 0; i < entries; ++i) {
+        ring->requests[i].next_free = ring->free_requests;
+        ring->free_requests         = &ring->requests[i];
+    }
+
+    ring->port    = port.port;
+    ring->entries = entries;
+    return ring;
+
+error:
+    free(ring->requests);
+    free(ring->cq);
+    free(ring);
+    return NULL;
+}
+
+void pmos_io_ring_destroy(pmos_io_ring_t *ring)
+{
+    if (!ring)
+        return;
+
+    // Also drops the replies which are still coming
+    pmos_delete_port(ring->port);
+    hashtable_destroy(&ring->in_flight);
+    free(ring->requests);
+    free(ring->cq);
+    free(ring);
+}
+
+unsigned pmos_io_ring_pending(const pmos_io_ring_t *ring)
+{
+    return ring->in_flight.count + ring->cq_count;
+}
+
+static void push_completion(pmos_io_ring_t *ring, uint64_t user_data, int64_t result)
+{
+    unsigned idx             = (ring->cq_head + ring->cq_count) % ring->entries;
+    ring->cq[idx].user_data = user_data;
+    ring->cq[idx].result    = result;
+    ++ring->cq_count;
+}
+
+static unsigned pop_completions(pmos_io_ring_t *ring, struct pmos_io_cqe *cqes, unsigned max)
+{
+    unsigned n = 0;
+    for (; n < max && ring->cq_count; ++n) {
+        cqes[n]       = ring->cq[ring->cq_head];
+        ring->cq_head = (ring->cq_head + 1) % ring->entries;
+        --ring->cq_count;
+    }
+    return n;
+}
+
+// Returns true if the request has been sent, or false if it has completed with *result
+static bool submit_one(pmos_io_ring_t *ring, const struct pmos_io_sqe *sqe, int64_t *result)
+{
+    if (sqe->opcode == PMOS_IO_NOP) {
+        *result = 0;
+        return false;
+    }
+
+    if (sqe->opcode != PMOS_IO_READ && sqe->opcode != PMOS_IO_WRITE) {
+        *result = -EINVAL;
+        return false;
+    }
+
+    struct IO_Ring_Request *req = ring->free_requests;
+    req->write                  = sqe->opcode == PMOS_IO_WRITE;
+    req->buf                    = sqe->buf;
+    req->len                    = sqe->len;
+    req->user_data              = sqe->user_data;
+
+    ssize_t sync_result;
+    int r = __submit_io_descriptor(sqe->fd, req->write, sqe->buf, sqe->len, sqe->offset, ring->port,
+                                   &req->reply_id, &sync_result);
+    if (r != 0) {
+        *result = r < 0 || sync_result < 0 ? -errno : sync_result;
+        return false;
+    }
+
+    if (hashmap_add(&ring->in_flight, request_hash, &req->ll) < 0) {
+        // The reply will be dropped when it arrives
+        *result = -errno;
+        return false;
+    }
+
+    ring->free_requests = req->next_free;
+    return true;
+}
+
+int pmos_io_ring_submit(pmos_io_ring_t *ring, const struct pmos_io_sqe *sqes, unsigned count)
+{
+    int saved_errno = errno;
+
+    unsigned i = 0;
+    for (; i < count && pmos_io_ring_pending(ring) < ring->entries; ++i) {
+        int64_t result;
+        if (!submit_one(ring, &sqes[i], &result))
+            push_completion(ring, sqes[i].user_data, result);
+    }
+
+    errno = saved_errno;
+    if (i == 0 && count > 0) {
+        errno = EBUSY;
+        return -1;
+    }
+    return i;
+}
+
+static int64_t reply_result(struct IO_Ring_Request *req, Message_Descriptor *desc, void *msg)
+{
+    IPC_Generic_Msg *m = msg;
+    if (req->write) {
+        if (desc->size < sizeof(IPC_Write_Reply) || m->type != IPC_Write_Reply_NUM)
+            return -EIO;
+
+        IPC_Write_Reply *reply = msg;
+        if (reply->result_code < 0)
+            return reply->result_code;
+        return reply->bytes_written;
+    }
+
+    if (desc->size < offsetof(IPC_Read_Reply, data) || m->type != IPC_Read_Reply_NUM)
+        return -EIO;
+
+    IPC_Read_Reply *reply = msg;
+    if (reply->result_code < 0)
+        return reply->result_code;
+
+    size_t count = desc->size - offsetof(IPC_Read_Reply, data);
+    if (count > req->len)
+        count = req->len;
+    memcpy(req->buf, reply->data, count);
+    return count;
+}
+
+/// Pops the front message of the port, completing its request
+static int receive_reply(pmos_io_ring_t *ring, Message_Descriptor *desc)
+{
+    union {
+        IPC_Write_Reply write;
+        IPC_Timer_Expired timer;
+        char buff[64];
+    } small;
+
+    void *msg = &small;
+    if (desc->size > sizeof(small)) {
+        msg = malloc(desc->size);
+        if (!msg)
+            return -1;
+    }
+
+    result_t result = get_first_message(msg, MSG_ARG_REJECT_RIGHT, ring->port).result;
+    if (result == SUCCESS) {
+        // Timers and the replies of the requests which couldn't be tracked are ignored
+        pmos_hashtable_ll_t *e =
+            hashtable_find(&ring->in_flight, &desc->sent_with_right, reply_id_hash, request_equals);
+        if (e) {
+            struct IO_Ring_Request *req = container_of(e, struct IO_Ring_Request, ll);
+            hashtable_delete(&ring->in_flight, request_hash, e);
+            push_completion(ring, req->user_data, reply_result(req, desc, msg));
+
+            req->next_free      = ring->free_requests;
+            ring->free_requests = req;
+        }
+    }
+
+    if (msg != &small)
+        free(msg);
+
+    if (result != SUCCESS) {
+        errno = -result;
+        return -1;
+    }
+    return 0;
+}
+
+static int arm_timer(pmos_io_ring_t *ring, uint64_t deadline)
+{
+    if (ring->timer_right == INVALID_RIGHT) {
+        right_request_t timer = pmos_create_timer(ring->port);
+        if (timer.result != SUCCESS) {
+            errno = -timer.result;
+            return -1;
+        }
+        ring->timer_right = timer.right;
+    }
+
+    result_t result = pmos_set_timer(ring->port, ring->timer_right, deadline, 0);
+    if (result != SUCCESS) {
+        errno = -result;
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t now_ns() { return pmos_get_time(GET_TIME_NANOSECONDS_SINCE_BOOTUP).value; }
+
+int pmos_io_ring_wait(pmos_io_ring_t *ring, struct pmos_io_cqe *cqes, unsigned max, unsigned min,
+                      int64_t timeout_ns)
+{
+    if (min > max)
+        min = max;
+
+    const uint64_t deadline = timeout_ns > 0 ? now_ns() + timeout_ns : 0;
+    bool timer_armed        = false;
+
+    unsigned n = 0;
+    for (;;) {
+        // Process the replies which have already arrived
+        Message_Descriptor desc;
+        while (syscall_get_message_info(&desc, ring->port, FLAG_NOBLOCK) == SUCCESS) {
+            if (receive_reply(ring, &desc) < 0)
+                return n ? (int)n : -1;
+        }
+
+        n += pop_completions(ring, cqes + n, max - n);
+
+        // Don't wait for the requests which were never submitted
+        if (n >= min || ring->in_flight.count == 0 || timeout_ns == 0)
+            break;
+
+        if (deadline) {
+            if (now_ns() >= deadline)
+                break;
+
+            if (!timer_armed) {
+                if (arm_timer(ring, deadline) < 0)
+                    return n ? (int)n : -1;
+                timer_armed = true;
+            }
+        }
+
+        result_t result = syscall_get_message_info(&desc, ring->port, 0);
+        if (result != SUCCESS) {
+            errno = -result;
+            return n ? (int)n : -1;
+        }
+    }
+
+    return n;
+}
@@ -210,6 +210,22 @@ right_request_t set_interrupt(pmos_right_t right, pmos_port_t port)
     return ret;
 }
 
+right_request_t set_interrupt_counter(pmos_right_t right, pmos_port_t port,
+                                      struct interrupt_counter *counter)
+{
+    syscall_r r;
+#ifdef __32BITSYSCALL
+    r = __pmos_syscall32_5words(SYSCALL_SET_INTERRUPT | (SET_INTERRUPT_COUNTER << 8), right, port,
+                                counter);
+#else
+    r = pmos_syscall(SYSCALL_SET_INTERRUPT | (SET_INTERRUPT_COUNTER << 8), right, port, counter);
+#endif
+    return (right_request_t) {
+        .result = r.result,
+        .right = r.value,
+    };
+}
+
 // result_t name_port(pmos_port_t portnum, const char *name, size_t length, uint32_t flags)
 // {
 // #ifdef __32BITSYSCALL
@@ -442,6 +458,15 @@ result_t set_affinity(uint64_t tid, uint32_t cpu_id, unsigned flags)
 #endif
 }
 
+result_t set_affinity_mask(uint64_t tid, const void *mask, size_t mask_size)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_4words(SYSCALL_SET_AFFINITY_MASK, tid, (unsigned)mask, mask_size).result;
+#else
+    return pmos_syscall(SYSCALL_SET_AFFINITY_MASK, tid, mask, mask_size).result;
+#endif
+}
+
 result_t complete_interrupt(pmos_port_t port, pmos_right_t receive_right)
 {
 #ifdef __32BITSYSCALL
@@ -451,6 +476,19 @@ result_t complete_interrupt(pmos_port_t port, pmos_right_t receive_right)
 #endif
 }
 
+result_t complete_interrupt_poll(pmos_port_t port, pmos_right_t receive_right, uint64_t delay_ns)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_6words(SYSCALL_COMPLETE_INTERRUPT | (COMPLETE_INTERRUPT_POLL << 8), port,
+                                   receive_right, delay_ns)
+        .result;
+#else
+    return pmos_syscall(SYSCALL_COMPLETE_INTERRUPT | (COMPLETE_INTERRUPT_POLL << 8), port,
+                        receive_right, delay_ns)
+        .result;
+#endif
+}
+
 result_t pmos_yield()
 {
 #ifdef __32BITSYSCALL
@@ -469,6 +507,53 @@ syscall_r pmos_get_time(unsigned mode)
 #endif
 }
 
+syscall_r pmos_get_lockstat(struct lockstat_entry *buffer, size_t count, unsigned flags)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_2words(SYSCALL_GET_LOCKSTAT | (flags << 8), buffer, count);
+#else
+    return pmos_syscall(SYSCALL_GET_LOCKSTAT | (flags << 8), buffer, count);
+#endif
+}
+
+syscall_r pmos_get_syscall_stats(struct syscall_stats_entry *buffer, size_t count, unsigned flags)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_2words(SYSCALL_GET_SYSCALL_STATS | (flags << 8), buffer, count);
+#else
+    return pmos_syscall(SYSCALL_GET_SYSCALL_STATS | (flags << 8), buffer, count);
+#endif
+}
+
+syscall_r pmos_get_rcu_stats(struct rcu_stats_entry *buffer, size_t count)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_2words(SYSCALL_GET_RCU_STATS, buffer, count);
+#else
+    return pmos_syscall(SYSCALL_GET_RCU_STATS, buffer, count);
+#endif
+}
+
+result_t pmos_futex_wait(const volatile uint32_t *addr, uint32_t expected, uint64_t timeout_ns,
+                         unsigned flags)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_4words(SYSCALL_FUTEX_WAIT | (flags << 8), timeout_ns, addr, expected)
+        .result;
+#else
+    return pmos_syscall(SYSCALL_FUTEX_WAIT | (flags << 8), timeout_ns, addr, expected).result;
+#endif
+}
+
+syscall_r pmos_futex_wake(const volatile uint32_t *addr, uint32_t count, unsigned flags)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_2words(SYSCALL_FUTEX_WAKE | (flags << 8), addr, count);
+#else
+    return pmos_syscall(SYSCALL_FUTEX_WAKE | (flags << 8), addr, count);
+#endif
+}
+
 result_t syscall_kill_task(uint64_t tid)
 {
 #ifdef __32BITSYSCALL
@@ -569,6 +654,47 @@ right_request_t allocate_interrupt(uint32_t gsi, uint32_t flags)
     };
 }
 
+right_request_t allocate_msi(uint32_t cpu)
+{
+    syscall_r result;
+#ifdef __32BITSYSCALL
+    result = __pmos_syscall32_1words(SYSCALL_ALLOCATE_MSI, cpu);
+#else
+    result = pmos_syscall(SYSCALL_ALLOCATE_MSI, cpu);
+#endif
+    return (right_request_t) {
+        .result = result.result,
+        .right = result.value,
+    };
+}
+
+result_t get_msi_message(pmos_right_t right, struct msi_message *message)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_3words(SYSCALL_GET_MSI_MESSAGE, right, message).result;
+#else
+    return pmos_syscall(SYSCALL_GET_MSI_MESSAGE, right, message).result;
+#endif
+}
+
+result_t set_interrupt_cpu(pmos_port_t port, pmos_right_t recieve_right, uint32_t cpu)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_5words(SYSCALL_SET_INTERRUPT_CPU, port, recieve_right, cpu).result;
+#else
+    return pmos_syscall(SYSCALL_SET_INTERRUPT_CPU, port, recieve_right, cpu).result;
+#endif
+}
+
+syscall_r get_interrupt_stats(struct interrupt_stats_entry *buffer, size_t count)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_2words(SYSCALL_GET_INTERRUPT_STATS, buffer, count);
+#else
+    return pmos_syscall(SYSCALL_GET_INTERRUPT_STATS, buffer, count);
+#endif
+}
+
 result_t set_right0(pmos_right_t right)
 {
     syscall_r result;
@@ -661,6 +787,25 @@ syscall_r get_mem_object_size(mem_object_t mem_object_id, unsigned flags)
     #endif
 }
 
+syscall_r set_mem_object_pager(pmos_right_t mem_object_right, pmos_right_t pager_right)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_4words(SYSCALL_SET_MEM_OBJECT_PAGER, mem_object_right, pager_right);
+#else
+    return pmos_syscall(SYSCALL_SET_MEM_OBJECT_PAGER, mem_object_right, pager_right);
+#endif
+}
+
+result_t provide_mem_object_page(pmos_right_t mem_object_right, uint64_t offset, const void *data)
+{
+#ifdef __32BITSYSCALL
+    return __pmos_syscall32_5words(SYSCALL_PROVIDE_MEM_OBJECT_PAGE, mem_object_right, offset, data)
+        .result;
+#else
+    return pmos_syscall(SYSCALL_PROVIDE_MEM_OBJECT_PAGE, mem_object_right, offset, data).result;
+#endif
+}
+
 right_request_t transfer_right(uint64_t task_group, uint64_t right, unsigned flags)
 {
     syscall_r result;
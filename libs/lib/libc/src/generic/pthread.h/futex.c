@@ -0,0 +1,51 @@
+#include "futex.h"
+
+#include <errno.h>
+#include <pmos/system.h>
+
+int __futex_wait(volatile uint32_t *addr, uint32_t expected, clockid_t clock,
+                 const struct timespec *abstime, unsigned flags)
+{
+    uint64_t timeout_ns = 0;
+    if (abstime) {
+        if (abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000 || abstime->tv_sec < 0)
+            return EINVAL;
+
+        uint64_t deadline = (uint64_t)abstime->tv_sec * 1000000000 + abstime->tv_nsec;
+        if (clock == CLOCK_MONOTONIC) {
+            // Same as the kernel's time since bootup
+            timeout_ns = deadline;
+        } else {
+            syscall_r now = pmos_get_time(GET_TIME_REALTIME_NANOSECONDS);
+            if (now.result != 0)
+                return -now.result;
+
+            if (deadline <= now.value)
+                return ETIMEDOUT;
+
+            timeout_ns = deadline - now.value;
+            flags |= PMOS_FUTEX_RELATIVE;
+        }
+
+        // 0 would mean no timeout
+        if (!timeout_ns)
+            return ETIMEDOUT;
+    }
+
+    result_t result = pmos_futex_wait(addr, expected, timeout_ns, flags);
+    switch (result) {
+        case -ETIMEDOUT:
+            return ETIMEDOUT;
+        case -EINVAL:
+        case -EFAULT:
+            return -result;
+        default:
+            // Woken up, the value has changed or the wait was interrupted
+            return 0;
+    }
+}
+
+void __futex_wake(volatile uint32_t *addr, uint32_t count, unsigned flags)
+{
+    pmos_futex_wake(addr, count, flags);
+}
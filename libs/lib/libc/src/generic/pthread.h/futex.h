@@ -0,0 +1,23 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+#include <time.h>
+
+/// @brief Blocks while *addr is equal to expected
+///
+/// Spurious wake-ups are possible, so the callers must recheck their condition in a loop.
+/// @param addr Futex word
+/// @param expected Value with which to block
+/// @param clock Clock of abstime, CLOCK_REALTIME or CLOCK_MONOTONIC
+/// @param abstime Absolute timeout, or NULL to wait indefinitely
+/// @param flags PMOS_FUTEX_SHARED for the words in the memory shared between processes
+/// @return 0 once woken up or if the value was different, ETIMEDOUT if abstime has passed, EINVAL
+/// if abstime is invalid
+int __futex_wait(volatile uint32_t *addr, uint32_t expected, clockid_t clock,
+                 const struct timespec *abstime, unsigned flags);
+
+/// @brief Wakes up to count threads waiting on addr
+void __futex_wake(volatile uint32_t *addr, uint32_t count, unsigned flags);
+
+#endif // FUTEX_H
@@ -26,37 +26,20 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "waiter_struct.h"
+#include "futex.h"
 
-#include <assert.h>
 #include <errno.h>
-#include <pmos/ipc.h>
-#include <pmos/system.h>
 #include <pthread.h>
 
-__thread struct __pthread_waiter cond_waiter_struct = {0, NULL};
-
 int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr)
 {
-    // Check if attr is NULL and if not, its type
-    // TODO: Condattr are not implemented yet
-    // if (attr != NULL) {
-    //     errno = EINVAL;
-    //     return -1;
-    // }
-
-    cond->waiters_list_head = NULL;
-    cond->waiters_list_tail = NULL;
+    cond->sequence = 0;
+    cond->waiters  = 0;
+    cond->attr     = attr ? *attr : 0;
     return 0;
 }
 
-int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *)
-{
-    // Sorry not sorry
-    return pthread_cond_wait(cond, mutex);
-}
-
-int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+static int cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime)
 {
     // Check if mutex is NULL
     if (mutex == NULL) {
@@ -64,133 +47,50 @@ int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
         return -1;
     }
 
-    // Check if mutex is locked by the calling thread
-    // TODO
-    // if (mutex->blocking_thread_id != pthread_self()) {
-    //     errno = EPERM;
-    //     return -1;
-    // }
+    // Any signal after this point changes the sequence, so the wait below can't miss it even
+    // though the mutex is unlocked before blocking
+    unsigned sequence = __atomic_load_n(&cond->sequence, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&cond->waiters, 1, __ATOMIC_SEQ_CST);
 
-    // Prepare waiter struct
-    if (cond_waiter_struct.notification_port == INVALID_PORT) {
-        if (__init_waiter_struct(&cond_waiter_struct) != 0) {
-            return -1;
-        }
+    // A recursive mutex must be released completely
+    unsigned long recursive_count = mutex->recursive_lock_count;
+    mutex->recursive_lock_count   = 0;
+    if (pthread_mutex_unlock(mutex) != 0) {
+        mutex->recursive_lock_count = recursive_count;
+        __atomic_fetch_sub(&cond->waiters, 1, __ATOMIC_RELAXED);
+        return -1;
     }
 
-    // Add waiter to the list. Do this before unlocking mutex to have a predictable order of waiters
-    __atomic_add_waiter(&cond->waiters_list_head, &cond->waiters_list_tail, &cond_waiter_struct);
-
-    // Unlock the mutex
-    pthread_mutex_unlock(mutex);
-
-    // Wait for an unlock message
-    IPC_Mutex_Unlock unlock_signal;
-    Message_Descriptor reply_descriptor;
-
-    result_t result =
-        syscall_get_message_info(&reply_descriptor, cond_waiter_struct.notification_port, 0);
-
-    // This should never fail
-    assert(result == SUCCESS);
-
-    // Check if the message is the unlock signal
-    assert(reply_descriptor.size >= sizeof(IPC_Mutex_Unlock));
+    // The attribute bit selects CLOCK_MONOTONIC, so that 0 is the POSIX default of CLOCK_REALTIME
+    clockid_t clock = (cond->attr & 0x01) ? CLOCK_MONOTONIC : CLOCK_REALTIME;
+    int result      = __futex_wait(&cond->sequence, sequence, clock, abstime, 0);
 
-    result = get_first_message((char *)&unlock_signal, MSG_ARG_REJECT_RIGHT,
-                               cond_waiter_struct.notification_port).result;
+    __atomic_fetch_sub(&cond->waiters, 1, __ATOMIC_RELAXED);
 
-    // Again, this should never fail
-    assert(result == SUCCESS);
+    // The mutex must be reacquired even if the wait has timed out
+    pthread_mutex_lock(mutex);
+    mutex->recursive_lock_count = recursive_count;
 
-    assert(unlock_signal.type == IPC_Mutex_Unlock_NUM);
-
-    // We've been woken up. Lock the mutex again
-    int lock_result = pthread_mutex_lock(mutex);
-
-    // In theory, mutex can only fail the first time it is locked, so if it does something screwy is
-    // going on
-    assert(lock_result == 0);
+    if (result != 0) {
+        errno = result;
+        return -1;
+    }
 
     return 0;
 }
 
-static void simple_lock(int *lock)
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 {
-    static int simple_lock_expected = 0;
-
-    do {
-        if (*lock == 1) {
-            sched_yield();
-            continue;
-        }
-
-        if (__atomic_compare_exchange_n(lock, &simple_lock_expected, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
-            return;
-        }
-    } while (1);
+    return cond_wait(cond, mutex, NULL);
 }
 
-static void simple_unlock(int *lock) { __atomic_store_n(lock, 0, __ATOMIC_SEQ_CST); }
-
-int pthread_cond_broadcast(pthread_cond_t *cond)
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime)
 {
-    // Check if cond is NULL
-    if (cond == NULL) {
-        errno = EINVAL;
-        return -1;
-    }
-
-    // Check if cond has any waiters
-    if (cond->waiters_list_head == NULL) {
-        return 0;
-    }
-
-    // Send unlock messages to all waiters
-    IPC_Mutex_Unlock unlock_signal = {
-        .type = IPC_Mutex_Unlock_NUM,
-        .flags = 0,
-    };
-
-    // Only one thread can call pop at the time, so protect it with a spinlock.
-    // Originally, I was planning to use N producers/N consumers lock-free queue, but
-    // that turned out to be very complicated and since most of the time only
-    // one thread is expected to broadcast, protecting pop with a spinlock
-    // should be fine and also allows for a simplier (and potentially faster)
-    // implementation of enqueue
-
-    simple_lock(&cond->pop_spinlock);
-    struct __pthread_waiter *waiter =
-        __try_pop_waiter(&cond->waiters_list_head, &cond->waiters_list_tail);
-    simple_unlock(&cond->pop_spinlock);
-
-    int fail_count = 0;
-
-    while (waiter != NULL) {
-        result_t result = send_message_port(waiter->notification_port, sizeof(IPC_Mutex_Unlock),
-                                            (char *)&unlock_signal);
-
-        if (result != SUCCESS) {
-            fail_count++;
-            __atomic_add_waiter(&cond->waiters_list_head, &cond->waiters_list_tail, waiter);
-
-            if (fail_count > 10) {
-                errno = EAGAIN;
-                return -1;
-            }
-        }
-
-        simple_lock(&cond->pop_spinlock);
-        struct __pthread_waiter *waiter =
-            __try_pop_waiter(&cond->waiters_list_head, &cond->waiters_list_tail);
-        simple_unlock(&cond->pop_spinlock);
-        assert(waiter != NULL);
-    }
-
-    return 0;
+    return cond_wait(cond, mutex, abstime);
 }
 
-int pthread_cond_signal(pthread_cond_t *cond)
+static int cond_wake(pthread_cond_t *cond, uint32_t count)
 {
     // Check if cond is NULL
     if (cond == NULL) {
@@ -198,38 +98,19 @@ int pthread_cond_signal(pthread_cond_t *cond)
         return -1;
     }
 
-    // Check if cond has any waiters
-    if (cond->waiters_list_head == NULL) {
-        return 0;
-    }
-
-    // Send unlock message to the first waiter
-    IPC_Mutex_Unlock unlock_signal = {
-        .type = IPC_Mutex_Unlock_NUM,
-        .flags = 0
-    };
-
-    simple_lock(&cond->pop_spinlock);
-    struct __pthread_waiter *waiter =
-        __try_pop_waiter(&cond->waiters_list_head, &cond->waiters_list_tail);
-    simple_unlock(&cond->pop_spinlock);
-
-    if (waiter == NULL) {
-        return 0;
-    }
-
-    result_t result = send_message_port(waiter->notification_port, sizeof(IPC_Mutex_Unlock),
-                                        (char *)&unlock_signal);
+    __atomic_fetch_add(&cond->sequence, 1, __ATOMIC_SEQ_CST);
 
-    if (result != SUCCESS) {
-        __atomic_add_waiter(&cond->waiters_list_head, &cond->waiters_list_tail, waiter);
-        errno = EAGAIN;
-        return -1;
-    }
+    // The waiters not counted yet have either started waiting after this, or will see the new
+    // sequence and not block
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_SEQ_CST))
+        __futex_wake(&cond->sequence, count, 0);
 
     return 0;
 }
 
+int pthread_cond_broadcast(pthread_cond_t *cond) { return cond_wake(cond, ~0U); }
+
+int pthread_cond_signal(pthread_cond_t *cond) { return cond_wake(cond, 1); }
 
 int pthread_cond_destroy(pthread_cond_t *cond)
 {
@@ -240,7 +121,7 @@ int pthread_cond_destroy(pthread_cond_t *cond)
     }
 
     // Check if cond has any waiters
-    if (cond->waiters_list_head != NULL) {
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_RELAXED) != 0) {
         errno = EBUSY;
         return -1;
     }
@@ -278,10 +159,10 @@ int pthread_condattr_setclock(pthread_condattr_t *attr, clockid_t clock_id)
 
     switch (clock_id) {
         case CLOCK_REALTIME:
-            *attr |= 0x01;
+            *attr &= ~0x01;
             return 0;
         case CLOCK_MONOTONIC:
-            *attr &= ~0x01;
+            *attr |= 0x01;
             return 0;
         default:
             errno = EINVAL;
@@ -299,9 +180,9 @@ int pthread_condattr_getclock(const pthread_condattr_t *attr, clockid_t *clock_i
     }
 
     if (*attr & 0x01) {
-        *clock_id = CLOCK_REALTIME;
-    } else {
         *clock_id = CLOCK_MONOTONIC;
+    } else {
+        *clock_id = CLOCK_REALTIME;
     }
 
     return 0;
@@ -35,6 +35,7 @@ void _atexit_pop_all();
 void __call_destructors(void);
 void __thread_exit_destroy_tls();
 void __notify_exit(void *exit_code, int type);
+void __malloc_thread_exit(void);
 
 // Defined in cxa_thread_atexit.c
 void __call_thread_atexit();
@@ -50,6 +51,8 @@ void __thread_exit_fire_destructors()
 {
     __pthread_key_call_destructors();
     __call_thread_atexit();
+    // The destructors might free memory, so the cache is emptied after them
+    __malloc_thread_exit();
 
     uint64_t remaining_count = __atomic_sub_fetch(&__active_threads, 1, __ATOMIC_SEQ_CST);
     if (remaining_count <= 1) {
@@ -26,19 +26,22 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "waiter_struct.h"
+#include "futex.h"
+#include "spin_pause.h"
 
-#include <assert.h>
 #include <errno.h>
-#include <pmos/ipc.h>
-#include <pmos/ports.h>
-#include <pmos/system.h>
 #include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/types.h>
 
-static __thread struct __pthread_waiter waiter_struct = {0, NULL};
+#define MUTEX_UNLOCKED  0
+#define MUTEX_LOCKED    1
+// Locked, and there might be threads blocked on it which need to be woken up
+#define MUTEX_CONTENDED 2
+
+// Number of attempts to take the lock before blocking, since it is usually held for a short time
+#define MUTEX_SPIN_COUNT 100
 
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
 {
@@ -49,160 +52,86 @@ int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
         return -1;
     }
 
+    mutex->state                = MUTEX_UNLOCKED;
+    mutex->type                 = attr ? *attr : PTHREAD_MUTEX_DEFAULT;
     mutex->blocking_thread      = NULL;
-    mutex->waiters_list_head    = NULL;
     mutex->recursive_lock_count = 0;
-    mutex->type                 = attr ? *attr : PTHREAD_MUTEX_DEFAULT;
-    mutex->block_count          = 0;
-    mutex->waiters_list_tail    = NULL;
     return 0;
 }
 
-int sched_yield();
-
-/// @brief Gets the thread ID of the current thread
-/// @return The thread ID of the current thread
-static uint64_t get_thread_id()
-{
-    // Since get_task_id() returns the task ID instead of PID (which is tecnically wrong), use it
-    // for now
-    return get_task_id();
-}
-
-// TODO: I've changed other parts of code without touching this, so it's very likely to be broken
-static void atomic_pop_front(pthread_mutex_t *mutex)
+// Checks if the mutex is already held by the current thread. Returns 1 if the lock was taken
+// recursively and -1 on error.
+static int lock_owned(pthread_mutex_t *mutex, pthread_t *thread)
 {
-    assert(mutex->waiters_list_head != NULL);
-
-    while (1) {
-        // Atomically remove waiter from mutex->waiters_list_head
-        struct __pthread_waiter *waiter =
-            __atomic_load_n(&mutex->waiters_list_head, __ATOMIC_SEQ_CST);
-
-        // Set the head to NULL
-        __atomic_store_n(&mutex->waiters_list_head, NULL, __ATOMIC_SEQ_CST);
-
-        // Check if the head is the only node in the list
-        struct __pthread_waiter *waiters_tail =
-            __atomic_load_n(&mutex->waiters_list_tail, __ATOMIC_SEQ_CST);
-        if (waiters_tail == waiter) {
-            // Try and set the tail to NULL
-
-            if (__atomic_compare_exchange_n(&mutex->waiters_list_tail, &waiters_tail, NULL, 1,
-                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
-                // Successfully removed waiter from the list
-                return;
-            }
-        }
-
-        // The waiter is not NULL, so we need to set the head to the next node
-        struct __pthread_waiter *next = __atomic_load_n(&waiter->next, __ATOMIC_SEQ_CST);
-        if (next == NULL) {
-            // Wait for the next node to appear
-            continue;
-        }
+    pthread_t *blocking_thread = __atomic_load_n(&mutex->blocking_thread, __ATOMIC_RELAXED);
+    if (blocking_thread != thread)
+        return 0;
 
-        struct __pthread_waiter *null = NULL;
+    if (mutex->type == PTHREAD_MUTEX_RECURSIVE) {
+        // Mutex has been acquired by the current thread
+        mutex->recursive_lock_count++;
+        return 1;
+    }
 
-        // Set the head to the next node
-        if (!__atomic_compare_exchange_n(&mutex->waiters_list_head, &null, next, 1,
-                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
-            // Failed to set the head to the next node
-            sched_yield();
-            continue;
-        }
+    // Since we are here anyways, return the error no mater the type
+    errno = EDEADLK;
+    return -1;
+}
 
-        // Successfully removed waiter from the list
-        return;
-    }
+static int try_acquire(pthread_mutex_t *mutex)
+{
+    unsigned expected = MUTEX_UNLOCKED;
+    return __atomic_compare_exchange_n(&mutex->state, &expected, MUTEX_LOCKED, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
 }
 
-int pthread_mutex_lock(pthread_mutex_t *mutex)
+static int mutex_lock(pthread_mutex_t *mutex, const struct timespec *abstime)
 {
     pthread_t *thread = pthread_self();
 
-    pthread_t *blocking_thread = __atomic_load_n(&mutex->blocking_thread, __ATOMIC_SEQ_CST);
-    if (blocking_thread == thread) {
-        if (mutex->type == PTHREAD_MUTEX_RECURSIVE) {
-            // Mutex has been acquired by the current thread
-            mutex->recursive_lock_count++;
-            return 0;
-        }
+    int owned = lock_owned(mutex, thread);
+    if (owned)
+        return owned > 0 ? 0 : -1;
 
-        // Since we are here anyways, return the error no mater the type
-        errno = EDEADLK;
-        return -1;
-    }
-
-    // Atomically increment mutex->block_count
-    uint64_t block_count = __atomic_fetch_add(&mutex->block_count, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < MUTEX_SPIN_COUNT; ++i) {
+        if (try_acquire(mutex))
+            goto acquired;
 
-    if (block_count == 0) {
-        // Mutex has been acquired
-        __atomic_store_n(&mutex->blocking_thread, thread, __ATOMIC_RELAXED);
-        return 0;
+        __spin_pause();
     }
 
-    // Prepare waiter struct
-    if (waiter_struct.notification_port == 0) {
-        int result = __init_waiter_struct(&waiter_struct);
+    // Mark the mutex as contended so that the unlock wakes up the waiters. Since it's not known if
+    // this was the last waiter, the mutex stays in this state once acquired.
+    while (__atomic_exchange_n(&mutex->state, MUTEX_CONTENDED, __ATOMIC_ACQUIRE) !=
+           MUTEX_UNLOCKED) {
+        int result = __futex_wait(&mutex->state, MUTEX_CONTENDED, CLOCK_REALTIME, abstime, 0);
         if (result != 0) {
-            // Could not prepare it. Atomically decrement mutex->block_count and return error
-            __atomic_fetch_sub(&mutex->block_count, 1, __ATOMIC_SEQ_CST);
+            errno = result;
             return -1;
         }
     }
 
-    // Add waiter to the lock-free list
-    struct __pthread_waiter *waiter = &waiter_struct;
-
-    __atomic_add_waiter(&mutex->waiters_list_head, &mutex->waiters_list_tail, waiter);
-
-    // Wait for the mutex to be unlocked
-    IPC_Mutex_Unlock unlock_signal;
-    Message_Descriptor reply_descriptor;
-
-    result_t result = syscall_get_message_info(&reply_descriptor, waiter->notification_port, 0);
-
-    // This function should never fail unless something is really wrong
-    assert(result == SUCCESS);
-
-    atomic_pop_front(mutex);
-
-    assert(reply_descriptor.size == sizeof(IPC_Mutex_Unlock));
-
-    result = get_first_message((char *)&unlock_signal, MSG_ARG_REJECT_RIGHT,
-                               waiter->notification_port).result;
-
-    // Again, this function should never fail unless something is really wrong
-    assert(result == SUCCESS);
-
-    // Mutex has been acquired
+acquired:
     __atomic_store_n(&mutex->blocking_thread, thread, __ATOMIC_RELAXED);
     return 0;
 }
 
+int pthread_mutex_lock(pthread_mutex_t *mutex) { return mutex_lock(mutex, NULL); }
+
+int pthread_mutex_timedlock(pthread_mutex_t *mutex, const struct timespec *abstime)
+{
+    return mutex_lock(mutex, abstime);
+}
+
 int pthread_mutex_trylock(pthread_mutex_t *mutex)
 {
     pthread_t *thread = pthread_self();
 
-    pthread_t * blocking_thread = __atomic_load_n(&mutex->blocking_thread, __ATOMIC_SEQ_CST);
-    if (blocking_thread == thread) {
-        if (mutex->type == PTHREAD_MUTEX_RECURSIVE) {
-            // Mutex has been acquired by the current thread
-            mutex->recursive_lock_count++;
-            return 0;
-        }
-
-        // Since we are here anyways, return the error no mater the type
-        errno = EDEADLK;
-        return -1;
-    }
+    int owned = lock_owned(mutex, thread);
+    if (owned)
+        return owned > 0 ? 0 : -1;
 
-    // Compare and set block count
-    uint64_t block_count = 0;
-    if (!__atomic_compare_exchange_n(&mutex->block_count, &block_count, 1, 0, __ATOMIC_SEQ_CST,
-                                     __ATOMIC_SEQ_CST)) {
+    if (!try_acquire(mutex)) {
         // Mutex is locked
         errno = EBUSY;
         return -1;
@@ -226,52 +155,14 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex)
     if (mutex->recursive_lock_count > 0) {
         mutex->recursive_lock_count--;
         return 0;
-    } else {
-        __atomic_store_n(&mutex->blocking_thread, 0, __ATOMIC_RELAXED);
-    }
-
-    // Atomically decrement mutex->block_count
-    uint64_t block_count = __atomic_sub_fetch(&mutex->block_count, 1, __ATOMIC_SEQ_CST);
-    if (block_count == 0) {
-        // No waiters
-        return 0;
     }
 
-    struct __pthread_waiter *head = __atomic_load_n(&mutex->waiters_list_head, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&mutex->blocking_thread, NULL, __ATOMIC_RELAXED);
 
-    // Wait for the tail to appear or its creation to fail
-    while (block_count != 0 && head == NULL) {
-        // Yield the CPU
-        sched_yield();
-
-        // Reload the head and block_count
-        head        = __atomic_load_n(&mutex->waiters_list_head, __ATOMIC_SEQ_CST);
-        block_count = __atomic_load_n(&mutex->block_count, __ATOMIC_SEQ_CST);
-    }
-
-    // pthread_mutex_lock() failed
-    if (block_count == 0) {
-        return 0;
-    }
-
-    // Unlock the waiter
-    IPC_Mutex_Unlock msg = {
-        .type  = IPC_Mutex_Unlock_NUM,
-        .flags = 0,
-    };
-
-    result_t result = send_message_port(head->notification_port, sizeof(msg), (const char *)&msg);
-
-    if (result != SUCCESS) {
-        // Block the mutex
-        __atomic_fetch_add(&mutex->block_count, 1, __ATOMIC_SEQ_CST);
-
-        // Return an error
-        errno = result;
-        return -1;
-    }
+    // Only enter the kernel if someone might be waiting
+    if (__atomic_exchange_n(&mutex->state, MUTEX_UNLOCKED, __ATOMIC_RELEASE) == MUTEX_CONTENDED)
+        __futex_wake(&mutex->state, 1, 0);
 
-    // Mutex has been unlocked
     return 0;
 }
 
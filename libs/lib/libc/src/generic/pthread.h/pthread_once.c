@@ -26,9 +26,15 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "futex.h"
+
 #include <errno.h>
 #include <pthread.h>
-#include <stdbool.h>
+
+#define ONCE_RUNNING 1
+// Running, and other threads are waiting for it
+#define ONCE_WAITING 2
+#define ONCE_DONE    3
 
 int pthread_once(pthread_once_t *once_control, void (*init_routine)(void))
 {
@@ -37,16 +43,29 @@ int pthread_once(pthread_once_t *once_control, void (*init_routine)(void))
         return -1;
     }
 
-    static const int __PTHREAD_ONCE_INIT = 0;
+    unsigned state = __atomic_load_n(once_control, __ATOMIC_ACQUIRE);
+    if (state == ONCE_DONE)
+        return 0;
 
-    if (*once_control != __PTHREAD_ONCE_INIT) {
+    if (state == 0 && __atomic_compare_exchange_n(once_control, &state, ONCE_RUNNING, 0,
+                                                  __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        init_routine();
+
+        if (__atomic_exchange_n(once_control, ONCE_DONE, __ATOMIC_RELEASE) == ONCE_WAITING)
+            __futex_wake((volatile uint32_t *)once_control, ~0U, 0);
         return 0;
     }
 
-    bool should_initialize = __sync_bool_compare_and_swap(once_control, __PTHREAD_ONCE_INIT, 1);
-    if (should_initialize) {
-        init_routine();
+    // Wait for the thread running init_routine to finish
+    while (state != ONCE_DONE) {
+        if (state == ONCE_RUNNING &&
+            !__atomic_compare_exchange_n(once_control, &state, ONCE_WAITING, 0, __ATOMIC_ACQUIRE,
+                                         __ATOMIC_ACQUIRE))
+            continue;
+
+        __futex_wait((volatile uint32_t *)once_control, ONCE_WAITING, CLOCK_MONOTONIC, NULL, 0);
+        state = __atomic_load_n(once_control, __ATOMIC_ACQUIRE);
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,16 @@
+#ifndef PTHREAD_RWLOCK_H
+#define PTHREAD_RWLOCK_H
+
+#include <pthread.h>
+
+// Value of pthread_rwlock_t::state when the lock is held by a writer
+#define RWLOCK_WRITE_LOCKED (~0U)
+
+// Waits for the lock to be released, if it is still held as described by the caller's condition.
+// The sequence must be read before the condition is checked.
+void __rwlock_wait(pthread_rwlock_t *lock, unsigned sequence);
+
+// Wakes up all of the waiters after the lock was released
+void __rwlock_wake(pthread_rwlock_t *lock);
+
+#endif // PTHREAD_RWLOCK_H
@@ -1,20 +1,23 @@
+#include "pthread_rwlock.h"
+
 #include <pthread.h>
 
 int pthread_rwlock_rdlock(pthread_rwlock_t *lock)
 {
-    int res = pthread_mutex_lock(&lock->g);
-    if (res != 0)
-        return res;
+    while (1) {
+        unsigned state = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+        if (state != RWLOCK_WRITE_LOCKED && state != RWLOCK_WRITE_LOCKED - 1 &&
+            !__atomic_load_n(&lock->writers_waiting, __ATOMIC_RELAXED)) {
+            if (__atomic_compare_exchange_n(&lock->state, &state, state + 1, 0, __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED))
+                return 0;
 
-    while (lock->num_writers_waiting || lock->writer_active) {
-        res = pthread_cond_wait(&lock->cond, &lock->g);
-        if (res != 0) {
-            pthread_mutex_unlock(&lock->g);
-            return res;
+            continue;
         }
-    }
 
-    lock->num_readers_active++;
-
-    return pthread_mutex_unlock(&lock->g);
-}
\ No newline at end of file
+        unsigned sequence = __atomic_load_n(&lock->sequence, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&lock->state, __ATOMIC_SEQ_CST) == RWLOCK_WRITE_LOCKED ||
+            __atomic_load_n(&lock->writers_waiting, __ATOMIC_SEQ_CST))
+            __rwlock_wait(lock, sequence);
+    }
+}
@@ -1,37 +1,25 @@
+#include "pthread_rwlock.h"
+
+#include <errno.h>
 #include <pthread.h>
 
 int pthread_rwlock_unlock(pthread_rwlock_t *lock)
 {
-    int res = pthread_mutex_lock(&lock->g);
-    if (res != 0)
-        return res;
+    unsigned state = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+    if (state == 0) {
+        errno = EPERM;
+        return -1;
+    }
 
-    if (lock->writer_active) {
-        lock->writer_active = 0;
-    
-        if (lock->num_writers_waiting) {
-            res = pthread_cond_signal(&lock->cond);
-            if (res != 0) {
-                pthread_mutex_unlock(&lock->g);
-                return res;
-            }
-        } else {
-            res = pthread_cond_broadcast(&lock->cond);
-            if (res != 0) {
-                pthread_mutex_unlock(&lock->g);
-                return res;
-            }
-        }
-    } else {
-        lock->num_readers_active--;
-        if (lock->num_readers_active == 0 && lock->num_writers_waiting) {
-            res = pthread_cond_signal(&lock->cond);
-            if (res != 0) {
-                pthread_mutex_unlock(&lock->g);
-                return res;
-            }
-        }
+    if (state == RWLOCK_WRITE_LOCKED) {
+        __atomic_store_n(&lock->state, 0, __ATOMIC_SEQ_CST);
+        __rwlock_wake(lock);
+        return 0;
     }
 
-    return pthread_mutex_unlock(&lock->g);
-}
\ No newline at end of file
+    // Only the last reader can let the writer in
+    if (__atomic_sub_fetch(&lock->state, 1, __ATOMIC_SEQ_CST) == 0)
+        __rwlock_wake(lock);
+
+    return 0;
+}
@@ -1,23 +1,40 @@
+#include "futex.h"
+#include "pthread_rwlock.h"
+
 #include <pthread.h>
 
+void __rwlock_wait(pthread_rwlock_t *lock, unsigned sequence)
+{
+    __atomic_fetch_add(&lock->waiters, 1, __ATOMIC_SEQ_CST);
+    __futex_wait(&lock->sequence, sequence, CLOCK_MONOTONIC, NULL, 0);
+    __atomic_fetch_sub(&lock->waiters, 1, __ATOMIC_RELAXED);
+}
+
+void __rwlock_wake(pthread_rwlock_t *lock)
+{
+    // The waiters recheck the lock after changing waiters, so they either see the new sequence or
+    // are seen here
+    __atomic_fetch_add(&lock->sequence, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&lock->waiters, __ATOMIC_SEQ_CST))
+        __futex_wake(&lock->sequence, ~0U, 0);
+}
+
 int pthread_rwlock_wrlock(pthread_rwlock_t *lock)
 {
-    int res = pthread_mutex_lock(&lock->g);
-    if (res != 0)
-        return res;
+    // The waiting writers hold off the new readers, so that they don't starve
+    __atomic_fetch_add(&lock->writers_waiting, 1, __ATOMIC_SEQ_CST);
 
-    lock->num_writers_waiting++;
+    while (1) {
+        unsigned state = 0;
+        if (__atomic_compare_exchange_n(&lock->state, &state, RWLOCK_WRITE_LOCKED, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
 
-    while (lock->num_readers_active || lock->writer_active) {
-        res = pthread_cond_wait(&lock->cond, &lock->g);
-        if (res != 0) {
-            pthread_mutex_unlock(&lock->g);
-            return res;
-        }
+        unsigned sequence = __atomic_load_n(&lock->sequence, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&lock->state, __ATOMIC_SEQ_CST) != 0)
+            __rwlock_wait(lock, sequence);
     }
 
-    lock->num_writers_waiting--;
-    lock->writer_active = 1;
-
-    return pthread_mutex_unlock(&lock->g);
-}
\ No newline at end of file
+    __atomic_fetch_sub(&lock->writers_waiting, 1, __ATOMIC_RELAXED);
+    return 0;
+}
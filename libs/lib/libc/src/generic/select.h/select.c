@@ -1,45 +1,256 @@
 #include <errno.h>
 #include <poll.h>
-#include <stdio.h>
+#include <pmos/system.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
 #include <sys/select.h>
-#include <unistd.h>
+#include <time.h>
 
-int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+struct Epoll_Instance;
+struct Epoll_Instance *__epoll_create_instance();
+int __epoll_ctl(struct Epoll_Instance *ep, int op, size_t key, int fd, struct epoll_event *event);
+int __epoll_wait(struct Epoll_Instance *ep, struct epoll_event *events, int maxevents,
+                 int64_t timeout_ns);
+void __epoll_clear(struct Epoll_Instance *ep);
+int __poll_descriptor(int fd, uint32_t events, pmos_port_t notify_port, uint64_t cookie,
+                      pmos_right_t *notify_id, uint32_t *revents);
+
+#define FD_BITS (8 * sizeof(unsigned long))
+
+void FD_CLR(int fd, fd_set *set) { set->fds_bits[fd / FD_BITS] &= ~(1UL << (fd % FD_BITS)); }
+
+int FD_ISSET(int fd, fd_set *set) { return !!(set->fds_bits[fd / FD_BITS] & (1UL << (fd % FD_BITS))); }
+
+void FD_SET(int fd, fd_set *set) { set->fds_bits[fd / FD_BITS] |= 1UL << (fd % FD_BITS); }
+
+void FD_ZERO(fd_set *set)
+{
+    for (size_t i = 0; i < FD_SETSIZE / FD_BITS; ++i)
+        set->fds_bits[i] = 0;
+}
+
+// Instance used by poll(), whose registrations are removed after each call. Its port belongs to
+// the thread, so it can't be shared.
+static __thread struct Epoll_Instance *poll_instance = NULL;
+
+/// poll() with the timeout in nanoseconds, -1 waiting indefinitely
+static int poll_ns(struct pollfd fds[], nfds_t nfds, int64_t timeout_ns)
 {
-    // Go uses select() for usleep(). Implement enought for that to work
-    if (nfds != 0 || readfds != NULL || writefds != NULL || exceptfds != NULL) {
-        // Not implemented
-        fprintf(stderr, "pmOS libc: select: nfds, readfds, writefds, exceptfds not implemented\n");
-        errno = ENOSYS;
+    if (nfds > INT32_MAX) {
+        errno = EINVAL;
         return -1;
     }
 
-    if (timeout == NULL) {
-        // Not implemented
-        errno = ENOSYS;
-        return -1;
+    // Check the readiness first, without registering the interest. This is enough if anything is
+    // ready, and the servers are only asked to notify if the thread has to wait.
+    int count = 0;
+    for (nfds_t i = 0; i < nfds; ++i) {
+        fds[i].revents = 0;
+        if (fds[i].fd < 0)
+            continue;
+
+        pmos_right_t unused;
+        uint32_t revents;
+        if (__poll_descriptor(fds[i].fd, fds[i].events, INVALID_PORT, 0, &unused, &revents) < 0) {
+            if (errno != EBADF)
+                return -1;
+            revents = POLLNVAL;
+        }
+
+        fds[i].revents = revents & (fds[i].events | POLLERR | POLLHUP | POLLNVAL);
+        if (fds[i].revents)
+            count++;
+    }
+
+    if (count > 0 || timeout_ns == 0)
+        return count;
+
+    if (!poll_instance) {
+        poll_instance = __epoll_create_instance();
+        if (!poll_instance)
+            return -1;
     }
 
-    // nanoslpeep
-    return usleep(timeout->tv_sec * 1000000 + timeout->tv_usec);
+    struct epoll_event *events = NULL;
+    if (nfds > 0) {
+        events = malloc(nfds * sizeof(*events));
+        if (!events)
+            return -1;
+    }
+
+    for (nfds_t i = 0; i < nfds; ++i) {
+        if (fds[i].fd < 0)
+            continue;
+
+        struct epoll_event ev = {
+            .events   = (uint16_t)fds[i].events,
+            .data.u64 = i,
+        };
+        if (__epoll_ctl(poll_instance, EPOLL_CTL_ADD, i, fds[i].fd, &ev) < 0) {
+            if (errno != EBADF) {
+                count = -1;
+                goto out;
+            }
+
+            // Closed in the meantime
+            fds[i].revents = POLLNVAL;
+            count++;
+        }
+    }
+
+    if (count > 0)
+        goto out;
+
+    count = __epoll_wait(poll_instance, events, nfds > 0 ? nfds : 1, timeout_ns);
+    for (int i = 0; i < count; ++i)
+        fds[events[i].data.u64].revents = events[i].events;
+
+out:
+    __epoll_clear(poll_instance);
+    free(events);
+    return count;
 }
 
 int poll(struct pollfd fds[], nfds_t nfds, int timeout)
 {
-    size_t count = 0;
-    for (nfds_t i = 0; i < nfds; ++i) {
-        if (fds[i].fd == STDOUT_FILENO || fds[i].fd == STDERR_FILENO) {
-            count++;
+    return poll_ns(fds, nfds, timeout < 0 ? -1 : (int64_t)timeout * 1000000);
+}
+
+int ppoll(struct pollfd fds[], nfds_t nfds, const struct timespec *restrict timeout,
+          const sigset_t *restrict sigmask)
+{
+    int64_t timeout_ns = -1;
+    if (timeout) {
+        if (timeout->tv_sec < 0 || timeout->tv_nsec < 0 || timeout->tv_nsec >= 1000000000) {
+            errno = EINVAL;
+            return -1;
         }
+        timeout_ns = timeout->tv_sec * 1000000000 + timeout->tv_nsec;
     }
 
-    if (count > 0) {
-        return count;
+    sigset_t old;
+    if (sigmask && pthread_sigmask(SIG_SETMASK, sigmask, &old) != 0)
+        return -1;
+
+    int result = poll_ns(fds, nfds, timeout_ns);
+
+    if (sigmask) {
+        int e = errno;
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        errno = e;
+    }
+    return result;
+}
+
+static int select_ns(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+                     int64_t timeout_ns)
+{
+    if (nfds < 0 || nfds > FD_SETSIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct pollfd *fds = NULL;
+    if (nfds > 0) {
+        fds = malloc(nfds * sizeof(*fds));
+        if (!fds)
+            return -1;
+    }
+
+    nfds_t count = 0;
+    for (int fd = 0; fd < nfds; ++fd) {
+        short events = 0;
+        if (readfds && FD_ISSET(fd, readfds))
+            events |= POLLIN;
+        if (writefds && FD_ISSET(fd, writefds))
+            events |= POLLOUT;
+        if (exceptfds && FD_ISSET(fd, exceptfds))
+            events |= POLLPRI;
+
+        if (events)
+            fds[count++] = (struct pollfd) {.fd = fd, .events = events, .revents = 0};
+    }
+
+    int result = poll_ns(fds, count, timeout_ns);
+    if (result < 0)
+        goto out;
+
+    for (nfds_t i = 0; i < count; ++i) {
+        if (fds[i].revents & POLLNVAL) {
+            errno  = EBADF;
+            result = -1;
+            goto out;
+        }
     }
 
-    // Not implemented
-    fprintf(stderr, "(args: fds=%p, nfds=%ld, timeout=%d)\n", fds, nfds, timeout);
-    fprintf(stderr, "pmOS libc: poll not implemented\n");
-    errno = ENOSYS;
-    return -1;
-}
\ No newline at end of file
+    if (readfds)
+        FD_ZERO(readfds);
+    if (writefds)
+        FD_ZERO(writefds);
+    if (exceptfds)
+        FD_ZERO(exceptfds);
+
+    // select() counts the bits, not the descriptors
+    result = 0;
+    for (nfds_t i = 0; i < count; ++i) {
+        const short revents = fds[i].revents;
+        if (readfds && (revents & (POLLIN | POLLHUP | POLLERR)) && (fds[i].events & POLLIN)) {
+            FD_SET(fds[i].fd, readfds);
+            result++;
+        }
+        if (writefds && (revents & (POLLOUT | POLLERR)) && (fds[i].events & POLLOUT)) {
+            FD_SET(fds[i].fd, writefds);
+            result++;
+        }
+        if (exceptfds && (revents & POLLPRI)) {
+            FD_SET(fds[i].fd, exceptfds);
+            result++;
+        }
+    }
+
+out:
+    free(fds);
+    return result;
+}
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    int64_t timeout_ns = -1;
+    if (timeout) {
+        if (timeout->tv_sec < 0 || timeout->tv_usec < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        timeout_ns = timeout->tv_sec * 1000000000 + timeout->tv_usec * 1000;
+    }
+
+    return select_ns(nfds, readfds, writefds, exceptfds, timeout_ns);
+}
+
+int pselect(int nfds, fd_set *restrict readfds, fd_set *writefds, fd_set *exceptfds,
+            const struct timespec *timeout, const sigset_t *sigmask)
+{
+    int64_t timeout_ns = -1;
+    if (timeout) {
+        if (timeout->tv_sec < 0 || timeout->tv_nsec < 0 || timeout->tv_nsec >= 1000000000) {
+            errno = EINVAL;
+            return -1;
+        }
+        timeout_ns = timeout->tv_sec * 1000000000 + timeout->tv_nsec;
+    }
+
+    sigset_t old;
+    if (sigmask && pthread_sigmask(SIG_SETMASK, sigmask, &old) != 0)
+        return -1;
+
+    int result = select_ns(nfds, readfds, writefds, exceptfds, timeout_ns);
+
+    if (sigmask) {
+        int e = errno;
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        errno = e;
+    }
+    return result;
+}
@@ -9,19 +9,11 @@ int sem_destroy(sem_t *s)
         return -1;
     }
 
-    if (pthread_mutex_lock(&s->lock) < 0)
-        return -1;
-
-    if (s->value < 0) {
+    if (__atomic_load_n(&s->waiters, __ATOMIC_RELAXED) != 0) {
         // Threads are blocking on the semaphore
-        pthread_mutex_unlock(&s->lock);
         errno = EBUSY;
         return -1;
     }
 
-    pthread_mutex_unlock(&s->lock);
-
-    pthread_mutex_destroy(&s->lock);
-    pthread_cond_destroy(&s->cond);
     return 0;
-}
\ No newline at end of file
+}
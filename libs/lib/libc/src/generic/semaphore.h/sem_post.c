@@ -1,6 +1,10 @@
+#include "../pthread.h/futex.h"
+
 #include <semaphore.h>
 #include <pthread.h>
 #include <errno.h>
+#include <limits.h>
+#include <pmos/system.h>
 
 int sem_post(sem_t *s)
 {
@@ -9,14 +13,19 @@ int sem_post(sem_t *s)
         return -1;
     }
 
-    int r = pthread_mutex_lock(&s->lock);
-    if (r < 0)
-        return -1;
+    unsigned value = __atomic_load_n(&s->value, __ATOMIC_RELAXED);
+    do {
+        if (value >= SEM_VALUE_MAX) {
+            errno = EOVERFLOW;
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&s->value, &value, value + 1, 0, __ATOMIC_SEQ_CST,
+                                          __ATOMIC_RELAXED));
 
-    s->value++;
-    if (s->value <= 1)
-        pthread_cond_signal(&s->cond);
+    // The waiters count themselves before checking the value, so the ones not seen here will find it
+    // non-zero
+    if (__atomic_load_n(&s->waiters, __ATOMIC_SEQ_CST))
+        __futex_wake(&s->value, 1, s->pshared ? PMOS_FUTEX_SHARED : 0);
 
-    pthread_mutex_unlock(&s->lock);
     return 0;
-}
\ No newline at end of file
+}
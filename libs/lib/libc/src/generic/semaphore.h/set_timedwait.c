@@ -1,18 +1,30 @@
+#include "../pthread.h/futex.h"
+
 #include <semaphore.h>
 #include <pthread.h>
 #include <errno.h>
+#include <pmos/system.h>
 
+// Also used by sem_wait(), with abs_timeout set to NULL
 int sem_timedwait(sem_t *sem, const struct timespec *abs_timeout) {
-    if (pthread_mutex_lock(&sem->lock) != 0)
-        return -1;
-    
-    while (sem->value <= 0) {
-        if (pthread_cond_timedwait(&sem->cond, &sem->lock, abs_timeout) != 0) {
-            pthread_mutex_unlock(&sem->lock);
+    unsigned value = __atomic_load_n(&sem->value, __ATOMIC_RELAXED);
+    while (1) {
+        while (value > 0) {
+            if (__atomic_compare_exchange_n(&sem->value, &value, value - 1, 0, __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED))
+                return 0;
+        }
+
+        __atomic_fetch_add(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+        int result = __futex_wait(&sem->value, 0, CLOCK_REALTIME, abs_timeout,
+                                  sem->pshared ? PMOS_FUTEX_SHARED : 0);
+        __atomic_fetch_sub(&sem->waiters, 1, __ATOMIC_RELAXED);
+
+        if (result != 0) {
+            errno = result;
             return -1;
         }
+
+        value = __atomic_load_n(&sem->value, __ATOMIC_RELAXED);
     }
-    
-    sem->value--;
-    pthread_mutex_unlock(&sem->lock);
-}
\ No newline at end of file
+}
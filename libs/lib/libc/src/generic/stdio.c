@@ -134,7 +134,7 @@ FILE *fdopen(int fd, const char *mode)
     file->fd = fd;
 
     file->buf_size  = BUFSIZ;
-    file->buf_flags = _FILE_FLAG_FLUSHNEWLINE;
+    file->buf_flags = _FILE_FLAG_FLUSHNEWLINE | _FILE_FLAG_DEFAULT_SIZE;
     // The buffer is gonna be malloc'ed on the first access
 
     int posix_mode = to_posix_mode(mode);
@@ -184,23 +184,79 @@ void funlockfile(FILE *file) { UNLOCK_FILE(&file->lock); }
 
 int setvbuf(FILE *stream, char *buffer, int mode, size_t size)
 {
+    if (mode != _IONBF && mode != _IOLBF && mode != _IOFBF) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Should only be called before any I/O, so there is nothing to flush
+    if (stream->buf_flags & _FILE_FLAG_MYBUF)
+        free(stream->buf);
+    stream->buf_pos = 0;
+    stream->buf_len = 0;
+
     if (mode == _IONBF) {
-        stream->buf      = NULL;
-        stream->buf_size = 0;
-    } else if (mode == _IOLBF || mode == _IOFBF) {
+        stream->buf       = NULL;
+        stream->buf_size  = 0;
+        stream->buf_flags = 0;
+    } else {
         stream->buf       = buffer;
         stream->buf_size  = size == 0 ? BUFSIZ : size;
         stream->buf_flags = mode == _IOLBF ? _FILE_FLAG_FLUSHNEWLINE : 0;
-    } else {
-        errno = EINVAL;
-        return -1;
+        if (!buffer && size == 0)
+            stream->buf_flags |= _FILE_FLAG_DEFAULT_SIZE;
     }
 
     return 0;
 }
 
+void setbuf(FILE *stream, char *buffer)
+{
+    setvbuf(stream, buffer, buffer ? _IOFBF : _IONBF, BUFSIZ);
+}
+
+// Buffer size of the streams that are read before being written. Every refill is an IPC round trip
+// to the filesystem, so it is larger than BUFSIZ.
+#define READ_BUFSIZ (64 * 1024)
+
+static int alloc_buffer(FILE *stream, size_t default_size)
+{
+    if (stream->buf_size == 0 || stream->buf != NULL)
+        return 0;
+
+    if (stream->buf_flags & _FILE_FLAG_DEFAULT_SIZE)
+        stream->buf_size = default_size;
+
+    stream->buf = malloc(stream->buf_size);
+    if (!stream->buf) {
+        errno = ENOMEM;
+        return -1;
+    }
+    stream->buf_flags |= _FILE_FLAG_MYBUF;
+    return 0;
+}
+
+// Discards the read-ahead data, moving the file position back to what has been consumed
+static void drop_read_buffer(FILE *stream)
+{
+    size_t unread = stream->buf_len - stream->buf_pos + stream->unget_pos;
+    if (unread)
+        // Not possible with pipes and terminals, in which case the data is lost
+        __lseek_internal(stream->fd, -(off_t)unread, SEEK_CUR);
+
+    stream->buf_pos   = 0;
+    stream->buf_len   = 0;
+    stream->unget_pos = 0;
+    stream->buf_flags &= ~_FILE_FLAG_READING;
+}
+
 static ssize_t flush_buffer(FILE *stream)
 {
+    if (stream->buf_flags & _FILE_FLAG_READING) {
+        drop_read_buffer(stream);
+        return 0;
+    }
+
     if (stream->buf_pos == 0)
         return 0;
 
@@ -217,14 +273,11 @@ static ssize_t write_file(void *arg, const char *str, size_t size)
 
     // Caller is expected to lock the file
 
-    if (stream->buf_size != 0 && stream->buf == NULL) {
-        stream->buf = malloc(stream->buf_size);
-        if (!stream->buf) {
-            errno = ENOMEM;
-            return -1;
-        }
-        stream->buf_flags |= _FILE_FLAG_MYBUF;
-    }
+    if (stream->buf_flags & _FILE_FLAG_READING)
+        drop_read_buffer(stream);
+
+    if (alloc_buffer(stream, BUFSIZ) < 0)
+        return -1;
 
     if (stream->buf_size != 0 && (size > (stream->buf_size - stream->buf_pos))) {
         ssize_t ret = flush_buffer(stream);
@@ -1013,39 +1066,118 @@ int snprintf(char *str, size_t size, const char *format, ...)
     return ret;
 }
 
-size_t fread(void *ptr, size_t size, size_t count, FILE *stream)
+static void set_flag(FILE *stream, int flag)
 {
-    __atomic_or_fetch(&stream->flags, _FILE_FLAG_ERROR, __ATOMIC_RELAXED);
+    __atomic_or_fetch(&stream->flags, flag, __ATOMIC_RELAXED);
+}
 
-    // Not implemented
-    errno = ENOSYS;
+// Switches the buffer to reading, writing out what's pending
+static int start_reading(FILE *stream)
+{
+    if (stream->buf_flags & _FILE_FLAG_READING)
+        return 0;
+
+    if (flush_buffer(stream) < 0 || alloc_buffer(stream, READ_BUFSIZ) < 0) {
+        set_flag(stream, _FILE_FLAG_ERROR);
+        return -1;
+    }
+
+    stream->buf_pos = 0;
+    stream->buf_len = 0;
+    stream->buf_flags |= _FILE_FLAG_READING;
     return 0;
+}
 
-    return __read_internal((long int)stream, ptr, size * count, true, 0);
+// Reads directly from the file, setting the end of file and error indicators
+static ssize_t read_fd(FILE *stream, void *buf, size_t size)
+{
+    // The prompt must be visible before blocking on the input
+    if (stream == stdin && stdout && (stdout->buf_flags & _FILE_FLAG_FLUSHNEWLINE))
+        fflush(stdout);
+
+    ssize_t r = __read_internal(stream->fd, buf, size, true, 0);
+    if (r < 0)
+        set_flag(stream, _FILE_FLAG_ERROR);
+    else if (r == 0)
+        set_flag(stream, _FILE_FLAG_EOF);
+    return r;
 }
 
-char* fgets(char* restrict str, int count, FILE* restrict stream)
+static ssize_t fill_buffer(FILE *stream)
 {
-    // Stub!
-    fprintf(stderr, "fgets stub!!!\n");
+    ssize_t r = read_fd(stream, stream->buf, stream->buf_size);
+    if (r > 0) {
+        stream->buf_pos = 0;
+        stream->buf_len = r;
+    }
+    return r;
+}
 
-    (void)str;
-    (void)count;
+static inline bool has_buffered_data(FILE *stream)
+{
+    return (stream->buf_flags & _FILE_FLAG_READING) && stream->unget_pos == 0 &&
+           stream->buf_pos < stream->buf_len;
+}
 
-    __atomic_or_fetch(&stream->flags, _FILE_FLAG_ERROR, __ATOMIC_RELAXED);
-    return NULL;
+// Caller is expected to lock the file
+static size_t read_file(FILE *stream, char *dst, size_t size)
+{
+    if (start_reading(stream) < 0)
+        return 0;
+
+    size_t done = 0;
+    while (done < size && stream->unget_pos > 0)
+        dst[done++] = stream->unget[--stream->unget_pos];
+
+    while (done < size) {
+        size_t available = stream->buf_len - stream->buf_pos;
+        if (available) {
+            size_t n = size - done < available ? size - done : available;
+            memcpy(dst + done, stream->buf + stream->buf_pos, n);
+            stream->buf_pos += n;
+            done += n;
+            continue;
+        }
+
+        // Requests larger than the buffer go straight to the destination
+        size_t left = size - done;
+        ssize_t r   = left >= stream->buf_size ? read_fd(stream, dst + done, left)
+                                               : fill_buffer(stream);
+        if (r <= 0)
+            break;
+        if (left >= stream->buf_size)
+            done += r;
+    }
+
+    return done;
+}
+
+size_t fread(void *ptr, size_t size, size_t count, FILE *stream)
+{
+    size_t bytes;
+    if (__builtin_mul_overflow(size, count, &bytes)) {
+        errno = EOVERFLOW;
+        set_flag(stream, _FILE_FLAG_ERROR);
+        return 0;
+    }
+
+    if (bytes == 0)
+        return 0;
+
+    LOCK(&stream->lock);
+    size_t r = read_file(stream, ptr, bytes);
+    UNLOCK_FILE(&stream->lock);
+    return r / size;
 }
 
 int getc_unlocked(FILE *stream)
 {
-    // Not implemented
-    errno = ENOSYS;
-    return -1;
+    if (has_buffered_data(stream))
+        return (unsigned char)stream->buf[stream->buf_pos++];
 
-    char c  = 0;
-    int ret = fread(&c, 1, 1, stream);
-    if (ret < 0)
-        return ret;
+    unsigned char c = 0;
+    if (read_file(stream, (char *)&c, 1) != 1)
+        return EOF;
     return c;
 }
 
@@ -1053,20 +1185,165 @@ int getchar_unlocked(void) { return getc_unlocked(stdin); }
 
 int getc(FILE *stream)
 {
-    char c  = 0;
-    int ret = fread(&c, 1, 1, stream);
-    if (ret < 0)
-        return ret;
+    LOCK(&stream->lock);
+    int c = getc_unlocked(stream);
+    UNLOCK_FILE(&stream->lock);
     return c;
 }
 
-int fgetc(FILE *stream)
+int fgetc(FILE *stream) { return getc(stream); }
+
+int getchar(void) { return getc(stdin); }
+
+int ungetc(int character, FILE *stream)
 {
-    char c  = 0;
-    int ret = fread(&c, 1, 1, stream);
-    if (ret < 0)
-        return ret;
-    return c;
+    if (character == EOF)
+        return EOF;
+
+    LOCK(&stream->lock);
+    int result = EOF;
+    if (start_reading(stream) < 0)
+        goto end;
+
+    if (stream->unget_pos == 0 && stream->buf_pos > 0) {
+        // Put back into the buffer, which keeps the fast paths going
+        stream->buf[--stream->buf_pos] = character;
+    } else if (stream->unget_pos < (int)sizeof(stream->unget)) {
+        stream->unget[stream->unget_pos++] = character;
+    } else {
+        goto end;
+    }
+
+    __atomic_and_fetch(&stream->flags, ~_FILE_FLAG_EOF, __ATOMIC_RELAXED);
+    result = (unsigned char)character;
+end:
+    UNLOCK_FILE(&stream->lock);
+    return result;
+}
+
+char *fgets(char *restrict str, int count, FILE *restrict stream)
+{
+    if (count <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    LOCK(&stream->lock);
+    size_t n = 0;
+    while (n + 1 < (size_t)count) {
+        if (has_buffered_data(stream)) {
+            const char *start = stream->buf + stream->buf_pos;
+            size_t available  = stream->buf_len - stream->buf_pos;
+            size_t want       = count - 1 - n;
+            if (want > available)
+                want = available;
+
+            const char *newline = memchr(start, '\n', want);
+            size_t len          = newline ? (size_t)(newline - start) + 1 : want;
+            memcpy(str + n, start, len);
+            stream->buf_pos += len;
+            n += len;
+            if (newline)
+                break;
+            continue;
+        }
+
+        int c = getc_unlocked(stream);
+        if (c == EOF)
+            break;
+        str[n++] = c;
+        if (c == '\n')
+            break;
+    }
+    UNLOCK_FILE(&stream->lock);
+
+    if (n == 0 && count > 1)
+        return NULL;
+
+    str[n] = '\0';
+    return str;
+}
+
+// Grows the getdelim() buffer to hold at least size bytes
+static int reserve_line(char **lineptr, size_t *n, size_t size)
+{
+    if (*lineptr && *n >= size)
+        return 0;
+
+    size_t new_size = *n > 64 ? *n : 64;
+    while (new_size < size)
+        new_size *= 2;
+
+    char *p = realloc(*lineptr, new_size);
+    if (!p) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    *lineptr = p;
+    *n       = new_size;
+    return 0;
+}
+
+ssize_t getdelim(char **restrict lineptr, size_t *restrict n, int delim, FILE *restrict stream)
+{
+    if (!lineptr || !n) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    LOCK(&stream->lock);
+    size_t len = 0;
+    for (;;) {
+        if (has_buffered_data(stream)) {
+            const char *start = stream->buf + stream->buf_pos;
+            size_t available  = stream->buf_len - stream->buf_pos;
+
+            const char *end = memchr(start, delim, available);
+            size_t chunk    = end ? (size_t)(end - start) + 1 : available;
+            if (reserve_line(lineptr, n, len + chunk + 1) < 0)
+                goto fail;
+
+            memcpy(*lineptr + len, start, chunk);
+            stream->buf_pos += chunk;
+            len += chunk;
+            if (end)
+                break;
+            continue;
+        }
+
+        int c = getc_unlocked(stream);
+        if (c == EOF)
+            break;
+
+        if (reserve_line(lineptr, n, len + 2) < 0)
+            goto fail;
+        (*lineptr)[len++] = c;
+        if (c == (unsigned char)delim)
+            break;
+    }
+    UNLOCK_FILE(&stream->lock);
+
+    if (len == 0)
+        return -1;
+
+    (*lineptr)[len] = '\0';
+    return len;
+
+fail:
+    set_flag(stream, _FILE_FLAG_ERROR);
+    UNLOCK_FILE(&stream->lock);
+    return -1;
+}
+
+ssize_t getline(char **restrict lineptr, size_t *restrict n, FILE *restrict stream)
+{
+    return getdelim(lineptr, n, '\n', stream);
+}
+
+void clearerr(FILE *stream)
+{
+    __atomic_and_fetch(&stream->flags, ~(_FILE_FLAG_EOF | _FILE_FLAG_ERROR), __ATOMIC_RELAXED);
 }
 
 int printf(const char *format, ...)
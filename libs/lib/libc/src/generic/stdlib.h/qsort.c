@@ -26,51 +26,345 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-static void swap(void *a, void *b, size_t size)
+/*
+ * Pattern-defeating quicksort (Orson Peters, 2021), adapted to qsort()'s untyped elements.
+ *
+ * The pivot is the median of 3, or a pseudo-median of 9 for the large partitions. Partitions which
+ * end up very unbalanced shuffle a few elements to break the patterns, and after log2(n) of them
+ * the rest is heapsorted, so the worst case is O(n log n). The partitions without any swap are
+ * checked with a bounded insertion sort, which makes the sorted and reversed-then-partitioned
+ * inputs linear, and runs of equal elements are put aside with partition_left().
+ */
+
+/// Partitions smaller than this are insertion sorted
+#define INSERTION_SORT_THRESHOLD 24
+/// Partitions larger than this use the pseudo-median of 9 as the pivot
+#define NINTHER_THRESHOLD 128
+/// Number of elements partial_insertion_sort() may move before giving up
+#define PARTIAL_INSERTION_SORT_LIMIT 8
+
+enum Swap_Type {
+    SWAP_BYTES,
+    SWAP_U32,
+    SWAP_U64,
+    SWAP_U128,
+    SWAP_WORDS,
+};
+
+struct Sort {
+    size_t size;
+    enum Swap_Type swap_type;
+    int (*compar)(const void *, const void *);
+};
+
+static enum Swap_Type swap_type(const void *base, size_t size)
 {
-    unsigned char t[size];
+    uintptr_t align = (uintptr_t)base | size;
+    if (size == sizeof(uint32_t) && align % _Alignof(uint32_t) == 0)
+        return SWAP_U32;
+    if (align % _Alignof(uint64_t) == 0) {
+        if (size == sizeof(uint64_t))
+            return SWAP_U64;
+        if (size == 2 * sizeof(uint64_t))
+            return SWAP_U128;
+        return SWAP_WORDS;
+    }
+    return SWAP_BYTES;
+}
 
-    if (a == b)
-        return;
+static inline void swap(const struct Sort *s, char *a, char *b)
+{
+    switch (s->swap_type) {
+    case SWAP_U32: {
+        uint32_t t       = *(uint32_t *)a;
+        *(uint32_t *)a = *(uint32_t *)b;
+        *(uint32_t *)b = t;
+        break;
+    }
+    case SWAP_U64: {
+        uint64_t t       = *(uint64_t *)a;
+        *(uint64_t *)a = *(uint64_t *)b;
+        *(uint64_t *)b = t;
+        break;
+    }
+    case SWAP_U128: {
+        uint64_t t0           = ((uint64_t *)a)[0];
+        uint64_t t1           = ((uint64_t *)a)[1];
+        ((uint64_t *)a)[0] = ((uint64_t *)b)[0];
+        ((uint64_t *)a)[1] = ((uint64_t *)b)[1];
+        ((uint64_t *)b)[0] = t0;
+        ((uint64_t *)b)[1] = t1;
+        break;
+    }
+    case SWAP_WORDS:
+        for (size_t i = 0; i < s->size / sizeof(uint64_t); ++i) {
+            uint64_t t         = ((uint64_t *)a)[i];
+            ((uint64_t *)a)[i] = ((uint64_t *)b)[i];
+            ((uint64_t *)b)[i] = t;
+        }
+        break;
+    case SWAP_BYTES:
+        for (size_t i = 0; i < s->size; ++i) {
+            char t = a[i];
+            a[i]   = b[i];
+            b[i]   = t;
+        }
+        break;
+    }
+}
 
-    memcpy(t, a, size);
-    memcpy(a, b, size);
-    memcpy(b, t, size);
+static inline bool less(const struct Sort *s, const char *a, const char *b)
+{
+    return s->compar(a, b) < 0;
 }
 
-static size_t partition(void *base, size_t elem_size, size_t l, size_t r,
-                        int (*compar)(const void *, const void *))
+static inline void sort2(const struct Sort *s, char *a, char *b)
 {
-    void *pivot = (char *)base + r * elem_size;
-    size_t i    = l;
+    if (less(s, b, a))
+        swap(s, a, b);
+}
 
-    for (size_t j = l; j < r; j++) {
-        if (compar((char *)base + j * elem_size, pivot) < 0) {
-            swap((char *)base + i * elem_size, (char *)base + j * elem_size, elem_size);
-            i++;
-        }
+static inline void sort3(const struct Sort *s, char *a, char *b, char *c)
+{
+    sort2(s, a, b);
+    sort2(s, b, c);
+    sort2(s, a, b);
+}
+
+static void insertion_sort(const struct Sort *s, char *begin, char *end)
+{
+    for (char *cur = begin + s->size; cur < end; cur += s->size)
+        for (char *p = cur; p > begin && less(s, p, p - s->size); p -= s->size)
+            swap(s, p, p - s->size);
+}
+
+// The element before begin must not be greater than any element of [begin, end)
+static void unguarded_insertion_sort(const struct Sort *s, char *begin, char *end)
+{
+    for (char *cur = begin + s->size; cur < end; cur += s->size)
+        for (char *p = cur; less(s, p, p - s->size); p -= s->size)
+            swap(s, p, p - s->size);
+}
+
+// Returns false if it has given up after moving too many elements
+static bool partial_insertion_sort(const struct Sort *s, char *begin, char *end)
+{
+    size_t moved = 0;
+    for (char *cur = begin + s->size; cur < end; cur += s->size) {
+        char *p = cur;
+        for (; p > begin && less(s, p, p - s->size); p -= s->size)
+            swap(s, p, p - s->size);
+
+        moved += (cur - p) / s->size;
+        if (moved > PARTIAL_INSERTION_SORT_LIMIT)
+            return false;
+    }
+    return true;
+}
+
+static void sift_down(const struct Sort *s, char *base, size_t root, size_t n)
+{
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= n)
+            return;
+        if (child + 1 < n && less(s, base + child * s->size, base + (child + 1) * s->size))
+            ++child;
+        if (!less(s, base + root * s->size, base + child * s->size))
+            return;
+        swap(s, base + root * s->size, base + child * s->size);
+        root = child;
+    }
+}
+
+static void heapsort(const struct Sort *s, char *base, size_t n)
+{
+    for (size_t i = n / 2; i > 0; --i)
+        sift_down(s, base, i - 1, n);
+
+    for (size_t i = n - 1; i > 0; --i) {
+        swap(s, base, base + i * s->size);
+        sift_down(s, base, 0, i);
     }
+}
+
+/// Partitions [begin, end) around the pivot at begin, with the elements equal to it going right.
+/// Returns the final position of the pivot and whether nothing had to be moved.
+static char *partition_right(const struct Sort *s, char *begin, char *end, bool *partitioned)
+{
+    const size_t size = s->size;
+    const char *pivot = begin;
+    char *first       = begin;
+    char *last        = end;
+
+    // There is an element >= pivot (the median of 3) on the right, so this stops
+    while (less(s, first += size, pivot))
+        ;
+
+    if (first - size == begin)
+        while (first < last && !less(s, last -= size, pivot))
+            ;
+    else
+        // ...and there is an element < pivot on the left
+        while (!less(s, last -= size, pivot))
+            ;
 
-    swap((char *)base + i * elem_size, pivot, elem_size);
-    return i;
+    *partitioned = first >= last;
+
+    while (first < last) {
+        swap(s, first, last);
+        while (less(s, first += size, pivot))
+            ;
+        while (!less(s, last -= size, pivot))
+            ;
+    }
+
+    char *pivot_pos = first - size;
+    swap(s, begin, pivot_pos);
+    return pivot_pos;
 }
 
-static void qsort_i(void *base, size_t elem_size, size_t l, size_t r,
-                    int (*compar)(const void *, const void *))
+/// Partitions [begin, end) around the pivot at begin, with the elements equal to it going left.
+/// Used when the pivot is equal to the element before the partition, so everything on the left
+/// ends up in its final position.
+static char *partition_left(const struct Sort *s, char *begin, char *end)
 {
-    size_t p = partition(base, elem_size, l, r, compar);
+    const size_t size = s->size;
+    const char *pivot = begin;
+    char *first       = begin;
+    char *last        = end;
+
+    while (less(s, pivot, last -= size))
+        ;
+
+    if (last + size == end)
+        while (first < last && !less(s, pivot, first += size))
+            ;
+    else
+        while (!less(s, pivot, first += size))
+            ;
+
+    while (first < last) {
+        swap(s, first, last);
+        while (less(s, pivot, last -= size))
+            ;
+        while (!less(s, pivot, first += size))
+            ;
+    }
 
-    if (p > l + 1)
-        qsort_i(base, elem_size, l, p - 1, compar);
-    if (p + 1 < r)
-        qsort_i(base, elem_size, p + 1, r, compar);
+    swap(s, begin, last);
+    return last;
+}
+
+static void pdqsort_loop(const struct Sort *s, char *begin, char *end, int bad_allowed,
+                         bool leftmost)
+{
+    const size_t size = s->size;
+
+    for (;;) {
+        const size_t n = (end - begin) / size;
+
+        if (n < INSERTION_SORT_THRESHOLD) {
+            if (leftmost)
+                insertion_sort(s, begin, end);
+            else
+                unguarded_insertion_sort(s, begin, end);
+            return;
+        }
+
+        // Move the pivot to begin
+        const size_t half = n / 2;
+        char *mid         = begin + half * size;
+        if (n > NINTHER_THRESHOLD) {
+            sort3(s, begin, mid, end - size);
+            sort3(s, begin + size, mid - size, end - 2 * size);
+            sort3(s, begin + 2 * size, mid + size, end - 3 * size);
+            sort3(s, mid - size, mid, mid + size);
+            swap(s, begin, mid);
+        } else {
+            sort3(s, mid, begin, end - size);
+        }
+
+        // The partitions after the first one have the previous pivot before them. If it is equal
+        // to this one, there is a run of equal elements, which don't need to be sorted further.
+        if (!leftmost && !less(s, begin - size, begin)) {
+            begin = partition_left(s, begin, end) + size;
+            continue;
+        }
+
+        bool partitioned;
+        char *pivot_pos     = partition_right(s, begin, end, &partitioned);
+        const size_t l_size = (pivot_pos - begin) / size;
+        const size_t r_size = (end - pivot_pos) / size - 1;
+
+        if (l_size < n / 8 || r_size < n / 8) {
+            if (--bad_allowed == 0) {
+                heapsort(s, begin, n);
+                return;
+            }
+
+            // Shuffle some elements to break the pattern
+            if (l_size >= INSERTION_SORT_THRESHOLD) {
+                const size_t q = l_size / 4;
+                swap(s, begin, begin + q * size);
+                swap(s, pivot_pos - size, pivot_pos - q * size);
+                if (l_size > NINTHER_THRESHOLD) {
+                    swap(s, begin + size, begin + (q + 1) * size);
+                    swap(s, begin + 2 * size, begin + (q + 2) * size);
+                    swap(s, pivot_pos - 2 * size, pivot_pos - (q + 1) * size);
+                    swap(s, pivot_pos - 3 * size, pivot_pos - (q + 2) * size);
+                }
+            }
+
+            if (r_size >= INSERTION_SORT_THRESHOLD) {
+                const size_t q = r_size / 4;
+                swap(s, pivot_pos + size, pivot_pos + (q + 1) * size);
+                swap(s, end - size, end - q * size);
+                if (r_size > NINTHER_THRESHOLD) {
+                    swap(s, pivot_pos + 2 * size, pivot_pos + (q + 2) * size);
+                    swap(s, pivot_pos + 3 * size, pivot_pos + (q + 3) * size);
+                    swap(s, end - 2 * size, end - (q + 1) * size);
+                    swap(s, end - 3 * size, end - (q + 2) * size);
+                }
+            }
+        } else if (partitioned && partial_insertion_sort(s, begin, pivot_pos) &&
+                   partial_insertion_sort(s, pivot_pos + size, end)) {
+            // Probably already sorted
+            return;
+        }
+
+        // Recurse into the smaller side, so the stack is O(log n)
+        if (l_size < r_size) {
+            pdqsort_loop(s, begin, pivot_pos, bad_allowed, leftmost);
+            begin    = pivot_pos + size;
+            leftmost = false;
+        } else {
+            pdqsort_loop(s, pivot_pos + size, end, bad_allowed, false);
+            end = pivot_pos;
+        }
+    }
 }
 
 void qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *))
 {
-    if (nmemb > 2)
-        qsort_i(base, size, 0, nmemb - 1, compar);
+    if (nmemb < 2 || size == 0)
+        return;
+
+    const struct Sort s = {
+        .size      = size,
+        .swap_type = swap_type(base, size),
+        .compar    = compar,
+    };
+
+    int log2_n = 0;
+    for (size_t n = nmemb; n > 1; n >>= 1)
+        ++log2_n;
+
+    char *begin = base;
+    pdqsort_loop(&s, begin, begin + nmemb * size, log2_n, true);
 }
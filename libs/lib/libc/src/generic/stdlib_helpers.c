@@ -370,6 +370,7 @@ auxv_t *__auxv;
 extern uint64_t process_task_group;
 
 void __init_environ(const char **envp);
+void __init_string_ops(void);
 
 /// @brief Initializes the standard library
 ///
@@ -402,6 +403,8 @@ void init_std_lib(void *load_data, size_t load_data_size, int *argc)
     __envp = envp;
     __auxv = auxv;
 
+    __init_string_ops();
+
     const auxv_t *tasg_group_e = __elf_aux_search(__auxv, AT_TASK_GROUP_ID);
     if (tasg_group_e && *(uint64_t *)tasg_group_e->a_ptr != 0) {
         process_task_group = *(uint64_t *)tasg_group_e->a_ptr;
@@ -28,28 +28,137 @@
 
 #include "../include/string.h"
 
+#include "string_ops.h"
+
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 
-size_t strlen(const char *str)
-{
-    size_t size = 0;
-    for (; str[size] != '\0'; ++size)
-        ;
+// The word-at-a-time routines access the memory through this type, which may alias anything
+typedef uintptr_t __attribute__((__may_alias__)) word_t;
 
-    return size;
+#define WORD_MASK   (sizeof(word_t) - 1)
+#define WORD_ONES   ((word_t)-1 / 0xff)
+#define WORD_HIGHS  (WORD_ONES * 0x80)
+// Non-zero if any of the bytes of the word is zero
+#define HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+
+// Misaligned loads are expanded by the compiler into whatever the architecture allows
+static inline word_t load_word(const unsigned char *p)
+{
+    word_t w;
+    __builtin_memcpy(&w, p, sizeof(w));
+    return w;
 }
 
-char *strcpy(char * restrict destination, const char * restrict source)
+size_t __strlen_generic(const char *str)
 {
-    char *p = destination;
-    while (*source != '\0') {
-        *p = *source;
+    const char *p = str;
+    for (; (uintptr_t)p & WORD_MASK; ++p)
+        if (*p == '\0')
+            return p - str;
+
+    // Aligned words never cross a page boundary, so reading past the terminator is safe
+    const word_t *w = (const word_t *)p;
+    while (!HAS_ZERO(*w))
+        ++w;
+
+    p = (const char *)w;
+    while (*p != '\0')
         ++p;
-        ++source;
+
+    return p - str;
+}
+
+void *__memcpy_generic(void *restrict dest, const void *restrict src, size_t n)
+{
+    unsigned char *d       = dest;
+    const unsigned char *s = src;
+
+    // Only the destination is aligned, since the source might never be
+    for (; n && ((uintptr_t)d & WORD_MASK); --n)
+        *d++ = *s++;
+
+    for (; n >= 4 * sizeof(word_t); n -= 4 * sizeof(word_t)) {
+        word_t w0 = load_word(s), w1 = load_word(s + sizeof(word_t));
+        word_t w2 = load_word(s + 2 * sizeof(word_t)), w3 = load_word(s + 3 * sizeof(word_t));
+        ((word_t *)d)[0] = w0;
+        ((word_t *)d)[1] = w1;
+        ((word_t *)d)[2] = w2;
+        ((word_t *)d)[3] = w3;
+        d += 4 * sizeof(word_t);
+        s += 4 * sizeof(word_t);
+    }
+
+    for (; n >= sizeof(word_t); n -= sizeof(word_t)) {
+        *(word_t *)d = load_word(s);
+        d += sizeof(word_t);
+        s += sizeof(word_t);
+    }
+
+    while (n--)
+        *d++ = *s++;
+
+    return dest;
+}
+
+void *__memset_generic(void *s, int c, size_t n)
+{
+    unsigned char *d = s;
+    const word_t w   = WORD_ONES * (unsigned char)c;
+
+    for (; n && ((uintptr_t)d & WORD_MASK); --n)
+        *d++ = (unsigned char)c;
+
+    for (; n >= 4 * sizeof(word_t); n -= 4 * sizeof(word_t)) {
+        ((word_t *)d)[0] = w;
+        ((word_t *)d)[1] = w;
+        ((word_t *)d)[2] = w;
+        ((word_t *)d)[3] = w;
+        d += 4 * sizeof(word_t);
+    }
+
+    for (; n >= sizeof(word_t); n -= sizeof(word_t)) {
+        *(word_t *)d = w;
+        d += sizeof(word_t);
+    }
+
+    while (n--)
+        *d++ = (unsigned char)c;
+
+    return s;
+}
+
+int __memcmp_generic(const void *s1, const void *s2, size_t n)
+{
+    const unsigned char *a = s1;
+    const unsigned char *b = s2;
+
+    // Skip the equal words, the first difference is then found byte by byte
+    for (; n >= sizeof(word_t) && load_word(a) == load_word(b); n -= sizeof(word_t)) {
+        a += sizeof(word_t);
+        b += sizeof(word_t);
     }
 
-    *p = '\0';
+    for (; n; --n, ++a, ++b)
+        if (*a != *b)
+            return *a < *b ? -1 : 1;
+
+    return 0;
+}
+
+struct __string_ops __string_ops = {
+    .memcpy = __memcpy_generic,
+    .memset = __memset_generic,
+    .memcmp = __memcmp_generic,
+    .strlen = __strlen_generic,
+};
+
+size_t strlen(const char *str) { return __string_ops.strlen(str); }
+
+char *strcpy(char * restrict destination, const char * restrict source)
+{
+    memcpy(destination, source, strlen(source) + 1);
     return destination;
 }
 
@@ -112,35 +221,12 @@ int strncmp(const char *s1, const char *s2, size_t size)
 
 void *memcpy(void * restrict dest, const void * restrict src, size_t n)
 {
-    void *k = dest;
-    while (n--) {
-        *((char *)dest++) = *((char *)src++);
-    }
-
-    return k;
-}
-
-void *memset(void *s, int c, size_t n)
-{
-    void *k = s;
-    while (n--) {
-        *((unsigned char *)(s)++) = (unsigned char)c;
-    }
-
-    return k;
+    return __string_ops.memcpy(dest, src, n);
 }
 
-int memcmp(const void *s1, const void *s2, size_t n)
-{
-    size_t k = 0;
-    for (; k < n && ((unsigned char *)s1)[k] == ((unsigned char *)s2)[k]; ++k)
-        ;
-
-    if (k == n)
-        return 0;
+void *memset(void *s, int c, size_t n) { return __string_ops.memset(s, c, n); }
 
-    return ((unsigned char *)s1)[k] < ((unsigned char *)s2)[k] ? -1 : 1;
-}
+int memcmp(const void *s1, const void *s2, size_t n) { return __string_ops.memcmp(s1, s2, n); }
 
 void *memmove(void *restrict dest, const void *restrict src, size_t n)
 {
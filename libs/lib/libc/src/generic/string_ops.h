@@ -0,0 +1,30 @@
+#ifndef STRING_OPS_H
+#define STRING_OPS_H
+
+#include <stddef.h>
+
+/// Implementations of the hot string functions, which memcpy(), memset(), memcmp() and strlen()
+/// call through. Until __init_string_ops() runs, these are the generic versions, so the functions
+/// can be used from the very start of init_std_lib().
+struct __string_ops {
+    void *(*memcpy)(void *restrict dest, const void *restrict src, size_t n);
+    void *(*memset)(void *s, int c, size_t n);
+    int (*memcmp)(const void *s1, const void *s2, size_t n);
+    size_t (*strlen)(const char *str);
+};
+
+extern struct __string_ops __string_ops;
+
+// Word-at-a-time versions, defined in string.c. The architecture-specific ones use them for the
+// sizes too small for the vectors.
+void *__memcpy_generic(void *restrict dest, const void *restrict src, size_t n);
+void *__memset_generic(void *s, int c, size_t n);
+int __memcmp_generic(const void *s1, const void *s2, size_t n);
+size_t __strlen_generic(const char *str);
+
+/// @brief Picks the fastest implementations supported by the CPU
+///
+/// Defined by each architecture and called by init_std_lib() once the auxiliary vector is known.
+void __init_string_ops(void);
+
+#endif // STRING_OPS_H
@@ -1,4 +1,5 @@
 #pragma once
+#include <pmos/interrupts.h>
 #include <pmos/ports.h>
 #include <pmos/system.h>
 #include <pmos/containers/intrusive_bst.hh>
@@ -111,8 +112,14 @@ private:
     pmos_port_t id = 0;
 };
 
-RecieveRight register_interrupt(const Right &int_source_right, Port &port);
+// If counter is not null, the interrupts are counted in it, and the message is only sent if the
+// counter's waiting flag is set (see set_interrupt_counter())
+RecieveRight register_interrupt(const Right &int_source_right, Port &port,
+                                interrupt_counter *counter = nullptr);
 void complete_interrupt(const RecieveRight &notification_right);
+// Completes the interrupt, but keeps it masked and asks the kernel to notify again after delay_ns
+// (see complete_interrupt_poll())
+void complete_interrupt_poll(const RecieveRight &notification_right, uint64_t delay_ns);
 
 RecieveRight create_timer_right(Port &port);
 void set_deadline(const RecieveRight &timer_right, uint64_t deadline_ns, bool relative = false);
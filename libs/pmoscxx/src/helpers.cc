@@ -245,7 +245,7 @@ Right::~Right()
         delete_right(right);
 }
 
-RecieveRight register_interrupt(const Right &int_source_right, Port &port)
+RecieveRight register_interrupt(const Right &int_source_right, Port &port, interrupt_counter *counter)
 {
     if (int_source_right.type() != RightType::IntSource)
         throw std::invalid_argument("Right must be of type IntSource");
@@ -260,7 +260,8 @@ RecieveRight register_interrupt(const Right &int_source_right, Port &port)
         throw std::system_error(-static_cast<int>(set_result), std::system_category(),
                                 "Failed to set interrupt affinity");
 
-    auto result = ::set_interrupt(int_source_right.get(), port.get());
+    auto result = counter ? ::set_interrupt_counter(int_source_right.get(), port.get(), counter)
+                          : ::set_interrupt(int_source_right.get(), port.get());
     if (result.result)
         throw std::system_error(-static_cast<int>(result.result), std::system_category(),
                                 "Failed to register interrupt");
@@ -279,6 +280,18 @@ void complete_interrupt(const RecieveRight &int_notification_right)
                                 "Failed to complete interrupt");
 }
 
+void complete_interrupt_poll(const RecieveRight &int_notification_right, uint64_t delay_ns)
+{
+    if (int_notification_right.type() != RightType::IntNotification)
+        throw std::invalid_argument("Right must be of type IntNotification");
+
+    auto result = ::complete_interrupt_poll(int_notification_right.port(),
+                                            int_notification_right.get(), delay_ns);
+    if (result)
+        throw std::system_error(-static_cast<int>(result), std::system_category(),
+                                "Failed to complete interrupt");
+}
+
 RecieveRight create_timer_right(Port &port)
 {
     auto result = ::pmos_create_timer(port.get());
@@ -101,6 +101,10 @@ unsafe extern "C" {
     #[link_name = "get_right_type"]
     unsafe fn get_right_type(right: Right) -> SyscallR;
 
+    unsafe fn create_mem_object(size: u64, flags: u32) -> RightRequestResult;
+    unsafe fn set_mem_object_pager(mem_object_right: Right, pager_right: Right) -> SyscallR;
+    unsafe fn provide_mem_object_page(mem_object_right: Right, offset: u64, data: *const u8) -> ResultT;
+
     #[link_name = "munmap"]
     unsafe fn sys_munmap(addr: *mut libc::c_void, length: libc::size_t) -> c_int;
 
@@ -546,6 +550,11 @@ impl ObjectMmap {
         unsafe { std::slice::from_raw_parts(self.ptr.as_ptr(), self.size) }
     }
 
+    /// Mutable view of the memory. The mapping must have been created with map_writable().
+    pub fn as_mut_slice(&mut self) -> &mut [u8] {
+        unsafe { std::slice::from_raw_parts_mut(self.ptr.as_ptr(), self.size) }
+    }
+
     pub fn len(&self) -> usize {
         self.size
     }
@@ -591,10 +600,62 @@ impl Drop for RecieveManyRight {
 }
 
 const MAP_PROT_READ: u64 = 1 << 0;
+const MAP_PROT_WRITE: u64 = 1 << 1;
 const MAP_MEM_OBJECT_IS_RIGHT: u64 = 1 << 15;
 
 impl MemoryObjectRight {
+    /// Creates a new (non-anonymous) memory object of the given size, which must be page aligned
+    pub fn create(size: u64) -> Result<Self, Error> {
+        unsafe { create_mem_object(size, 0) }
+            .result()
+            .map(Self)
+            .map_err(|(e, _)| e)
+    }
+
+    pub fn duplicate(&self) -> Result<Self, Error> {
+        unsafe { dup_right(self.0) }
+            .result()
+            .map(Self)
+            .map_err(|(e, _)| e)
+    }
+
+    /// Makes the caller the pager of the object. The kernel sends IPCKernelRequestPage messages
+    /// through the given right when a page is missing. Returns the id of the memory object, which
+    /// is used in the requests. The pager can only be set once.
+    pub fn set_pager(&self, pager: &SendManyRight) -> Result<u64, Error> {
+        let SyscallR { result, value } = unsafe { set_mem_object_pager(self.0, pager.0) };
+        result.result().map(|()| value)
+    }
+
+    /// Provides the page at the offset to the object, waking up the tasks waiting for it. If data
+    /// is None or shorter than the page, the rest is filled with zeros. Only the owner of the
+    /// pager's port can provide the pages.
+    pub fn provide_page(&self, offset: u64, data: Option<&[u8]>) -> Result<(), Error> {
+        const PAGE_SIZE: usize = 4096;
+        match data {
+            Some(d) if d.len() >= PAGE_SIZE => unsafe {
+                provide_mem_object_page(self.0, offset, d.as_ptr())
+            }
+            .result(),
+            Some(d) => {
+                let mut page = vec![0u8; PAGE_SIZE];
+                page[..d.len()].copy_from_slice(d);
+                unsafe { provide_mem_object_page(self.0, offset, page.as_ptr()) }.result()
+            }
+            None => unsafe { provide_mem_object_page(self.0, offset, ptr::null()) }.result(),
+        }
+    }
+
     pub unsafe fn map(&self, offset: u64, size: u64) -> Result<ObjectMmap, Error> {
+        unsafe { self.map_with_access(offset, size, MAP_PROT_READ) }
+    }
+
+    /// Maps the object for reading and writing, e.g. to fill the buffers shared by the clients
+    pub unsafe fn map_writable(&self, offset: u64, size: u64) -> Result<ObjectMmap, Error> {
+        unsafe { self.map_with_access(offset, size, MAP_PROT_READ | MAP_PROT_WRITE) }
+    }
+
+    unsafe fn map_with_access(&self, offset: u64, size: u64, access: u64) -> Result<ObjectMmap, Error> {
         let params = MapMemObjectParamT {
             page_table_id: 0, // Page table self
             mem_object_id_right: self.0,
@@ -603,7 +664,7 @@ impl MemoryObjectRight {
             offset_object: offset,
             offset_start: 0,
             object_size: size,
-            access_flags: MAP_PROT_READ | MAP_MEM_OBJECT_IS_RIGHT,
+            access_flags: access | MAP_MEM_OBJECT_IS_RIGHT,
         };
 
         let result = unsafe { map_mem_object(&params) };
@@ -154,6 +154,167 @@ pub struct IPCRead {
     pub max_size: u64,
 }
 
+pub const IPC_READ_SHARED_NUM: u32 = 0x43;
+/// Read into a memory object shared with the client. The object is sent along with the first
+/// request (and whenever the client replaces it), and is kept by the server until the file is closed.
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCReadShared {
+    msg_type: u32,
+    pub flags: u32,
+    pub offset: u64,
+    pub max_size: u64,
+    /// Size of the shared object
+    pub buffer_size: u64,
+}
+
+pub const IPC_READ_SHARED_REPLY_NUM: u32 = 0x52;
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCReadSharedReply {
+    msg_type: u32,
+    pub flags: u16,
+    pub result: i16,
+    pub bytes_read: u64,
+}
+
+impl IPCReadSharedReply {
+    pub fn new(result: i16, bytes_read: u64) -> Self {
+        Self {
+            msg_type: IPC_READ_SHARED_REPLY_NUM,
+            flags: 0,
+            result,
+            bytes_read,
+        }
+    }
+}
+
+pub const IPC_MMAP_NUM: u32 = 0x44;
+/// Requests a memory object with the contents of the file, to be mapped by the client
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCMmap {
+    msg_type: u32,
+    /// MAP_SHARED or MAP_PRIVATE
+    pub flags: u32,
+    /// PROT_READ, PROT_WRITE and PROT_EXEC
+    pub prot: u32,
+}
+
+pub const MAP_SHARED: u32 = 0x01;
+pub const MAP_PRIVATE: u32 = 0x02;
+pub const PROT_WRITE: u32 = 0x02;
+
+pub const IPC_MMAP_REPLY_NUM: u32 = 0x53;
+/// Reply to IPCMmap. On success, the memory object right is sent with it
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCMmapReply {
+    msg_type: u32,
+    pub flags: u16,
+    pub result: i16,
+    /// Size of the object, in bytes
+    pub object_size: u64,
+}
+
+impl IPCMmapReply {
+    pub fn new(result: i16, object_size: u64) -> Self {
+        Self {
+            msg_type: IPC_MMAP_REPLY_NUM,
+            flags: 0,
+            result,
+            object_size,
+        }
+    }
+}
+
+pub const IPC_MSYNC_NUM: u32 = 0x45;
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCMsync {
+    msg_type: u32,
+    pub flags: u32,
+    pub offset: u64,
+    pub size: u64,
+}
+
+pub const IPC_MSYNC_REPLY_NUM: u32 = 0x54;
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCMsyncReply {
+    msg_type: u32,
+    pub flags: u16,
+    pub result: i16,
+}
+
+impl IPCMsyncReply {
+    pub fn new(result: i16) -> Self {
+        Self {
+            msg_type: IPC_MSYNC_REPLY_NUM,
+            flags: 0,
+            result,
+        }
+    }
+}
+
+pub const IPC_POLL_REGISTER_NUM: u32 = 0x46;
+/// Asks for the readiness of the file. If the message carries a right, the server notifies through
+/// it with IPCPollNotify each time one of the events becomes ready.
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCPollRegister {
+    msg_type: u32,
+    pub flags: u32,
+    pub events: u32,
+    _pad: u32,
+    pub cookie: u64,
+}
+
+pub const POLLIN: u32 = 0x001;
+pub const POLLOUT: u32 = 0x002;
+pub const POLLRDNORM: u32 = 0x004;
+pub const POLLWRNORM: u32 = POLLOUT;
+
+pub const IPC_POLL_REGISTER_REPLY_NUM: u32 = 0x55;
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCPollRegisterReply {
+    msg_type: u32,
+    pub flags: u16,
+    pub result: i16,
+    pub revents: u32,
+}
+
+impl IPCPollRegisterReply {
+    pub fn new(result: i16, revents: u32) -> Self {
+        Self {
+            msg_type: IPC_POLL_REGISTER_REPLY_NUM,
+            flags: 0,
+            result,
+            revents,
+        }
+    }
+}
+
+pub const IPC_POLL_NOTIFY_NUM: u32 = 0x47;
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCPollNotify {
+    msg_type: u32,
+    pub revents: u32,
+    pub cookie: u64,
+}
+
+impl IPCPollNotify {
+    pub fn new(revents: u32, cookie: u64) -> Self {
+        Self {
+            msg_type: IPC_POLL_NOTIFY_NUM,
+            revents,
+            cookie,
+        }
+    }
+}
+
 pub const IPC_READ_REPLY_NUM: u32 = 0x50;
 #[derive(Debug)]
 pub struct IPCReadReply<'a> {
@@ -361,6 +522,8 @@ impl Serializable for IPCFSResolvePath {
 }
 
 pub const IPC_FS_OPEN_REPLY_NUM: u32 = 0xD0;
+/// The opened file accepts IPCReadShared
+pub const IPC_FS_FLAG_SHARED_READ: u16 = 0x01;
 #[repr(C)]
 #[derive(Debug, Copy, Clone, Zeroable, Pod)]
 pub struct IPCFSOpenReply {
@@ -509,6 +672,17 @@ pub struct IPCFSProbeResult {
     pub properties: Vec<FSProperty>,
 }
 
+pub const IPC_KERNEL_REQUEST_PAGE_NUM: u32 = 0x23;
+/// Sent by the kernel to the pager of a memory object when one of its pages is missing
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Zeroable, Pod)]
+pub struct IPCKernelRequestPage {
+    msg_type: u32,
+    pub flags: u32,
+    pub mem_object_id: u64,
+    pub page_offset: u64,
+}
+
 pub const IPC_KERNEL_RECIEVE_RIGHT_DESTROYED_NUM: u32 = 0x26;
 #[repr(C)]
 #[derive(Copy, Clone, Debug, Zeroable, Pod)]
@@ -631,6 +805,11 @@ pub enum Message<'a> {
     IPCKernelRightDestroyed(IPCKernelRightDestroyed),
     IPCNamedRightNotification(IPCNamedRightNotification),
     IPCRead(IPCRead),
+    IPCReadShared(IPCReadShared),
+    IPCMmap(IPCMmap),
+    IPCMsync(IPCMsync),
+    IPCPollRegister(IPCPollRegister),
+    IPCKernelRequestPage(IPCKernelRequestPage),
     IPCFSOpen(IPCFSOpen),
     IPCMountFS(IPCMountFS),
     IPCMountFSReply(IPCMountFSReply),
@@ -730,6 +909,16 @@ impl super::ipc::Message {
                 }
                 IPC_READ_NUM =>
                     try_from_bytes::<IPCRead>(data).map(|data| Message::IPCRead(data.clone())).unwrap_or(Message::Unknown),
+                IPC_READ_SHARED_NUM =>
+                    try_from_bytes::<IPCReadShared>(data).map(|data| Message::IPCReadShared(data.clone())).unwrap_or(Message::Unknown),
+                IPC_MMAP_NUM =>
+                    try_from_bytes::<IPCMmap>(data).map(|data| Message::IPCMmap(data.clone())).unwrap_or(Message::Unknown),
+                IPC_POLL_REGISTER_NUM =>
+                    try_from_bytes::<IPCPollRegister>(data).map(|data| Message::IPCPollRegister(data.clone())).unwrap_or(Message::Unknown),
+                IPC_MSYNC_NUM =>
+                    try_from_bytes::<IPCMsync>(data).map(|data| Message::IPCMsync(data.clone())).unwrap_or(Message::Unknown),
+                IPC_KERNEL_REQUEST_PAGE_NUM =>
+                    try_from_bytes::<IPCKernelRequestPage>(data).map(|data| Message::IPCKernelRequestPage(data.clone())).unwrap_or(Message::Unknown),
                 IPC_OPEN_NUM => {
                     if data.len() < size_of::<IPCOpenHdr>() {
                         return Message::Unknown;
@@ -219,37 +219,24 @@ typedef void *pthread_t;
     #define __DECLARED_PTHREAD_T
 #endif
 
-#if (defined(__DECLARE_PTHREAD_MUTEX_T) || defined(__DECLARE_PTHREAD_COND_T)) && \
-    !defined(__DECLARED___PTHREAD_WAITER)
-struct __pthread_waiter {
-    __pmos64u_t notification_port;
-    struct __pthread_waiter *next;
-};
-    #define __DECLARED___PTHREAD_WAITER
-#endif
-
 #if defined(__DECLARE_PTHREAD_MUTEX_T) && !defined(__DECLARED_PTHREAD_MUTEX_T)
 typedef struct {
-    __pmos64u_t block_count;
-    void * blocking_thread;
-    struct __pthread_waiter *waiters_list_head;
-    struct __pthread_waiter *waiters_list_tail;
-    unsigned long recursive_lock_count;
+    // Futex word: 0 if unlocked, 1 if locked and 2 if there might be threads waiting for it
+    unsigned int state;
     int type;
-#ifdef __i386__
-    int reserved;
-} pthread_mutex_t __attribute__((aligned(8)));
-#else
+    void *blocking_thread;
+    unsigned long recursive_lock_count;
 } pthread_mutex_t;
-#endif
     #define __DECLARED_PTHREAD_MUTEX_T
 #endif
 
 #if defined(__DECLARE_PTHREAD_COND_T) && !defined(__DECLARED_PTHREAD_COND_T)
 typedef struct {
-    struct __pthread_waiter *waiters_list_head;
-    struct __pthread_waiter *waiters_list_tail;
-    int pop_spinlock;
+    // Futex word, incremented by every signal and broadcast
+    unsigned int sequence;
+    unsigned int waiters;
+    // pthread_condattr_t the condition variable was initialized with
+    unsigned int attr;
 } pthread_cond_t;
     #define __DECLARED_PTHREAD_COND_T
 #endif
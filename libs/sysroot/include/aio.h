@@ -0,0 +1,71 @@
+#ifndef _AIO_H
+#define _AIO_H 1
+
+#include <signal.h>
+
+#define __DECLARE_SIZE_T
+#define __DECLARE_SSIZE_T
+#define __DECLARE_OFF_T
+#include "__posix_types.h"
+
+struct timespec;
+
+struct aiocb {
+    int aio_fildes;               //< File descriptor
+    off_t aio_offset;             //< File offset
+    volatile void *aio_buf;       //< Location of the buffer
+    size_t aio_nbytes;            //< Length of the transfer
+    int aio_reqprio;              //< Request priority offset (ignored)
+    struct sigevent aio_sigevent; //< Notification type (only SIGEV_NONE is supported)
+    int aio_lio_opcode;           //< Operation to be performed by lio_listio()
+
+    // Private
+    int __error;
+    ssize_t __return;
+    void *__ring;
+};
+
+/// Return values of aio_cancel()
+#define AIO_CANCELED    0
+#define AIO_NOTCANCELED 1
+#define AIO_ALLDONE     2
+
+/// Operations of lio_listio()
+#define LIO_READ  0
+#define LIO_WRITE 1
+#define LIO_NOP   2
+
+/// Modes of lio_listio()
+#define LIO_WAIT   0
+#define LIO_NOWAIT 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __STDC_HOSTED__
+
+/*
+ * The requests are submitted to a ring of the calling thread (see <pmos/io_ring.h>), and their
+ * completions are collected by the calls to aio_error() and aio_suspend() from the same thread.
+ * Other threads see the requests in progress until then.
+ */
+
+int aio_read(struct aiocb *aiocbp);
+int aio_write(struct aiocb *aiocbp);
+int lio_listio(int mode, struct aiocb *const list[], int nent, struct sigevent *sig);
+
+int aio_error(const struct aiocb *aiocbp);
+ssize_t aio_return(struct aiocb *aiocbp);
+int aio_suspend(const struct aiocb *const list[], int nent, const struct timespec *timeout);
+
+int aio_cancel(int fildes, struct aiocb *aiocbp);
+int aio_fsync(int op, struct aiocb *aiocbp);
+
+#endif // __STDC_HOSTED__
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // _AIO_H
@@ -119,6 +119,7 @@ typedef struct {
 #define AT_PHDR   3 // a_ptr, PHDR address
 #define AT_PHENT  4 // a_val, PHDR size of entry
 #define AT_PHNUM  5 // a_val, PHDR number of entries
+#define AT_HWCAP  16 // a_val, Architecture-specific CPU features usable by the user space
 
 #define	AT_USRSTACKBASE	35 // Base (top) of the userspace stack
 #define	AT_USRSTACKLIM  36 // Maximum size of the user stack
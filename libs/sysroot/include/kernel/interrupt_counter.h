@@ -0,0 +1,24 @@
+#ifndef KERNEL_INTERRUPT_COUNTER_H
+#define KERNEL_INTERRUPT_COUNTER_H
+
+#include "types.h"
+
+// Flag of SYSCALL_SET_INTERRUPT, counting the interrupts in the shared memory instead of sending a
+// message for every one of them
+#define SET_INTERRUPT_COUNTER 0x01
+
+// Flag of SYSCALL_COMPLETE_INTERRUPT, keeping the interrupt masked while the driver polls the
+// device
+#define COMPLETE_INTERRUPT_POLL 0x01
+
+// Interrupt counter, shared between the kernel and the driver. Must not cross a page boundary.
+struct interrupt_counter {
+    // Incremented by the kernel on every interrupt
+    u64 count;
+    // Set to non-zero by the driver before it blocks on the port. The kernel only sends the
+    // notification message if it is set, clearing it.
+    u32 waiting;
+    u32 reserved;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef KERNEL_INTERRUPT_STATS_H
+#define KERNEL_INTERRUPT_STATS_H
+#include "types.h"
+
+#define INTERRUPT_STATS_EDGE    0x01
+// The line is masked while the driver polls the device
+#define INTERRUPT_STATS_POLLING 0x02
+
+struct interrupt_stats_entry {
+    // Number of times the interrupt has fired
+    u64 count;
+    // Task that handles the interrupt, or 0 if nobody does
+    u64 owner_task;
+    u32 id;
+    // -1 for the message-signalled interrupts
+    u32 gsi;
+    // CPU the interrupt is delivered to, in the same format as get_interrupt_affinity()
+    u32 cpu;
+    u32 flags;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef KERNEL_LOCKSTAT_H
+#define KERNEL_LOCKSTAT_H
+#include "types.h"
+
+// Clear the counters after reading them
+#define LOCKSTAT_RESET 0x01
+
+// Statistics of a kernel spinlock call site. The time is in the CPU timestamp counter ticks
+// (TSC on x86, time CSR on RISC-V, stable counter on LoongArch).
+struct lockstat_entry {
+    // Kernel address of the code taking the lock. 0 holds everything that didn't fit
+    u64 site;
+    u64 acquisitions;
+    // Acquisitions that had to wait for the lock
+    u64 contended;
+    // Total time spent waiting for the lock
+    u64 spin_ticks;
+    // Total and maximum time the lock was held
+    u64 hold_ticks;
+    u64 max_hold_ticks;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef KERNEL_MSI_H
+#define KERNEL_MSI_H
+
+#include "types.h"
+
+// Message to be programmed into the MSI or MSI-X capability of the device
+struct msi_message {
+    u64 address;
+    u32 data;
+    // CPU the interrupt is delivered to, in the same format as get_interrupt_affinity()
+    u32 cpu;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef KERNEL_RCU_STATS_H
+#define KERNEL_RCU_STATS_H
+#include "types.h"
+
+// Indexes of the entries returned by pmos_get_rcu_stats()
+#define RCU_STATS_PAGING 0
+#define RCU_STATS_HEAP   1
+
+// State of one of the kernel RCUs, with the callbacks summed over all CPUs
+struct rcu_stats_entry {
+    char name[16];
+    // Number of the grace periods so far
+    u64 generation;
+    // Callbacks waiting for their grace period to end
+    u64 callbacks_waiting;
+    // Callbacks whose grace period has ended, but which haven't been run yet
+    u64 callbacks_ready;
+    u64 callbacks_run;
+    // Largest number of the ready callbacks seen on a single CPU
+    u64 max_ready;
+    // Number of the grace periods hurried up with IPIs
+    u64 expedited;
+};
+
+#endif
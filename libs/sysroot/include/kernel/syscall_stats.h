@@ -0,0 +1,23 @@
+#ifndef KERNEL_SYSCALL_STATS_H
+#define KERNEL_SYSCALL_STATS_H
+#include "types.h"
+
+// Clear the counters after reading them
+#define SYSCALL_STATS_RESET 0x01
+
+#define SYSCALL_STATS_BUCKETS 32
+
+// Statistics of a system call, summed over all CPUs
+struct syscall_stats_entry {
+    char name[32];
+    u64 calls;
+    // Number of times the system call had to be restarted, after blocking the task (e.g. to fetch
+    // the page of the user buffer)
+    u64 repeats;
+    // Time spent in the kernel handling the call, in CPU timestamp counter ticks. Bucket N counts
+    // the calls that took [2^N, 2^(N+1)) ticks, with the first one also counting 0 and the last
+    // one everything longer.
+    u64 latency_histogram[SYSCALL_STATS_BUCKETS];
+};
+
+#endif
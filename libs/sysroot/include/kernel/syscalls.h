@@ -101,5 +101,17 @@
 #define SYSCALL_WATCH_RIGHT                 60
 #define SYSCALL_CREATE_TIMER                61
 #define SYSCALL_SET_TIMER_DEADLINE          62
+#define SYSCALL_SET_AFFINITY_MASK           63
+#define SYSCALL_GET_LOCKSTAT                64
+#define SYSCALL_GET_SYSCALL_STATS           65
+#define SYSCALL_ALLOCATE_MSI                66
+#define SYSCALL_GET_MSI_MESSAGE             67
+#define SYSCALL_SET_INTERRUPT_CPU           68
+#define SYSCALL_GET_INTERRUPT_STATS         69
+#define SYSCALL_GET_RCU_STATS               70
+#define SYSCALL_FUTEX_WAIT                  71
+#define SYSCALL_FUTEX_WAKE                  72
+#define SYSCALL_SET_MEM_OBJECT_PAGER        73
+#define SYSCALL_PROVIDE_MEM_OBJECT_PAGE     74
 
 #endif
\ No newline at end of file
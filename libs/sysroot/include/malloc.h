@@ -0,0 +1,63 @@
+#ifndef _MALLOC_H
+#define _MALLOC_H 1
+
+#define __DECLARE_SIZE_T
+#include "__posix_types.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/// Statistics of the heap, as returned by mallinfo()
+struct mallinfo {
+    size_t arena;    ///< Non-mmapped space allocated from the system
+    size_t ordblks;  ///< Number of free chunks
+    size_t smblks;   ///< Number of blocks held in the thread caches
+    size_t hblks;    ///< Always 0
+    size_t hblkhd;   ///< Space in mmapped regions
+    size_t usmblks;  ///< Maximum total allocated space
+    size_t fsmblks;  ///< Space held in the thread caches
+    size_t uordblks; ///< Total allocated space
+    size_t fordblks; ///< Total free space, including the thread caches
+    size_t keepcost; ///< Space releasable by malloc_trim()
+};
+
+// mallopt() parameters
+#define M_TRIM_THRESHOLD (-1)
+#define M_GRANULARITY    (-2)
+#define M_MMAP_THRESHOLD (-3)
+/// Maximum number of blocks kept per size class in each thread's cache, 0 disables the caches
+#define M_THREAD_CACHE   (-100)
+/// If not 0, the threads that haven't allocated yet get their own heaps (mspaces) instead of
+/// sharing the global one
+#define M_THREAD_MSPACES (-101)
+
+void *malloc(size_t size);
+void *calloc(size_t nmemb, size_t size);
+void *realloc(void *ptr, size_t size);
+void free(void *ptr);
+
+void *memalign(size_t alignment, size_t size);
+void *valloc(size_t size);
+void *pvalloc(size_t size);
+
+size_t malloc_usable_size(void *ptr);
+
+struct mallinfo mallinfo(void);
+int mallopt(int param, int value);
+
+/// @brief Returns the unused memory to the system
+///
+/// Also empties the calling thread's cache.
+/// @param pad Free space to keep at the top of the heap
+/// @return 1 if any memory was released, 0 otherwise
+int malloc_trim(size_t pad);
+
+/// Prints the heap statistics to stderr
+void malloc_stats(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+#endif
@@ -38,7 +38,7 @@ private:
         value_type value;
         RBTreeNode<Node> bst_head;
 
-        Node(const K &&key, V &&value): value(key, value) {}
+        Node(const K &&key, V &&value): value(key, pmos::utility::move(value)) {}
     };
 
     using tree_type = RedBlackTree<Node, &Node::bst_head, detail::MapTreeCmp<Node, K>>;
@@ -87,6 +87,7 @@ public:
     // first == nullptr, second == false => allocation failed
     std::pair<iterator, bool> insert_noexcept(const value_type &val) noexcept;
     std::pair<iterator, bool> insert_noexcept(value_type &&val) noexcept;
+    // Removes and frees the element, returning the one after it
     iterator erase(iterator pos) noexcept;
     size_type erase(const key_type &key) noexcept;
 
@@ -119,7 +120,6 @@ template<typename K, typename V> size_t map<K, V>::erase(const K &key) noexcept
     }
 
     erase(it);
-    dealloc(it);
     return 1;
 }
 
@@ -142,7 +142,9 @@ std::pair<typename map<K, V>::iterator, bool> map<K, V>::insert_noexcept(value_t
 template<typename K, typename V>
 typename map<K, V>::iterator map<K, V>::erase(iterator pos) noexcept
 {
-    return tree.erase(pos);
+    auto next = tree.erase(pos);
+    dealloc(pos);
+    return next;
 }
 
 template<typename K, typename V> bool map<K, V>::empty() const noexcept { return tree.empty(); }
@@ -177,10 +179,8 @@ template<typename K, typename V> map<K, V>::~map() noexcept { clear(); }
 template<typename K, typename V> void map<K, V>::clear() noexcept
 {
     iterator it;
-    while ((it = begin()) != end()) {
+    while ((it = begin()) != end())
         erase(it);
-        dealloc(it);
-    }
 }
 
 template<typename K, typename V> map<K, V>::size_type map<K, V>::size() const noexcept
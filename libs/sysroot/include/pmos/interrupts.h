@@ -34,13 +34,46 @@ extern "C" {
 #endif
 
 #include "ports.h"
+#include "../kernel/interrupt_counter.h"
+#include "../kernel/interrupt_stats.h"
+#include "../kernel/msi.h"
 
 #ifdef __STDC_HOSTED__
 
 right_request_t set_interrupt(pmos_right_t right, pmos_port_t port);
 
+/// @brief Registers the interrupt, counting it in the shared memory instead of sending a message
+/// every time
+///
+/// On every interrupt, the kernel increments counter->count. The notification message is only
+/// sent to the port if counter->waiting is set, which the driver should do (and then check the
+/// count again) before blocking on the port. This way, a busy driver can process the interrupts
+/// without any syscalls. Edge-triggered interrupts (e.g. MSIs) are completed by the kernel; for
+/// the others, complete_interrupt() should be called once the new interrupts have been serviced.
+/// @param right Interrupt source right
+/// @param port Port owned by the caller, to which the notifications are sent
+/// @param counter Counter, which must be in normal memory and must not cross the page boundary.
+///                It must stay valid while the interrupt is registered.
+/// @return On success, the interrupt notification right
+right_request_t set_interrupt_counter(pmos_right_t right, pmos_port_t port,
+                                      struct interrupt_counter *counter);
+
 result_t complete_interrupt(pmos_port_t port, pmos_right_t recieve_right);
 
+/// @brief Completes the interrupt, keeping it masked while the driver polls the device
+///
+/// Under load, the driver can process the device's work in batches instead of taking an interrupt
+/// for each of it. After delay_ns, the notification is sent again (or the counter is incremented,
+/// see set_interrupt_counter()) as if the interrupt has fired, and the driver should poll the
+/// device. If it finds more work, it calls this function again; otherwise, complete_interrupt()
+/// unmasks the interrupt. Edge-triggered interrupts that arrive while masked are lost, so the
+/// device should be checked once more after it is unmasked.
+/// @param port Port the notification right belongs to
+/// @param recieve_right Interrupt notification right
+/// @param delay_ns Coalescing delay, after which the driver is notified to poll again
+/// @return 0 on success, -EINVAL if delay_ns is 0
+result_t complete_interrupt_poll(pmos_port_t port, pmos_right_t recieve_right, uint64_t delay_ns);
+
 typedef struct interrupt_info_t {
     result_t result;
     u32 interrupt_affinity_cpu;
@@ -49,6 +82,44 @@ typedef struct interrupt_info_t {
 
 interrupt_info_t get_interrupt_affinity(pmos_right_t right);
 
+/// @brief Allocates a message-signalled interrupt
+///
+/// The returned right is used the same way as the one from allocate_interrupt(). The message
+/// to program into the device is obtained with get_msi_message(). The interrupt is freed once
+/// all of its source rights and the notification rights created from them are deleted, so the
+/// device must stop sending the message before that.
+/// @param cpu CPU the interrupt should be delivered to (in the format of get_interrupt_affinity()),
+///            or 0 to let the kernel choose
+/// @return On success, the interrupt source right. -ENOTSUP if the platform doesn't support MSIs.
+right_request_t allocate_msi(uint32_t cpu);
+
+/// @brief Gets the address and the data the device must write to trigger the MSI
+/// @param right Interrupt source right returned by allocate_msi()
+/// @param message Output for the message
+/// @return 0 on success, -EINVAL if the right is not for an MSI
+result_t get_msi_message(pmos_right_t right, struct msi_message *message);
+
+/// @brief Moves the interrupt to another CPU, together with the calling thread
+///
+/// The caller must own all of the notification rights of the interrupt, and no other interrupts,
+/// since they are bound to the CPU the interrupt is delivered to. Pending notifications are kept,
+/// and an interrupt that is not yet completed stays masked until it is completed on the new CPU.
+/// @param port Port the notification right belongs to
+/// @param recieve_right Interrupt notification right
+/// @param cpu New CPU, in the format of get_interrupt_affinity()
+/// @return 0 on success, -EBUSY if the interrupt is shared with other tasks, -ENOTSUP if it can't
+///         be moved (e.g. MSIs, which should be allocated on the right CPU instead)
+result_t set_interrupt_cpu(pmos_port_t port, pmos_right_t recieve_right, uint32_t cpu);
+
+/// @brief Reads the counters of the allocated interrupts
+///
+/// Entry N of the buffer describes the interrupt with the id N.
+/// @param buffer Buffer for the entries
+/// @param count Number of entries the buffer can hold
+/// @return syscall_r result of the operation. On success, the value holds the number of entries
+///         written, which is less than count if there are no more interrupts.
+syscall_r get_interrupt_stats(struct interrupt_stats_entry *buffer, size_t count);
+
 #endif
 
 #if defined(__cplusplus)
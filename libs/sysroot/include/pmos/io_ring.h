@@ -0,0 +1,80 @@
+#ifndef _PMOS_IO_RING_H
+#define _PMOS_IO_RING_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Batched asynchronous I/O
+ *
+ * The requests are sent to the servers as soon as they are submitted, without waiting for the
+ * replies, so that many of them can be in flight at the same time. The replies are delivered to the
+ * port of the ring and turned into completions by pmos_io_ring_wait(), in the order they arrive.
+ *
+ * The port is owned by the thread which created the ring, so it must be the only one using it.
+ * The descriptors not supporting the asynchronous I/O (for example, the logger) are accessed
+ * synchronously during the submission, and complete immediately.
+ */
+typedef struct pmos_io_ring pmos_io_ring_t;
+
+#define PMOS_IO_READ  0
+#define PMOS_IO_WRITE 1
+#define PMOS_IO_NOP   2
+
+/// Submission entry
+struct pmos_io_sqe {
+    uint32_t opcode;    //< PMOS_IO_*
+    int fd;             //< Descriptor
+    void *buf;          //< Buffer, which must stay valid until the completion for the reads
+    size_t len;         //< Size of the buffer
+    uint64_t offset;    //< Offset in the file. The requests don't change the file position.
+    uint64_t user_data; //< Returned in the completion
+};
+
+/// Completion entry
+struct pmos_io_cqe {
+    uint64_t user_data; //< user_data of the submission
+    int64_t result;     //< Number of bytes transferred, or -errno on error
+};
+
+#ifdef __STDC_HOSTED__
+
+/// @brief Creates a new ring
+/// @param entries Maximum number of requests submitted and not yet waited for
+/// @return The ring, or NULL with errno set
+pmos_io_ring_t *pmos_io_ring_create(unsigned entries);
+
+/// @brief Destroys the ring. The replies of the requests still in flight are discarded.
+void pmos_io_ring_destroy(pmos_io_ring_t *ring);
+
+/// @brief Submits the requests
+///
+/// The errors of the individual requests (like bad descriptors) are reported in their completions.
+/// @return The number of requests submitted, which is less than count if the ring is full, or -1
+///         with errno set to EBUSY if none could be
+int pmos_io_ring_submit(pmos_io_ring_t *ring, const struct pmos_io_sqe *sqes, unsigned count);
+
+/// @brief Waits for the completions
+/// @param cqes Completions output
+/// @param max Maximum number of completions to return
+/// @param min Number of completions to wait for. It is limited to the number of requests in the ring.
+/// @param timeout_ns Timeout in nanoseconds, or -1 to wait indefinitely
+/// @return The number of completions stored in cqes, which might be less than min on timeout, or -1
+///         with errno set
+int pmos_io_ring_wait(pmos_io_ring_t *ring, struct pmos_io_cqe *cqes, unsigned max, unsigned min,
+                      int64_t timeout_ns);
+
+/// @brief Returns the number of the submitted requests which completions haven't been returned yet
+unsigned pmos_io_ring_pending(const pmos_io_ring_t *ring);
+
+#endif // __STDC_HOSTED__
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+#endif // _PMOS_IO_RING_H
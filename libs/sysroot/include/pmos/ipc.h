@@ -161,6 +161,21 @@ typedef struct IPC_Request_PCI_Interrupt {
     uint16_t pin;
 } IPC_Register_PCI_Interrupt;
 
+// Replies with IPC_Request_Int_Reply
+// Allocates a message-signalled interrupt for the device, through MSI-X if the device supports it
+// and MSI otherwise. Every vector of MSI-X can be delivered to a different CPU; with MSI, only
+// vector 0 is available. Returns -ENOTSUP if the device has neither, in which case
+// IPC_Request_PCI_Interrupt should be used instead.
+#define IPC_Request_PCI_MSI_NUM 0x14
+typedef struct IPC_Request_PCI_MSI {
+    uint32_t type;
+    uint16_t flags;
+    // Index of the entry in the MSI-X table
+    uint16_t vector;
+    // CPU to deliver the interrupt to (as returned by get_interrupt_affinity()), or 0 for any
+    uint32_t cpu;
+} IPC_Request_PCI_MSI;
+
 #define IPC_PCI_Read_NUM 0x0F
 typedef struct IPC_PCI_Read {
     uint32_t type;
@@ -357,6 +372,150 @@ typedef struct IPC_Read_Reply {
     unsigned char data[];
 } IPC_Read_Reply;
 
+#define IPC_Read_Shared_NUM 0x43
+/// Reads the file into a memory object shared with the server, instead of copying the data into
+/// the reply. The memory object is sent as the first extra right with the first request and each
+/// time the client replaces it; the server keeps its mapping until the file is closed. Only
+/// supported if the server has set IPC_FS_FLAG_SHARED_READ when opening the file.
+typedef struct IPC_Read_Shared {
+    /// Message type (must be IPC_Read_Shared_NUM)
+    uint32_t type;
+
+    /// Flags changing the behaviour
+    uint32_t flags;
+
+    /// Beginning of the file to be read
+    uint64_t start_offset;
+
+    /// Maximum size to be read
+    uint64_t max_size;
+
+    /// Size of the memory object. The data is always written at its start.
+    uint64_t buffer_size;
+} IPC_Read_Shared;
+
+#define IPC_Read_Shared_Reply_NUM 0x52
+typedef struct IPC_Read_Shared_Reply {
+    /// Message type (must be IPC_Read_Shared_Reply_NUM)
+    uint32_t type;
+
+    /// Flags changing the behaviour
+    uint16_t flags;
+
+    /// Result of the operation
+    int16_t result_code;
+
+    /// Number of bytes written to the memory object. 0 indicates the end of the file.
+    uint64_t bytes_read;
+} IPC_Read_Shared_Reply;
+
+#define IPC_Mmap_NUM 0x44
+/// Requests the memory object holding the contents of the file, for mmap(). The object is
+/// returned as the first extra right of the reply. Its pages are provided by the server on demand,
+/// and the object is shared by all the mappings of the file.
+typedef struct IPC_Mmap {
+    /// Message type (must be IPC_Mmap_NUM)
+    uint32_t type;
+
+    /// Flags of the mapping (MAP_SHARED or MAP_PRIVATE)
+    uint32_t flags;
+
+    /// Protection of the mapping (PROT_*)
+    uint32_t prot;
+} IPC_Mmap;
+
+#define IPC_Mmap_Reply_NUM 0x53
+typedef struct IPC_Mmap_Reply {
+    /// Message type (must be IPC_Mmap_Reply_NUM)
+    uint32_t type;
+
+    /// Flags changing the behaviour
+    uint16_t flags;
+
+    /// Result of the operation
+    int16_t result_code;
+
+    /// Size of the memory object in bytes. Accessing the pages past it is an error.
+    uint64_t object_size;
+} IPC_Mmap_Reply;
+
+#define IPC_Msync_NUM 0x45
+/// Asks the server to write back the range of the file's memory object
+typedef struct IPC_Msync {
+    /// Message type (must be IPC_Msync_NUM)
+    uint32_t type;
+
+    /// MS_SYNC or MS_ASYNC. With MS_ASYNC, the server may reply before the data is written.
+    uint32_t flags;
+
+    /// Start of the range in the file
+    uint64_t offset;
+
+    /// Size of the range
+    uint64_t size;
+} IPC_Msync;
+
+#define IPC_Msync_Reply_NUM 0x54
+typedef struct IPC_Msync_Reply {
+    /// Message type (must be IPC_Msync_Reply_NUM)
+    uint32_t type;
+
+    /// Flags changing the behaviour
+    uint16_t flags;
+
+    /// Result of the operation
+    int16_t result_code;
+} IPC_Msync_Reply;
+
+#define IPC_Poll_Register_NUM 0x46
+/// Asks the server for the readiness of the file, for poll() and epoll. If the message carries an
+/// extra right, the server keeps it and sends IPC_Poll_Notify through it each time one of the
+/// events becomes ready, until sending fails (the client deletes the receive right to cancel the
+/// interest). Only sent if the server has set IPC_FS_FLAG_POLL when opening the file; the other
+/// files are always ready.
+typedef struct IPC_Poll_Register {
+    /// Message type (must be IPC_Poll_Register_NUM)
+    uint32_t type;
+
+    /// Flags changing the behaviour
+    uint32_t flags;
+
+    /// Events of interest (POLLIN, POLLOUT, etc.)
+    uint32_t events;
+
+    /// Value echoed in the notifications, identifying the registration for the client
+    uint64_t cookie;
+} IPC_Poll_Register;
+
+#define IPC_Poll_Register_Reply_NUM 0x55
+typedef struct IPC_Poll_Register_Reply {
+    /// Message type (must be IPC_Poll_Register_Reply_NUM)
+    uint32_t type;
+
+    /// Flags changing the behaviour
+    uint16_t flags;
+
+    /// Result of the operation
+    int16_t result_code;
+
+    /// Events that are ready now, plus POLLHUP and POLLERR
+    uint32_t revents;
+} IPC_Poll_Register_Reply;
+
+#define IPC_Poll_Notify_NUM 0x47
+/// Sent by the server through the right of IPC_Poll_Register when the events become ready. The
+/// notifications can be spurious, so the clients query the readiness again before relying on it.
+typedef struct IPC_Poll_Notify {
+    /// Message type (must be IPC_Poll_Notify_NUM)
+    uint32_t type;
+
+    /// Events that became ready
+    uint32_t revents;
+
+    /// Cookie of the registration
+    uint64_t cookie;
+} IPC_Poll_Notify;
+
 #define IPC_Write_Reply_NUM 0x51
 typedef struct IPC_Write_Reply {
     /// Message type (must be IPC_Write_Reply_NUM)
@@ -464,10 +623,15 @@ typedef struct IPC_Open_Reply {
     /// Result code indicating the outcome of the open operation
     int16_t result_code;
 
-    /// Flags associated with the file system
+    /// Flags associated with the file system (IPC_FS_FLAG_*)
     uint16_t fs_flags;
 } IPC_Open_Reply;
 
+/// The file supports IPC_Read_Shared
+#define IPC_FS_FLAG_SHARED_READ 0x01
+/// The readiness of the file can change, and the server accepts IPC_Poll_Register
+#define IPC_FS_FLAG_POLL 0x02
+
 #define IPC_Dup_NUM 0x5d
 typedef struct IPC_Dup {
     /// Message type (must be IPC_Dup_NUM)
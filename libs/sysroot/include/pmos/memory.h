@@ -338,6 +338,36 @@ syscall_r init_stack(uint64_t tid, uint64_t stack_top);
  */
 syscall_r get_mem_object_size(pmos_right_t mem_object_right, unsigned flags);
 
+/**
+ * @brief Makes the caller the pager of the memory object
+ *
+ * When a page of the object is accessed for the first time, the kernel sends
+ * IPC_Kernel_Request_Page through pager_right, and the accessing tasks are blocked until the page
+ * is provided with provide_mem_object_page().
+ *
+ * @param mem_object_right Right to the memory object. Anonymous and DMA objects can't have pagers
+ * @param pager_right Send many right to a port owned by the caller. It is not consumed, and the
+ * requests are sent to the port as if they came through it.
+ * @return syscall_r result of the operation. If the result is SUCCESS, the value is the ID of the
+ * object, as found in mem_object_id of IPC_Kernel_Request_Page. -EEXIST if the object already has
+ * a pager.
+ */
+syscall_r set_mem_object_pager(pmos_right_t mem_object_right, pmos_right_t pager_right);
+
+/**
+ * @brief Provides a page of the memory object
+ *
+ * Typically in response to IPC_Kernel_Request_Page. The data is copied into a new page, which
+ * then becomes part of the object.
+ *
+ * @param mem_object_right Right to the memory object
+ * @param offset Page aligned offset of the page in the object
+ * @param data PAGE_SIZE bytes of the contents of the page, or NULL for a zeroed page
+ * @return SUCCESS, -EEXIST if the object already has the page, or -EPERM if the caller doesn't own
+ * the port of the object's pager
+ */
+result_t provide_mem_object_page(pmos_right_t mem_object_right, uint64_t offset, const void *data);
+
 #endif
 
 #if defined(__cplusplus)
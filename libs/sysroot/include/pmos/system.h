@@ -28,7 +28,10 @@
 
 #ifndef _SYSTEM_H
 #define _SYSTEM_H 1
+#include "../kernel/lockstat.h"
 #include "../kernel/messaging.h"
+#include "../kernel/rcu_stats.h"
+#include "../kernel/syscall_stats.h"
 #include "../kernel/syscalls.h"
 #include "../kernel/types.h"
 
@@ -248,6 +251,23 @@ result_t request_priority(uint32_t priority);
  */
 result_t set_affinity(uint64_t tid, uint32_t cpu_id, uint32_t flags);
 
+/**
+ * @brief Restricts the task to a set of CPUs
+ *
+ * Unlike set_affinity(), which pins the task to a single CPU, this allows the kernel to schedule the
+ * task on any of the CPUs in the mask. Bit N of the mask corresponds to the CPU N + 1 in the
+ * set_affinity() numbering (i.e. bit 0 is the first CPU). CPUs not present in the system are
+ * ignored, and bytes past mask_size are treated as 0. A mask with all bits set removes the
+ * restriction.
+ *
+ * @param tid ID of the task. Takes TASK_ID_SELF (0).
+ * @param mask Pointer to the bitmask of CPUs
+ * @param mask_size Size of the mask in bytes
+ * @return result_t result of the operation. -EINVAL if the mask contains no existing CPUs, -EBUSY if
+ * the task is not the caller and is not paused, -EPERM if the task owns interrupts.
+ */
+result_t set_affinity_mask(uint64_t tid, const void *mask, size_t mask_size);
+
 /// Returns the LAPIC id the process is running on when calling the process
 /// @param cpu_num Index of the CPU (assigned by the kernel during its initialization).
 ///                0 counts as the CPU the caller is executing on.
@@ -379,6 +399,45 @@ result_t pmos_yield();
  */
 syscall_r pmos_get_time(unsigned mode);
 
+/**
+ * @brief Reads the kernel spinlock statistics
+ *
+ * The statistics are only collected if the kernel is built with ENABLE_LOCKSTAT. Otherwise, the
+ * call fails with -ENOSYS.
+ *
+ * @param buffer Buffer for the entries, one per lock call site
+ * @param count Number of entries the buffer can hold
+ * @param flags LOCKSTAT_RESET to clear the counters after reading them
+ * @return syscall_r result of the operation. On success, the value holds the total number of the
+ * call sites, which might be greater than count
+ */
+syscall_r pmos_get_lockstat(struct lockstat_entry *buffer, size_t count, unsigned flags);
+
+/**
+ * @brief Reads the per-syscall call counts and latency histograms
+ *
+ * Entry N of the buffer describes the system call number N.
+ *
+ * @param buffer Buffer for the entries
+ * @param count Number of entries the buffer can hold
+ * @param flags SYSCALL_STATS_RESET to clear the counters after reading them
+ * @return syscall_r result of the operation. On success, the value holds the number of system
+ * calls known to the kernel
+ */
+syscall_r pmos_get_syscall_stats(struct syscall_stats_entry *buffer, size_t count, unsigned flags);
+
+/**
+ * @brief Reads the state of the kernel RCUs
+ *
+ * Shows how many deferred frees are waiting for their grace periods and for being run, which is
+ * where the recently released memory goes before it becomes available again.
+ *
+ * @param buffer Buffer for the entries, indexed by RCU_STATS_*
+ * @param count Number of entries the buffer can hold
+ * @return syscall_r result of the operation. On success, the value holds the number of the RCUs
+ */
+syscall_r pmos_get_rcu_stats(struct rcu_stats_entry *buffer, size_t count);
+
 right_request_t request_named_port(const char *name, size_t name_length, pmos_port_t reply_port,
                             uint32_t flags);
 
@@ -525,6 +584,34 @@ result_t pmos_set_timer(pmos_port_t port, pmos_right_t timer_right, uint64_t dea
 
 #define PMOS_SET_TIMER_RELATIVE (1 << 0)
 
+/// @brief Blocks the thread while the value at addr is equal to expected
+///
+/// The value is checked atomically with respect to pmos_futex_wake(), so the wake-ups done after
+/// changing it are never lost. The thread can also be woken up spuriously, so the callers must
+/// recheck their condition.
+/// @param addr Address of the 4-byte aligned word
+/// @param expected Value with which to block
+/// @param timeout_ns Deadline in nanoseconds since bootup, or the timeout with PMOS_FUTEX_RELATIVE.
+/// 0 waits indefinitely.
+/// @param flags PMOS_FUTEX_SHARED and PMOS_FUTEX_RELATIVE
+/// @return 0 once woken up, -EAGAIN if the value was different, -ETIMEDOUT if the deadline has
+/// passed
+result_t pmos_futex_wait(const volatile uint32_t *addr, uint32_t expected, uint64_t timeout_ns,
+                         unsigned flags);
+
+/// @brief Wakes up the threads blocked on addr
+/// @param addr Address passed to pmos_futex_wait()
+/// @param count Maximum number of threads to wake up
+/// @param flags PMOS_FUTEX_SHARED, if the waiters used it
+/// @return Number of the woken up threads
+syscall_r pmos_futex_wake(const volatile uint32_t *addr, uint32_t count, unsigned flags);
+
+// The word is in memory shared with other processes. Without this flag, only the threads of the
+// same address space are woken up, which is cheaper.
+#define PMOS_FUTEX_SHARED   (1 << 0)
+// timeout_ns is relative to the current time
+#define PMOS_FUTEX_RELATIVE (1 << 1)
+
 #endif
 
 #if defined(__cplusplus)
@@ -60,6 +60,8 @@ extern "C" {
 
 #ifdef __STDC_HOSTED__
 
+struct timespec;
+
 int poll(struct pollfd *fds, nfds_t nfds, int timeout);
 int ppoll(struct pollfd[], nfds_t, const struct timespec *restrict, const sigset_t *_RESTRICT);
 
@@ -48,7 +48,7 @@
 
 #define PTHREAD_CANCELLED (-1)
 
-#define PTHREAD_COND_INITIALIZER {NULL, NULL, 0}
+#define PTHREAD_COND_INITIALIZER {0, 0, 0}
 
 #define PTHREAD_CREATE_JOINABLE (0x00)
 #define PTHREAD_CREATE_DETACHED (0x01)
@@ -57,12 +57,10 @@
 #define PTHREAD_EXPLICIT_SCHED (0x02)
 
 #define PTHREAD_MUTEX_INITIALIZER                     \
-    ((pthread_mutex_t) {.block_count          = 0x00, \
+    ((pthread_mutex_t) {.state                = 0x00, \
+                        .type                 = 0,    \
                         .blocking_thread      = NULL, \
-                        .waiters_list_head    = NULL, \
-                        .waiters_list_tail    = NULL, \
-                        .recursive_lock_count = 0,    \
-                        .type                 = 0})
+                        .recursive_lock_count = 0})
 
 #define PTHREAD_ONCE_INIT ((pthread_once_t)(0x00))
 
@@ -78,15 +76,7 @@
 #define PTHREAD_PROCESS_PRIVATE (0x01)
 #define PTHREAD_PROCESS_SHARED  (0x02)
 
-#define PTHREAD_RWLOCK_INITIALIZER \
-    {                              \
-        PTHREAD_COND_INITIALIZER,  \
-        PTHREAD_MUTEX_INITIALIZER, \
-                                   \
-        0,                         \
-        0,                         \
-        0,                         \
-    }
+#define PTHREAD_RWLOCK_INITIALIZER {0, 0, 0, 0}
 
 #define PTHREAD_SCOPE_PROCESS (0x01);
 #define PTHREAD_SCOPE_SYSTEM  (0x02);
@@ -210,8 +200,10 @@ int pthread_cond_timedwait(pthread_cond_t *, pthread_mutex_t *, const struct tim
 int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
 
 int pthread_condattr_destroy(pthread_condattr_t *);
+int pthread_condattr_getclock(const pthread_condattr_t *, clockid_t *);
 int pthread_condattr_getpshared(const pthread_condattr_t *, int *);
 int pthread_condattr_init(pthread_condattr_t *);
+int pthread_condattr_setclock(pthread_condattr_t *, clockid_t);
 int pthread_condattr_setpshared(pthread_condattr_t *, int);
 
 /**
@@ -60,9 +60,14 @@ typedef struct _FILE {
 
     char *buf;
     size_t buf_size;
+    // Bytes waiting to be written, or the read position when reading
     size_t buf_pos;
+    // Bytes in the buffer when reading
+    size_t buf_len;
 #define _FILE_FLAG_FLUSHNEWLINE 1
 #define _FILE_FLAG_MYBUF        2
+#define _FILE_FLAG_READING      4
+#define _FILE_FLAG_DEFAULT_SIZE 8
     int buf_flags;
 
 #define __UNGET_SIZE 8
@@ -160,6 +165,26 @@ int fgetc(FILE *stream);
 
 char *fgets(char *str, int num, FILE *stream);
 
+/**
+ * @brief Read a delimited record from a file stream.
+ *
+ * The `getdelim` function reads from `stream` up to and including the `delim` character, or until
+ * the end of file, and stores the null-terminated result in `*lineptr`. The buffer is allocated
+ * or grown with realloc() as needed, and its size is kept in `*n`.
+ *
+ * @param lineptr Pointer to the malloc'ed buffer, or to NULL
+ * @param n       Pointer to the size of the buffer
+ * @param delim   Delimiter character
+ * @param stream  The file stream to read from.
+ *
+ * @return The number of characters read, including the delimiter but not the null terminator, or
+ * -1 on error or if the end of file was reached before reading anything.
+ */
+ssize_t getdelim(char **lineptr, size_t *n, int delim, FILE *stream);
+
+/// Same as getdelim() with '\n' as the delimiter
+ssize_t getline(char **lineptr, size_t *n, FILE *stream);
+
 /**
  * @brief Write a character to the given file stream.
  *
@@ -191,6 +216,8 @@ int fputs(const char *str, FILE *stream);
 int getc(FILE *stream);
 
 int getchar(void);
+int getc_unlocked(FILE *stream);
+int getchar_unlocked(void);
 char *gets(char *str);
 
 /**
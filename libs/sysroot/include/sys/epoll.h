@@ -0,0 +1,77 @@
+#ifndef _SYS_EPOLL_H
+#define _SYS_EPOLL_H 1
+
+#include <poll.h>
+#include <stdint.h>
+
+#define __DECLARE_SIGSET_T
+#include "__posix_types.h"
+
+/// Events of struct epoll_event, same as the ones of poll()
+#define EPOLLIN     POLLIN
+#define EPOLLPRI    POLLPRI
+#define EPOLLOUT    POLLOUT
+#define EPOLLRDNORM POLLRDNORM
+#define EPOLLRDBAND POLLRDBAND
+#define EPOLLWRNORM POLLWRNORM
+#define EPOLLWRBAND POLLWRBAND
+#define EPOLLERR    POLLERR
+#define EPOLLHUP    POLLHUP
+
+/// Only report the event once, until the descriptor is modified with EPOLL_CTL_MOD
+#define EPOLLONESHOT (1U << 30)
+/// Edge-triggered: report the events when they become ready, instead of while they are ready
+#define EPOLLET      (1U << 31)
+
+/// Operations of epoll_ctl()
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+/// Flags of epoll_create1()
+#define EPOLL_CLOEXEC 0x01
+
+typedef union epoll_data {
+    void *ptr;
+    int fd;
+    uint32_t u32;
+    uint64_t u64;
+} epoll_data_t;
+
+struct epoll_event {
+    uint32_t events;   //< Requested or returned events
+    epoll_data_t data; //< User data
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __STDC_HOSTED__
+
+/// @brief Creates an epoll instance
+///
+/// The instance keeps the interest in the descriptors added to it, so that epoll_wait() only has
+/// to deal with the ones that are ready. The notifications are delivered to a port of the thread
+/// calling this function, so it must also be the one calling epoll_wait().
+/// @param flags EPOLL_CLOEXEC
+/// @return The descriptor of the instance, or -1 with errno set
+int epoll_create1(int flags);
+int epoll_create(int size);
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+
+/// @brief Waits for the events of the instance
+/// @param timeout Timeout in milliseconds, -1 to wait indefinitely
+/// @return The number of events stored in events, 0 on timeout, or -1 with errno set
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+int epoll_pwait(int epfd, struct epoll_event *events, int maxevents, int timeout,
+                const sigset_t *sigmask);
+
+#endif // __STDC_HOSTED__
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // _SYS_EPOLL_H
@@ -70,12 +70,12 @@ typedef unsigned pthread_mutexattr_t;
 typedef volatile unsigned pthread_once_t;
 
 typedef struct pthread_rwlock_t {
-    pthread_cond_t cond;
-    pthread_mutex_t g;
-
-    unsigned long num_readers_active;
-    unsigned long num_writers_waiting;
-    unsigned long writer_active;
+    // Number of the readers holding the lock, or ~0U if it is held by a writer
+    unsigned int state;
+    unsigned int writers_waiting;
+    // Futex word, incremented every time the lock is released
+    unsigned int sequence;
+    unsigned int waiters;
 } pthread_rwlock_t;
 
 typedef unsigned pthread_rwlockattr_t;
@@ -500,7 +500,8 @@ void TimerWaiter::wait(int time_ms)
     }
 }
 
-void react_interrupt()
+// Returns true if any of the ports had something to do
+bool react_interrupt()
 {
     uint32_t is       = ahci_virt_base[2];
     ahci_virt_base[2] = is;
@@ -510,6 +511,7 @@ void react_interrupt()
             find_port(i).react_interrupt();
         }
     }
+    return is != 0;
 }
 
 pmos::async::detached_task ahci_controller_main()
@@ -533,6 +535,9 @@ pmos::async::detached_task ahci_controller_main()
 
 std::string pci_string;
 
+// How long the completions are batched for. Bounds the extra latency the commands see under load.
+constexpr uint64_t interrupt_coalesce_ns = 50'000;
+
 pmos::async::detached_task handle_interrupts(pmos::RecieveRight int_right)
 {
     while (1) {
@@ -547,8 +552,16 @@ pmos::async::detached_task handle_interrupts(pmos::RecieveRight int_right)
         case IPC_Kernel_Interrupt_NUM: {
             // auto kmsg = (IPC_Kernel_Interrupt *)request;
             //printf("Kernel interrupt: %i\n", kmsg->intno);
-            react_interrupt();
-            pmos::complete_interrupt(int_right);
+            // Under load, keep the interrupt masked and poll the controller every
+            // interrupt_coalesce_ns instead, until it runs out of work
+            if (react_interrupt()) {
+                pmos::complete_interrupt_poll(int_right, interrupt_coalesce_ns);
+            } else {
+                pmos::complete_interrupt(int_right);
+                // The interrupt might have been edge-triggered (MSI), so service whatever has
+                // come in while it was masked
+                react_interrupt();
+            }
         } break;
         default:
             printf("AHCId: unknown message type: %i in interrupt handler!\n", request->type);
@@ -0,0 +1,220 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pci/pci.h>
+#include <phys_map/phys_map.h>
+#include <pmos/interrupts.h>
+#include <pmos/io.h>
+#include <pmos/ipc.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PCI_COMMAND_MEMORY       0x0002
+#define PCI_COMMAND_BUS_MASTER   0x0004
+#define PCI_COMMAND_INTX_DISABLE 0x0400
+
+#define MSI_CONTROL_ENABLE          0x0001
+#define MSI_CONTROL_MME_MASK        0x0070
+#define MSI_CONTROL_64BIT           0x0080
+#define MSI_CONTROL_PER_VECTOR_MASK 0x0100
+
+#define MSIX_CONTROL_TABLE_SIZE_MASK 0x07ff
+#define MSIX_CONTROL_FUNCTION_MASK   0x4000
+#define MSIX_CONTROL_ENABLE          0x8000
+
+#define MSIX_ENTRY_SIZE          16
+#define MSIX_ENTRY_VECTOR_MASKED 0x1
+
+// Message-signalled interrupts are memory writes, so the device must be allowed to do them. Legacy
+// interrupts are switched off, since some devices would raise both.
+static void enable_msi_delivery(struct PCIDevicePtr *p)
+{
+    uint16_t command = pci_read_word(p, 0x4);
+    command |= PCI_COMMAND_BUS_MASTER | PCI_COMMAND_INTX_DISABLE;
+    pci_write_word(p, 0x4, command);
+}
+
+static int program_msi(struct PCIDevicePtr *p, struct PCIDevice *device, unsigned vector,
+                       const struct msi_message *m)
+{
+    // Multiple messages need a block of contiguous vectors on one CPU, which defeats the point of
+    // steering them, so only a single one is used
+    if (vector != 0)
+        return -EINVAL;
+
+    if (device->msi_enabled)
+        return -EBUSY;
+
+    const unsigned cap = device->msi_cap;
+    uint16_t control   = pci_read_word(p, cap + 2);
+    control &= ~(MSI_CONTROL_ENABLE | MSI_CONTROL_MME_MASK);
+    pci_write_word(p, cap + 2, control);
+
+    unsigned mask_offset;
+    pci_write_register(p, (cap + 4) >> 2, (uint32_t)m->address);
+    if (control & MSI_CONTROL_64BIT) {
+        pci_write_register(p, (cap + 8) >> 2, m->address >> 32);
+        pci_write_word(p, cap + 0xc, m->data);
+        mask_offset = cap + 0x10;
+    } else {
+        if (m->address >> 32)
+            return -EINVAL;
+
+        pci_write_word(p, cap + 8, m->data);
+        mask_offset = cap + 0xc;
+    }
+
+    if (control & MSI_CONTROL_PER_VECTOR_MASK)
+        pci_write_register(p, mask_offset >> 2, pci_read_register(p, mask_offset >> 2) & ~1U);
+
+    enable_msi_delivery(p);
+    pci_write_word(p, cap + 2, control | MSI_CONTROL_ENABLE);
+    device->msi_enabled = true;
+    return 0;
+}
+
+static int map_msix_table(struct PCIDevicePtr *p, struct PCIDevice *device)
+{
+    if (device->msix_table)
+        return 0;
+
+    const unsigned cap = device->msix_cap;
+    uint16_t control   = pci_read_word(p, cap + 2);
+    uint32_t table     = pci_read_register(p, (cap + 4) >> 2);
+    unsigned bir       = table & 0x7;
+    uint32_t offset    = table & ~0x7U;
+
+    unsigned bars = pci_header_type(p) == 0 ? 6 : 2;
+    if (bir >= bars)
+        return -EINVAL;
+
+    uint32_t bar = pci_read_register(p, 0x4 + bir);
+    // I/O space
+    if (bar & 0x1)
+        return -EINVAL;
+
+    uint64_t base = bar & ~0xfULL;
+    if (((bar >> 1) & 0x3) == 0x2) {
+        if (bir + 1 >= bars)
+            return -EINVAL;
+        base |= (uint64_t)pci_read_register(p, 0x4 + bir + 1) << 32;
+    }
+
+    if (!base)
+        return -ENODEV;
+
+    uint16_t size = (control & MSIX_CONTROL_TABLE_SIZE_MASK) + 1;
+    void *virt    = map_phys(base + offset, size * MSIX_ENTRY_SIZE);
+    if (!virt)
+        return -ENOMEM;
+
+    device->msix_table      = virt;
+    device->msix_table_size = size;
+    return 0;
+}
+
+static int program_msix(struct PCIDevicePtr *p, struct PCIDevice *device, unsigned vector,
+                        const struct msi_message *m)
+{
+    int result = map_msix_table(p, device);
+    if (result != 0)
+        return result;
+
+    if (vector >= device->msix_table_size)
+        return -ERANGE;
+
+    uint32_t *entry = device->msix_table + vector * (MSIX_ENTRY_SIZE / sizeof(uint32_t));
+
+    // The entry must not be used while it's being changed
+    mmio_writel(entry + 3, mmio_readl(entry + 3) | MSIX_ENTRY_VECTOR_MASKED);
+    mmio_writel(entry + 0, (uint32_t)m->address);
+    mmio_writel(entry + 1, m->address >> 32);
+    mmio_writel(entry + 2, m->data);
+    mmio_writel(entry + 3, mmio_readl(entry + 3) & ~MSIX_ENTRY_VECTOR_MASKED);
+
+    const unsigned cap = device->msix_cap;
+    uint16_t control   = pci_read_word(p, cap + 2);
+    if (!(control & MSIX_CONTROL_ENABLE) || (control & MSIX_CONTROL_FUNCTION_MASK)) {
+        // The table lives in a BAR, which must be decoded
+        uint16_t command = pci_read_word(p, 0x4);
+        pci_write_word(p, 0x4, command | PCI_COMMAND_MEMORY);
+
+        enable_msi_delivery(p);
+        control |= MSIX_CONTROL_ENABLE;
+        control &= ~MSIX_CONTROL_FUNCTION_MASK;
+        pci_write_word(p, cap + 2, control);
+        device->msi_enabled = true;
+    }
+
+    return 0;
+}
+
+void request_pci_msi(Message_Descriptor *msg, IPC_Request_PCI_MSI *desc, struct PCIDevice *device,
+                     pmos_right_t reply_right)
+{
+    IPC_Request_Int_Reply reply;
+    int result                = 0;
+    right_request_t irq_right = {};
+    message_extra_t extra     = {0};
+
+    if (msg->size < sizeof(IPC_Request_PCI_MSI)) {
+        result = -EINVAL;
+        goto end;
+    }
+
+    if (!device->msi_cap && !device->msix_cap) {
+        result = -ENOTSUP;
+        goto end;
+    }
+
+    struct PCIDevicePtr p;
+    if (fill_device_from_device(&p, device) != 0) {
+        result = -ENODEV;
+        goto end;
+    }
+
+    irq_right = allocate_msi(desc->cpu);
+    if (irq_right.result != 0) {
+        fprintf(stderr, "Failed to allocate MSI: %i (%s)\n", (int)irq_right.result,
+                strerror(-irq_right.result));
+        result = irq_right.result;
+        goto end;
+    }
+
+    struct msi_message m;
+    result = get_msi_message(irq_right.right, &m);
+    if (result != 0)
+        goto end;
+
+    if (device->msix_cap)
+        result = program_msix(&p, device, desc->vector, &m);
+    else
+        result = program_msi(&p, device, desc->vector, &m);
+
+    if (result != 0)
+        goto end;
+
+    printf("devicesd: PCI %i:%i:%i.%i vector %i -> MSI address %" PRIx64 " data %x CPU %i\n",
+           device->group, device->bus, device->device, device->function, desc->vector, m.address,
+           m.data, m.cpu);
+    extra.extra_rights[0] = irq_right.right;
+
+end:
+    if (result != 0 && irq_right.right) {
+        delete_right(irq_right.right);
+        irq_right.right = 0;
+    }
+
+    reply = (IPC_Request_Int_Reply) {
+        .type   = IPC_Request_Int_Reply_NUM,
+        .flags  = 0,
+        .status = result,
+    };
+
+    result = send_message_right(reply_right, 0, &reply, sizeof(reply), &extra, SEND_MESSAGE_DELETE_RIGHT).result;
+    if (result != 0) {
+        delete_right(reply_right);
+        if (irq_right.right)
+            delete_right(irq_right.right);
+        printf("Failed to send message in request_pci_msi: %i (%s)\n", result, strerror(-result));
+    }
+}
@@ -127,8 +127,8 @@ void check_function(struct PCIHostBridge *g, uint8_t bus, uint8_t device, uint8_
         case 0x4:
             // printf("Slot Identification\n");
             break;
-        case 0x5:
-            // printf("MSI Capability\n");
+        case PCI_CAP_MSI:
+            d->msi_cap = old_cap;
             break;
         case 0x6:
             // printf("CompactPCI Hot Swap\n");
@@ -154,8 +154,8 @@ void check_function(struct PCIHostBridge *g, uint8_t bus, uint8_t device, uint8_
             printf("device Type %i\n", dd);
             d->downstream = dd == 0x4 || dd == 0x6; // || dd == 0x8
         } break;
-        case 0x11:
-            // printf("MSI-X Capability\n");
+        case PCI_CAP_MSIX:
+            d->msix_cap = old_cap;
             break;
         default:
             // printf("Unknown (%02X)\n", id);
@@ -1035,6 +1035,7 @@ void request_pci_device_gsi(Message_Descriptor *desc, IPC_Request_PCI_Device_GSI
 }
 
 void request_pci_interrupt(Message_Descriptor *msg, IPC_Register_PCI_Interrupt *desc, struct PCIDevice *device, pmos_right_t reply_right);
+void request_pci_msi(Message_Descriptor *msg, IPC_Request_PCI_MSI *desc, struct PCIDevice *device, pmos_right_t reply_right);
 
 static int pci_callback(Message_Descriptor *desc, void *msg_buff, pmos_right_t *reply_right,
                      pmos_right_t *other_rights, void *ctx, struct pmos_msgloop_data *)
@@ -1051,6 +1052,10 @@ static int pci_callback(Message_Descriptor *desc, void *msg_buff, pmos_right_t *
         request_pci_interrupt(desc, msg_buff, device, *reply_right);
         *reply_right = 0;
         break;
+    case IPC_Request_PCI_MSI_NUM:
+        request_pci_msi(desc, msg_buff, device, *reply_right);
+        *reply_right = 0;
+        break;
     case IPC_Request_PCI_Device_GSI_NUM:
         request_pci_device_gsi(desc, msg_buff, device, *reply_right);
         *reply_right = 0;
@@ -101,9 +101,18 @@ struct PCIDevice {
 
     int pcie : 1;
     int downstream : 1;
+    unsigned msi_enabled : 1;
 
     // For PCI bridges
     uint8_t secondary_bus;
+
+    // Offsets of the MSI and MSI-X capabilities in the config space, 0 if absent
+    uint8_t msi_cap;
+    uint8_t msix_cap;
+
+    // MSI-X table, mapped on the first request
+    uint32_t *msix_table;
+    uint16_t msix_table_size;
 };
 
 struct LegacyAddr {
@@ -146,6 +155,9 @@ struct PCIHostBridge {
 #define PCI_FUNCTIONS       8
 #define PCI_DEVICES_PER_BUS 32
 
+#define PCI_CAP_MSI  0x05
+#define PCI_CAP_MSIX 0x11
+
 uint32_t pci_read_register(struct PCIDevicePtr *s, unsigned register);
 void pci_write_register(struct PCIDevicePtr *s, unsigned register, uint32_t value);
 int fill_device(struct PCIDevicePtr *s, struct PCIHostBridge *g, uint8_t bus, uint8_t device, uint8_t function);
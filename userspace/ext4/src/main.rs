@@ -4,12 +4,18 @@ use async_trait::async_trait;
 use pmos::ipc_runner::Executor;
 use pmos::ipc::SendRight;
 use pmos::ipc::SendManyRight;
+use pmos::ipc::MemoryObjectRight;
+use pmos::ipc::ObjectMmap;
 use pmos::ipc_runner::ManyReciever;
+use pmos::ipc_msgs::MAP_SHARED;
+use pmos::ipc_msgs::PROT_WRITE;
+use pmos::ipc_msgs::{POLLIN, POLLOUT, POLLRDNORM, POLLWRNORM};
 use pmos::async_helpers::get_named_right;
 use pmos::ipc_msgs::IPCMountFS;
 use pmos::ipc::send_message_right;
 use pmos::ipc::send_message_right_consume;
 use pmos::ipc_msgs::IPC_FLAG_IO_OP_SEEK;
+use pmos::ipc_msgs::IPC_FS_FLAG_SHARED_READ;
 
 use futures::StreamExt;
 
@@ -17,6 +23,7 @@ use std::num::NonZeroU32;
 
 use std::rc::Rc;
 use std::cell::RefCell;
+use std::collections::HashMap;
 
 use ext4plus::Ext4;
 
@@ -438,6 +445,134 @@ fn ipc_read_reply(reply_right: SendRight, result: i16, flags: u16, data: &[u8])
     }
 }
 
+fn ipc_read_shared_reply(reply_right: SendRight, result: i16, bytes_read: u64) {
+    let msg = pmos::ipc_msgs::IPCReadSharedReply::new(result, bytes_read);
+
+    let result = send_message_right(&msg, &mut Some(reply_right), &mut [None, None, None, None]);
+    if let Err(e) = result {
+        eprintln!("ext4: Failed to send IPCReadSharedReply message: {}", e.0);
+    }
+}
+
+fn ipc_mmap_reply(reply_right: SendRight, result: i16, object_size: u64, object: Option<MemoryObjectRight>) {
+    let msg = pmos::ipc_msgs::IPCMmapReply::new(result, object_size);
+    let rights = [object.map(SendRight::from), None, None, None];
+
+    let result = send_message_right_consume(&msg, reply_right, rights);
+    if let Err(e) = result {
+        eprintln!("ext4: Failed to send IPCMmapReply message: {}", e.0);
+    }
+}
+
+fn ipc_poll_register_reply(reply_right: SendRight, result: i16, revents: u32) {
+    let msg = pmos::ipc_msgs::IPCPollRegisterReply::new(result, revents);
+
+    let result = send_message_right(&msg, &mut Some(reply_right), &mut [None, None, None, None]);
+    if let Err(e) = result {
+        eprintln!("ext4: Failed to send IPCPollRegisterReply message: {}", e.0);
+    }
+}
+
+fn ipc_msync_reply(reply_right: SendRight, result: i16) {
+    let msg = pmos::ipc_msgs::IPCMsyncReply::new(result);
+
+    let result = send_message_right(&msg, &mut Some(reply_right), &mut [None, None, None, None]);
+    if let Err(e) = result {
+        eprintln!("ext4: Failed to send IPCMsyncReply message: {}", e.0);
+    }
+}
+
+thread_local! {
+    /// Memory objects of the mmapped files, by inode. All the mappings of a file share its object,
+    /// so its pages are only read once.
+    static MAPPED_FILES: RefCell<HashMap<u32, Rc<MemoryObjectRight>>> = RefCell::new(HashMap::new());
+}
+
+/// Provides the pages of the file's memory object, as the kernel requests them
+async fn ipc_pager(object: Rc<MemoryObjectRight>, _pager_right: SendManyRight, mut reciever: ManyReciever, mut file: File) {
+    let page_size = get_page_size() as usize;
+    let file_size = file.metadata().len();
+
+    while let Some(msg) = reciever.next().await {
+        match msg.deserialize() {
+            pmos::ipc_msgs::Message::IPCKernelRequestPage(req) => {
+                // The tail of the last page is zero-filled
+                let mut page = vec![0u8; page_size];
+                let size = std::cmp::min(file_size.saturating_sub(req.page_offset), page_size as u64) as usize;
+
+                let mut filled = 0;
+                if size > 0 {
+                    if let Err(e) = file.seek_to(req.page_offset) {
+                        eprintln!("ext4: Failed to seek to page {:#x}: {}", req.page_offset, ext4error_to_int(e));
+                    } else {
+                        while filled < size {
+                            match file.read_bytes(&mut page[filled..size]).await {
+                                Ok(0) => break,
+                                Ok(n) => filled += n as usize,
+                                Err(e) => {
+                                    eprintln!("ext4: Failed to read page {:#x}: {}", req.page_offset, ext4error_to_int(e));
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                // The page must be provided even if reading failed, or the tasks mapping it would
+                // stay blocked
+                if let Err(e) = object.provide_page(req.page_offset, Some(&page)) {
+                    eprintln!("ext4: Failed to provide page {:#x}: {}", req.page_offset, e.get());
+                }
+            }
+            _ => {
+                eprintln!("ext4: Received unexpected message type {} in pager", msg.get_known_id().unwrap_or(0));
+            }
+        }
+    }
+}
+
+/// Returns the memory object of the file, creating it and starting its pager on the first mapping
+fn get_mapped_file(executor: &Executor, fs: &Ext4, inode: &Inode) -> Result<Rc<MemoryObjectRight>, i32> {
+    let index = inode.index.get();
+    if let Some(object) = MAPPED_FILES.with(|m| m.borrow().get(&index).cloned()) {
+        return Ok(object);
+    }
+
+    let file = File::open_inode(fs, inode.clone()).map_err(ext4error_to_int)?;
+    let page_size = get_page_size();
+    let size = file.metadata().len().div_ceil(page_size) * page_size;
+
+    let object = Rc::new(MemoryObjectRight::create(size).map_err(|e| -e.get())?);
+    let (pager_right, reciever) = executor.create_right_sendmany().map_err(|e| -e.get())?;
+    object.set_pager(&pager_right).map_err(|e| -e.get())?;
+
+    executor.spawn(ipc_pager(object.clone(), pager_right, reciever, file));
+    MAPPED_FILES.with(|m| m.borrow_mut().insert(index, object.clone()));
+    Ok(object)
+}
+
+/// Reads the file from the offset into the buffer. read_bytes() stops at the block boundaries, so it
+/// is repeated to fill the whole buffer, or until the end of the file. Errors are only returned if
+/// nothing could be read.
+async fn read_at(file: &mut File, offset: u64, buffer: &mut [u8]) -> Result<usize, i32> {
+    // Positional reads past the end of the file return nothing, the same as on the other systems
+    if offset >= file.metadata().len() {
+        return Ok(0);
+    }
+    file.seek_to(offset).map_err(ext4error_to_int)?;
+
+    let mut filled = 0;
+    while filled < buffer.len() {
+        match file.read_bytes(&mut buffer[filled..]).await {
+            Ok(0) => break,
+            Ok(n) => filled += n as usize,
+            Err(e) if filled == 0 => return Err(ext4error_to_int(e)),
+            Err(_) => break,
+        }
+    }
+    Ok(filled)
+}
+
 async fn ipc_fs_open(executor: Executor, reply_right: Option<SendRight>, fs: Ext4, _flags: u32, inode: u64) {
     let inode = u32::try_from(inode).ok().and_then(NonZeroU32::new);
     if inode.is_none() {
@@ -453,7 +588,7 @@ async fn ipc_fs_open(executor: Executor, reply_right: Option<SendRight>, fs: Ext
     }
     let inode = inode.unwrap();
 
-    let file = File::open_inode(&fs, inode);
+    let file = File::open_inode(&fs, inode.clone());
     if let Err(e) = file {
         _ = ipc_fs_open_reply(reply_right, ext4error_to_int(e).try_into().unwrap(), 0, None);
         return;
@@ -462,7 +597,7 @@ async fn ipc_fs_open(executor: Executor, reply_right: Option<SendRight>, fs: Ext
 
     let right = executor.create_right_sendmany().expect("Failed to create SendManyRight for the filesystem");
 
-    let result = ipc_fs_open_reply(reply_right, 0, 0, Some(right.0.into()));
+    let result = ipc_fs_open_reply(reply_right, 0, IPC_FS_FLAG_SHARED_READ, Some(right.0.into()));
     if let Err(e) = result {
         println!("Failed to reply to IPC_FS_Open request! {}", e);
         return;
@@ -470,8 +605,16 @@ async fn ipc_fs_open(executor: Executor, reply_right: Option<SendRight>, fs: Ext
 
     let mut recieve_right = right.1;
 
+    // Buffer shared with the client for IPCReadShared. The right is kept alive with the mapping.
+    let mut shared_buffer: Option<(MemoryObjectRight, ObjectMmap)> = None;
+
+    // Position of the reads with IPC_FLAG_IO_OP_SEEK. The other reads use the offset from the
+    // request (pread() and aio), and don't change it.
+    let mut position: u64 = 0;
+
     while let Some(mut msg) = recieve_right.next().await {
         let reply_right = msg.reply_right.take();
+        let other_right = msg.other_rights[0].take();
         match msg.deserialize() {
             pmos::ipc_msgs::Message::IPCRead(data) => {
                 if reply_right.is_none() {
@@ -480,21 +623,96 @@ async fn ipc_fs_open(executor: Executor, reply_right: Option<SendRight>, fs: Ext
                 }
                 let reply_right = reply_right.unwrap();
 
-                if (data.flags & IPC_FLAG_IO_OP_SEEK) != 0 {
-                    let mut buffer = vec![0u8; data.max_size as usize];
+                let seek = (data.flags & IPC_FLAG_IO_OP_SEEK) != 0;
+                let offset = if seek { position } else { data.offset };
+                let mut buffer = vec![0u8; data.max_size as usize];
 
-                    let result = file.read_bytes(buffer.as_mut_slice()).await;
-                    if let Err(e) = result {
-                        let error_code = ext4error_to_int(e);
-                        ipc_read_reply(reply_right, error_code as i16, 0, &[]);
-                    } else {
-                        let bytes_read = result.unwrap();
-                        ipc_read_reply(reply_right, 0, 0, &buffer[..bytes_read as usize]);
+                match read_at(&mut file, offset, buffer.as_mut_slice()).await {
+                    Ok(bytes_read) => {
+                        if seek {
+                            position += bytes_read as u64;
+                        }
+                        ipc_read_reply(reply_right, 0, 0, &buffer[..bytes_read]);
+                    }
+                    Err(e) => ipc_read_reply(reply_right, e as i16, 0, &[]),
+                }
+            },
+            pmos::ipc_msgs::Message::IPCReadShared(data) => {
+                let Some(reply_right) = reply_right else {
+                    println!("ext4: Recieved shared read with no reply right!");
+                    continue;
+                };
+
+                // The client sends the buffer with its first read, and again if it replaces it
+                if let Some(SendRight::Object(object)) = other_right {
+                    match unsafe { object.map_writable(0, data.buffer_size) } {
+                        Ok(mapping) => shared_buffer = Some((object, mapping)),
+                        Err(e) => {
+                            ipc_read_shared_reply(reply_right, -e.get() as i16, 0);
+                            continue;
+                        }
                     }
-                } else {
-                    // Not implemented
-                    ipc_read_reply(reply_right, -libc::ENOSYS as i16, 0, &[]);
                 }
+
+                let Some((_, buffer)) = shared_buffer.as_mut() else {
+                    ipc_read_shared_reply(reply_right, -libc::EINVAL as i16, 0);
+                    continue;
+                };
+
+                let seek = (data.flags & IPC_FLAG_IO_OP_SEEK) != 0;
+                let offset = if seek { position } else { data.offset };
+                let size = std::cmp::min(data.max_size, buffer.len() as u64) as usize;
+
+                match read_at(&mut file, offset, &mut buffer.as_mut_slice()[..size]).await {
+                    Ok(bytes_read) => {
+                        if seek {
+                            position += bytes_read as u64;
+                        }
+                        ipc_read_shared_reply(reply_right, 0, bytes_read as u64);
+                    }
+                    Err(e) => ipc_read_shared_reply(reply_right, e as i16, 0),
+                }
+            },
+            pmos::ipc_msgs::Message::IPCMmap(data) => {
+                let Some(reply_right) = reply_right else {
+                    println!("ext4: Recieved mmap with no reply right!");
+                    continue;
+                };
+
+                // The filesystem is read-only, and the rights don't limit the access to the
+                // object, so the shared mappings can't be writable
+                if (data.flags & MAP_SHARED) != 0 && (data.prot & PROT_WRITE) != 0 {
+                    ipc_mmap_reply(reply_right, -libc::EACCES as i16, 0, None);
+                    continue;
+                }
+
+                let object = get_mapped_file(&executor, &fs, &inode)
+                    .and_then(|object| object.duplicate().map_err(|e| -e.get()));
+                match object {
+                    Ok(object) => {
+                        let size = file.metadata().len().div_ceil(get_page_size()) * get_page_size();
+                        ipc_mmap_reply(reply_right, 0, size, Some(object));
+                    }
+                    Err(e) => ipc_mmap_reply(reply_right, e as i16, 0, None),
+                }
+            },
+            pmos::ipc_msgs::Message::IPCPollRegister(data) => {
+                let Some(reply_right) = reply_right else {
+                    continue;
+                };
+
+                // Regular files are always ready, so the notification right (if any) is dropped.
+                // The clients don't normally ask, since IPC_FS_FLAG_POLL isn't set.
+                let ready = POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+                ipc_poll_register_reply(reply_right, 0, data.events & ready);
+            },
+            pmos::ipc_msgs::Message::IPCMsync(_) => {
+                let Some(reply_right) = reply_right else {
+                    continue;
+                };
+
+                // Nothing is ever written to the mappings
+                ipc_msync_reply(reply_right, 0);
             },
             _ => {
                 println!("Ext4: recieved unknown message in IPC open file consumer");
@@ -0,0 +1,76 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pmos/system.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Prints the kernel spinlock statistics, sorted by the time spent waiting for the locks. The
+// addresses are the call sites in the kernel, which can be resolved with addr2line.
+//
+// Usage: lockstat [-r] [max entries]
+//   -r  reset the counters after reading them
+
+static int compare_spin(const void *a, const void *b)
+{
+    const struct lockstat_entry *ea = a, *eb = b;
+    if (ea->spin_ticks != eb->spin_ticks)
+        return ea->spin_ticks < eb->spin_ticks ? 1 : -1;
+    if (ea->contended != eb->contended)
+        return ea->contended < eb->contended ? 1 : -1;
+    return ea->acquisitions < eb->acquisitions ? 1 : ea->acquisitions > eb->acquisitions ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned flags   = 0;
+    size_t max_print = 50;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0)
+            flags |= LOCKSTAT_RESET;
+        else
+            max_print = strtoul(argv[i], NULL, 10);
+    }
+
+    syscall_r r = pmos_get_lockstat(NULL, 0, 0);
+    if (r.result != SUCCESS) {
+        if ((int64_t)r.result == -ENOSYS)
+            fprintf(stderr, "lockstat: the kernel is built without ENABLE_LOCKSTAT\n");
+        else
+            fprintf(stderr, "lockstat: error %" PRIi64 "\n", (int64_t)r.result);
+        return 1;
+    }
+
+    // New call sites might appear between the calls
+    size_t capacity                = r.value + 16;
+    struct lockstat_entry *entries = calloc(capacity, sizeof(*entries));
+    if (!entries) {
+        fprintf(stderr, "lockstat: out of memory\n");
+        return 1;
+    }
+
+    r = pmos_get_lockstat(entries, capacity, flags);
+    if (r.result != SUCCESS) {
+        fprintf(stderr, "lockstat: error %" PRIi64 "\n", (int64_t)r.result);
+        return 1;
+    }
+
+    size_t count = r.value < capacity ? r.value : capacity;
+    qsort(entries, count, sizeof(*entries), compare_spin);
+
+    printf("%-18s %12s %12s %14s %14s %14s\n", "site", "acquired", "contended", "spin ticks",
+           "avg hold", "max hold");
+    for (size_t i = 0; i < count && i < max_print; ++i) {
+        struct lockstat_entry *e = &entries[i];
+        uint64_t avg_hold        = e->acquisitions ? e->hold_ticks / e->acquisitions : 0;
+        printf("0x%016" PRIx64 " %12" PRIu64 " %12" PRIu64 " %14" PRIu64 " %14" PRIu64
+               " %14" PRIu64 "\n",
+               e->site, e->acquisitions, e->contended, e->spin_ticks, avg_hold, e->max_hold_ticks);
+    }
+
+    if (count > max_print)
+        printf("... %zu more\n", count - max_print);
+
+    free(entries);
+    return 0;
+}
@@ -148,6 +148,11 @@ void clear_register(int index, uint8_t mask)
 
 pmos::RecieveRight interrupt_right;
 
+// Counted by the kernel, so that the interrupts coming while the driver is busy don't need a message
+// each
+interrupt_counter irq_counter = {};
+uint64_t irq_handled         = 0;
+
 void set_up_interrupt()
 {
     printf("Initializing interrupts... Mask: %x\n", interrupt_type_mask);
@@ -209,7 +214,7 @@ void set_up_interrupt()
     }
 
     try {
-        interrupt_right = register_interrupt(msg->other_rights[0], serial_port);
+        interrupt_right = register_interrupt(msg->other_rights[0], serial_port, &irq_counter);
     } catch (const std::exception &e) {
         printf("Failed to set up interrupt: %s\n", e.what());
         return;
@@ -438,10 +443,13 @@ void write_interrupt()
     }
 }
 
-void check_rx()
+// Returns true if anything has been received
+bool check_rx()
 {
+    bool received = false;
     while ((io_rw->read_register(LSR) & LSR_DATA_READY) != 0) {
         auto t = io_rw->read_register(THR);
+        received = true;
 
         // putc(t, stdout);
         printf("\033[1;36m"
@@ -451,6 +459,7 @@ void check_rx()
                t);
     }
     fflush(stdout);
+    return received;
 }
 
 void check_buffers()
@@ -498,8 +507,10 @@ void react_named_port_notification(const char *msg_buff, size_t size, pmos::Righ
     pmos::send_message_right_one(log_right, reg, {&serial_port, pmos::RightType::SendOnce}, false, std::move(serial_right)).value();
 }
 
-void react_interrupt()
+// Returns true if there was incoming data
+bool react_interrupt()
 {
+    bool rx_work = false;
     u8 interrupt_status = io_rw->read_register(ISR);
     if ((interrupt_status & ISR_INT_PENDING) == 0) {
         switch (interrupt_status & ISR_MASK) {
@@ -508,10 +519,10 @@ void react_interrupt()
             io_rw->read_register(LSR);
             break;
         case 0b0100: // Received Data Available
-            check_rx();
+            rx_work = true;
             break;
         case 0b1100: // Reception Timeout
-            check_rx();
+            rx_work = true;
             break;
         case 0b0010: // Transmitter Holding Register Empty
             write_interrupt();
@@ -519,7 +530,48 @@ void react_interrupt()
         }
     } // else: Spurious interrupt
 
-    pmos::complete_interrupt(interrupt_right);
+    // While polling, the FIFO is drained whether or not the trigger level has been reached
+    return check_rx() or rx_work;
+}
+
+// How long the interrupt stays masked while the data is coming in. The FIFO of 16 bytes fills up
+// in about 1.4 ms at 115200 baud.
+constexpr uint64_t rx_coalesce_ns = 500'000;
+
+// Services the interrupts counted since the last call, and asks the kernel to send the message for
+// the next one before the driver blocks on the port. While the data keeps coming, the interrupt is
+// left masked and the kernel wakes the driver up to poll the receiver instead.
+void poll_interrupts()
+{
+    if (!have_interrupts)
+        return;
+
+    bool serviced = false, rx_work = false;
+    while (true) {
+        auto count = __atomic_load_n(&irq_counter.count, __ATOMIC_ACQUIRE);
+        if (count != irq_handled) {
+            irq_handled = count;
+            rx_work |= react_interrupt();
+            serviced = true;
+            continue;
+        }
+
+        __atomic_store_n(&irq_counter.waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&irq_counter.count, __ATOMIC_SEQ_CST) == irq_handled)
+            break;
+    }
+
+    if (!serviced)
+        return;
+
+    if (rx_work) {
+        pmos::complete_interrupt_poll(interrupt_right, rx_coalesce_ns);
+    } else {
+        pmos::complete_interrupt(interrupt_right);
+        // The edges are lost while the interrupt is masked, so clear whatever the UART has raised
+        // in the meantime, to let it interrupt again
+        react_interrupt();
+    }
 }
 
 int main()
@@ -533,6 +585,8 @@ int main()
     request_logger_port();
 
     while (1) {
+        poll_interrupts();
+
         auto [msg, msg_buff, reply_right, array] = serial_port.get_first_message().value();
 
         if (msg.size < sizeof(IPC_Generic_Msg)) {
@@ -567,7 +621,7 @@ int main()
             react_named_port_notification(reinterpret_cast<const char *>(msg_buff.data()), msg.size, std::move(array[0]));
             break;
         case IPC_Kernel_Interrupt_NUM:
-            react_interrupt();
+            // Only wakes the driver up, poll_interrupts() does the rest
             break;
         default:
             write_str("Warning: Unknown message type " + std::to_string(ipc_msg->type) +
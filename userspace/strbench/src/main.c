@@ -0,0 +1,121 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Measures the throughput of memcpy(), memset(), memcmp() and strlen() for the sizes from 8 bytes
+// to 1 MiB, comparing the implementations libc has picked for this CPU with its generic
+// word-at-a-time ones.
+//
+// Usage: strbench [-q]
+//   -q  shorter runs, for a quick check
+
+// Exported by libc for the architecture-specific versions to fall back on
+void *__memcpy_generic(void *restrict dest, const void *restrict src, size_t n);
+void *__memset_generic(void *s, int c, size_t n);
+int __memcmp_generic(const void *s1, const void *s2, size_t n);
+size_t __strlen_generic(const char *str);
+
+#define MIN_SIZE 8
+#define MAX_SIZE (1024 * 1024)
+
+// Bytes processed per measurement, so that all sizes take roughly the same time
+static uint64_t bytes_per_run = 256 * 1024 * 1024;
+
+static unsigned char *buffer_a, *buffer_b;
+// Keeps the results alive, so that the calls are not optimized out
+static volatile uint64_t sink;
+
+enum routine { MEMCPY, MEMSET, MEMCMP, STRLEN, ROUTINES_COUNT };
+static const char *routine_names[ROUTINES_COUNT] = {"memcpy", "memset", "memcmp", "strlen"};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void prepare(enum routine r, size_t size)
+{
+    memset(buffer_a, 'a', size);
+    memset(buffer_b, 'a', size);
+    if (r == STRLEN)
+        buffer_a[size - 1] = '\0';
+}
+
+static void run_once(enum routine r, int generic, size_t size)
+{
+    switch (r) {
+        case MEMCPY:
+            generic ? __memcpy_generic(buffer_b, buffer_a, size) : memcpy(buffer_b, buffer_a, size);
+            break;
+        case MEMSET:
+            generic ? __memset_generic(buffer_b, 'b', size) : memset(buffer_b, 'b', size);
+            break;
+        case MEMCMP:
+            sink += generic ? __memcmp_generic(buffer_a, buffer_b, size)
+                            : memcmp(buffer_a, buffer_b, size);
+            break;
+        case STRLEN:
+            sink += generic ? __strlen_generic((const char *)buffer_a)
+                            : strlen((const char *)buffer_a);
+            break;
+        default:
+            break;
+    }
+}
+
+// Returns the throughput in MiB/s
+static uint64_t measure(enum routine r, int generic, size_t size)
+{
+    prepare(r, size);
+
+    uint64_t iterations = bytes_per_run / size;
+    if (iterations < 4)
+        iterations = 4;
+
+    // Warm up the caches
+    run_once(r, generic, size);
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; ++i)
+        run_once(r, generic, size);
+    uint64_t elapsed = now_ns() - start;
+
+    if (!elapsed)
+        elapsed = 1;
+    return (iterations * size * 1000000000ULL / elapsed) >> 20;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-q"))
+        bytes_per_run /= 16;
+
+    buffer_a = malloc(MAX_SIZE);
+    buffer_b = malloc(MAX_SIZE);
+    if (!buffer_a || !buffer_b) {
+        fprintf(stderr, "strbench: could not allocate the buffers\n");
+        return 1;
+    }
+
+    for (int r = 0; r < ROUTINES_COUNT; ++r) {
+        printf("%s (MiB/s)\n", routine_names[r]);
+        printf("%10s %12s %12s %8s\n", "size", "generic", "selected", "speedup");
+
+        for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 4) {
+            uint64_t generic  = measure(r, 1, size);
+            uint64_t selected = measure(r, 0, size);
+            printf("%10zu %12" PRIu64 " %12" PRIu64 " %7.2fx\n", size, generic, selected,
+                   generic ? (double)selected / generic : 0.0);
+        }
+        printf("\n");
+    }
+
+    free(buffer_a);
+    free(buffer_b);
+    return 0;
+}
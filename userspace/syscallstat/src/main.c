@@ -0,0 +1,94 @@
+#include <inttypes.h>
+#include <pmos/system.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Prints the number of calls, restarts and the latency distribution of every system call that
+// has been used, most called first. The latencies are in CPU timestamp counter ticks.
+//
+// Usage: syscallstat [-r] [-h]
+//   -r  reset the counters after reading them
+//   -h  print the full histograms
+
+static int compare_calls(const void *a, const void *b)
+{
+    const struct syscall_stats_entry *ea = a, *eb = b;
+    return ea->calls < eb->calls ? 1 : ea->calls > eb->calls ? -1 : 0;
+}
+
+// Returns the upper bound of the bucket containing the given fraction of the calls
+static uint64_t percentile(const struct syscall_stats_entry *e, unsigned permille)
+{
+    uint64_t target = (e->calls * permille + 999) / 1000;
+    uint64_t seen   = 0;
+    for (unsigned i = 0; i < SYSCALL_STATS_BUCKETS; ++i) {
+        seen += e->latency_histogram[i];
+        if (seen >= target)
+            return (uint64_t)2 << i;
+    }
+    return UINT64_MAX;
+}
+
+static void print_histogram(const struct syscall_stats_entry *e)
+{
+    for (unsigned i = 0; i < SYSCALL_STATS_BUCKETS; ++i) {
+        if (!e->latency_histogram[i])
+            continue;
+
+        printf("    [%12" PRIu64 ", %12" PRIu64 ") %12" PRIu64 "\n", i ? (uint64_t)1 << i : 0,
+               (uint64_t)2 << i, e->latency_histogram[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned flags       = 0;
+    bool full_histograms = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0)
+            flags |= SYSCALL_STATS_RESET;
+        else if (strcmp(argv[i], "-h") == 0)
+            full_histograms = true;
+    }
+
+    syscall_r r = pmos_get_syscall_stats(NULL, 0, 0);
+    if (r.result != SUCCESS) {
+        fprintf(stderr, "syscallstat: error %" PRIi64 "\n", (int64_t)r.result);
+        return 1;
+    }
+
+    size_t count                        = r.value;
+    struct syscall_stats_entry *entries = calloc(count, sizeof(*entries));
+    if (!entries) {
+        fprintf(stderr, "syscallstat: out of memory\n");
+        return 1;
+    }
+
+    r = pmos_get_syscall_stats(entries, count, flags);
+    if (r.result != SUCCESS) {
+        fprintf(stderr, "syscallstat: error %" PRIi64 "\n", (int64_t)r.result);
+        return 1;
+    }
+
+    qsort(entries, count, sizeof(*entries), compare_calls);
+
+    printf("%-32s %12s %12s %12s %12s %12s\n", "syscall", "calls", "repeats", "p50 <", "p99 <",
+           "max <");
+    for (size_t i = 0; i < count; ++i) {
+        const struct syscall_stats_entry *e = &entries[i];
+        if (!e->calls)
+            break;
+
+        printf("%-32.32s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n",
+               e->name, e->calls, e->repeats, percentile(e, 500), percentile(e, 990),
+               percentile(e, 1000));
+
+        if (full_histograms)
+            print_histogram(e);
+    }
+
+    free(entries);
+    return 0;
+}
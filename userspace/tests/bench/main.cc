@@ -0,0 +1,14 @@
+#include <cstdio>
+
+// Benchmarks that take too long to run with the tests on every boot. Started manually.
+
+extern "C" void bench_qsort();
+void bench_tree_lookups();
+
+int main()
+{
+    printf("Starting benchmarks...\n");
+    bench_tree_lookups();
+    bench_qsort();
+    return 0;
+}
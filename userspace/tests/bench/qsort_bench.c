@@ -0,0 +1,58 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdio.h>
+
+// Times qsort() on the input patterns that pattern-defeating quicksort handles specially
+
+#define BENCH_SIZE 200000
+
+static int compare(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+enum Pattern { PATTERN_RANDOM, PATTERN_SORTED, PATTERN_REVERSED, PATTERN_FEW_UNIQUE, PATTERN_COUNT };
+static const char *const pattern_names[] = {"random", "sorted", "reversed", "few unique"};
+
+static int pattern_value(enum Pattern p, int i, int n)
+{
+    switch (p) {
+    case PATTERN_SORTED:
+        return i;
+    case PATTERN_REVERSED:
+        return n - i;
+    case PATTERN_FEW_UNIQUE:
+        return rand() % 8;
+    default:
+        return rand();
+    }
+}
+
+static double elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void bench_qsort()
+{
+    static int values[BENCH_SIZE];
+
+    printf("qsort of %i ints:\n", BENCH_SIZE);
+    for (int p = 0; p < PATTERN_COUNT; ++p) {
+        srand(1234);
+        for (int i = 0; i < BENCH_SIZE; ++i)
+            values[i] = pattern_value(p, i, BENCH_SIZE);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        qsort(values, BENCH_SIZE, sizeof(int), compare);
+        printf("  %-10s %8.2f ms\n", pattern_names[p], elapsed_ms(&start));
+
+        for (int i = 0; i < BENCH_SIZE - 1; ++i)
+            assert(values[i] <= values[i + 1]);
+    }
+}
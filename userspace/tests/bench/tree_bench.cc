@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <pmos/containers/map.hh>
+#include <thread>
+#include <vector>
+
+// Compares the lookups in a shared tree from several threads: a splay tree, which restructures
+// itself on every lookup and so needs an exclusive lock even for the readers (like the kernel's
+// klib::splay_tree_map), and the red-black tree of pmos::containers::map, where the readers only
+// take a reader-writer lock shared.
+
+namespace
+{
+
+constexpr uint64_t tree_size          = 4096;
+constexpr uint64_t lookups_per_thread = 200000;
+
+struct ExclusiveLock {
+    std::atomic<bool> locked = false;
+
+    void lock()
+    {
+        while (locked.exchange(true, std::memory_order_acquire))
+            while (locked.load(std::memory_order_relaxed))
+                ;
+    }
+    void unlock() { locked.store(false, std::memory_order_release); }
+};
+
+struct ReaderWriterLock {
+    static constexpr uint32_t WRITER = 1U << 31;
+    std::atomic<uint32_t> state      = 0;
+
+    void lock()
+    {
+        uint32_t s = state.load(std::memory_order_relaxed);
+        while (true) {
+            if (!(s & WRITER) and
+                state.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+                return;
+            s = state.load(std::memory_order_relaxed);
+        }
+    }
+    void unlock() { state.fetch_sub(1, std::memory_order_release); }
+};
+
+// Top-down splay tree, with the nodes preallocated
+class SplayTree
+{
+    struct Node {
+        uint64_t key;
+        Node *left  = nullptr;
+        Node *right = nullptr;
+    };
+
+    std::vector<Node> nodes;
+    Node *root = nullptr;
+
+    Node *build(uint64_t low, uint64_t high)
+    {
+        if (low >= high)
+            return nullptr;
+
+        uint64_t middle = low + (high - low) / 2;
+        Node *n         = &nodes[middle];
+        n->key          = middle;
+        n->left         = build(low, middle);
+        n->right        = build(middle + 1, high);
+        return n;
+    }
+
+    // Brings the node with the key, or the last one on the path to it, to the root
+    void splay(uint64_t key)
+    {
+        Node header;
+        Node *l = &header, *r = &header, *t = root;
+        while (true) {
+            if (key < t->key) {
+                if (!t->left)
+                    break;
+                if (key < t->left->key) {
+                    Node *y  = t->left;
+                    t->left  = y->right;
+                    y->right = t;
+                    t        = y;
+                    if (!t->left)
+                        break;
+                }
+                r->left = t;
+                r       = t;
+                t       = t->left;
+            } else if (key > t->key) {
+                if (!t->right)
+                    break;
+                if (key > t->right->key) {
+                    Node *y  = t->right;
+                    t->right = y->left;
+                    y->left  = t;
+                    t        = y;
+                    if (!t->right)
+                        break;
+                }
+                l->right = t;
+                l        = t;
+                t        = t->right;
+            } else {
+                break;
+            }
+        }
+        l->right = t->left;
+        r->left  = t->right;
+        t->left  = header.right;
+        t->right = header.left;
+        root     = t;
+    }
+
+public:
+    explicit SplayTree(uint64_t size): nodes(size) { root = build(0, size); }
+
+    bool contains(uint64_t key)
+    {
+        if (!root)
+            return false;
+        splay(key);
+        return root->key == key;
+    }
+};
+
+template<typename Lock, typename Lookup>
+double run_lookups(Lock &lock, Lookup lookup, unsigned threads)
+{
+    std::atomic<unsigned> ready = 0;
+    std::atomic<bool> start     = false;
+    std::atomic<uint64_t> found = 0;
+
+    auto reader = [&](unsigned seed) {
+        uint64_t x     = seed * 2654435761U + 1;
+        uint64_t local = 0;
+
+        ready.fetch_add(1);
+        while (!start.load(std::memory_order_acquire))
+            ;
+
+        for (uint64_t i = 0; i < lookups_per_thread; ++i) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+
+            lock.lock();
+            local += lookup(x % tree_size);
+            lock.unlock();
+        }
+        found.fetch_add(local);
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(reader, i);
+
+    while (ready.load() != threads)
+        ;
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto &t: workers)
+        t.join();
+    auto end = std::chrono::steady_clock::now();
+
+    if (found.load() != threads * lookups_per_thread)
+        printf("tree_bench: lost %lu keys\n", threads * lookups_per_thread - found.load());
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    return threads * lookups_per_thread / seconds;
+}
+
+} // namespace
+
+void bench_tree_lookups()
+{
+    printf("Benchmarking concurrent tree lookups...\n");
+
+    SplayTree splay_tree(tree_size);
+    pmos::containers::map<uint64_t, uint64_t> rb_tree;
+    for (uint64_t i = 0; i < tree_size; ++i)
+        rb_tree.insert_noexcept({i, i});
+
+    const unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        ExclusiveLock exclusive;
+        ReaderWriterLock shared;
+
+        const double s = run_lookups(
+            exclusive, [&](uint64_t key) { return splay_tree.contains(key); }, threads);
+        const double r = run_lookups(
+            shared, [&](uint64_t key) { return rb_tree.find(key) != rb_tree.end(); }, threads);
+        printf("  %u threads: splay tree %lu lookups/s, red-black tree %lu lookups/s\n", threads,
+               (uint64_t)s, (uint64_t)r);
+    }
+}
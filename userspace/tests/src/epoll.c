@@ -0,0 +1,70 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+// Checks the readiness paths of poll() and epoll on descriptors that are always ready, and the
+// timeout of a wait with nothing to report
+
+static long elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+void test_epoll()
+{
+    printf("Testing poll and epoll...\n");
+
+    struct pollfd pfd = {.fd = STDOUT_FILENO, .events = POLLOUT};
+    int result        = poll(&pfd, 1, 1000);
+    if (result != 1 || !(pfd.revents & POLLOUT))
+        printf("poll: expected stdout to be writable, got %i revents %#x\n", result, pfd.revents);
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep == -1) {
+        perror("epoll_create1");
+        return;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct epoll_event events[4];
+    result = epoll_wait(ep, events, 4, 50);
+    if (result != 0)
+        printf("epoll_wait: expected timeout on an empty instance, got %i\n", result);
+    else if (elapsed_ms(&start) < 50)
+        printf("epoll_wait: returned after %li ms, before the timeout\n", elapsed_ms(&start));
+
+    struct epoll_event ev = {.events = EPOLLOUT, .data.u64 = 0x1234};
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, STDOUT_FILENO, &ev) == -1)
+        perror("epoll_ctl ADD");
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, STDOUT_FILENO, &ev) != -1 || errno != EEXIST)
+        printf("epoll_ctl: adding the descriptor twice did not fail with EEXIST\n");
+
+    // Level-triggered, so it must be reported on every wait
+    for (int i = 0; i < 2; ++i) {
+        result = epoll_wait(ep, events, 4, -1);
+        if (result != 1 || events[0].data.u64 != 0x1234 || !(events[0].events & EPOLLOUT))
+            printf("epoll_wait: iteration %i got %i events\n", i, result);
+    }
+
+    ev.events = EPOLLOUT | EPOLLONESHOT;
+    if (epoll_ctl(ep, EPOLL_CTL_MOD, STDOUT_FILENO, &ev) == -1)
+        perror("epoll_ctl MOD");
+    result = epoll_wait(ep, events, 4, 0);
+    if (result != 1)
+        printf("epoll_wait: oneshot event was not reported, got %i\n", result);
+    result = epoll_wait(ep, events, 4, 0);
+    if (result != 0)
+        printf("epoll_wait: oneshot event was reported twice\n");
+
+    if (epoll_ctl(ep, EPOLL_CTL_DEL, STDOUT_FILENO, NULL) == -1)
+        perror("epoll_ctl DEL");
+
+    close(ep);
+    printf("poll and epoll test done\n");
+}
@@ -1,5 +1,7 @@
+#include <aio.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
 
 const char path[] = "/root/test_file.txt";
@@ -25,5 +27,45 @@ void read_test_file()
     buffer[bytes_read] = '\0';
     printf("Contents of test_file.txt:\n%s\n", buffer);
 
+    // Read it again in chunks, with all of the requests in flight at the same time
+    enum { CHUNKS = 4 };
+    const size_t chunk = (bytes_read + CHUNKS - 1) / CHUNKS;
+    char async_buffer[256];
+    struct aiocb cbs[CHUNKS] = {};
+    struct aiocb *list[CHUNKS];
+    for (int i = 0; i < CHUNKS; ++i) {
+        cbs[i].aio_fildes     = fd;
+        cbs[i].aio_offset     = i * chunk;
+        cbs[i].aio_buf        = async_buffer + i * chunk;
+        cbs[i].aio_nbytes     = (size_t)bytes_read > (i + 1) * chunk ? chunk
+                                : (size_t)bytes_read > i * chunk ? bytes_read - i * chunk
+                                                                 : 0;
+        cbs[i].aio_lio_opcode = LIO_READ;
+        list[i]               = &cbs[i];
+    }
+
+    if (lio_listio(LIO_WAIT, list, CHUNKS, NULL) < 0) {
+        perror("lio_listio");
+    } else {
+        ssize_t total = 0;
+        for (int i = 0; i < CHUNKS; ++i)
+            total += aio_return(&cbs[i]);
+        if (total != bytes_read || memcmp(buffer, async_buffer, bytes_read) != 0)
+            printf("Asynchronous reads returned %zi bytes, different from read()\n", total);
+    }
+
+    // The lowest free descriptors are reused, and dup2() can go past the end of the table. The
+    // regular files can't be cloned, so stdout (an IPC queue) is duplicated instead.
+    int high = dup2(STDOUT_FILENO, 200);
+    int low  = dup(STDOUT_FILENO);
+    if (high != 200 || low != fd + 1)
+        printf("dup2() returned %i and dup() %i, expected 200 and %i\n", high, low, fd + 1);
+    close(low);
+    if (close(high) < 0 || close(high) == 0)
+        printf("Closing the duplicated descriptor twice didn't fail\n");
+    if (dup(STDOUT_FILENO) != low)
+        printf("Closed descriptor %i was not reused\n", low);
+    close(low);
+
     close(fd);
 }
\ No newline at end of file
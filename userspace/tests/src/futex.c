@@ -0,0 +1,136 @@
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <time.h>
+
+// Exercises the futex-based pthread primitives under contention
+
+#define FUTEX_TEST_THREADS    4
+#define FUTEX_TEST_ITERATIONS 100000
+
+static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long counter         = 0;
+
+static pthread_mutex_t turn_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t turn_cond   = PTHREAD_COND_INITIALIZER;
+static int turn                   = 0;
+
+static sem_t items;
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static int once_calls      = 0;
+static void once_routine() { ++once_calls; }
+
+static void *counter_thread(void *arg)
+{
+    pthread_once(&once, once_routine);
+
+    for (int i = 0; i < FUTEX_TEST_ITERATIONS; ++i) {
+        pthread_mutex_lock(&counter_mutex);
+        ++counter;
+        pthread_mutex_unlock(&counter_mutex);
+    }
+    return NULL;
+}
+
+// Passes the turn back and forth with the main thread
+static void *ping_thread(void *arg)
+{
+    for (int i = 0; i < 1000; ++i) {
+        pthread_mutex_lock(&turn_mutex);
+        while (turn != 1)
+            pthread_cond_wait(&turn_cond, &turn_mutex);
+        turn = 0;
+        pthread_cond_signal(&turn_cond);
+        pthread_mutex_unlock(&turn_mutex);
+    }
+    return NULL;
+}
+
+// Deadline 10ms from now on the given clock
+static struct timespec short_deadline(clockid_t clock)
+{
+    struct timespec deadline;
+    clock_gettime(clock, &deadline);
+    deadline.tv_nsec += 10000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_nsec -= 1000000000;
+        deadline.tv_sec += 1;
+    }
+    return deadline;
+}
+
+static void *consumer_thread(void *arg)
+{
+    for (int i = 0; i < FUTEX_TEST_ITERATIONS / 10; ++i)
+        sem_wait(&items);
+    return NULL;
+}
+
+void test_futex_locks()
+{
+    printf("Testing futex-based locks...\n");
+
+    pthread_t threads[FUTEX_TEST_THREADS];
+    for (int i = 0; i < FUTEX_TEST_THREADS; ++i)
+        pthread_create(&threads[i], NULL, counter_thread, NULL);
+    for (int i = 0; i < FUTEX_TEST_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+
+    if (counter != FUTEX_TEST_THREADS * FUTEX_TEST_ITERATIONS)
+        printf("test_futex_locks: mutex lost updates: %lu\n", counter);
+    if (once_calls != 1)
+        printf("test_futex_locks: pthread_once ran %i times\n", once_calls);
+
+    pthread_t ping;
+    pthread_create(&ping, NULL, ping_thread, NULL);
+    for (int i = 0; i < 1000; ++i) {
+        pthread_mutex_lock(&turn_mutex);
+        while (turn != 0)
+            pthread_cond_wait(&turn_cond, &turn_mutex);
+        turn = 1;
+        pthread_cond_signal(&turn_cond);
+        pthread_mutex_unlock(&turn_mutex);
+    }
+    pthread_join(ping, NULL);
+
+    sem_init(&items, 0, 0);
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, consumer_thread, NULL);
+    for (int i = 0; i < FUTEX_TEST_ITERATIONS / 10; ++i)
+        sem_post(&items);
+    pthread_join(consumer, NULL);
+
+    // Nothing is posted, so this must time out
+    struct timespec deadline = short_deadline(CLOCK_REALTIME);
+    if (sem_timedwait(&items, &deadline) != -1 || errno != ETIMEDOUT)
+        printf("test_futex_locks: sem_timedwait did not time out\n");
+    sem_destroy(&items);
+
+    // Nobody signals the condition, so the waits must time out on the selected clock, with
+    // CLOCK_REALTIME being the default
+    pthread_condattr_t attr;
+    clockid_t clock = CLOCK_MONOTONIC;
+    pthread_condattr_init(&attr);
+    if (pthread_condattr_getclock(&attr, &clock) != 0 || clock != CLOCK_REALTIME)
+        printf("test_futex_locks: default condition clock is not CLOCK_REALTIME\n");
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    pthread_cond_t monotonic_cond;
+    pthread_cond_init(&monotonic_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(&turn_mutex);
+    deadline = short_deadline(CLOCK_REALTIME);
+    if (pthread_cond_timedwait(&turn_cond, &turn_mutex, &deadline) != -1 || errno != ETIMEDOUT)
+        printf("test_futex_locks: pthread_cond_timedwait did not time out\n");
+    deadline = short_deadline(CLOCK_MONOTONIC);
+    if (pthread_cond_timedwait(&monotonic_cond, &turn_mutex, &deadline) != -1 ||
+        errno != ETIMEDOUT)
+        printf("test_futex_locks: monotonic pthread_cond_timedwait did not time out\n");
+    pthread_mutex_unlock(&turn_mutex);
+    pthread_cond_destroy(&monotonic_cond);
+
+    printf("Futex-based locks test finished\n");
+}
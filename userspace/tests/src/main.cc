@@ -89,6 +89,8 @@ void test_threads()
 extern "C" void test_qsort();
 extern "C" void test_pipe();
 extern "C" void test_tlb_shootdown();
+extern "C" void test_futex_locks();
+extern "C" void test_epoll();
 
 void test_containers();
 
@@ -131,6 +133,9 @@ int main()
     test_delete_ipc();
     //tick();
     test_containers();
+    test_qsort();
+    test_futex_locks();
+    test_epoll();
     test_exception();
     read_test_file();
 
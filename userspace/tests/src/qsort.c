@@ -1,12 +1,40 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
-#include <time.h>
 #include <stdio.h>
 
 #define ARRAY_SIZE 1000
 
 int compare(const void * a, const void * b) {
-    return ( *(int*)a - *(int*)b );
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+struct Record {
+    uint32_t key;
+    uint32_t payload[2];
+};
+
+static int compare_records(const void *a, const void *b)
+{
+    uint32_t x = ((const struct Record *)a)->key, y = ((const struct Record *)b)->key;
+    return (x > y) - (x < y);
+}
+
+enum Pattern { PATTERN_RANDOM, PATTERN_SORTED, PATTERN_REVERSED, PATTERN_FEW_UNIQUE, PATTERN_COUNT };
+
+static int pattern_value(enum Pattern p, int i, int n)
+{
+    switch (p) {
+    case PATTERN_SORTED:
+        return i;
+    case PATTERN_REVERSED:
+        return n - i;
+    case PATTERN_FEW_UNIQUE:
+        return rand() % 8;
+    default:
+        return rand();
+    }
 }
 
 void test_qsort() {
@@ -14,14 +42,14 @@ void test_qsort() {
 
     static int srand_seed = 1234;
 
-    for (int i = 0; i < 100; ++i) {
+    for (int round = 0; round < 100; ++round) {
         srand(srand_seed);
         srand_seed = rand();
 
         int values[ARRAY_SIZE];
 
         for(int i = 0; i < ARRAY_SIZE; i++) {
-            values[i] = rand(); // Generate random numbers between 0 and 9999
+            values[i] = pattern_value(round % PATTERN_COUNT, i, ARRAY_SIZE);
         }
 
         qsort(values, ARRAY_SIZE, sizeof(int), compare);
@@ -35,4 +63,18 @@ void test_qsort() {
         //     printf("%d ", values[i]);
         // }
     }
-}
\ No newline at end of file
+
+    // Elements without a specialized swap, and the smallest arrays
+    static struct Record records[ARRAY_SIZE];
+    for (int n = 0; n < 40; ++n) {
+        for (int i = 0; i < n; ++i)
+            records[i] = (struct Record) {rand() % 16, {i, ~i}};
+
+        qsort(records, n, sizeof(struct Record), compare_records);
+
+        for (int i = 0; i < n - 1; ++i)
+            assert(records[i].key <= records[i + 1].key);
+        for (int i = 0; i < n; ++i)
+            assert(records[i].payload[1] == ~records[i].payload[0]);
+    }
+}